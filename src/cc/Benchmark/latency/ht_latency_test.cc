@@ -0,0 +1,409 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include "Common/Compat.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+
+#include "Common/Init.h"
+#include "Common/DiscreteRandomGeneratorFactory.h"
+#include "Common/Error.h"
+#include "Common/Random.h"
+#include "Common/Stopwatch.h"
+#include "Common/String.h"
+#include "Common/Thread.h"
+#include "Common/Time.h"
+#include "Common/Usage.h"
+
+#include "AsyncComm/Config.h"
+
+#include "Hypertable/Lib/Client.h"
+#include "Hypertable/Lib/KeySpec.h"
+
+using namespace Hypertable;
+using namespace Hypertable::Config;
+using namespace std;
+
+namespace {
+
+  const char *usage =
+    "Usage: ht_latency_test [options]\n\n"
+    "Description:\n"
+    "  Runs a series of workloads against a running Hypertable instance\n"
+    "  (e.g. one started with start-all-servers.sh local) and reports the\n"
+    "  throughput and the p50/p99/p999 latency of each one.  The workloads\n"
+    "  are run in the order given by --workload, so a write workload should\n"
+    "  precede the read workloads when starting from an empty table.\n"
+    "  Valid workloads are:\n\n"
+    "    seq-write     write keys sequentially, one range of keys per thread\n"
+    "    random-write  write keys chosen from --distribution\n"
+    "    point-read    look up a single row chosen from --distribution\n"
+    "    short-scan    scan --short-scan-rows rows starting at a chosen row\n"
+    "    long-scan     scan --long-scan-rows rows starting at a chosen row\n"
+    "    counter       increment a counter cell of a chosen row\n"
+    "    delete        delete the data cell of a chosen row\n\n"
+    "  Write latencies are measured per mutator flush, which happens every\n"
+    "  --flush-interval cells.  If --output is given, one JSON object per\n"
+    "  workload is appended to that file.\n\n"
+    "Options";
+
+  const char *default_workload =
+    "seq-write,random-write,point-read,short-scan,long-scan,counter,delete";
+
+  const char *schema =
+    "<Schema>"
+    "<AccessGroup name=\"default\">"
+    "<ColumnFamily><Name>data</Name></ColumnFamily>"
+    "</AccessGroup>"
+    "<AccessGroup name=\"counters\">"
+    "<ColumnFamily><Name>count</Name><Counter>true</Counter></ColumnFamily>"
+    "</AccessGroup>"
+    "</Schema>";
+
+  struct AppPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc(usage).add_options()
+        ("table", str()->default_value("LatencyTest"),
+            "Table to run against, created if it does not exist")
+        ("workload", str()->default_value(default_workload),
+            "Comma separated list of workloads to run")
+        ("threads", i32()->default_value(8), "Number of client threads")
+        ("operations", i32()->default_value(100000),
+            "Number of operations per workload, split across all threads")
+        ("key-count", i64()->default_value(1000000),
+            "Number of distinct row keys")
+        ("distribution", str()->default_value("uniform"),
+            "Key distribution, e.g. \"uniform\" or \"zipf --s=0.8\"")
+        ("value-size", i32()->default_value(100), "Size of written values")
+        ("short-scan-rows", i32()->default_value(10),
+            "Number of rows returned by a short scan")
+        ("long-scan-rows", i32()->default_value(1000),
+            "Number of rows returned by a long scan")
+        ("flush-interval", i32()->default_value(1),
+            "Number of cells buffered by a mutator before it is flushed")
+        ("seed", i32()->default_value(1234), "Random number generator seed")
+        ("output", str(), "File to which JSON results are appended")
+        ;
+    }
+  };
+
+  typedef Meta::list<AppPolicy, DefaultCommPolicy> Policies;
+
+  enum WorkloadType {
+    SEQ_WRITE, RANDOM_WRITE, POINT_READ, SHORT_SCAN, LONG_SCAN, COUNTER,
+    DELETE
+  };
+
+  struct Workload {
+    const char *name;
+    WorkloadType type;
+  };
+
+  Workload workloads[] = {
+    { "seq-write", SEQ_WRITE },
+    { "random-write", RANDOM_WRITE },
+    { "point-read", POINT_READ },
+    { "short-scan", SHORT_SCAN },
+    { "long-scan", LONG_SCAN },
+    { "counter", COUNTER },
+    { "delete", DELETE },
+    { 0, SEQ_WRITE }
+  };
+
+  struct TestSettings {
+    TablePtr table;
+    WorkloadType type;
+    int32_t threads;
+    int64_t operations;
+    int64_t key_count;
+    String distribution;
+    int32_t value_size;
+    int32_t short_scan_rows;
+    int32_t long_scan_rows;
+    int32_t flush_interval;
+    uint32_t seed;
+  };
+
+  /**
+   * State and samples of a single client thread.  Latencies are recorded
+   * in microseconds.
+   */
+  struct WorkerState {
+    WorkerState() : operations(0), cells(0), error(Error::OK) { }
+    vector<uint32_t> latencies;
+    int64_t operations;
+    int64_t cells;
+    int error;
+    String error_msg;
+  };
+
+  inline uint32_t elapsed_micros(const HiResTime &start) {
+    HiResTime now;
+    int64_t micros = ((int64_t)now.sec - (int64_t)start.sec) * 1000000LL
+        + ((int64_t)now.nsec - (int64_t)start.nsec) / 1000;
+    return micros < 0 ? 0 : (uint32_t)micros;
+  }
+
+  inline void format_row(char *buf, int64_t n) {
+    sprintf(buf, "%012llu", (Llu)n);
+  }
+
+  void run_worker(TestSettings *settings, int32_t id, WorkerState *state) {
+    DiscreteRandomGeneratorPtr generator;
+    TableMutatorPtr mutator;
+    ScanSpecBuilder ssb;
+    TableScannerPtr scanner;
+    Cell cell;
+    char row[32], end_row[32];
+    String value;
+    int64_t ops = settings->operations / settings->threads;
+    int64_t seq_base = (settings->key_count / settings->threads) * id;
+    int32_t pending = 0;
+    HiResTime start;
+
+    if (id < settings->operations % settings->threads)
+      ops++;
+
+    try {
+      generator = DiscreteRandomGeneratorFactory::create(settings->distribution);
+      // every worker must see the same hot keys, so the value permutation
+      // comes from the shared seed and only the sample stream differs
+      generator->set_seed(settings->seed);
+      generator->set_sample_seed(settings->seed + id + 1);
+      generator->set_value_count(settings->key_count);
+
+      value.resize(settings->value_size);
+      Random::fill_buffer_with_random_ascii((char *)value.data(),
+                                            settings->value_size);
+
+      if (settings->type == SEQ_WRITE || settings->type == RANDOM_WRITE ||
+          settings->type == COUNTER || settings->type == DELETE)
+        mutator = settings->table->create_mutator();
+
+      state->latencies.reserve(ops);
+
+      for (int64_t i = 0; i < ops; ++i) {
+
+        if (settings->type == SEQ_WRITE)
+          format_row(row, (seq_base + i) % settings->key_count);
+        else
+          format_row(row, generator->get_sample());
+
+        if (pending == 0)
+          start.reset();
+
+        switch (settings->type) {
+        case SEQ_WRITE:
+        case RANDOM_WRITE:
+          mutator->set(KeySpec(row, "data"), value.data(), value.size());
+          break;
+        case COUNTER:
+          mutator->set(KeySpec(row, "count"), "+1", 2);
+          break;
+        case DELETE:
+          mutator->set_delete(KeySpec(row, "data"));
+          break;
+        case POINT_READ:
+        case SHORT_SCAN:
+        case LONG_SCAN:
+          ssb.clear();
+          ssb.add_column("data");
+          if (settings->type == POINT_READ)
+            ssb.add_row(row);
+          else {
+            format_row(end_row, settings->key_count);
+            ssb.add_row_interval(row, true, end_row, false);
+            ssb.set_row_limit(settings->type == SHORT_SCAN ?
+                              settings->short_scan_rows :
+                              settings->long_scan_rows);
+          }
+          scanner = settings->table->create_scanner(ssb.get());
+          while (scanner->next(cell))
+            state->cells++;
+          scanner = 0;
+          state->latencies.push_back(elapsed_micros(start));
+          state->operations++;
+          continue;
+        }
+
+        state->cells++;
+        state->operations++;
+        if (++pending == settings->flush_interval || i == ops - 1) {
+          mutator->flush();
+          state->latencies.push_back(elapsed_micros(start));
+          pending = 0;
+        }
+      }
+    }
+    catch (Exception &e) {
+      state->error = e.code();
+      state->error_msg = e.what();
+    }
+  }
+
+  inline double percentile(const vector<uint32_t> &sorted, double p) {
+    if (sorted.empty())
+      return 0.0;
+    size_t index = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+    return (double)sorted[index] / 1000.0;
+  }
+
+  bool run_workload(TestSettings &settings, const char *name,
+                    ofstream &output) {
+    vector<WorkerState> states(settings.threads);
+    ThreadGroup threads;
+    vector<uint32_t> latencies;
+    int64_t operations = 0, cells = 0;
+    bool success = true;
+
+    Stopwatch stopwatch;
+    for (int32_t i=0; i<settings.threads; i++)
+      threads.create_thread(boost::bind(run_worker, &settings, i, &states[i]));
+    threads.join_all();
+    stopwatch.stop();
+
+    foreach(WorkerState &state, states) {
+      if (state.error != Error::OK) {
+        HT_ERRORF("%s: %s - %s", name, Error::get_text(state.error),
+                  state.error_msg.c_str());
+        success = false;
+      }
+      latencies.insert(latencies.end(), state.latencies.begin(),
+                       state.latencies.end());
+      operations += state.operations;
+      cells += state.cells;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    double elapsed = stopwatch.elapsed();
+    double ops_per_sec = elapsed > 0.0 ? (double)operations / elapsed : 0.0;
+    double p50 = percentile(latencies, 0.5);
+    double p99 = percentile(latencies, 0.99);
+    double p999 = percentile(latencies, 0.999);
+
+    printf("%s\n", name);
+    printf("     Elapsed time:  %.2f s\n", elapsed);
+    printf("       Operations:  %llu\n", (Llu)operations);
+    printf("            Cells:  %llu\n", (Llu)cells);
+    printf("       Throughput:  %.2f ops/s\n", ops_per_sec);
+    printf("  Latency p50/p99/p999:  %.3f / %.3f / %.3f ms\n", p50, p99, p999);
+    fflush(stdout);
+
+    if (output.is_open()) {
+      output << "{\"workload\":\"" << name << "\""
+             << ",\"threads\":" << settings.threads
+             << ",\"distribution\":\"" << settings.distribution << "\""
+             << ",\"key_count\":" << settings.key_count
+             << ",\"value_size\":" << settings.value_size
+             << ",\"flush_interval\":" << settings.flush_interval
+             << ",\"operations\":" << operations
+             << ",\"cells\":" << cells
+             << ",\"elapsed_sec\":" << elapsed
+             << ",\"ops_per_sec\":" << ops_per_sec
+             << ",\"p50_ms\":" << p50
+             << ",\"p99_ms\":" << p99
+             << ",\"p999_ms\":" << p999
+             << ",\"success\":" << (success ? "true" : "false") << "}\n";
+      output.flush();
+    }
+    return success;
+  }
+
+} // local namespace
+
+
+int main(int argc, char **argv) {
+  ClientPtr client;
+  NamespacePtr ns;
+  TestSettings settings;
+  vector<String> names;
+  ofstream output;
+  bool success = true;
+
+  try {
+    init_with_policies<Policies>(argc, argv);
+
+    settings.threads = get_i32("threads");
+    settings.operations = get_i32("operations");
+    settings.key_count = get_i64("key-count");
+    settings.distribution = get_str("distribution");
+    settings.value_size = get_i32("value-size");
+    settings.short_scan_rows = get_i32("short-scan-rows");
+    settings.long_scan_rows = get_i32("long-scan-rows");
+    settings.flush_interval = get_i32("flush-interval");
+    settings.seed = get_i32("seed");
+
+    if (settings.threads <= 0 || settings.key_count <= 0 ||
+        settings.flush_interval <= 0) {
+      cerr << "error: --threads, --key-count and --flush-interval must be "
+          "positive" << endl;
+      _exit(1);
+    }
+
+    Random::seed(settings.seed);
+
+    boost::split(names, get_str("workload"), boost::is_any_of(", "),
+                 boost::token_compress_on);
+
+    if (has("output")) {
+      output.open(get_str("output").c_str(), ios_base::out | ios_base::app);
+      if (!output.is_open()) {
+        cerr << "error: unable to open '" << get_str("output") << "'" << endl;
+        _exit(1);
+      }
+    }
+
+    client = new Hypertable::Client(System::locate_install_dir(argv[0]));
+    ns = client->open_namespace("/");
+    if (!ns->exists_table(get_str("table")))
+      ns->create_table(get_str("table"), schema);
+    settings.table = ns->open_table(get_str("table"));
+  }
+  catch (Hypertable::Exception &e) {
+    cerr << "error: " << Error::get_text(e.code()) << " - " << e.what() << endl;
+    _exit(1);
+  }
+
+  foreach(const String &name, names) {
+    if (name.empty())
+      continue;
+    Workload *workload = workloads;
+    for (; workload->name; ++workload)
+      if (name == workload->name)
+        break;
+    if (workload->name == 0) {
+      cerr << "error: unknown workload '" << name << "'" << endl;
+      _exit(1);
+    }
+    settings.type = workload->type;
+    if (!run_workload(settings, workload->name, output))
+      success = false;
+  }
+
+  _exit(success ? 0 : 1); // don't bother with static objects.
+}
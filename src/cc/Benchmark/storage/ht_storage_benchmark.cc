@@ -0,0 +1,502 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include "Common/Compat.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+
+#include "Common/Init.h"
+#include "Common/BloomFilter.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Error.h"
+#include "Common/InetAddr.h"
+#include "Common/Random.h"
+#include "Common/Serialization.h"
+#include "Common/Stopwatch.h"
+#include "Common/String.h"
+#include "Common/System.h"
+#include "Common/Thread.h"
+#include "Common/Usage.h"
+
+#include "AsyncComm/Config.h"
+#include "AsyncComm/ConnectionManager.h"
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/Schema.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "Hypertable/RangeServer/CellCache.h"
+#include "Hypertable/RangeServer/CellStoreFactory.h"
+#include "Hypertable/RangeServer/CellStoreV7.h"
+#include "Hypertable/RangeServer/FileBlockCache.h"
+#include "Hypertable/RangeServer/Global.h"
+#include "Hypertable/RangeServer/KeyCompressorPrefix.h"
+#include "Hypertable/RangeServer/KeyDecompressorPrefix.h"
+#include "Hypertable/RangeServer/MemoryTracker.h"
+#include "Hypertable/RangeServer/MergeScannerAccessGroup.h"
+#include "Hypertable/RangeServer/ScanContext.h"
+
+using namespace Hypertable;
+using namespace Hypertable::Config;
+using namespace std;
+
+namespace {
+
+  const char *usage =
+    "Usage: ht_storage_benchmark [options]\n\n"
+    "Description:\n"
+    "  Times the RangeServer storage components in isolation.  The components\n"
+    "  to run are given by --component, which defaults to all of them:\n\n"
+    "    cellcache        CellCache::add and a full scan of the cache\n"
+    "    cellstore        CellStore write and full scan, once per compressor\n"
+    "                     listed in --compressors (needs a running DFS broker)\n"
+    "    mergescanner     MergeScannerAccessGroup over --merge-inputs caches\n"
+    "    bloomfilter      BloomFilter::may_contain for present and absent keys\n"
+    "    keycompressor    KeyCompressorPrefix encode and KeyDecompressorPrefix\n"
+    "                     decode\n"
+    "    fileblockcache   FileBlockCache checkout/checkin from --threads threads\n\n"
+    "Options";
+
+  const char *default_components =
+    "cellcache,cellstore,mergescanner,bloomfilter,keycompressor,fileblockcache";
+
+  const char *schema_str =
+    "<Schema>"
+    "<AccessGroup name=\"default\">"
+    "<ColumnFamily id=\"1\"><Name>data</Name></ColumnFamily>"
+    "</AccessGroup>"
+    "</Schema>";
+
+  struct AppPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc(usage).add_options()
+        ("component", str()->default_value(default_components),
+            "Comma separated list of components to benchmark")
+        ("cells", i32()->default_value(1000000), "Number of cells to use")
+        ("value-size", i32()->default_value(100), "Size of cell values")
+        ("compressors", str()->default_value("none,bmz,zlib,lzo,quicklz,snappy"),
+            "Comma separated list of block compressors for the cellstore "
+            "benchmark")
+        ("merge-inputs", i32()->default_value(8),
+            "Number of scanners merged by the mergescanner benchmark")
+        ("threads", i32()->default_value(8),
+            "Number of threads for the fileblockcache benchmark")
+        ("block-count", i32()->default_value(1000),
+            "Number of blocks held in the fileblockcache benchmark")
+        ("block-size", i32()->default_value(65536),
+            "Size of blocks held in the fileblockcache benchmark")
+        ("dir", str()->default_value("/ht_storage_benchmark"),
+            "DFS directory for cellstore files")
+        ("seed", i32()->default_value(1234), "Random number generator seed")
+        ;
+    }
+  };
+
+  typedef Meta::list<AppPolicy, DefaultCommPolicy> Policies;
+
+  /**
+   * Serialized keys and the value shared by all of the benchmarks.  Keys are
+   * generated in sorted order, #order holds a random permutation of them.
+   */
+  struct TestData {
+    DynamicBuffer key_buf;
+    vector<SerializedKey> keys;
+    vector<uint32_t> order;
+    DynamicBuffer value_buf;
+    ByteString value;
+    SchemaPtr schema;
+  };
+
+  void report(const char *name, size_t count, Stopwatch &stopwatch,
+              const char *unit = "cells") {
+    double elapsed = stopwatch.elapsed();
+    printf("%-32s %10llu %s  %8.3f s  %12.2f %s/s\n", name, (Llu)count, unit,
+           elapsed, elapsed > 0.0 ? (double)count / elapsed : 0.0, unit);
+    fflush(stdout);
+  }
+
+  void create_test_data(TestData &data, int32_t cells, int32_t value_size) {
+    char row[32];
+    SerializedKey serkey;
+    vector<size_t> offsets;
+
+    // create_key_and_append() may reallocate the buffer, so keys are
+    // recorded as offsets and resolved once the buffer is complete
+    offsets.reserve(cells);
+    data.key_buf.reserve((size_t)cells * 32);
+    for (int32_t i = 0; i < cells; ++i) {
+      offsets.push_back(data.key_buf.fill());
+      sprintf(row, "%012d", i);
+      create_key_and_append(data.key_buf, FLAG_INSERT, row, 1, "", i+1, i+1);
+    }
+
+    data.keys.reserve(cells);
+    foreach(size_t offset, offsets) {
+      serkey.ptr = data.key_buf.base + offset;
+      data.keys.push_back(serkey);
+    }
+
+    data.order.resize(cells);
+    for (int32_t i = 0; i < cells; ++i)
+      data.order[i] = i;
+    for (int32_t i = cells - 1; i > 0; --i)
+      swap(data.order[i], data.order[Random::number32() % (i+1)]);
+
+    data.value_buf.reserve(value_size + 8);
+    Serialization::encode_vi32(&data.value_buf.ptr, value_size);
+    Random::fill_buffer_with_random_ascii((char *)data.value_buf.ptr,
+                                          value_size);
+    data.value_buf.ptr += value_size;
+    data.value.ptr = data.value_buf.base;
+
+    data.schema = Schema::new_instance(schema_str, strlen(schema_str));
+    if (!data.schema->is_valid())
+      HT_THROWF(Error::BAD_SCHEMA, "%s", data.schema->get_error_string());
+  }
+
+  ScanContextPtr create_scan_context(TestData &data, RangeSpec &range,
+                                     ScanSpecBuilder &ssb) {
+    range.start_row = "";
+    range.end_row = Key::END_ROW_MARKER;
+    return new ScanContext(TIMESTAMP_MAX, &ssb.get(), &range, data.schema);
+  }
+
+  size_t drain(CellListScanner *scanner) {
+    Key key;
+    ByteString value;
+    size_t count = 0;
+    while (scanner->get(key, value)) {
+      count++;
+      scanner->forward();
+    }
+    return count;
+  }
+
+  void bench_cellcache(TestData &data) {
+    CellCachePtr cache = new CellCache();
+    RangeSpec range;
+    ScanSpecBuilder ssb;
+    ScanContextPtr scan_ctx = create_scan_context(data, range, ssb);
+    Key key;
+    size_t count;
+
+    Stopwatch stopwatch;
+    foreach(uint32_t i, data.order) {
+      key.load(data.keys[i]);
+      cache->add(key, data.value);
+    }
+    stopwatch.stop();
+    report("cellcache add", data.keys.size(), stopwatch);
+
+    stopwatch.reset();
+    stopwatch.start();
+    {
+      CellListScannerPtr scanner = cache->create_scanner(scan_ctx);
+      count = drain(scanner.get());
+    }
+    stopwatch.stop();
+    HT_ASSERT(count == data.keys.size());
+    report("cellcache scan", count, stopwatch);
+  }
+
+  void bench_cellstore(TestData &data, const String &dir,
+                       const String &compressor) {
+    TableIdentifier table_id("0");
+    String name = dir + "/cs-" + compressor;
+    PropertiesPtr cs_props = new Properties();
+    CellStorePtr cs;
+    RangeSpec range;
+    ScanSpecBuilder ssb;
+    ScanContextPtr scan_ctx = create_scan_context(data, range, ssb);
+    Key key;
+    size_t count;
+
+    cs_props->set("compressor", compressor);
+
+    Stopwatch stopwatch;
+    cs = new CellStoreV7(Global::dfs.get(), data.schema.get());
+    cs->create(name.c_str(), data.keys.size(), cs_props, &table_id);
+    foreach(const SerializedKey &serkey, data.keys) {
+      key.load(serkey);
+      cs->add(key, data.value);
+    }
+    cs->finalize(&table_id);
+    stopwatch.stop();
+    report(format("cellstore write (%s)", compressor.c_str()).c_str(),
+           data.keys.size(), stopwatch);
+    printf("%-32s %10llu bytes  ratio %.3f\n", "", (Llu)cs->disk_usage(),
+           cs->compression_ratio());
+    cs = 0;
+
+    stopwatch.reset();
+    stopwatch.start();
+    cs = CellStoreFactory::open(name, "", Key::END_ROW_MARKER);
+    {
+      CellListScannerPtr scanner = cs->create_scanner(scan_ctx);
+      count = drain(scanner.get());
+    }
+    stopwatch.stop();
+    HT_ASSERT(count == data.keys.size());
+    report(format("cellstore scan (%s)", compressor.c_str()).c_str(),
+           count, stopwatch);
+    cs = 0;
+
+    Global::dfs->remove(name);
+  }
+
+  void bench_mergescanner(TestData &data, int32_t inputs) {
+    vector<CellCachePtr> caches(inputs);
+    RangeSpec range;
+    ScanSpecBuilder ssb;
+    ScanContextPtr scan_ctx = create_scan_context(data, range, ssb);
+    String table_name = "0";
+    Key key;
+    size_t count;
+
+    for (int32_t i = 0; i < inputs; ++i)
+      caches[i] = new CellCache();
+    for (size_t i = 0; i < data.keys.size(); ++i) {
+      key.load(data.keys[i]);
+      caches[i % inputs]->add(key, data.value);
+    }
+
+    Stopwatch stopwatch;
+    {
+      MergeScannerAccessGroup scanner(table_name, scan_ctx);
+      for (int32_t i = 0; i < inputs; ++i)
+        scanner.add_scanner(caches[i]->create_scanner(scan_ctx));
+      count = drain(&scanner);
+    }
+    stopwatch.stop();
+    HT_ASSERT(count == data.keys.size());
+    report(format("mergescanner (%d inputs)", (int)inputs).c_str(), count,
+           stopwatch);
+  }
+
+  void bench_bloomfilter(TestData &data) {
+    BloomFilter filter(data.keys.size(), 0.01);
+    Key key;
+    size_t hits = 0;
+    char absent[32];
+
+    foreach(const SerializedKey &serkey, data.keys) {
+      key.load(serkey);
+      filter.insert(key.row, key.len_row());
+    }
+
+    Stopwatch stopwatch;
+    foreach(uint32_t i, data.order) {
+      key.load(data.keys[i]);
+      if (filter.may_contain(key.row, key.len_row()))
+        hits++;
+    }
+    stopwatch.stop();
+    HT_ASSERT(hits == data.keys.size());
+    report("bloomfilter may_contain (hit)", data.keys.size(), stopwatch,
+           "lookups");
+
+    hits = 0;
+    stopwatch.reset();
+    stopwatch.start();
+    for (size_t i = 0; i < data.keys.size(); ++i) {
+      sprintf(absent, "x%011d", (int)data.order[i]);
+      if (filter.may_contain(absent, 12))
+        hits++;
+    }
+    stopwatch.stop();
+    report("bloomfilter may_contain (miss)", data.keys.size(), stopwatch,
+           "lookups");
+    printf("%-32s false positive rate %.4f\n", "",
+           (double)hits / (double)data.keys.size());
+  }
+
+  void bench_keycompressor(TestData &data) {
+    KeyCompressorPrefix compressor;
+    KeyDecompressorPrefix decompressor;
+    DynamicBuffer buf(data.key_buf.fill());
+    Key key;
+    size_t count = 0;
+
+    Stopwatch stopwatch;
+    compressor.reset();
+    foreach(const SerializedKey &serkey, data.keys) {
+      key.load(serkey);
+      compressor.add(key);
+      buf.ensure(compressor.length());
+      compressor.write(buf.ptr);
+      buf.ptr += compressor.length();
+    }
+    stopwatch.stop();
+    report("keycompressor encode", data.keys.size(), stopwatch, "keys");
+    printf("%-32s %10llu -> %llu bytes\n", "", (Llu)data.key_buf.fill(),
+           (Llu)buf.fill());
+
+    stopwatch.reset();
+    stopwatch.start();
+    decompressor.reset();
+    for (const uint8_t *ptr = buf.base; ptr < buf.ptr; ++count) {
+      ptr = decompressor.add(ptr);
+      decompressor.load(key);
+    }
+    stopwatch.stop();
+    HT_ASSERT(count == data.keys.size());
+    report("keycompressor decode", count, stopwatch, "keys");
+  }
+
+  void fileblockcache_worker(FileBlockCache *cache, int32_t block_count,
+                             int32_t iterations, uint32_t seed,
+                             size_t *hitsp) {
+    uint8_t *block;
+    uint32_t length;
+    size_t hits = 0;
+
+    for (int32_t i = 0; i < iterations; ++i) {
+      seed = seed * 1103515245 + 12345;
+      int32_t n = (int32_t)((seed >> 8) % block_count);
+      if (cache->checkout(n % 16, (uint32_t)(n / 16), &block, &length)) {
+        cache->checkin(n % 16, (uint32_t)(n / 16));
+        hits++;
+      }
+    }
+    *hitsp = hits;
+  }
+
+  void bench_fileblockcache(int32_t threads, int32_t block_count,
+                            int32_t block_size, int32_t cells) {
+    int64_t memory = (int64_t)block_count * block_size;
+    FileBlockCache cache(memory, memory, false);
+    vector<size_t> hits(threads);
+    ThreadGroup thread_group;
+    size_t total_hits = 0;
+
+    for (int32_t n = 0; n < block_count; ++n) {
+      uint8_t *block = new uint8_t [block_size];
+      memset(block, 0, block_size);
+      if (!cache.insert(n % 16, (uint32_t)(n / 16), block, block_size))
+        delete [] block;
+    }
+
+    Stopwatch stopwatch;
+    for (int32_t i = 0; i < threads; ++i)
+      thread_group.create_thread(boost::bind(fileblockcache_worker, &cache,
+          block_count, cells / threads, (uint32_t)Random::number32(),
+          &hits[i]));
+    thread_group.join_all();
+    stopwatch.stop();
+
+    foreach(size_t h, hits)
+      total_hits += h;
+    report(format("fileblockcache (%d threads)", (int)threads).c_str(),
+           (size_t)(cells / threads) * threads, stopwatch, "checkouts");
+    printf("%-32s hit rate %.4f\n", "",
+           (double)total_hits / (double)((cells / threads) * threads));
+  }
+
+  void connect_to_dfs(const String &dir) {
+    struct sockaddr_in addr;
+    ConnectionManagerPtr conn_mgr = new ConnectionManager();
+    DfsBroker::Client *client;
+
+    InetAddr::initialize(&addr, "localhost", get_i16("DfsBroker.Port"));
+    client = new DfsBroker::Client(conn_mgr, addr, 15000);
+    Global::dfs = client;
+    if (!client->wait_for_connection(15000))
+      HT_THROW(Error::REQUEST_TIMEOUT, "Unable to connect to DFS broker");
+    client->mkdirs(dir);
+  }
+
+} // local namespace
+
+
+int main(int argc, char **argv) {
+  TestData data;
+  vector<String> components;
+  vector<String> compressors;
+
+  try {
+    init_with_policies<Policies>(argc, argv);
+
+    int32_t cells = get_i32("cells");
+    int32_t threads = get_i32("threads");
+    int32_t merge_inputs = get_i32("merge-inputs");
+    int32_t block_count = get_i32("block-count");
+    String dir = get_str("dir");
+
+    if (cells <= 0 || threads <= 0 || merge_inputs <= 0 || block_count <= 0) {
+      cerr << "error: --cells, --threads, --merge-inputs and --block-count "
+          "must be positive" << endl;
+      _exit(1);
+    }
+
+    Random::seed(get_i32("seed"));
+
+    boost::split(components, get_str("component"), boost::is_any_of(", "),
+                 boost::token_compress_on);
+    boost::split(compressors, get_str("compressors"), boost::is_any_of(", "),
+                 boost::token_compress_on);
+
+    Global::memory_tracker = new MemoryTracker(0, 0);
+
+    create_test_data(data, cells, get_i32("value-size"));
+
+    foreach(const String &component, components) {
+      if (component.empty())
+        continue;
+      if (component == "cellcache")
+        bench_cellcache(data);
+      else if (component == "cellstore") {
+        if (!Global::dfs)
+          connect_to_dfs(dir);
+        foreach(const String &compressor, compressors) {
+          if (!compressor.empty())
+            bench_cellstore(data, dir, compressor);
+        }
+      }
+      else if (component == "mergescanner")
+        bench_mergescanner(data, merge_inputs);
+      else if (component == "bloomfilter")
+        bench_bloomfilter(data);
+      else if (component == "keycompressor")
+        bench_keycompressor(data);
+      else if (component == "fileblockcache")
+        bench_fileblockcache(threads, block_count, get_i32("block-size"),
+                             cells);
+      else {
+        cerr << "error: unknown component '" << component << "'" << endl;
+        _exit(1);
+      }
+    }
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  _exit(0); // don't bother with static objects.
+}
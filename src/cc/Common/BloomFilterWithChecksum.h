@@ -37,26 +37,34 @@ namespace Hypertable {
 
 /**
  * A space-efficent probabilistic set for membership test, false postives
- * are possible, but false negatives are not.
+ * are possible, but false negatives are not.  A blocked filter sets all of
+ * an item's bits within one 32-byte bucket, so each lookup touches a single
+ * cache line at the cost of a slightly higher false positive rate.
  */
 template <class HasherT = MurmurHash2>
 class BasicBloomFilterWithChecksum {
 public:
-  BasicBloomFilterWithChecksum(size_t items_estimate, float false_positive_prob) {
+
+  /** Bit layout; BLOCKED keeps all of an item's bits in one bucket */
+  enum Layout { STANDARD, BLOCKED };
+
+  BasicBloomFilterWithChecksum(size_t items_estimate, float false_positive_prob,
+                               Layout layout=STANDARD)
+    : m_blocked(layout == BLOCKED) {
     m_items_actual = 0;
     m_items_estimate = items_estimate;
     m_false_positive_prob = false_positive_prob;
     double num_hashes = -std::log(m_false_positive_prob) / std::log(2);
     m_num_hash_functions = (size_t)num_hashes;
     m_num_bits = (size_t)(m_items_estimate * num_hashes / std::log(2));
+    // blocked filters need about 10% more bits for a similar rate
+    if (m_blocked)
+      m_num_bits += m_num_bits / 10;
     if (m_num_bits == 0) {
       HT_THROWF(Error::EMPTY_BLOOMFILTER, "Num elements=%lu false_positive_prob=%.3f",
                 (Lu)items_estimate, false_positive_prob);
     }
-    m_num_bytes = (m_num_bits / CHAR_BIT) + (m_num_bits % CHAR_BIT ? 1 : 0);
-    m_bloom_base = new uint8_t[4+m_num_bytes+HT_IO_ALIGNMENT_PADDING(4+m_num_bytes)];
-    m_bloom_bits = m_bloom_base + 4;
-    memset(m_bloom_base, 0, 4+m_num_bytes+HT_IO_ALIGNMENT_PADDING(4+m_num_bytes));
+    allocate();
 
     HT_DEBUG_OUT <<"num funcs="<< m_num_hash_functions
                  <<" num bits="<< m_num_bits <<" num bytes="<< m_num_bytes
@@ -64,7 +72,9 @@ public:
                  << HT_END;
   }
 
-  BasicBloomFilterWithChecksum(size_t items_estimate, float bits_per_item, size_t num_hashes) {
+  BasicBloomFilterWithChecksum(size_t items_estimate, float bits_per_item,
+                               size_t num_hashes, Layout layout=STANDARD)
+    : m_blocked(layout == BLOCKED) {
     m_items_actual = 0;
     m_items_estimate = items_estimate;
     m_false_positive_prob = 0.0;
@@ -74,10 +84,7 @@ public:
       HT_THROWF(Error::EMPTY_BLOOMFILTER, "Num elements=%lu bits_per_item=%.3f",
                 (Lu)items_estimate, bits_per_item);
     }
-    m_num_bytes = (m_num_bits / CHAR_BIT) + (m_num_bits % CHAR_BIT ? 1 : 0);
-    m_bloom_base = new uint8_t[4+m_num_bytes+HT_IO_ALIGNMENT_PADDING(4+m_num_bytes)];
-    m_bloom_bits = m_bloom_base + 4;
-    memset(m_bloom_base, 0, 4+m_num_bytes+HT_IO_ALIGNMENT_PADDING(4+m_num_bytes));
+    allocate();
 
     HT_DEBUG_OUT <<"num funcs="<< m_num_hash_functions
                  <<" num bits="<< m_num_bits <<" num bytes="<< m_num_bytes
@@ -86,7 +93,8 @@ public:
   }
 
   BasicBloomFilterWithChecksum(size_t items_estimate, size_t items_actual,
-                 int64_t length, size_t num_hashes) {
+                 int64_t length, size_t num_hashes, Layout layout=STANDARD)
+    : m_blocked(layout == BLOCKED) {
     m_items_actual = items_actual;
     m_items_estimate = items_estimate;
     m_false_positive_prob = 0.0;
@@ -96,10 +104,7 @@ public:
       HT_THROWF(Error::EMPTY_BLOOMFILTER, "Estimated items=%lu actual items=%lu length=%lld num hashes=%lu",
                 (Lu)items_estimate, (Lu)items_actual, (Lld)length, (Lu)num_hashes);
     }
-    m_num_bytes = (m_num_bits / CHAR_BIT) + (m_num_bits % CHAR_BIT ? 1 : 0);
-    m_bloom_base = new uint8_t[4+m_num_bytes+HT_IO_ALIGNMENT_PADDING(4+m_num_bytes)];
-    m_bloom_bits = m_bloom_base + 4;
-    memset(m_bloom_base, 0, 4+m_num_bytes+HT_IO_ALIGNMENT_PADDING(4+m_num_bytes));
+    allocate();
 
     HT_DEBUG_OUT <<"num funcs="<< m_num_hash_functions
                  <<" num bits="<< m_num_bits <<" num bytes="<< m_num_bytes
@@ -108,7 +113,7 @@ public:
   }
 
   ~BasicBloomFilterWithChecksum() {
-    delete[] m_bloom_base;
+    delete[] m_bloom_alloc;
   }
 
   /* XXX/review static functions to expose the bloom filter parameters, given
@@ -120,6 +125,12 @@ public:
   void insert(const void *key, size_t len) {
     uint32_t hash = len;
 
+    if (m_blocked) {
+      insert_blocked(key, len);
+      m_items_actual++;
+      return;
+    }
+
     for (size_t i = 0; i < m_num_hash_functions; ++i) {
       hash = m_hasher(key, len, hash) % m_num_bits;
       m_bloom_bits[hash / CHAR_BIT] |= (1 << (hash % CHAR_BIT));
@@ -136,6 +147,9 @@ public:
     uint8_t byte_mask;
     uint8_t byte;
 
+    if (m_blocked)
+      return may_contain_blocked(key, len);
+
     for (size_t i = 0; i < m_num_hash_functions; ++i) {
       hash = m_hasher(key, len, hash) % m_num_bits;
       byte = m_bloom_bits[hash / CHAR_BIT];
@@ -187,7 +201,73 @@ public:
 
   size_t get_items_actual() { return m_items_actual; }
 
+  bool is_blocked() { return m_blocked; }
+
+  /**
+   * Number of bits set for each item in a blocked filter, one in each
+   * 32-bit word of a bucket
+   */
+  enum { BLOCKED_NUM_HASHES = 8, BUCKET_BYTES = 32 };
+
 private:
+
+  /**
+   * Allocates the zeroed bit array behind a 4 byte checksum.  The bit array
+   * starts on a 64-byte boundary so that a bucket of a blocked filter never
+   * spans two cache lines.  Blocked filters are rounded up to a whole
+   * number of buckets.
+   */
+  void allocate() {
+    if (m_blocked) {
+      size_t bucket_bits = BUCKET_BYTES * CHAR_BIT;
+      m_num_bits = ((m_num_bits + bucket_bits - 1) / bucket_bits) * bucket_bits;
+      m_num_hash_functions = BLOCKED_NUM_HASHES;
+    }
+    m_num_bytes = (m_num_bits / CHAR_BIT) + (m_num_bits % CHAR_BIT ? 1 : 0);
+    size_t total = 4+m_num_bytes+HT_IO_ALIGNMENT_PADDING(4+m_num_bytes);
+    m_bloom_alloc = new uint8_t[total + 64];
+    uintptr_t bits = ((uintptr_t)m_bloom_alloc + 4 + 63) & ~(uintptr_t)63;
+    m_bloom_base = (uint8_t *)(bits - 4);
+    m_bloom_bits = m_bloom_base + 4;
+    memset(m_bloom_base, 0, total);
+  }
+
+  /**
+   * Returns the bucket for a blocked filter item and computes the hash that
+   * selects its bits.  The bucket is chosen by scaling the first hash into
+   * the bucket count, which avoids a division.
+   */
+  uint32_t *bucket(const void *key, size_t len, uint32_t *hashp) const {
+    uint32_t hash = m_hasher(key, len, len);
+    size_t num_buckets = m_num_bytes / BUCKET_BYTES;
+    size_t index = (size_t)(((uint64_t)hash * (uint64_t)num_buckets) >> 32);
+    *hashp = m_hasher(key, len, hash);
+    return (uint32_t *)(m_bloom_bits + index * BUCKET_BYTES);
+  }
+
+  static uint32_t word_bit(uint32_t hash, size_t i) {
+    static const uint32_t salt[BLOCKED_NUM_HASHES] = { 0x47b6137bU,
+        0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU,
+        0x9efc4947U, 0x5c6bfb31U };
+    return (uint32_t)1 << ((hash * salt[i]) >> 27);
+  }
+
+  void insert_blocked(const void *key, size_t len) {
+    uint32_t hash;
+    uint32_t *words = bucket(key, len, &hash);
+    for (size_t i = 0; i < BLOCKED_NUM_HASHES; ++i)
+      words[i] |= word_bit(hash, i);
+  }
+
+  bool may_contain_blocked(const void *key, size_t len) const {
+    uint32_t hash;
+    const uint32_t *words = bucket(key, len, &hash);
+    uint32_t missing = 0;
+    for (size_t i = 0; i < BLOCKED_NUM_HASHES; ++i)
+      missing |= word_bit(hash, i) & ~words[i];
+    return missing == 0;
+  }
+
   HasherT    m_hasher;
   size_t     m_items_estimate;
   size_t     m_items_actual;
@@ -197,6 +277,8 @@ private:
   size_t     m_num_bytes;
   uint8_t   *m_bloom_bits;
   uint8_t   *m_bloom_base;
+  uint8_t   *m_bloom_alloc;
+  bool       m_blocked;
 };
 
 typedef BasicBloomFilterWithChecksum<> BloomFilterWithChecksum;
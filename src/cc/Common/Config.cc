@@ -246,11 +246,31 @@ void DefaultPolicy::init_options() {
         "Number of Hyperspace Replica worker threads created")
     ("Hyperspace.Replica.Reactors", i32(),
         "Number of Hyperspace Master communication reactor threads created")
+    ("Hyperspace.Replica.Reads.HeartbeatInterval", i32()->default_value(1000),
+        "Interval (millisec) at which the replication master records a "
+        "heartbeat that replicas use to bound the staleness of reads they serve")
+    ("Hyperspace.Replica.Reads.FenceWait", i32()->default_value(100),
+        "Time (millisec) a replica waits to apply the mutations a client has "
+        "already seen committed before it refers the client's read to the "
+        "master")
     ("Hyperspace.Replica.Dir", str(), "Root of hyperspace file and directory "
         "heirarchy in local filesystem (if relative path, then is relative to "
         "the Hypertable data directory root)")
     ("Hyperspace.KeepAlive.Interval", i32()->default_value(10000),
         "Hyperspace Keepalive interval (see Chubby paper)")
+    ("Hyperspace.Client.Cache.MaxMemory", i64()->default_value(0),
+        "Memory limit for the Hyperspace client-side attribute and directory "
+        "listing cache (0 disables the cache)")
+    ("Hyperspace.Client.Cache.TTL", i32()->default_value(1000),
+        "Time (millisec) the client cache keeps entries for nodes that no "
+        "handle in the session watches for changes (0 only caches watched "
+        "nodes)")
+    ("Hyperspace.Client.ReplicaReads", boo()->default_value(false),
+        "Serve read-only by-name requests (attr_get, attr_exists, exists, "
+        "readdir_attr, readpath_attr) from Hyperspace replicas")
+    ("Hyperspace.Client.ReplicaReads.MaxStaleness", i32()->default_value(5000),
+        "Maximum staleness (millisec) of reads served by a Hyperspace replica; "
+        "reads fall back to the master when a replica lags by more than this")
     ("Hyperspace.Lease.Interval", i32()->default_value(60000),
         "Hyperspace Lease interval (see Chubby paper)")
     ("Hyperspace.GracePeriod", i32()->default_value(60000),
@@ -274,8 +294,31 @@ void DefaultPolicy::init_options() {
     ("Hypertable.LoadBalancer.LoadavgThreshold", f64()->default_value(0.25),
         "Servers with loadavg above this much above the mean will be considered by the "
         "load balancer to be overloaded")
+    ("Hypertable.LoadBalancer.CostBased", boo()->default_value(false),
+        "Use the cost model (see Hypertable.LoadBalancer.Cost.*) instead of "
+        "loadavg when distributing load")
+    ("Hypertable.LoadBalancer.Cost.CpuWeight", f64()->default_value(1.0),
+        "Weight of per-range cell and operation rates in the balancer cost model")
+    ("Hypertable.LoadBalancer.Cost.DiskWeight", f64()->default_value(1.0),
+        "Weight of per-range disk read byte rates in the balancer cost model")
+    ("Hypertable.LoadBalancer.Cost.NetworkWeight", f64()->default_value(1.0),
+        "Weight of per-range scanned and written byte rates in the balancer "
+        "cost model")
+    ("Hypertable.LoadBalancer.Cost.Tolerance", f64()->default_value(0.2),
+        "Servers whose modeled cost exceeds the mean by more than this "
+        "fraction are considered overloaded")
+    ("Hypertable.LoadBalancer.Cost.MoveCost", f64()->default_value(0.02),
+        "Penalty, as a fraction of the mean server cost, charged for each "
+        "range move; moves that gain less are not made")
+    ("Hypertable.LoadBalancer.Cost.MaxMoves", i32()->default_value(100),
+        "Maximum number of range moves in a cost-based balance plan")
     ("Hypertable.HqlInterpreter.Mutator.NoLogSync", boo()->default_value(false),
         "Suspends CommitLog sync operation on updates until command completion")
+    ("Hypertable.HqlInterpreter.LoadData.ParseThreads", i32()->default_value(4),
+        "Number of threads used to parse LOAD DATA INFILE input")
+    ("Hypertable.HqlInterpreter.LoadData.ChunkSize", i32()->default_value(4*M),
+        "Amount of LOAD DATA INFILE input (bytes) handed to a parse thread at "
+        "a time")
     ("Hypertable.Mutator.FlushDelay", i32()->default_value(0), "Number of "
         "milliseconds to wait prior to flushing scatter buffers (for testing)")
     ("Hypertable.Mutator.ScatterBuffer.FlushLimit.PerServer",
@@ -298,6 +341,23 @@ void DefaultPolicy::init_options() {
         "Number of Hypertable Master communication reactor threads created")
     ("Hypertable.Master.Gc.Interval", i32()->default_value(300000),
         "Garbage collection interval in milliseconds by Master")
+    ("Hypertable.Master.Gc.FullScanInterval", i32()->default_value(12),
+        "Number of incremental garbage collection passes between passes that "
+        "scan all of METADATA")
+    ("Hypertable.Master.Gc.Incremental.Overlap", i32()->default_value(600000),
+        "Incremental garbage collection passes rescan METADATA changes made "
+        "this many milliseconds before the previous pass started")
+    ("Hypertable.Master.Gc.RemovalThreads", i32()->default_value(8),
+        "Number of threads used to remove unreferenced files from the DFS")
+    ("Hypertable.Master.Recovery.GracePeriod", i32()->default_value(120000),
+        "Milliseconds to wait for a disconnected RangeServer to come back "
+        "before its ranges are recovered onto the other servers")
+    ("Hypertable.Master.Recovery.ReadThreads", i32()->default_value(8),
+        "Number of threads used to decompress and partition the commit log "
+        "of a failed RangeServer during recovery")
+    ("Hypertable.Master.Recovery.UpdateBufferSize", i32()->default_value(1*M),
+        "Amount of recovered updates (bytes) accumulated for a RangeServer "
+        "before they are sent in a replay request")
     ("Hypertable.Master.Locations.IncludeMasterHash", boo()->default_value(false),
         "Includes master hash (host:port) in RangeServer location id")
     ("Hypertable.Master.Split.SoftLimitEnabled", boo()->default_value(true),
@@ -330,8 +390,17 @@ void DefaultPolicy::init_options() {
         "CellStores in which merges will be considered")
     ("Hypertable.RangeServer.CellStore.Merge.RunLengthThreshold", i32()->default_value(10),
         "Trigger a merge if an adjacent run of merge candidate CellStores exceeds this length")
+    ("Hypertable.RangeServer.AccessGroup.DefaultCompactionPolicy",
+        str()->default_value("default"), "Default compaction policy "
+        "(default|size-tiered|leveled) for access groups that do not "
+        "specify one")
     ("Hypertable.RangeServer.CellStore.DefaultBlockSize",
         i32()->default_value(64*KiB), "Default block size for cell stores")
+    ("Hypertable.RangeServer.CellStore.IndexPartitionSize",
+        i32()->default_value(64*KiB), "Target size of the block index "
+        "partitions of a cell store.  Indexes larger than this are split into "
+        "partitions that are loaded on demand through the block cache "
+        "(0 disables partitioning)")
     ("Hypertable.RangeServer.Data.DefaultReplication",
         i32()->default_value(-1), "Default replication for data")
     ("Hypertable.RangeServer.CellStore.DefaultCompressor",
@@ -340,6 +409,10 @@ void DefaultPolicy::init_options() {
         str()->default_value("rows"), "Default bloom filter for cell stores")
     ("Hypertable.RangeServer.CellStore.SkipNotFound",
         boo()->default_value(false), "Skip over cell stores that are non-existent")
+    ("Hypertable.RangeServer.CellStore.Mmap",
+        boo()->default_value(false), "Read cell stores by memory mapping them "
+        "from the local broker root directory instead of through the broker "
+        "(only valid when DfsBroker/local runs on the same host)")
     ("Hypertable.RangeServer.IgnoreClockSkewErrors",
         boo()->default_value(false), "Ignore clock skew errors")
     ("Hypertable.RangeServer.CommitInterval", i32()->default_value(50),
@@ -356,6 +429,15 @@ void DefaultPolicy::init_options() {
         "Size of range in bytes before splitting")
     ("Hypertable.RangeServer.Range.MaximumSize", i64()->default_value(3*G),
         "Maximum size of a range in bytes before updates get throttled")
+    ("Hypertable.RangeServer.Range.HotSplit.CellWriteRate",
+     i32()->default_value(0), "Split ranges that receive more than this many "
+        "cells per second, regardless of size (0 disables)")
+    ("Hypertable.RangeServer.Range.HotSplit.ScanRate", i32()->default_value(0),
+        "Split ranges that receive more than this many scans per second, "
+        "regardless of size (0 disables)")
+    ("Hypertable.RangeServer.Range.HotSplit.MinimumSize",
+     i64()->default_value(32*MiB), "Ranges smaller than this are not split "
+        "because of their cell write or scan rate")
     ("Hypertable.RangeServer.Range.MetadataSplitSize", i64(), "Size of METADATA "
         "range in bytes before splitting (for testing)")
     ("Hypertable.RangeServer.Range.SplitOff", str()->default_value("high"),
@@ -404,6 +486,28 @@ void DefaultPolicy::init_options() {
         "Millisecond delay before scheduling merging compactions in non-low memory mode")
     ("Hypertable.RangeServer.Maintenance.MoveCompactionsPerInterval", i32()->default_value(2),
         "Limit on number of major compactions due to move per maintenance interval")
+    ("Hypertable.RangeServer.Maintenance.MajorCompaction.Partitions",
+        i32()->default_value(1), "Maximum number of row sub-ranges that a "
+        "major compaction is divided into and run concurrently (1 = disabled)")
+    ("Hypertable.RangeServer.Maintenance.MajorCompaction.PartitionMinimumSize",
+        i64()->default_value(1*G), "Minimum on-disk size of an access group "
+        "before its major compactions are partitioned")
+    ("Hypertable.RangeServer.Maintenance.MajorCompaction.ExtraThreads", i32(),
+        "Limit on number of additional threads running compaction partitions "
+        "across the whole server (default = number of cores)")
+    ("Hypertable.RangeServer.Maintenance.Throttle.ReadRate", i64()->default_value(0),
+        "Bytes per second that compactions may read (0 = unlimited)")
+    ("Hypertable.RangeServer.Maintenance.Throttle.WriteRate", i64()->default_value(0),
+        "Bytes per second that compactions may write (0 = unlimited)")
+    ("Hypertable.RangeServer.Maintenance.Throttle.UpdateQueueThreshold",
+        i32()->default_value(32), "Update queue depth above which the "
+        "maintenance I/O budget is reduced (0 = ignore)")
+    ("Hypertable.RangeServer.Maintenance.Throttle.ScanLatencyThreshold",
+        i32()->default_value(100), "Average scan block latency in milliseconds "
+        "above which the maintenance I/O budget is reduced (0 = ignore)")
+    ("Hypertable.RangeServer.Maintenance.Throttle.MinimumFraction",
+        f64()->default_value(0.1), "Lowest fraction of the maintenance I/O "
+        "budget that foreground load can reduce it to")
     ("Hypertable.RangeServer.Monitoring.DataDirectories", str()->default_value("/"),
         "Comma-separated list of directory mount points of disk volumes to monitor")
     ("Hypertable.RangeServer.Workers", i32()->default_value(50),
@@ -425,10 +529,20 @@ void DefaultPolicy::init_options() {
         "threshold for (size of cell data) for thrift broker next calls")
     ("ThriftBroker.API.Logging", boo()->default_value(false), "Enable or "
         "disable Thrift API logging")
+    ("ThriftBroker.API.Metrics", boo()->default_value(false), "Enable or "
+        "disable collection of per-method Thrift API latency histograms")
+    ("ThriftBroker.API.Metrics.ReportInterval", i32()->default_value(60000),
+        "Interval in milliseconds at which API latency histograms are logged "
+        "and reset")
     ("ThriftBroker.Mutator.FlushInterval", i32()->default_value(1000),
         "Maximum flush interval in milliseconds")
     ("ThriftBroker.Workers", i32()->default_value(50), "Number of "
         "worker threads for thrift broker")
+    ("ThriftBroker.Reactors", i32()->default_value(4), "Number of I/O "
+        "threads for the non-blocking thrift broker server")
+    ("ThriftBroker.Server.Type", str()->default_value("threaded"), "Thrift "
+        "server model: threaded (thread per connection) or nonblocking "
+        "(reactor threads plus a fixed pool of workers)")
     ("ThriftBroker.Hyperspace.Session.Reconnect", boo()->default_value(true),
         "ThriftBroker will reconnect to Hyperspace on session expiry")
     ;
@@ -50,6 +50,20 @@ namespace Hypertable {
       m_u01 = boost::uniform_01<boost::mt19937>(m_rng);
     }
 
+    /**
+     * Reseeds only the stream that samples are drawn from, leaving the
+     * seed that lays values out over the distribution (set_seed) alone.
+     * Generators that share a seed but use different sample seeds agree on
+     * which values are hot but draw independent sequences.  Must be called
+     * after set_seed, which resets both streams.
+     *
+     * @param s seed for the sampling stream
+     */
+    void set_sample_seed(unsigned int s) {
+      boost::mt19937 rng((uint32_t)s);
+      m_u01 = boost::uniform_01<boost::mt19937>(rng);
+    }
+
     void set_value_count(uint64_t value_count) {
       m_value_count = value_count;
       delete [] m_cmf;
@@ -157,6 +157,7 @@ namespace Hypertable {
       HYPERSPACE_STATEDB_NODE_EXISTS               = 0x00030028,
       HYPERSPACE_STATEDB_NODE_NOT_EXISTS           = 0x00030029,
       HYPERSPACE_STATEDB_NODE_ATTR_NOT_FOUND       = 0x0003002A,
+      HYPERSPACE_REPLICA_STALE                     = 0x0003002B,
 
       MASTER_TABLE_EXISTS                    = 0x00040001,
       MASTER_BAD_SCHEMA                      = 0x00040002,
@@ -33,6 +33,12 @@ namespace Hypertable {
  */
 uint32_t murmurhash2(const void *data, size_t len, uint32_t hash);
 
+/**
+ * MurmurHash64A, the 64-bit flavor of MurmurHash 2.  Used where 32 bits of
+ * hash would collide too often (e.g. fingerprinting millions of keys).
+ */
+uint64_t murmurhash64(const void *data, size_t len, uint64_t seed);
+
 struct MurmurHash2 {
   uint32_t operator()(const String& s) const {
     return murmurhash2(s.c_str(), s.length(), 0);
@@ -0,0 +1,184 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hypertable. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "Common/Compat.h"
+
+#include <algorithm>
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+
+#include "XorFilterWithChecksum.h"
+
+using namespace Hypertable;
+
+namespace {
+  enum {
+    DEDUP_THRESHOLD_MIN = 65536,
+    MAX_BUILD_ATTEMPTS = 64
+  };
+}
+
+
+XorFilterWithChecksum::XorFilterWithChecksum()
+  : m_dedup_threshold(DEDUP_THRESHOLD_MIN), m_items_actual(0), m_seed(0),
+    m_block_length(0), m_num_bytes(0), m_base(0), m_fingerprints(0),
+    m_alloc(0) {
+}
+
+
+XorFilterWithChecksum::XorFilterWithChecksum(size_t items_actual)
+  : m_dedup_threshold(DEDUP_THRESHOLD_MIN), m_items_actual(items_actual),
+    m_seed(0), m_block_length(0), m_num_bytes(0), m_base(0),
+    m_fingerprints(0), m_alloc(0) {
+  allocate();
+}
+
+
+/**
+ * The table has 1.23 * items + 32 slots, split into three equal blocks.
+ * The size depends only on the number of items so that a reader can
+ * allocate it from the trailer before reading the filter.
+ */
+void XorFilterWithChecksum::allocate() {
+  size_t capacity = 32 + (123 * m_items_actual + 99) / 100;
+  m_block_length = (uint32_t)(capacity / 3);
+  m_num_bytes = m_items_actual ? 3 * (size_t)m_block_length : 0;
+  delete [] m_alloc;
+  size_t total = total_size();
+  m_alloc = new uint8_t[total];
+  memset(m_alloc, 0, total);
+  m_base = m_alloc;
+  m_fingerprints = m_base + HEADER_SIZE;
+}
+
+
+/**
+ * Keys arrive in sorted order, so the same row (or row+column) is
+ * inserted once per cell.  Collapsing the duplicates whenever the vector
+ * doubles bounds build memory to twice the number of distinct items.
+ */
+void XorFilterWithChecksum::dedup() {
+  std::sort(m_hashes.begin(), m_hashes.end());
+  m_hashes.erase(std::unique(m_hashes.begin(), m_hashes.end()),
+                 m_hashes.end());
+  m_dedup_threshold = std::max((size_t)DEDUP_THRESHOLD_MIN,
+                               2 * m_hashes.size());
+}
+
+
+void XorFilterWithChecksum::build() {
+  dedup();
+  m_items_actual = m_hashes.size();
+  allocate();
+
+  if (m_items_actual == 0)
+    return;
+
+  size_t capacity = m_num_bytes;
+  std::vector<uint64_t> xor_mask(capacity);
+  std::vector<uint32_t> count(capacity);
+  std::vector<uint32_t> queue;
+  std::vector<std::pair<uint64_t, uint32_t> > stack;
+  uint64_t hash;
+  uint32_t idx, s;
+
+  queue.reserve(capacity);
+  stack.reserve(m_items_actual);
+
+  // Peel slots that are hit by exactly one item until all items are
+  // placed; a failed attempt is retried with a new seed
+  for (int attempt = 0; ; attempt++) {
+    if (attempt == MAX_BUILD_ATTEMPTS)
+      HT_THROWF(Error::FAILED_EXPECTATION, "Unable to build xor filter for "
+                "%llu items", (Llu)m_items_actual);
+
+    m_seed = mix(0x9e3779b97f4a7c15ULL * (attempt + 1));
+    std::fill(xor_mask.begin(), xor_mask.end(), 0);
+    std::fill(count.begin(), count.end(), 0);
+    queue.clear();
+    stack.clear();
+
+    for (size_t i = 0; i < m_hashes.size(); i++) {
+      hash = mix(m_hashes[i] + m_seed);
+      for (int j = 0; j < 3; j++) {
+        s = slot(hash, j);
+        xor_mask[s] ^= hash;
+        count[s]++;
+      }
+    }
+
+    for (idx = 0; idx < capacity; idx++)
+      if (count[idx] == 1)
+        queue.push_back(idx);
+
+    while (!queue.empty()) {
+      idx = queue.back();
+      queue.pop_back();
+      if (count[idx] != 1)
+        continue;
+      hash = xor_mask[idx];
+      stack.push_back(std::make_pair(hash, idx));
+      for (int j = 0; j < 3; j++) {
+        s = slot(hash, j);
+        xor_mask[s] ^= hash;
+        if (--count[s] == 1)
+          queue.push_back(s);
+      }
+    }
+
+    if (stack.size() == m_items_actual)
+      break;
+  }
+
+  // Assign fingerprints in reverse peeling order; each item's own slot is
+  // still zero when it is assigned, so it takes whatever makes the xor of
+  // its three slots equal its fingerprint
+  for (size_t i = stack.size(); i > 0; i--) {
+    hash = stack[i-1].first;
+    idx = stack[i-1].second;
+    m_fingerprints[idx] = fingerprint(hash) ^ m_fingerprints[slot(hash, 0)]
+      ^ m_fingerprints[slot(hash, 1)] ^ m_fingerprints[slot(hash, 2)];
+  }
+
+  std::vector<uint64_t>().swap(m_hashes);
+}
+
+
+void XorFilterWithChecksum::serialize(StaticBuffer &buf) {
+  buf.set(m_base, total_size(), false);
+  uint8_t *ptr = m_base + 4;
+  Serialization::encode_i64(&ptr, m_seed);
+  ptr = m_base;
+  Serialization::encode_i32(&ptr, fletcher32(m_base + 4,
+                                             HEADER_SIZE - 4 + m_num_bytes));
+}
+
+
+void XorFilterWithChecksum::validate(String &filename) {
+  const uint8_t *ptr = m_base;
+  size_t remain = HEADER_SIZE;
+  uint32_t stored_checksum = Serialization::decode_i32(&ptr, &remain);
+  uint32_t computed_checksum = fletcher32(m_base + 4,
+                                          HEADER_SIZE - 4 + m_num_bytes);
+  if (stored_checksum != computed_checksum)
+    HT_THROW(Error::BLOOMFILTER_CHECKSUM_MISMATCH, filename.c_str());
+  m_seed = Serialization::decode_i64(&ptr, &remain);
+}
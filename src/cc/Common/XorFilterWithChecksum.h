@@ -0,0 +1,145 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hypertable. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef HYPERTABLE_XOR_FILTER_WITH_CHECKSUM_H
+#define HYPERTABLE_XOR_FILTER_WITH_CHECKSUM_H
+
+#include <vector>
+
+#include "Common/Checksum.h"
+#include "Common/Filesystem.h"
+#include "Common/MurmurHash.h"
+#include "Common/StaticBuffer.h"
+#include "Common/String.h"
+
+namespace Hypertable {
+
+/**
+ * A static set for approximate membership tests, false positives are
+ * possible, but false negatives are not.  Each item is represented by an
+ * 8-bit fingerprint that is the xor of three table slots, which gives a
+ * false positive rate of about 0.4% at 9.84 bits per item (a Bloom filter
+ * needs about 11.5 bits per item for the same rate).  Unlike a Bloom filter
+ * the table can only be built once all of the items are known, so items
+ * are collected with insert() and the table is constructed by build().
+ */
+class XorFilterWithChecksum {
+public:
+  /** Constructs an empty filter to be populated with insert() */
+  XorFilterWithChecksum();
+
+  /**
+   * Constructs a filter for items_actual items whose serialized form
+   * is to be read into base() and checked with validate()
+   */
+  XorFilterWithChecksum(size_t items_actual);
+
+  ~XorFilterWithChecksum() { delete [] m_alloc; }
+
+  void insert(const void *key, size_t len) {
+    m_hashes.push_back(murmurhash64(key, len, 0));
+    if (m_hashes.size() >= m_dedup_threshold)
+      dedup();
+  }
+
+  void insert(const String &key) {
+    insert(key.c_str(), key.length());
+  }
+
+  /**
+   * Builds the fingerprint table from the inserted items and releases
+   * them.  Throws Error::FAILED_EXPECTATION if no table can be found,
+   * which only happens if distinct items collide on all 64 hash bits.
+   */
+  void build();
+
+  bool may_contain(const void *key, size_t len) const {
+    uint64_t hash = mix(murmurhash64(key, len, 0) + m_seed);
+    return fingerprint(hash) == (m_fingerprints[slot(hash, 0)] ^
+                                 m_fingerprints[slot(hash, 1)] ^
+                                 m_fingerprints[slot(hash, 2)]);
+  }
+
+  bool may_contain(const String &key) const {
+    return may_contain(key.c_str(), key.length());
+  }
+
+  void serialize(StaticBuffer &buf);
+
+  uint8_t *base() { return m_base; }
+
+  void validate(String &filename);
+
+  size_t size() { return m_num_bytes; }
+
+  size_t total_size() {
+    return HEADER_SIZE + m_num_bytes
+      + HT_IO_ALIGNMENT_PADDING(HEADER_SIZE + m_num_bytes);
+  }
+
+  size_t get_num_hashes() { return 3; }
+
+  size_t get_length_bits() { return m_num_bytes * 8; }
+
+  size_t get_items_actual() { return m_items_actual; }
+
+  /** Serialized header: checksum (4 bytes) followed by the seed (8 bytes) */
+  enum { HEADER_SIZE = 12 };
+
+private:
+
+  void allocate();
+
+  void dedup();
+
+  /** 64-bit finalizer from MurmurHash3 */
+  static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  static uint8_t fingerprint(uint64_t hash) {
+    return (uint8_t)(hash ^ (hash >> 32));
+  }
+
+  /** Table slot of the i'th hash, one in each third of the table */
+  uint32_t slot(uint64_t hash, int i) const {
+    uint32_t h = (uint32_t)((hash << (21 * i)) | (hash >> ((64 - 21 * i) & 63)));
+    return (uint32_t)(((uint64_t)h * m_block_length) >> 32)
+      + i * m_block_length;
+  }
+
+  std::vector<uint64_t> m_hashes;
+  size_t     m_dedup_threshold;
+  size_t     m_items_actual;
+  uint64_t   m_seed;
+  uint32_t   m_block_length;
+  size_t     m_num_bytes;
+  uint8_t   *m_base;
+  uint8_t   *m_fingerprints;
+  uint8_t   *m_alloc;
+};
+
+} //namespace Hypertable
+
+#endif // HYPERTABLE_XOR_FILTER_WITH_CHECKSUM_H
@@ -21,6 +21,7 @@
 #include "Common/Init.h"
 #include "Common/BloomFilter.h"
 #include "Common/BloomFilterWithChecksum.h"
+#include "Common/XorFilterWithChecksum.h"
 #include "Common/Logger.h"
 #include "Common/Stopwatch.h"
 #include "Common/Lookup3.h"
@@ -176,12 +177,104 @@ struct BloomFilterTest {
 
     delete filter_with_checksum;
 
+    /*** Blocked, with Checksum ***/
+
+    filter_with_checksum = new BasicBloomFilterWithChecksum<HashT>(nitems, fp_prob,
+        BasicBloomFilterWithChecksum<HashT>::BLOCKED);
+
+    cout << label << " (blocked)" << endl;
+
+    MEASURE("  insert", for (size_t i = 0; i < nitems; ++i)
+      filter_with_checksum->insert(items[i].data), nitems);
+
+    MEASURE("  true positives", for (size_t i = 0; i < nitems; ++i)
+      HT_ASSERT(filter_with_checksum->may_contain(items[i].data)), nitems);
+
+    false_positives = 0.;
+
+    MEASURE("  false positives",
+      for (size_t i = nitems, n = items.size(); i < n; ++i)
+        if (filter_with_checksum->may_contain(items[i].data))
+          ++false_positives, nfalses);
+
+    cout << "  false positive rate: expected "<< fp_prob <<", got "
+         << false_positives / nfalses << endl;
+
+    filter_with_checksum->serialize(sbuf);
+    StaticBuffer blocked_buf(sbuf.size);
+    memcpy(blocked_buf.base, sbuf.base, sbuf.size);
+    length = filter_with_checksum->get_length_bits();
+    num_hashes = filter_with_checksum->get_num_hashes();
+
+    delete filter_with_checksum;
+
+    filter_with_checksum = new BasicBloomFilterWithChecksum<HashT>(nitems, nitems, length, num_hashes,
+        BasicBloomFilterWithChecksum<HashT>::BLOCKED);
+    memcpy(filter_with_checksum->base(), blocked_buf.base, blocked_buf.size);
+    String name("blocked");
+    filter_with_checksum->validate(name);
+
+    for (size_t i = 0; i < nitems; ++i)
+      HT_ASSERT(filter_with_checksum->may_contain(items[i].data));
+
+    delete filter_with_checksum;
+
+  }
+
+  void test_xor() {
+    size_t nitems = items.size() / 2;
+    XorFilterWithChecksum *filter = new XorFilterWithChecksum();
+
+    cout << "XorFilter (with checksum)" << endl;
+
+    // every item twice, like the repeated rows of a cell store
+    MEASURE("  insert", for (size_t i = 0; i < 2 * nitems; ++i)
+      filter->insert(items[i / 2].data), 2 * nitems);
+
+    MEASURE("  build", filter->build(), nitems);
+
+    HT_ASSERT(filter->get_items_actual() == nitems);
+    cout << "  bits per item: "
+         << (double)filter->get_length_bits() / nitems << endl;
+
+    MEASURE("  true positives", for (size_t i = 0; i < nitems; ++i)
+      HT_ASSERT(filter->may_contain(items[i].data)), nitems);
+
+    double false_positives = 0.;
+    size_t nfalses = items.size() - nitems;
+
+    MEASURE("  false positives",
+      for (size_t i = nitems, n = items.size(); i < n; ++i)
+        if (filter->may_contain(items[i].data))
+          ++false_positives, nfalses);
+
+    cout << "  false positive rate: expected 0.0039, got "
+         << false_positives / nfalses << endl;
+
+    StaticBuffer sbuf;
+    filter->serialize(sbuf);
+    StaticBuffer serialized_buf(sbuf.size);
+    memcpy(serialized_buf.base, sbuf.base, sbuf.size);
+
+    delete filter;
+
+    filter = new XorFilterWithChecksum(nitems);
+    HT_ASSERT(filter->total_size() == serialized_buf.size);
+    memcpy(filter->base(), serialized_buf.base, serialized_buf.size);
+    String name("xor");
+    filter->validate(name);
+
+    for (size_t i = 0; i < nitems; ++i)
+      HT_ASSERT(filter->may_contain(items[i].data));
+
+    delete filter;
   }
 
   void run() {
     TEST_IF(Lookup3);
     TEST_IF(SuperFastHash);
     TEST_IF(MurmurHash2);
+    test_xor();
   }
 };
 
@@ -0,0 +1,303 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <cerrno>
+#include <cstring>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+}
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "MappedClient.h"
+
+using namespace Hypertable;
+using namespace Hypertable::DfsBroker;
+
+
+MappedClient::MappedFile::~MappedFile() {
+  ::munmap(base, length);
+}
+
+
+MappedClient::MappedClient(FilesystemPtr &fs, const String &rootdir)
+  : m_fs(fs), m_rootdir(rootdir), m_mapped_reads(0) {
+}
+
+
+MappedClient::~MappedClient() {
+}
+
+
+void MappedClient::map_file(int32_t fd, const String &name) {
+  String abspath;
+  struct stat statbuf;
+  void *base;
+  int local_fd;
+
+  if (name[0] == '/')
+    abspath = m_rootdir + name;
+  else
+    abspath = m_rootdir + "/" + name;
+
+  if ((local_fd = ::open(abspath.c_str(), O_RDONLY)) == -1) {
+    HT_WARNF("Unable to open '%s' for memory mapping, reading through "
+             "broker - %s", abspath.c_str(), strerror(errno));
+    return;
+  }
+
+  if (::fstat(local_fd, &statbuf) != 0 || statbuf.st_size == 0) {
+    ::close(local_fd);
+    return;
+  }
+
+  base = ::mmap(0, statbuf.st_size, PROT_READ, MAP_SHARED, local_fd, 0);
+  ::close(local_fd);
+
+  if (base == MAP_FAILED) {
+    HT_WARNF("Unable to memory map '%s', reading through broker - %s",
+             abspath.c_str(), strerror(errno));
+    return;
+  }
+
+  ScopedLock lock(m_mutex);
+  m_mapped_files[fd] = new MappedFile((uint8_t *)base, statbuf.st_size);
+}
+
+
+void
+MappedClient::open(const String &name, uint32_t flags,
+                   DispatchHandler *handler) {
+  m_fs->open(name, flags, handler);
+}
+
+
+int
+MappedClient::open(const String &name, uint32_t flags, bool verify_checksum) {
+  int32_t fd = m_fs->open(name, flags, verify_checksum);
+  map_file(fd, name);
+  return fd;
+}
+
+
+int
+MappedClient::open_buffered(const String &name, uint32_t flags,
+                            uint32_t buf_size, uint32_t outstanding,
+                            uint64_t start_offset, uint64_t end_offset) {
+  return m_fs->open_buffered(name, flags, buf_size, outstanding,
+                             start_offset, end_offset);
+}
+
+
+void
+MappedClient::create(const String &name, uint32_t flags, int32_t bufsz,
+                     int32_t replication, int64_t blksz,
+                     DispatchHandler *handler) {
+  m_fs->create(name, flags, bufsz, replication, blksz, handler);
+}
+
+
+int
+MappedClient::create(const String &name, uint32_t flags, int32_t bufsz,
+                     int32_t replication, int64_t blksz) {
+  return m_fs->create(name, flags, bufsz, replication, blksz);
+}
+
+
+void MappedClient::close(int32_t fd, DispatchHandler *handler) {
+  {
+    ScopedLock lock(m_mutex);
+    m_mapped_files.erase(fd);
+  }
+  m_fs->close(fd, handler);
+}
+
+
+void MappedClient::close(int32_t fd) {
+  {
+    ScopedLock lock(m_mutex);
+    m_mapped_files.erase(fd);
+  }
+  m_fs->close(fd);
+}
+
+
+void MappedClient::read(int32_t fd, size_t amount, DispatchHandler *handler) {
+  m_fs->read(fd, amount, handler);
+}
+
+
+size_t MappedClient::read(int32_t fd, void *dst, size_t amount) {
+  return m_fs->read(fd, dst, amount);
+}
+
+
+void
+MappedClient::append(int32_t fd, StaticBuffer &buffer, uint32_t flags,
+                     DispatchHandler *handler) {
+  m_fs->append(fd, buffer, flags, handler);
+}
+
+
+size_t MappedClient::append(int32_t fd, StaticBuffer &buffer, uint32_t flags) {
+  return m_fs->append(fd, buffer, flags);
+}
+
+
+void MappedClient::seek(int32_t fd, uint64_t offset, DispatchHandler *handler) {
+  m_fs->seek(fd, offset, handler);
+}
+
+
+void MappedClient::seek(int32_t fd, uint64_t offset) {
+  m_fs->seek(fd, offset);
+}
+
+
+void MappedClient::remove(const String &name, DispatchHandler *handler) {
+  m_fs->remove(name, handler);
+}
+
+
+void MappedClient::remove(const String &name, bool force) {
+  m_fs->remove(name, force);
+}
+
+
+void MappedClient::length(const String &name, DispatchHandler *handler) {
+  m_fs->length(name, handler);
+}
+
+
+int64_t MappedClient::length(const String &name) {
+  return m_fs->length(name);
+}
+
+
+void
+MappedClient::pread(int32_t fd, size_t len, uint64_t offset,
+                    DispatchHandler *handler) {
+  m_fs->pread(fd, len, offset, handler);
+}
+
+
+size_t
+MappedClient::pread(int32_t fd, void *dst, size_t len, uint64_t offset,
+                    bool verify_checksum) {
+  MappedFilePtr mapped_file;
+
+  {
+    ScopedLock lock(m_mutex);
+    MappedFileMap::iterator iter = m_mapped_files.find(fd);
+    if (iter != m_mapped_files.end() && offset + len <= iter->second->length) {
+      mapped_file = iter->second;
+      m_mapped_reads++;
+    }
+  }
+
+  if (!mapped_file)
+    return m_fs->pread(fd, dst, len, offset, verify_checksum);
+
+  memcpy(dst, mapped_file->base + offset, len);
+  return len;
+}
+
+
+void MappedClient::mkdirs(const String &name, DispatchHandler *handler) {
+  m_fs->mkdirs(name, handler);
+}
+
+
+void MappedClient::mkdirs(const String &name) {
+  m_fs->mkdirs(name);
+}
+
+
+void MappedClient::flush(int32_t fd, DispatchHandler *handler) {
+  m_fs->flush(fd, handler);
+}
+
+
+void MappedClient::flush(int32_t fd) {
+  m_fs->flush(fd);
+}
+
+
+void MappedClient::rmdir(const String &name, DispatchHandler *handler) {
+  m_fs->rmdir(name, handler);
+}
+
+
+void MappedClient::rmdir(const String &name, bool force) {
+  m_fs->rmdir(name, force);
+}
+
+
+void MappedClient::readdir(const String &name, DispatchHandler *handler) {
+  m_fs->readdir(name, handler);
+}
+
+
+void MappedClient::readdir(const String &name, std::vector<String> &listing) {
+  m_fs->readdir(name, listing);
+}
+
+
+void MappedClient::exists(const String &name, DispatchHandler *handler) {
+  m_fs->exists(name, handler);
+}
+
+
+bool MappedClient::exists(const String &name) {
+  return m_fs->exists(name);
+}
+
+
+void
+MappedClient::rename(const String &src, const String &dst,
+                     DispatchHandler *handler) {
+  m_fs->rename(src, dst, handler);
+}
+
+
+void MappedClient::rename(const String &src, const String &dst) {
+  m_fs->rename(src, dst);
+}
+
+
+void MappedClient::debug(int32_t command, StaticBuffer &serialized_parameters) {
+  m_fs->debug(command, serialized_parameters);
+}
+
+
+void
+MappedClient::debug(int32_t command, StaticBuffer &serialized_parameters,
+                    DispatchHandler *handler) {
+  m_fs->debug(command, serialized_parameters, handler);
+}
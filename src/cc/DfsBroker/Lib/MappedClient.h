@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_DFSBROKER_MAPPEDCLIENT_H
+#define HYPERTABLE_DFSBROKER_MAPPEDCLIENT_H
+
+#include "Common/Filesystem.h"
+#include "Common/HashMap.h"
+#include "Common/Mutex.h"
+#include "Common/ReferenceCount.h"
+
+namespace Hypertable { namespace DfsBroker {
+
+    /** Filesystem for RangeServers that share a host with the local DFS
+     * broker.  Every request is forwarded to the wrapped broker client,
+     * except that files opened for reading are also memory mapped directly
+     * from the broker's root directory and synchronous preads that fall
+     * within the mapping are served from it in-process, without a broker
+     * round trip.  If a file cannot be mapped, or a read extends beyond
+     * the mapped length, the request falls through to the broker.
+     */
+    class MappedClient : public Filesystem {
+    public:
+
+      /** Constructor.
+       *
+       * @param fs broker client to forward requests to
+       * @param rootdir root directory of the local broker
+       */
+      MappedClient(FilesystemPtr &fs, const String &rootdir);
+
+      virtual ~MappedClient();
+
+      virtual void open(const String &name, uint32_t flags, DispatchHandler *handler);
+      virtual int open(const String &name, uint32_t flags, bool verify_checksum);
+      virtual int open_buffered(const String &name, uint32_t flags, uint32_t buf_size,
+                                uint32_t outstanding, uint64_t start_offset=0,
+                                uint64_t end_offset=0);
+
+      virtual void create(const String &name, uint32_t flags,
+                          int32_t bufsz, int32_t replication,
+                          int64_t blksz, DispatchHandler *handler);
+      virtual int create(const String &name, uint32_t flags, int32_t bufsz,
+                         int32_t replication, int64_t blksz);
+
+      virtual void close(int32_t fd, DispatchHandler *handler);
+      virtual void close(int32_t fd);
+
+      virtual void read(int32_t fd, size_t amount, DispatchHandler *handler);
+      virtual size_t read(int32_t fd, void *dst, size_t amount);
+
+      virtual void append(int32_t fd, StaticBuffer &buffer, uint32_t flags,
+                          DispatchHandler *handler);
+      virtual size_t append(int32_t fd, StaticBuffer &buffer,
+                            uint32_t flags = 0);
+
+      virtual void seek(int32_t fd, uint64_t offset, DispatchHandler *handler);
+      virtual void seek(int32_t fd, uint64_t offset);
+
+      virtual void remove(const String &name, DispatchHandler *handler);
+      virtual void remove(const String &name, bool force = true);
+
+      virtual void length(const String &name, DispatchHandler *handler);
+      virtual int64_t length(const String &name);
+
+      virtual void pread(int32_t fd, size_t len, uint64_t offset,
+                         DispatchHandler *handler);
+      virtual size_t pread(int32_t fd, void *dst, size_t len, uint64_t offset,
+			   bool verify_checksum);
+
+      virtual void mkdirs(const String &name, DispatchHandler *handler);
+      virtual void mkdirs(const String &name);
+
+      virtual void flush(int32_t fd, DispatchHandler *handler);
+      virtual void flush(int32_t fd);
+
+      virtual void rmdir(const String &name, DispatchHandler *handler);
+      virtual void rmdir(const String &name, bool force = true);
+
+      virtual void readdir(const String &name, DispatchHandler *handler);
+      virtual void readdir(const String &name, std::vector<String> &listing);
+
+      virtual void exists(const String &name, DispatchHandler *handler);
+      virtual bool exists(const String &name);
+
+      virtual void rename(const String &src, const String &dst,
+                          DispatchHandler *handler);
+      virtual void rename(const String &src, const String &dst);
+
+      virtual void debug(int32_t command, StaticBuffer &serialized_parameters);
+      virtual void debug(int32_t command, StaticBuffer &serialized_parameters,
+                         DispatchHandler *handler);
+
+      /** Returns the number of preads served from a mapping */
+      uint64_t mapped_reads() { ScopedLock lock(m_mutex); return m_mapped_reads; }
+
+    private:
+
+      /** Read-only mapping of an open file.  Readers hold a reference
+       * while copying so that a concurrent close cannot unmap the region
+       * out from under them.
+       */
+      class MappedFile : public ReferenceCount {
+      public:
+        MappedFile(uint8_t *base, size_t length) : base(base), length(length) { }
+        ~MappedFile();
+        uint8_t *base;
+        size_t length;
+      };
+      typedef intrusive_ptr<MappedFile> MappedFilePtr;
+
+      typedef hash_map<int32_t, MappedFilePtr> MappedFileMap;
+
+      void map_file(int32_t fd, const String &name);
+
+      Mutex m_mutex;
+      FilesystemPtr m_fs;
+      String m_rootdir;
+      MappedFileMap m_mapped_files;
+      uint64_t m_mapped_reads;
+    };
+
+    typedef intrusive_ptr<MappedClient> MappedClientPtr;
+
+}} // namespace Hypertable::DfsBroker
+
+
+#endif // HYPERTABLE_DFSBROKER_MAPPEDCLIENT_H
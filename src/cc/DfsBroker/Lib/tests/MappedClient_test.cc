@@ -0,0 +1,246 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/String.h"
+
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+}
+
+#include "DfsBroker/Lib/MappedClient.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  /**
+   * Stands in for the broker client by serving synchronous requests from
+   * local files under the same root directory that MappedClient maps
+   * from, counting the preads that reach it
+   */
+  class LocalFilesystem : public Filesystem {
+  public:
+    LocalFilesystem(const String &rootdir) : preads(0), m_rootdir(rootdir) { }
+
+    virtual void open(const String &name, uint32_t flags, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "open");
+    }
+    virtual int open(const String &name, uint32_t flags, bool verify_checksum) {
+      int fd = ::open((m_rootdir + name).c_str(), O_RDONLY);
+      HT_ASSERT(fd >= 0);
+      return fd;
+    }
+    virtual int open_buffered(const String &name, uint32_t flags, uint32_t buf_size,
+                              uint32_t outstanding, uint64_t start_offset=0,
+                              uint64_t end_offset=0) {
+      return open(name, flags, false);
+    }
+    virtual void create(const String &name, uint32_t flags, int32_t bufsz,
+                        int32_t replication, int64_t blksz, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "create");
+    }
+    virtual int create(const String &name, uint32_t flags, int32_t bufsz,
+                       int32_t replication, int64_t blksz) {
+      int fd = ::open((m_rootdir + name).c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+      HT_ASSERT(fd >= 0);
+      return fd;
+    }
+    virtual void close(int fd, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "close");
+    }
+    virtual void close(int fd) { ::close(fd); }
+    virtual void read(int fd, size_t len, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "read");
+    }
+    virtual size_t read(int fd, void *dst, size_t len) {
+      return ::read(fd, dst, len);
+    }
+    virtual void append(int fd, StaticBuffer &buffer, uint32_t flags,
+                        DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "append");
+    }
+    virtual size_t append(int fd, StaticBuffer &buffer, uint32_t flags = 0) {
+      return ::write(fd, buffer.base, buffer.size);
+    }
+    virtual void seek(int fd, uint64_t offset, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "seek");
+    }
+    virtual void seek(int fd, uint64_t offset) { ::lseek(fd, offset, SEEK_SET); }
+    virtual void remove(const String &name, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "remove");
+    }
+    virtual void remove(const String &name, bool force = true) {
+      ::unlink((m_rootdir + name).c_str());
+    }
+    virtual void length(const String &name, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "length");
+    }
+    virtual int64_t length(const String &name) {
+      struct stat statbuf;
+      HT_ASSERT(::stat((m_rootdir + name).c_str(), &statbuf) == 0);
+      return statbuf.st_size;
+    }
+    virtual void pread(int fd, size_t amount, uint64_t offset,
+                       DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "pread");
+    }
+    virtual size_t pread(int fd, void *dst, size_t len, uint64_t offset,
+                         bool verify_checksum=true) {
+      preads++;
+      return ::pread(fd, dst, len, offset);
+    }
+    virtual void mkdirs(const String &name, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "mkdirs");
+    }
+    virtual void mkdirs(const String &name) {
+      ::mkdir((m_rootdir + name).c_str(), 0755);
+    }
+    virtual void rmdir(const String &name, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "rmdir");
+    }
+    virtual void rmdir(const String &name, bool force = true) {
+      ::rmdir((m_rootdir + name).c_str());
+    }
+    virtual void readdir(const String &name, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "readdir");
+    }
+    virtual void readdir(const String &name, std::vector<String> &listing) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "readdir");
+    }
+    virtual void flush(int fd, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "flush");
+    }
+    virtual void flush(int fd) { }
+    virtual void exists(const String &name, DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "exists");
+    }
+    virtual bool exists(const String &name) {
+      struct stat statbuf;
+      return ::stat((m_rootdir + name).c_str(), &statbuf) == 0;
+    }
+    virtual void rename(const String &src, const String &dst,
+                        DispatchHandler *handler) {
+      HT_THROW(Error::NOT_IMPLEMENTED, "rename");
+    }
+    virtual void rename(const String &src, const String &dst) {
+      ::rename((m_rootdir + src).c_str(), (m_rootdir + dst).c_str());
+    }
+    virtual void debug(int32_t command, StaticBuffer &serialized_parameters) { }
+    virtual void debug(int32_t command, StaticBuffer &serialized_parameters,
+                       DispatchHandler *handler) { }
+
+    uint64_t preads;
+
+  private:
+    String m_rootdir;
+  };
+
+  typedef intrusive_ptr<LocalFilesystem> LocalFilesystemPtr;
+
+  void write_file(Filesystem *fs, const String &name, size_t length,
+                  uint8_t seed) {
+    StaticBuffer buf(length);
+    for (size_t i=0; i<length; i++)
+      buf.base[i] = (uint8_t)(seed + i * 7);
+    int fd = fs->create(name, 0, -1, -1, -1);
+    fs->append(fd, buf);
+    fs->close(fd);
+  }
+
+  /**
+   * Reads the same extent through the mapping and through the broker and
+   * checks that they agree
+   */
+  void check_pread(DfsBroker::MappedClient *client, LocalFilesystem *broker,
+                   int fd, size_t len, uint64_t offset) {
+    std::vector<uint8_t> mapped(len), direct(len);
+    HT_ASSERT(client->pread(fd, &mapped[0], len, offset, true) == len);
+    HT_ASSERT(broker->pread(fd, &direct[0], len, offset) == len);
+    HT_ASSERT(!memcmp(&mapped[0], &direct[0], len));
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  String rootdir = format("/tmp/MappedClient_test-%d", (int)getpid());
+  HT_ASSERT(::mkdir(rootdir.c_str(), 0755) == 0);
+
+  LocalFilesystemPtr broker = new LocalFilesystem(rootdir);
+  FilesystemPtr fs = broker.get();
+  DfsBroker::MappedClientPtr client = new DfsBroker::MappedClient(fs, rootdir);
+  uint64_t preads;
+  int fd;
+
+  write_file(broker.get(), "/cs0", 65536, 1);
+  write_file(broker.get(), "/cs1", 8192, 2);
+
+  // reads within the file are served from the mapping
+  fd = client->open("/cs0", 0, true);
+  preads = broker->preads;
+  check_pread(client.get(), broker.get(), fd, 4096, 0);
+  check_pread(client.get(), broker.get(), fd, 1000, 12345);
+  check_pread(client.get(), broker.get(), fd, 4096, 65536 - 4096);
+  HT_ASSERT(client->mapped_reads() == 3);
+  HT_ASSERT(broker->preads == preads + 3);   // only check_pread's own reads
+
+  // data appended after open lies beyond the mapping and goes to the broker
+  {
+    StaticBuffer buf(4096);
+    memset(buf.base, 0xab, 4096);
+    int wfd = ::open((rootdir + "/cs0").c_str(), O_WRONLY|O_APPEND);
+    HT_ASSERT(wfd >= 0);
+    HT_ASSERT(::write(wfd, buf.base, buf.size) == (ssize_t)buf.size);
+    ::close(wfd);
+  }
+  preads = broker->preads;
+  check_pread(client.get(), broker.get(), fd, 8192, 65536 - 4096);
+  HT_ASSERT(client->mapped_reads() == 3);
+  HT_ASSERT(broker->preads == preads + 2);
+  client->close(fd);
+
+  // a descriptor number reused after close must not see the old mapping
+  fd = client->open("/cs1", 0, true);
+  check_pread(client.get(), broker.get(), fd, 8192, 0);
+  HT_ASSERT(client->mapped_reads() == 4);
+  client->close(fd);
+
+  // buffered opens are not mapped
+  fd = client->open_buffered("/cs1", 0, 65536, 2);
+  check_pread(client.get(), broker.get(), fd, 1024, 0);
+  HT_ASSERT(client->mapped_reads() == 4);
+  client->close(fd);
+
+  broker->remove("/cs0");
+  broker->remove("/cs1");
+  ::rmdir(rootdir.c_str());
+
+  return 0;
+}
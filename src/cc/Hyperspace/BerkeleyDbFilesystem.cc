@@ -432,6 +432,7 @@ void BerkeleyDbFilesystem::db_event_callback(DbEnv *dbenv, uint32_t which, void
    break;
   case DB_EVENT_REP_STARTUPDONE:
    HT_INFO_OUT << "Received DB_EVENT_REP_STARTUPDONE event" << HT_END;
+   replication_info->startup_done = true;
    break;
   case DB_EVENT_WRITE_FAILED:
    HT_INFO_OUT << "Received DB_EVENT_WROTE_FAILED event" << HT_END;
@@ -499,13 +500,15 @@ BDbHandlesPtr BerkeleyDbFilesystem::get_db_handles() {
 
   // Open per thread handles if not already open
   if (!it->second->m_open) {
+    // replicas only read the databases created by the master
+    uint32_t db_flags = is_master() ? m_db_flags : (m_db_flags & ~DB_CREATE);
     it->second->m_handle_namespace_db = new Db(&m_env, 0);
     it->second->m_handle_state_db = new Db(&m_env, 0);
     it->second->m_handle_namespace_db->open(NULL, ms_name_namespace_db,
-                                            NULL, DB_BTREE, m_db_flags, 0);
+                                            NULL, DB_BTREE, db_flags, 0);
     it->second->m_handle_state_db->set_flags(DB_DUP|DB_REVSPLITOFF);
     it->second->m_handle_state_db->open(NULL, ms_name_state_db, NULL,
-                                        DB_BTREE, m_db_flags, 0);
+                                        DB_BTREE, db_flags, 0);
     it->second->m_open=true;
   }
   return it->second;
@@ -584,6 +587,10 @@ void BerkeleyDbFilesystem::start_transaction(BDbTxn &txn) {
 
     // open txn
     m_env.txn_begin(NULL, &txn.m_db_txn, 0);
+
+    // replicas need the commit token of a mutation to tell whether they
+    // have applied it
+    txn.m_want_commit_token = m_replication_info.do_replication;
   }
   catch (DbException &e) {
     HT_FATALF("Error starting Berkeley DB transaction: %s", e.what());
@@ -593,6 +600,33 @@ void BerkeleyDbFilesystem::start_transaction(BDbTxn &txn) {
   return;
 }
 
+/**
+ *
+ */
+bool BerkeleyDbFilesystem::txn_applied(const String &token, uint32_t timeout_ms) {
+#if DB_VERSION_MAJOR > 5 || (DB_VERSION_MAJOR == 5 && DB_VERSION_MINOR >= 2)
+  DB_TXN_TOKEN db_token;
+  int ret;
+
+  if (token.size() != DB_TXN_TOKEN_SIZE)
+    return false;
+  memcpy(db_token.buf, token.data(), DB_TXN_TOKEN_SIZE);
+
+  try {
+    ret = m_env.txn_applied(&db_token, (db_timeout_t)timeout_ms * 1000, 0);
+  }
+  catch (DbException &e) {
+    HT_DEBUGF("txn_applied failed - %s", e.what());
+    return false;
+  }
+
+  // DB_KEYEMPTY means the transaction did not write anything
+  return ret == 0 || ret == DB_KEYEMPTY;
+#else
+  return false;
+#endif
+}
+
 
 /**
  */
@@ -2071,6 +2105,42 @@ BerkeleyDbFilesystem::session_exists(BDbTxn &txn, uint64_t id)
   return exists;
 }
 
+/**
+ *
+ */
+bool
+BerkeleyDbFilesystem::session_expired(BDbTxn &txn, uint64_t id)
+{
+  int ret;
+  DbtManaged keym, datam;
+  bool expired = true;
+
+  HT_DEBUG_OUT <<"session_expired txn="<< txn << " session id=" << id << HT_END;
+
+  try {
+    keym.set_str(get_session_key(id, SESSION_EXPIRED));
+
+    ret = txn.m_handle_state_db->get(txn.m_db_txn, &keym, &datam, 0);
+
+    HT_ASSERT(ret == 0 || ret == DB_NOTFOUND);
+
+    if (ret == 0)
+      expired = String(datam.get_str()) != "0";
+  }
+  catch (DbException &e) {
+    if (e.get_errno() == DB_LOCK_DEADLOCK)
+      HT_THROW(HYPERSPACE_BERKELEYDB_DEADLOCK, e.what());
+    else if (e.get_errno() == DB_REP_HANDLE_DEAD)
+      HT_THROW(HYPERSPACE_BERKELEYDB_REP_HANDLE_DEAD, e.what());
+    HT_ERRORF("Berkeley DB error: %s", e.what());
+    HT_THROW(HYPERSPACE_BERKELEYDB_ERROR, e.what());
+  }
+
+  HT_DEBUG_OUT <<"exitting session_expired txn="<< txn << " session id=" << id
+               << " expired=" << expired << HT_END;
+  return expired;
+}
+
 /**
  *
  */
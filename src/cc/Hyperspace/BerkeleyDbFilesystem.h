@@ -69,7 +69,8 @@ namespace Hyperspace {
   class ReplicationInfo {
   public:
     ReplicationInfo(): initial_election_done(false), do_replication(true),
-                       is_master(false), master_eid(-1), num_replicas(0) {}
+                       is_master(false), startup_done(false), master_eid(-1),
+                       num_replicas(0) {}
 
     void wait_for_initial_election() {
       ScopedLock lock(initial_election_mutex);
@@ -79,6 +80,8 @@ namespace Hyperspace {
     bool initial_election_done;
     bool do_replication;
     bool is_master;
+    /** Set once a replica has synchronized with the master */
+    bool startup_done;
     int master_eid;
     uint32_t num_replicas;
     String localhost;
@@ -122,13 +125,35 @@ namespace Hyperspace {
 
   class BDbTxn{
   public:
-    BDbTxn(): m_handle_namespace_db(0), m_handle_state_db(0), m_db_txn(0) {}
+    BDbTxn(): m_handle_namespace_db(0), m_handle_state_db(0), m_db_txn(0),
+              m_want_commit_token(false), m_have_commit_token(false) {}
     ~BDbTxn() {}
 
     void commit(int flag=0) {
+#if DB_VERSION_MAJOR > 5 || (DB_VERSION_MAJOR == 5 && DB_VERSION_MINOR >= 2)
+      if (m_want_commit_token)
+        m_have_commit_token = m_db_txn->set_commit_token(&m_commit_token) == 0;
+#endif
       m_db_txn->commit(flag);
     }
 
+    /**
+     * Gets the commit token of a committed transaction, which replicas can
+     * check with BerkeleyDbFilesystem::txn_applied().  The token is empty if
+     * the environment is not replicated or Berkeley DB is older than 5.2.
+     *
+     * @param token filled in with the opaque token
+     */
+    void get_commit_token(String &token) {
+#if DB_VERSION_MAJOR > 5 || (DB_VERSION_MAJOR == 5 && DB_VERSION_MINOR >= 2)
+      if (m_have_commit_token) {
+        token.assign((const char *)m_commit_token.buf, DB_TXN_TOKEN_SIZE);
+        return;
+      }
+#endif
+      token.clear();
+    }
+
     void abort() {
       m_db_txn->abort();
     }
@@ -136,6 +161,11 @@ namespace Hyperspace {
     Db *m_handle_namespace_db;
     Db *m_handle_state_db;
     DbTxn *m_db_txn;
+    bool m_want_commit_token;
+    bool m_have_commit_token;
+#if DB_VERSION_MAJOR > 5 || (DB_VERSION_MAJOR == 5 && DB_VERSION_MINOR >= 2)
+    DB_TXN_TOKEN m_commit_token;
+#endif
   };
 
   ostream &operator<<(ostream &out, const BDbTxn &txn);
@@ -155,6 +185,27 @@ namespace Hyperspace {
       return (!m_replication_info.do_replication || m_replication_info.is_master);
     }
 
+    /** Returns true if this is a replica that has caught up with the master
+     * and can serve (possibly stale) reads */
+    bool is_readable_replica() {
+      return m_replication_info.do_replication &&
+        !m_replication_info.is_master && m_replication_info.startup_done;
+    }
+
+    bool is_replicated() {
+      return m_replication_info.do_replication;
+    }
+
+    /**
+     * Checks whether a replica has applied the transaction identified by a
+     * commit token obtained from BDbTxn::get_commit_token() on the master.
+     *
+     * @param token commit token
+     * @param timeout_ms how long to wait for the transaction to be applied
+     * @return true if the transaction has been applied locally
+     */
+    bool txn_applied(const String &token, uint32_t timeout_ms);
+
     String get_current_master() {
       if (m_replication_info.is_master)
         return m_replication_info.localhost;
@@ -315,6 +366,15 @@ namespace Hyperspace {
      */
     bool session_exists(BDbTxn &txn, uint64_t id);
 
+    /**
+     * Check if specified session has been marked expired in StateDB
+     *
+     * @param txn BerkeleyDB txn for this DB update
+     * @param id Session id
+     * @return true if session is missing or marked expired in StateDB
+     */
+    bool session_expired(BDbTxn &txn, uint64_t id);
+
     /**
      * Get name of session executable
      *
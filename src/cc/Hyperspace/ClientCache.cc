@@ -0,0 +1,375 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <cstring>
+
+#include "Common/Time.h"
+
+#include "ClientCache.h"
+#include "HandleCallback.h"
+
+using namespace Hypertable;
+using namespace Hyperspace;
+
+namespace {
+
+  const size_t ENTRY_OVERHEAD = 64;
+
+  const uint32_t ATTR_EVENTS = EVENT_MASK_ATTR_SET | EVENT_MASK_ATTR_DEL;
+  const uint32_t DIR_EVENTS = EVENT_MASK_CHILD_NODE_ADDED |
+                              EVENT_MASK_CHILD_NODE_REMOVED;
+
+  String parent_of(const String &name) {
+    size_t slash = name.rfind('/');
+    if (slash == String::npos || slash == 0)
+      return "/";
+    return name.substr(0, slash);
+  }
+
+  int64_t now_ms() {
+    return get_ts64() / 1000000LL;
+  }
+
+}
+
+
+void ClientCache::add_watch(const String &name, uint32_t event_mask) {
+  ScopedLock lock(m_mutex);
+  if ((event_mask & ATTR_EVENTS) == ATTR_EVENTS)
+    m_watches[name].attr_watchers++;
+  if ((event_mask & DIR_EVENTS) == DIR_EVENTS)
+    m_watches[name].dir_watchers++;
+}
+
+
+void ClientCache::remove_watch(const String &name, uint32_t event_mask) {
+  ScopedLock lock(m_mutex);
+  WatchMap::iterator iter = m_watches.find(name);
+
+  if (iter == m_watches.end())
+    return;
+
+  m_generation++;
+
+  if ((event_mask & ATTR_EVENTS) == ATTR_EVENTS &&
+      iter->second.attr_watchers > 0)
+    iter->second.attr_watchers--;
+  if ((event_mask & DIR_EVENTS) == DIR_EVENTS &&
+      iter->second.dir_watchers > 0)
+    iter->second.dir_watchers--;
+
+  // coherent entries become unreliable once their watch is gone
+  if (iter->second.dir_watchers == 0) {
+    erase(listing_key(name));
+    String prefix = (name == "/") ? name : name + "/";
+    EntryMap::iterator eiter = m_entries.lower_bound(prefix);
+    while (eiter != m_entries.end() &&
+           eiter->first.compare(0, prefix.length(), prefix) == 0) {
+      const String &key = eiter->first;
+      if (eiter->second.expire_time == 0 &&
+          key.compare(key.length()-2, 2, "\ne") == 0 &&
+          key.find('/', prefix.length()) == String::npos)
+        erase(eiter++);
+      else
+        ++eiter;
+    }
+  }
+  if (iter->second.attr_watchers == 0)
+    erase_prefix(name + "\na");
+  if (iter->second.attr_watchers == 0 && iter->second.dir_watchers == 0)
+    m_watches.erase(iter);
+}
+
+
+void ClientCache::clear_watches() {
+  ScopedLock lock(m_mutex);
+  m_generation++;
+  m_watches.clear();
+  m_stats.invalidations += m_entries.size();
+  m_entries.clear();
+  m_lru.clear();
+  m_memory_used = 0;
+}
+
+
+uint64_t ClientCache::generation() {
+  ScopedLock lock(m_mutex);
+  return m_generation;
+}
+
+
+bool ClientCache::get_attr(const String &name, const String &attr,
+                           DynamicBuffer &value) {
+  ScopedLock lock(m_mutex);
+  Entry *entry = lookup(attr_key(name, attr));
+
+  if (entry == 0)
+    return false;
+
+  value.clear();
+  value.ensure(entry->value.length() + 1);
+  value.add_unchecked(entry->value.data(), entry->value.length());
+  // nul-terminate, as the decoded response would be
+  *value.ptr = 0;
+  return true;
+}
+
+
+void ClientCache::put_attr(const String &name, const String &attr,
+                           const DynamicBuffer &value, uint64_t generation) {
+  ScopedLock lock(m_mutex);
+  WatchMap::iterator iter = m_watches.find(name);
+  int64_t expire_time;
+
+  if (!fillable(generation, iter != m_watches.end() &&
+                iter->second.attr_watchers > 0, &expire_time))
+    return;
+
+  String key = attr_key(name, attr);
+  Entry &entry = insert(key, key.length() + value.fill() + ENTRY_OVERHEAD,
+                        expire_time);
+  entry.value.assign((const char *)value.base, value.fill());
+}
+
+
+bool ClientCache::get_listing(const String &name,
+                              std::vector<DirEntry> &listing) {
+  ScopedLock lock(m_mutex);
+  Entry *entry = lookup(listing_key(name));
+
+  if (entry == 0)
+    return false;
+
+  listing = entry->listing;
+  return true;
+}
+
+
+void ClientCache::put_listing(const String &name,
+                              const std::vector<DirEntry> &listing,
+                              uint64_t generation) {
+  ScopedLock lock(m_mutex);
+  WatchMap::iterator iter = m_watches.find(name);
+  int64_t expire_time;
+
+  if (!fillable(generation, iter != m_watches.end() &&
+                iter->second.dir_watchers > 0, &expire_time))
+    return;
+
+  String key = listing_key(name);
+  size_t memory = key.length() + ENTRY_OVERHEAD;
+  for (size_t i=0; i<listing.size(); i++)
+    memory += sizeof(DirEntry) + listing[i].name.length();
+  Entry &entry = insert(key, memory, expire_time);
+  entry.listing = listing;
+}
+
+
+bool ClientCache::exists(const String &name, bool *existsp) {
+  ScopedLock lock(m_mutex);
+
+  if (name == "/") {
+    *existsp = true;
+    return true;
+  }
+
+  String parent = parent_of(name);
+  Entry *entry = lookup(listing_key(parent));
+
+  if (entry == 0) {
+    if ((entry = lookup(exists_key(name))) == 0)
+      return false;
+    *existsp = entry->exists;
+    return true;
+  }
+
+  String child = name.substr(parent == "/" ? 1 : parent.length() + 1);
+  *existsp = false;
+  for (size_t i=0; i<entry->listing.size(); i++) {
+    if (entry->listing[i].name == child) {
+      *existsp = true;
+      break;
+    }
+  }
+  return true;
+}
+
+
+void ClientCache::put_exists(const String &name, bool exists,
+                             uint64_t generation) {
+  ScopedLock lock(m_mutex);
+  WatchMap::iterator iter = m_watches.find(parent_of(name));
+  int64_t expire_time;
+
+  if (name == "/" ||
+      !fillable(generation, iter != m_watches.end() &&
+                iter->second.dir_watchers > 0, &expire_time))
+    return;
+
+  String key = exists_key(name);
+  Entry &entry = insert(key, key.length() + ENTRY_OVERHEAD, expire_time);
+  entry.exists = exists;
+}
+
+
+void ClientCache::invalidate_attr(const String &name, const String &attr) {
+  ScopedLock lock(m_mutex);
+  m_generation++;
+  erase(attr_key(name, attr));
+}
+
+
+void ClientCache::invalidate_listing(const String &name) {
+  ScopedLock lock(m_mutex);
+  m_generation++;
+  erase(listing_key(name));
+}
+
+
+void ClientCache::invalidate_node(const String &name) {
+  ScopedLock lock(m_mutex);
+  m_generation++;
+  erase_node(name);
+  if (name != "/")
+    erase(listing_key(parent_of(name)));
+}
+
+
+void ClientCache::notify(const String &name, uint32_t event_mask,
+                         const String &arg) {
+  ScopedLock lock(m_mutex);
+
+  m_generation++;
+
+  if (event_mask == EVENT_MASK_ATTR_SET || event_mask == EVENT_MASK_ATTR_DEL)
+    erase(attr_key(name, arg));
+  else if (event_mask == EVENT_MASK_CHILD_NODE_ADDED ||
+           event_mask == EVENT_MASK_CHILD_NODE_REMOVED) {
+    erase(listing_key(name));
+    erase_node(name == "/" ? "/" + arg : name + "/" + arg);
+  }
+}
+
+
+void ClientCache::clear() {
+  ScopedLock lock(m_mutex);
+  m_generation++;
+  m_stats.invalidations += m_entries.size();
+  m_entries.clear();
+  m_lru.clear();
+  m_memory_used = 0;
+}
+
+
+void ClientCache::get_stats(Stats &stats) {
+  ScopedLock lock(m_mutex);
+  stats = m_stats;
+  stats.memory_used = m_memory_used;
+  stats.entries = m_entries.size();
+}
+
+
+bool ClientCache::fillable(uint64_t generation, bool watched,
+                           int64_t *expire_timep) {
+  // an invalidation arrived while the request was outstanding
+  if (generation != m_generation)
+    return false;
+  if (watched) {
+    *expire_timep = 0;
+    return true;
+  }
+  if (m_ttl_ms == 0)
+    return false;
+  *expire_timep = now_ms() + m_ttl_ms;
+  return true;
+}
+
+
+ClientCache::Entry *ClientCache::lookup(const String &key) {
+  EntryMap::iterator iter = m_entries.find(key);
+
+  if (iter != m_entries.end() && iter->second.expire_time &&
+      iter->second.expire_time <= now_ms()) {
+    m_memory_used -= iter->second.memory;
+    m_lru.erase(iter->second.lru);
+    m_entries.erase(iter);
+    iter = m_entries.end();
+  }
+
+  if (iter == m_entries.end()) {
+    m_stats.misses++;
+    return 0;
+  }
+
+  m_stats.hits++;
+  m_lru.splice(m_lru.end(), m_lru, iter->second.lru);
+  return &iter->second;
+}
+
+
+ClientCache::Entry &ClientCache::insert(const String &key, size_t memory,
+                                        int64_t expire_time) {
+
+  erase(key);
+
+  while (!m_lru.empty() && m_memory_used + memory > m_max_memory) {
+    EntryMap::iterator iter = m_entries.find(m_lru.front());
+    HT_ASSERT(iter != m_entries.end());
+    m_memory_used -= iter->second.memory;
+    m_lru.pop_front();
+    m_entries.erase(iter);
+    m_stats.evictions++;
+  }
+
+  Entry &entry = m_entries[key];
+  entry.exists = false;
+  entry.expire_time = expire_time;
+  entry.memory = memory;
+  entry.lru = m_lru.insert(m_lru.end(), key);
+  m_memory_used += memory;
+  return entry;
+}
+
+
+void ClientCache::erase(EntryMap::iterator iter) {
+  m_memory_used -= iter->second.memory;
+  m_lru.erase(iter->second.lru);
+  m_entries.erase(iter);
+  m_stats.invalidations++;
+}
+
+
+void ClientCache::erase(const String &key) {
+  EntryMap::iterator iter = m_entries.find(key);
+  if (iter != m_entries.end())
+    erase(iter);
+}
+
+
+void ClientCache::erase_prefix(const String &prefix) {
+  EntryMap::iterator iter = m_entries.lower_bound(prefix);
+
+  while (iter != m_entries.end() &&
+         iter->first.compare(0, prefix.length(), prefix) == 0)
+    erase(iter++);
+}
@@ -0,0 +1,204 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERSPACE_CLIENTCACHE_H
+#define HYPERSPACE_CLIENTCACHE_H
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/HashMap.h"
+#include "Common/Mutex.h"
+#include "Common/ReferenceCount.h"
+#include "Common/String.h"
+
+#include "DirEntry.h"
+
+namespace Hyperspace {
+
+  using namespace Hypertable;
+
+  /**
+   * Client-side cache of node attribute values, node existence and
+   * directory listings.
+   *
+   * Entries are kept coherent through the change notifications the
+   * master delivers to this session.  A node's attribute values are
+   * coherent while at least one handle on it was opened with both
+   * EVENT_MASK_ATTR_SET and EVENT_MASK_ATTR_DEL, and its directory
+   * listing, along with the existence of its children, while at least
+   * one handle was opened with both EVENT_MASK_CHILD_NODE_ADDED and
+   * EVENT_MASK_CHILD_NODE_REMOVED.  Such entries live until they are
+   * invalidated.  Entries for nodes that are not watched are only
+   * cached when a time-to-live is configured and expire after it, which
+   * bounds how long a change made by another session can go unseen.
+   *
+   * Entries are dropped when the corresponding notification arrives,
+   * when this session modifies the node, when the last watching handle
+   * is closed, and in bulk whenever the session leaves the SAFE state,
+   * since notifications may have been missed while the lease was in
+   * doubt.  Every invalidation advances a generation number; callers
+   * read it before issuing a request and pass it back with the reply,
+   * and fills whose generation is out of date are dropped, so that an
+   * invalidation that arrives while a request is outstanding is not
+   * undone by the reply.  Entries are evicted in LRU order once the
+   * memory limit is reached.
+   */
+  class ClientCache : public ReferenceCount {
+  public:
+
+    struct Stats {
+      Stats() : hits(0), misses(0), evictions(0), invalidations(0),
+                memory_used(0), entries(0) { }
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t evictions;
+      uint64_t invalidations;
+      uint64_t memory_used;
+      uint64_t entries;
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param max_memory memory limit
+     * @param ttl_ms time-to-live in milliseconds of entries for nodes that
+     *        are not watched (0 disables caching of such entries)
+     */
+    ClientCache(uint64_t max_memory, uint32_t ttl_ms=0)
+      : m_max_memory(max_memory), m_memory_used(0), m_ttl_ms(ttl_ms),
+        m_generation(0) { }
+
+    /** Registers an open handle on node <code>name</code>. */
+    void add_watch(const String &name, uint32_t event_mask);
+
+    /** Unregisters an open handle on node <code>name</code>. */
+    void remove_watch(const String &name, uint32_t event_mask);
+
+    /**
+     * Unregisters all handles and drops all entries.  Used when the
+     * session's handles have been lost.
+     */
+    void clear_watches();
+
+    /**
+     * Returns the current generation.  Must be read before issuing the
+     * request whose reply is passed to one of the put methods.
+     */
+    uint64_t generation();
+
+    bool get_attr(const String &name, const String &attr, DynamicBuffer &value);
+    void put_attr(const String &name, const String &attr,
+                  const DynamicBuffer &value, uint64_t generation);
+
+    bool get_listing(const String &name, std::vector<DirEntry> &listing);
+    void put_listing(const String &name, const std::vector<DirEntry> &listing,
+                     uint64_t generation);
+
+    /**
+     * Answers an existence check for <code>name</code> from the cached
+     * listing of its parent directory or from a previous existence check.
+     *
+     * @param name normalized node name
+     * @param existsp address of variable to hold the answer
+     * @return true if the answer could be determined from the cache
+     */
+    bool exists(const String &name, bool *existsp);
+    void put_exists(const String &name, bool exists, uint64_t generation);
+
+    void invalidate_attr(const String &name, const String &attr);
+    void invalidate_listing(const String &name);
+
+    /**
+     * Drops all entries for node <code>name</code> along with the
+     * cached listing of its parent directory.  Used when the node is
+     * created or removed.
+     */
+    void invalidate_node(const String &name);
+
+    /** Applies a change notification received for node <code>name</code>. */
+    void notify(const String &name, uint32_t event_mask, const String &arg);
+
+    void clear();
+
+    void get_stats(Stats &stats);
+
+  private:
+
+    struct Entry {
+      String value;
+      std::vector<DirEntry> listing;
+      bool exists;
+      int64_t expire_time;
+      size_t memory;
+      std::list<String>::iterator lru;
+    };
+
+    struct Watch {
+      Watch() : attr_watchers(0), dir_watchers(0) { }
+      uint32_t attr_watchers;
+      uint32_t dir_watchers;
+    };
+
+    typedef std::map<String, Entry> EntryMap;
+    typedef hash_map<String, Watch> WatchMap;
+
+    static String attr_key(const String &name, const String &attr) {
+      return name + '\n' + 'a' + attr;
+    }
+    static String listing_key(const String &name) {
+      return name + '\n' + 'd';
+    }
+    static String exists_key(const String &name) {
+      return name + '\n' + 'e';
+    }
+
+    /**
+     * Determines whether a fill may be inserted and computes its expire
+     * time (0 if the entry is kept coherent by notifications).
+     */
+    bool fillable(uint64_t generation, bool watched, int64_t *expire_timep);
+
+    Entry *lookup(const String &key);
+    Entry &insert(const String &key, size_t memory, int64_t expire_time);
+    void erase(EntryMap::iterator iter);
+    void erase(const String &key);
+    void erase_prefix(const String &prefix);
+    void erase_node(const String &name) { erase_prefix(name + '\n'); }
+
+    Mutex m_mutex;
+    EntryMap m_entries;
+    WatchMap m_watches;
+    std::list<String> m_lru;
+    uint64_t m_max_memory;
+    uint64_t m_memory_used;
+    uint32_t m_ttl_ms;
+    uint64_t m_generation;
+    Stats m_stats;
+  };
+
+  typedef intrusive_ptr<ClientCache> ClientCachePtr;
+
+} // namespace Hyperspace
+
+#endif // HYPERSPACE_CLIENTCACHE_H
@@ -279,6 +279,8 @@ void ClientKeepaliveHandler::handle(Hypertable::EventPtr &event) {
                 event_mask == EVENT_MASK_CHILD_NODE_REMOVED) {
               name = decode_vstr(&decode_ptr, &decode_remain);
 
+              m_session->notify_cache(handle_state->normal_name, event_mask, name);
+
               if (event_id <= m_last_known_event)
                 continue;
 
@@ -71,6 +71,12 @@ using namespace std;
     m_bdb_fs->start_transaction(txn); \
     try
 
+#define HT_BDBTXN_BEGIN_READ() \
+  do { \
+    BDbTxn txn;\
+    m_bdb_fs->start_transaction(txn); \
+    try
+
 #define HT_BDBTXN_END_CB(_cb_) \
     catch (Exception &e) { \
       if (e.code() == Error::HYPERSPACE_BERKELEYDB_DEADLOCK) { \
@@ -139,6 +145,9 @@ Master::Master(ConnectionManagerPtr &conn_mgr, PropertiesPtr &props,
   m_lease_interval = props->get_i32("Hyperspace.Lease.Interval");
   m_keep_alive_interval = props->get_i32("Hyperspace.KeepAlive.Interval");
   m_maintenance_interval = props->get_i32("Hyperspace.Maintenance.Interval");
+  m_heartbeat_interval = props->get_i32("Hyperspace.Replica.Reads.HeartbeatInterval");
+  m_last_heartbeat = 0;
+  m_fence_wait = props->get_i32("Hyperspace.Replica.Reads.FenceWait");
 
   Path base_dir(props->get_str("Hyperspace.Replica.Dir"));
 
@@ -507,7 +516,7 @@ void Master::remove_expired_sessions() {
  * > Send out CHILD_NODE_ADDED notifications
  */
 void
-Master::mkdir(ResponseCallback *cb, uint64_t session_id, const char *name, const std::vector<Attribute>& init_attrs) {
+Master::mkdir(ResponseCallbackCommit *cb, uint64_t session_id, const char *name, const std::vector<Attribute>& init_attrs) {
   bool commited = false;
   CommandContext ctx("mkdir", session_id);
   HT_BDBTXN_BEGIN() {
@@ -520,6 +529,7 @@ Master::mkdir(ResponseCallback *cb, uint64_t session_id, const char *name, const
       txn.abort();
     else {
       txn.commit(0);
+      txn.get_commit_token(ctx.commit_token);
       commited = true;
     }
   }
@@ -541,47 +551,24 @@ Master::mkdir(ResponseCallback *cb, uint64_t session_id, const char *name, const
   if (commited)
     deliver_event_notifications(ctx);
 
-  if ((ctx.error = cb->response_ok()) != Error::OK)
+  if ((ctx.error = cb->response(ctx.commit_token)) != Error::OK)
     HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
 }
 
 void
-Master::mkdirs(ResponseCallback *cb, uint64_t session_id, const char *name, const std::vector<Attribute>& init_attrs) {
-  std::vector<EventContext> evts;
+Master::mkdirs(ResponseCallbackCommit *cb, uint64_t session_id, const char *name, const std::vector<Attribute>& init_attrs) {
   bool commited = false;
   CommandContext ctx("mkdirs", session_id);
   HT_BDBTXN_BEGIN() {
     commited = false;
     ctx.reset(&txn);
-    bool file_exists;
-    exists(ctx, name, file_exists);
-    if (!ctx.aborted && !file_exists) {
-      typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-      boost::char_separator<char> sep("/");
-      std::vector<String> name_components;
-      String path(name);
-      tokenizer tokens(path, sep);
-      for (tokenizer::iterator tok_iter = tokens.begin();
-            tok_iter != tokens.end(); ++tok_iter)
-        name_components.push_back(*tok_iter);
-
-      path.clear();
-      for (size_t i=0; i<name_components.size(); i++) {
-        path += String("/") + name_components[i];
-        mkdir(ctx, path.c_str());
-        if (ctx.aborted && ctx.error != Error::HYPERSPACE_FILE_EXISTS)
-          break;
-        if (init_attrs.size() && !ctx.aborted &&
-            i == name_components.size() - 1)
-          attr_set(ctx, 0, name, init_attrs);
-        ctx.reset_error();
-      }
-    }
+    mkdirs(ctx, name, init_attrs);
 
     if (ctx.aborted)
       txn.abort();
     else {
       txn.commit(0);
+      txn.get_commit_token(ctx.commit_token);
       commited = true;
     }
   }
@@ -603,7 +590,7 @@ Master::mkdirs(ResponseCallback *cb, uint64_t session_id, const char *name, cons
   if (commited)
     deliver_event_notifications(ctx);
 
-  if ((ctx.error = cb->response_ok()) != Error::OK)
+  if ((ctx.error = cb->response(ctx.commit_token)) != Error::OK)
     HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
 }
 
@@ -621,7 +608,7 @@ Master::mkdirs(ResponseCallback *cb, uint64_t session_id, const char *name, cons
  * > Deliver notifications
  */
 void
-Master::unlink(ResponseCallback *cb, uint64_t session_id, const char *name) {
+Master::unlink(ResponseCallbackCommit *cb, uint64_t session_id, const char *name) {
   bool commited = false;
   CommandContext ctx("unlink", session_id);
   HT_BDBTXN_BEGIN() {
@@ -632,6 +619,7 @@ Master::unlink(ResponseCallback *cb, uint64_t session_id, const char *name) {
       txn.abort();
     else {
       txn.commit(0);
+      txn.get_commit_token(ctx.commit_token);
       commited = true;
     }
   }
@@ -648,7 +636,7 @@ Master::unlink(ResponseCallback *cb, uint64_t session_id, const char *name) {
   if (commited)
     deliver_event_notifications(ctx);
 
-  if ((ctx.error = cb->response_ok()) != Error::OK)
+  if ((ctx.error = cb->response(ctx.commit_token)) != Error::OK)
     HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
 }
 
@@ -677,6 +665,7 @@ Master::open(ResponseCallbackOpen *cb, uint64_t session_id, const char *name,
       txn.abort();
     else {
       txn.commit(0);
+      txn.get_commit_token(ctx.commit_token);
       commited = true;
     }
   }
@@ -697,7 +686,8 @@ Master::open(ResponseCallbackOpen *cb, uint64_t session_id, const char *name,
     HT_INFOF("exitting open(session_id=%llu, session_name = %s, fname=%s, flags=0x%x, event_mask=0x%x)",
         (Llu)ctx.session_id, ctx.session_data->get_name(), name, flags, event_mask);
 
-  if ((ctx.error = cb->response(handle, created, lock_generation)) != Error::OK)
+  if ((ctx.error = cb->response(handle, created, lock_generation,
+                                  ctx.commit_token)) != Error::OK)
     HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
 }
 
@@ -775,7 +765,7 @@ void Master::close(CommandContext &ctx, uint64_t handle)
  * > Send response
  */
 void
-Master::attr_set(ResponseCallback *cb, uint64_t session_id, uint64_t handle,
+Master::attr_set(ResponseCallbackCommit *cb, uint64_t session_id, uint64_t handle,
                  const char *name, uint32_t oflags, const std::vector<Attribute> &attrs) {
 
   bool commited = false;
@@ -801,6 +791,7 @@ Master::attr_set(ResponseCallback *cb, uint64_t session_id, uint64_t handle,
       txn.abort();
     else {
       txn.commit(0);
+      txn.get_commit_token(ctx.commit_token);
       commited = true;
     }
   }
@@ -826,7 +817,7 @@ Master::attr_set(ResponseCallback *cb, uint64_t session_id, uint64_t handle,
     }
   }
 
-  if ((ctx.error = cb->response_ok()) != Error::OK)
+  if ((ctx.error = cb->response(ctx.commit_token)) != Error::OK)
     HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
 }
 
@@ -904,8 +895,10 @@ Master::attr_incr(ResponseCallbackAttrIncr *cb, uint64_t session_id,
     attr_incr(ctx, handle, name, attr, attr_val);
     if (ctx.aborted)
       txn.abort();
-    else
+    else {
       txn.commit(0);
+      txn.get_commit_token(ctx.commit_token);
+    }
   }
   HT_BDBTXN_END_CB(cb);
 
@@ -915,7 +908,7 @@ Master::attr_incr(ResponseCallbackAttrIncr *cb, uint64_t session_id,
     return;
   }
 
-  if ((ctx.error = cb->response(attr_val)) != Error::OK)
+  if ((ctx.error = cb->response(attr_val, ctx.commit_token)) != Error::OK)
     HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
 }
 
@@ -932,7 +925,7 @@ Master::attr_incr(ResponseCallbackAttrIncr *cb, uint64_t session_id,
  *
  */
 void
-Master::attr_del(ResponseCallback *cb, uint64_t session_id, uint64_t handle,
+Master::attr_del(ResponseCallbackCommit *cb, uint64_t session_id, uint64_t handle,
                  const char *name) {
   bool commited = false;
   CommandContext ctx("attrdel", session_id);
@@ -944,6 +937,7 @@ Master::attr_del(ResponseCallback *cb, uint64_t session_id, uint64_t handle,
       txn.abort();
     else {
       txn.commit(0);
+      txn.get_commit_token(ctx.commit_token);
       commited = true;
     }
   }
@@ -960,7 +954,7 @@ Master::attr_del(ResponseCallback *cb, uint64_t session_id, uint64_t handle,
   if (commited)
     deliver_event_notifications(ctx);
 
-  if ((ctx.error = cb->response_ok()) != Error::OK)
+  if ((ctx.error = cb->response(ctx.commit_token)) != Error::OK)
     HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
 }
 
@@ -1160,6 +1154,157 @@ Master::readpath_attr(ResponseCallbackReadpathAttr *cb, uint64_t session_id,
     HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
 }
 
+/**
+ * multi does the following:
+ *
+ * > Start BDB txn
+ *   > Execute each operation of the batch, in order, stopping at the first
+ *     one that fails
+ *   > Persist event notifications of all operations
+ * > Commit (or abort) BDB txn, a single replication round for the batch
+ * > Deliver event notifications
+ * > Destroy handles opened implicitly by by-name ATTR_SET operations
+ * > Send the results of all operations back in one response
+ */
+void
+Master::multi(ResponseCallbackMulti *cb, uint64_t session_id,
+              std::vector<MultiOp> &ops) {
+  bool commited = false;
+  std::vector<MultiOpResult> results;
+  std::vector<uint64_t> opened_handles;
+  size_t ii = 0;
+  CommandContext ctx("multi", session_id);
+  HT_BDBTXN_BEGIN() {
+    commited = false;
+    ctx.reset(&txn);
+    results.clear();
+    results.resize(ops.size());
+    opened_handles.clear();
+    for (ii=0; ii<ops.size(); ii++) {
+      multi(ctx, ops[ii], results[ii], opened_handles);
+      if (ctx.aborted)
+        break;
+    }
+    if (ctx.aborted)
+      txn.abort();
+    else {
+      txn.commit(0);
+      txn.get_commit_token(ctx.commit_token);
+      commited = true;
+    }
+  }
+  HT_BDBTXN_END_CB(cb);
+
+  // check for errors
+  if (ctx.aborted) {
+    String error_msg = format("operation %u of %u - %s", (unsigned)ii,
+                              (unsigned)ops.size(), ctx.error_msg.c_str());
+    // callers probe for these, don't flood the log with them
+    if (ctx.error == Error::HYPERSPACE_FILE_EXISTS ||
+        ctx.error == Error::HYPERSPACE_FILE_NOT_FOUND)
+      HT_DEBUG_OUT << Error::get_text(ctx.error) << " - " << error_msg << HT_END;
+    else
+      HT_ERROR_OUT << Error::get_text(ctx.error) << " - " << error_msg << HT_END;
+    cb->error(ctx.error, error_msg);
+    return;
+  }
+
+  // deliver notifications
+  if (commited)
+    deliver_event_notifications(ctx);
+
+  foreach (uint64_t handle, opened_handles) {
+    if (!destroy_handle(handle, ctx.error, ctx.error_msg)) {
+      cb->error(ctx.error, ctx.error_msg);
+      return;
+    }
+  }
+
+  if ((ctx.error = cb->response(ops, results, ctx.commit_token)) != Error::OK)
+    HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
+}
+
+/**
+ * replica_read does the following:
+ *
+ * > If running on a replica, wait (briefly) until the transactions of the
+ *   client's write fence have been applied locally
+ * > Start BDB txn (read-only, may run on a replica)
+ *   > Validate the session
+ *   > If running on a replica, check that the last replicated heartbeat
+ *     satisfies the staleness bound
+ *   > Execute each read-only operation of the batch
+ * > End BDB txn
+ * > Send the results of all operations back in one response
+ */
+void
+Master::replica_read(ResponseCallbackMulti *cb, uint64_t session_id,
+                     uint32_t max_staleness_ms, const std::vector<String> &fence,
+                     std::vector<MultiOp> &ops) {
+  std::vector<MultiOpResult> results;
+  std::vector<uint64_t> opened_handles;
+  size_t ii = 0;
+  CommandContext ctx("replicaread", session_id);
+
+  if (!is_master()) {
+    if (!m_bdb_fs->is_readable_replica()) {
+      cb->error(Error::HYPERSPACE_REPLICA_STALE, "Replica not synchronized");
+      return;
+    }
+    // read-your-writes: the replica must have applied the client's mutations
+    foreach(const String &token, fence) {
+      if (!m_bdb_fs->txn_applied(token, m_fence_wait)) {
+        cb->error(Error::HYPERSPACE_REPLICA_STALE, "Write fence not reached");
+        return;
+      }
+    }
+  }
+
+  HT_BDBTXN_BEGIN_READ() {
+    ctx.reset(&txn);
+    ctx.replica_read = true;
+    results.clear();
+    results.resize(ops.size());
+    if (validate_session(ctx) && !is_master()) {
+      // heartbeat and now are both taken from server clocks
+      uint64_t heartbeat = 0;
+      int64_t now = get_ts64() / 1000000LL;
+      m_bdb_fs->get_xattr_i64(txn, "/hyperspace/metadata",
+                              "replica_heartbeat", &heartbeat);
+      if ((int64_t)heartbeat + (int64_t)max_staleness_ms < now)
+        ctx.set_error(Error::HYPERSPACE_REPLICA_STALE,
+                      format("heartbeat=%lld now=%lld", (Lld)heartbeat,
+                             (Lld)now));
+    }
+    for (ii=0; ii<ops.size() && !ctx.aborted; ii++) {
+      if (ops[ii].is_mutation() || ops[ii].handle) {
+        ctx.set_error(Error::PROTOCOL_ERROR,
+                      format("Operation type %d not allowed in replica read",
+                             (int)ops[ii].type));
+        break;
+      }
+      multi(ctx, ops[ii], results[ii], opened_handles);
+    }
+    txn.abort();
+  }
+  HT_BDBTXN_END_CB(cb);
+
+  if (ctx.aborted) {
+    if (ctx.error == Error::HYPERSPACE_REPLICA_STALE ||
+        ctx.error == Error::HYPERSPACE_EXPIRED_SESSION ||
+        ctx.error == Error::HYPERSPACE_ATTR_NOT_FOUND ||
+        ctx.error == Error::HYPERSPACE_FILE_NOT_FOUND)
+      HT_DEBUG_OUT << Error::get_text(ctx.error) << " - " << ctx.error_msg << HT_END;
+    else
+      HT_ERROR_OUT << Error::get_text(ctx.error) << " - " << ctx.error_msg << HT_END;
+    cb->error(ctx.error, ctx.error_msg);
+    return;
+  }
+
+  if ((ctx.error = cb->response(ops, results, String())) != Error::OK)
+    HT_ERRORF("Problem sending back response - %s", Error::get_text(ctx.error));
+}
+
 /**
  * shutdown
  */
@@ -1820,6 +1965,26 @@ Master::destroy_handle(uint64_t handle, int &error, String &errmsg,
 /**
  *
  */
+void Master::write_replica_heartbeat() {
+  if (!is_master() || !m_bdb_fs->is_replicated())
+    return;
+
+  int64_t now = get_ts64() / 1000000LL;
+  {
+    ScopedLock lock(m_last_tick_mutex);
+    if (now - m_last_heartbeat < m_heartbeat_interval)
+      return;
+    m_last_heartbeat = now;
+  }
+
+  HT_BDBTXN_BEGIN() {
+    m_bdb_fs->set_xattr_i64(txn, "/hyperspace/metadata", "replica_heartbeat",
+                            (uint64_t)now);
+    txn.commit(0);
+  }
+  HT_BDBTXN_END(BOOST_PP_EMPTY());
+}
+
 void Master::do_maintenance() {
 
   {
@@ -1888,6 +2053,35 @@ void Master::mkdir(CommandContext &ctx, const char *name) {
 
 
 
+void Master::mkdirs(CommandContext &ctx, const char *name,
+                    const std::vector<Attribute>& init_attrs) {
+  bool file_exists;
+  exists(ctx, name, file_exists);
+  if (ctx.aborted || file_exists)
+    return;
+
+  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
+  boost::char_separator<char> sep("/");
+  std::vector<String> name_components;
+  String path(name);
+  tokenizer tokens(path, sep);
+  for (tokenizer::iterator tok_iter = tokens.begin();
+        tok_iter != tokens.end(); ++tok_iter)
+    name_components.push_back(*tok_iter);
+
+  path.clear();
+  for (size_t i=0; i<name_components.size(); i++) {
+    path += String("/") + name_components[i];
+    mkdir(ctx, path.c_str());
+    if (ctx.aborted && ctx.error != Error::HYPERSPACE_FILE_EXISTS)
+      break;
+    if (init_attrs.size() && !ctx.aborted &&
+        i == name_components.size() - 1)
+      attr_set(ctx, 0, name, init_attrs);
+    ctx.reset_error();
+  }
+}
+
 void Master::open(CommandContext &ctx, const char *name,
           uint32_t flags, uint32_t event_mask,
           std::vector<Attribute> &init_attrs, uint64_t& handle,
@@ -2351,6 +2545,74 @@ void Master::readpath_attr(CommandContext& ctx, uint64_t handle, const char *nam
   }
 }
 
+void Master::multi(CommandContext &ctx, MultiOp &op, MultiOpResult &result,
+                   std::vector<uint64_t> &opened_handles) {
+  const char *name = op.handle ? 0 : op.name.c_str();
+
+  // by-name operations that take no handle require a normalized name
+  if (!op.handle &&
+      (op.name.empty() || op.name[0] != '/' ||
+       (op.name.length() > 1 && op.name[op.name.length()-1] == '/'))) {
+    ctx.set_error(Error::HYPERSPACE_BAD_PATHNAME, (String)"name '" + op.name + "'");
+    return;
+  }
+
+  switch (op.type) {
+  case MultiOp::MKDIR:
+    mkdir(ctx, name);
+    if (!op.attrs.empty() && !ctx.aborted)
+      attr_set(ctx, 0, name, op.attrs);
+    break;
+  case MultiOp::MKDIRS:
+    mkdirs(ctx, name, op.attrs);
+    break;
+  case MultiOp::UNLINK:
+    unlink(ctx, name);
+    break;
+  case MultiOp::EXISTS:
+    exists(ctx, name, result.exists);
+    break;
+  case MultiOp::ATTR_SET:
+    if (op.handle || !(op.oflags & ~(OPEN_FLAG_READ|OPEN_FLAG_WRITE)))
+      attr_set(ctx, op.handle, name, op.attrs);
+    else {
+      bool created;
+      uint64_t opened_handle = 0, lock_generation;
+      std::vector<Attribute> none;
+      open(ctx, name, op.oflags, 0, none, opened_handle, created, lock_generation);
+      if (!ctx.aborted) {
+        opened_handles.push_back(opened_handle);
+        attr_set(ctx, opened_handle, 0, op.attrs);
+        close(ctx, opened_handle);
+      }
+    }
+    break;
+  case MultiOp::ATTR_GET:
+    result.value = new DynamicBuffer();
+    attr_get(ctx, op.handle, name, op.attr.c_str(), *result.value);
+    break;
+  case MultiOp::ATTR_INCR:
+    attr_incr(ctx, op.handle, name, op.attr.c_str(), result.attr_val);
+    break;
+  case MultiOp::ATTR_DEL:
+    attr_del(ctx, op.handle, op.attr.c_str());
+    break;
+  case MultiOp::ATTR_EXISTS:
+    attr_exists(ctx, op.handle, name, op.attr.c_str(), result.exists);
+    break;
+  case MultiOp::READDIR_ATTR:
+    readdir_attr(ctx, op.handle, name, op.attr.c_str(),
+                 op.include_sub_entries, result.listing);
+    break;
+  case MultiOp::READPATH_ATTR:
+    readpath_attr(ctx, op.handle, name, op.attr.c_str(), result.listing);
+    break;
+  default:
+    ctx.set_error(Error::PROTOCOL_ERROR, format("Unrecognized operation type %d",
+                                                (int)op.type));
+  }
+}
+
 /**
  * Validates the session and returns the node for the handle specified
  */
@@ -2391,17 +2653,36 @@ bool Master::get_handle_node(CommandContext &ctx, uint64_t handle, const char* a
 }
 
 /**
- * Validates the session and returns the node for the name specified
+ * Validates the session.  Replicas hold no session leases, so on a replica
+ * the session must exist in the replicated state and not be marked expired.
  */
-bool Master::get_named_node(CommandContext &ctx, const char *name, const char* attr, String &node, bool *is_dir) {
-  if (!ctx.session_data) {
-    if (!get_session(ctx.session_id, ctx.session_data)) {
-      ctx.set_error(Error::HYPERSPACE_EXPIRED_SESSION, format("Session %llu", (Llu)ctx.session_id));
-      return false;
+bool Master::validate_session(CommandContext &ctx) {
+  if (ctx.session_data || ctx.session_validated)
+    return true;
+
+  if (ctx.replica_read && !is_master()) {
+    HT_ASSERT(ctx.txn);
+    if (m_bdb_fs->session_exists(*ctx.txn, ctx.session_id) &&
+        !m_bdb_fs->session_expired(*ctx.txn, ctx.session_id)) {
+      ctx.session_validated = true;
+      return true;
     }
   }
+  else if (get_session(ctx.session_id, ctx.session_data))
+    return true;
 
-  if (m_verbose) {
+  ctx.set_error(Error::HYPERSPACE_EXPIRED_SESSION, format("Session %llu", (Llu)ctx.session_id));
+  return false;
+}
+
+/**
+ * Validates the session and returns the node for the name specified
+ */
+bool Master::get_named_node(CommandContext &ctx, const char *name, const char* attr, String &node, bool *is_dir) {
+  if (!validate_session(ctx))
+    return false;
+
+  if (m_verbose && ctx.session_data) {
     if (attr && *attr)
       HT_INFOF("%s(session=%llu(%s), name=%s, attr=%s)", ctx.friendly_name,
                  (Llu)ctx.session_id, ctx.session_data->get_name(), name, attr);
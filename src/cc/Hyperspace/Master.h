@@ -45,7 +45,9 @@
 #include "ResponseCallbackAttrIncr.h"
 #include "ResponseCallbackAttrExists.h"
 #include "ResponseCallbackAttrList.h"
+#include "ResponseCallbackCommit.h"
 #include "ResponseCallbackLock.h"
+#include "ResponseCallbackMulti.h"
 #include "ResponseCallbackReaddir.h"
 #include "ResponseCallbackReaddirAttr.h"
 #include "ResponseCallbackReadpathAttr.h"
@@ -83,20 +85,20 @@ namespace Hyperspace {
         return (String) "";
     };
     // Hyperspace command implementations
-    void mkdir(ResponseCallback *cb, uint64_t session_id, const char *name, const std::vector<Attribute>& init_attrs);
-    void mkdirs(ResponseCallback *cb, uint64_t session_id, const char *name, const std::vector<Attribute>& init_attrs);
-    void unlink(ResponseCallback *cb, uint64_t session_id, const char *name);
+    void mkdir(ResponseCallbackCommit *cb, uint64_t session_id, const char *name, const std::vector<Attribute>& init_attrs);
+    void mkdirs(ResponseCallbackCommit *cb, uint64_t session_id, const char *name, const std::vector<Attribute>& init_attrs);
+    void unlink(ResponseCallbackCommit *cb, uint64_t session_id, const char *name);
     void open(ResponseCallbackOpen *cb, uint64_t session_id, const char *name,
               uint32_t flags, uint32_t event_mask,
               std::vector<Attribute> &init_attrs);
     void close(ResponseCallback *cb, uint64_t session_id, uint64_t handle);
-    void attr_set(ResponseCallback *cb, uint64_t session_id, uint64_t handle,
+    void attr_set(ResponseCallbackCommit *cb, uint64_t session_id, uint64_t handle,
                   const char *name, uint32_t oflags, const std::vector<Attribute> &attrs);
     void attr_get(ResponseCallbackAttrGet *cb, uint64_t session_id,
                   uint64_t handle, const char *name, const std::vector<String> &attrs);
     void attr_incr(ResponseCallbackAttrIncr *cb, uint64_t session_id,
                    uint64_t handle, const char *name, const char *attr);
-    void attr_del(ResponseCallback *cb, uint64_t session_id, uint64_t handle,
+    void attr_del(ResponseCallbackCommit *cb, uint64_t session_id, uint64_t handle,
                   const char *name);
     void attr_exists(ResponseCallbackAttrExists *cb, uint64_t session_id, uint64_t handle,
                      const char *name, const char *attr);
@@ -111,6 +113,20 @@ namespace Hyperspace {
                       bool include_sub_entries);
     void readpath_attr(ResponseCallbackReadpathAttr *cb, uint64_t session_id,
                        uint64_t handle, const char *name, const char *attr);
+    void multi(ResponseCallbackMulti *cb, uint64_t session_id,
+               std::vector<MultiOp> &ops);
+    /**
+     * Executes a batch of read-only, by-name operations.  Can be served by a
+     * replica, in which case the request fails with
+     * Error::HYPERSPACE_REPLICA_STALE if the replica has not applied every
+     * transaction in fence (the commit tokens of the client's recent
+     * mutations, see WriteFence) or if the last replicated master heartbeat
+     * is older than max_staleness_ms.
+     */
+    void replica_read(ResponseCallbackMulti *cb, uint64_t session_id,
+                      uint32_t max_staleness_ms,
+                      const std::vector<String> &fence,
+                      std::vector<MultiOp> &ops);
     void shutdown(ResponseCallback *cb, uint64_t session_id);
     void lock(ResponseCallbackLock *cb, uint64_t session_id, uint64_t handle,
               uint32_t mode, bool try_lock);
@@ -168,6 +184,13 @@ namespace Hyperspace {
 
     void do_maintenance();
 
+    /**
+     * On the replication master, periodically records the current time in
+     * the replicated state so replicas can bound the staleness of the reads
+     * they serve.
+     */
+    void write_replica_heartbeat();
+
   private:
 
     struct EventContext {
@@ -195,12 +218,17 @@ namespace Hyperspace {
       BDbTxn *txn;
       std::vector<EventContext> evts;
       bool aborted;
+      bool replica_read;
+      bool session_validated;
       int error;
       String error_msg;
+      /** Commit token of the transaction, returned with the response */
+      String commit_token;
 
       CommandContext(const char* _friendly_name, uint64_t _session_id)
         : friendly_name(_friendly_name), session_id(_session_id), txn(0),
-          aborted(false), error(Error::OK) {}
+          aborted(false), replica_read(false), session_validated(false),
+          error(Error::OK) {}
 
       void set_error(int _error, const char *_error_msg, bool abort=true) {
         error = _error;
@@ -222,13 +250,17 @@ namespace Hyperspace {
 
       void reset(BDbTxn *_txn) {
         session_data = 0;
+        session_validated = false;
         txn = _txn;
         evts.clear();
+        commit_token.clear();
         reset_error();
       }
     };
 
     void mkdir(CommandContext &ctx, const char *name);
+    void mkdirs(CommandContext &ctx, const char *name,
+                const std::vector<Attribute>& init_attrs);
     void unlink(CommandContext &ctx, const char *name);
     void open(CommandContext &ctx, const char *name,
               uint32_t flags, uint32_t event_mask,
@@ -254,6 +286,9 @@ namespace Hyperspace {
                       bool include_sub_entries, std::vector<DirEntryAttr>& listing);
     void readpath_attr(CommandContext& ctx, uint64_t handle, const char *name, const char *attr,
                        std::vector<DirEntryAttr>& listing);
+    void multi(CommandContext &ctx, MultiOp &op, MultiOpResult &result,
+               std::vector<uint64_t> &opened_handles);
+    bool validate_session(CommandContext &ctx);
     bool get_handle_node(CommandContext &ctx, uint64_t handle, const char* attr, String &node);
     bool get_named_node(CommandContext &ctx, const char *name, const char* attr, String &node, bool *is_dir=0);
     void create_event(CommandContext &ctx, const String &node,
@@ -325,6 +360,9 @@ namespace Hyperspace {
     boost::xtime  m_last_tick;
     uint64_t      m_lease_credit;
     bool          m_shutdown;
+    int32_t       m_heartbeat_interval;
+    int64_t       m_last_heartbeat;
+    uint32_t      m_fence_wait;
 
     // BerkeleyDB state
     BerkeleyDbFilesystem *m_bdb_fs;
@@ -0,0 +1,194 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Serialization.h"
+
+#include <algorithm>
+
+#include "MultiOp.h"
+
+using namespace Hypertable;
+using namespace Serialization;
+
+namespace Hyperspace {
+
+  size_t encoded_length_multi_op(const MultiOp &op) {
+    size_t len = 1 + 1 + 4 + encoded_length_vstr(op.attr) + 1 + 4;
+    if (op.handle)
+      len += 8;
+    else
+      len += encoded_length_vstr(op.name);
+    foreach(const Attribute &attr, op.attrs)
+      len += encoded_length_vstr(attr.name) +
+        encoded_length_vstr(attr.value_len);
+    return len;
+  }
+
+  void encode_multi_op(uint8_t **bufp, const MultiOp &op) {
+    encode_i8(bufp, op.type);
+    encode_bool(bufp, op.handle == 0);
+    if (op.handle)
+      encode_i64(bufp, op.handle);
+    else
+      encode_vstr(bufp, op.name);
+    encode_i32(bufp, op.oflags);
+    encode_vstr(bufp, op.attr);
+    encode_bool(bufp, op.include_sub_entries);
+    encode_i32(bufp, op.attrs.size());
+    foreach(const Attribute &attr, op.attrs) {
+      encode_vstr(bufp, attr.name);
+      encode_vstr(bufp, attr.value, attr.value_len);
+    }
+  }
+
+  MultiOp &decode_multi_op(const uint8_t **bufp, size_t *remainp, MultiOp &op) {
+    op.type = decode_i8(bufp, remainp);
+    if (decode_bool(bufp, remainp)) {
+      op.handle = 0;
+      op.name = decode_vstr(bufp, remainp);
+    }
+    else {
+      op.handle = decode_i64(bufp, remainp);
+      op.name.clear();
+    }
+    op.oflags = decode_i32(bufp, remainp);
+    op.attr = decode_vstr(bufp, remainp);
+    op.include_sub_entries = decode_bool(bufp, remainp);
+    uint32_t attr_count = decode_i32(bufp, remainp);
+    Attribute attr;
+    op.attrs.clear();
+    // attr_count comes off the wire; each attribute takes at least four
+    // bytes (two empty vstrs), so don't reserve more than could be present
+    op.attrs.reserve(std::min((size_t)attr_count, *remainp / 4));
+    while (attr_count--) {
+      attr.name = decode_vstr(bufp, remainp);
+      attr.value = decode_vstr(bufp, remainp, &attr.value_len);
+      op.attrs.push_back(attr);
+    }
+    return op;
+  }
+
+  void decode_multi_ops(const uint8_t **bufp, size_t *remainp,
+                        std::vector<MultiOp> &ops) {
+    uint32_t op_count = decode_i32(bufp, remainp);
+    ops.clear();
+    // Grow one operation at a time; a bogus count from a malformed or
+    // truncated request runs into an input overrun instead of an allocation
+    while (op_count--) {
+      ops.push_back(MultiOp());
+      decode_multi_op(bufp, remainp, ops.back());
+    }
+  }
+
+  size_t encoded_length_multi_op_result(const MultiOp &op,
+                                        const MultiOpResult &result) {
+    switch (op.type) {
+    case MultiOp::EXISTS:
+    case MultiOp::ATTR_EXISTS:
+      return 1;
+    case MultiOp::ATTR_GET:
+      return encoded_length_bytes32(result.value ? result.value->fill() : 0);
+    case MultiOp::ATTR_INCR:
+      return 8;
+    case MultiOp::READDIR_ATTR:
+    case MultiOp::READPATH_ATTR:
+      {
+        size_t len = 4;
+        foreach(const DirEntryAttr &entry, result.listing)
+          len += encoded_length_dir_entry_attr(entry);
+        return len;
+      }
+    default:
+      break;
+    }
+    return 0;
+  }
+
+  void encode_multi_op_result(uint8_t **bufp, const MultiOp &op,
+                              const MultiOpResult &result) {
+    switch (op.type) {
+    case MultiOp::EXISTS:
+    case MultiOp::ATTR_EXISTS:
+      encode_bool(bufp, result.exists);
+      break;
+    case MultiOp::ATTR_GET:
+      if (result.value)
+        encode_bytes32(bufp, result.value->base, result.value->fill());
+      else
+        encode_i32(bufp, 0);
+      break;
+    case MultiOp::ATTR_INCR:
+      encode_i64(bufp, result.attr_val);
+      break;
+    case MultiOp::READDIR_ATTR:
+    case MultiOp::READPATH_ATTR:
+      encode_i32(bufp, result.listing.size());
+      foreach(const DirEntryAttr &entry, result.listing)
+        encode_dir_entry_attr(bufp, entry);
+      break;
+    default:
+      break;
+    }
+  }
+
+  MultiOpResult &decode_multi_op_result(const uint8_t **bufp, size_t *remainp,
+                                        const MultiOp &op,
+                                        MultiOpResult &result) {
+    switch (op.type) {
+    case MultiOp::EXISTS:
+    case MultiOp::ATTR_EXISTS:
+      result.exists = decode_bool(bufp, remainp);
+      break;
+    case MultiOp::ATTR_GET:
+      {
+        uint32_t attr_val_len;
+        void *attr_val = decode_bytes32(bufp, remainp, &attr_val_len);
+        result.value = new DynamicBuffer(attr_val_len+1);
+        result.value->add_unchecked(attr_val, attr_val_len);
+        // nul-terminate to make caller's lives easier
+        *result.value->ptr = 0;
+      }
+      break;
+    case MultiOp::ATTR_INCR:
+      result.attr_val = decode_i64(bufp, remainp);
+      break;
+    case MultiOp::READDIR_ATTR:
+    case MultiOp::READPATH_ATTR:
+      {
+        uint32_t entry_cnt = decode_i32(bufp, remainp);
+        DirEntryAttr dentry;
+        result.listing.clear();
+        result.listing.reserve(std::min((size_t)entry_cnt, *remainp));
+        while (entry_cnt--) {
+          decode_dir_entry_attr(bufp, remainp, dentry);
+          result.listing.push_back(dentry);
+        }
+      }
+      break;
+    default:
+      break;
+    }
+    return result;
+  }
+
+}
@@ -0,0 +1,219 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERSPACE_MULTIOP_H
+#define HYPERSPACE_MULTIOP_H
+
+#include <vector>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/String.h"
+
+#include "DirEntryAttr.h"
+#include "Protocol.h"
+
+namespace Hyperspace {
+
+  /**
+   * A single operation of a batched (MULTI) request.  All operations of a
+   * batch are executed by the master, in order, inside one BerkeleyDB
+   * transaction: either all of them are committed (and replicated) together
+   * or, if any one of them fails, none of them are.  Operations refer to a
+   * node either by an open handle or, when handle is zero, by name (ATTR_DEL
+   * requires a handle).
+   */
+  class MultiOp {
+  public:
+    enum {
+      MKDIR        = 1,
+      MKDIRS       = 2,
+      UNLINK       = 3,
+      EXISTS       = 4,
+      ATTR_SET     = 5,
+      ATTR_GET     = 6,
+      ATTR_INCR    = 7,
+      ATTR_DEL     = 8,
+      ATTR_EXISTS  = 9,
+      READDIR_ATTR = 10,
+      READPATH_ATTR = 11
+    };
+
+    MultiOp() : type(0), handle(0), oflags(0), include_sub_entries(false) { }
+
+    static MultiOp mkdir(const String &name, bool create_intermediate=false,
+                         const std::vector<Attribute> *init_attrs=0) {
+      MultiOp op(create_intermediate ? MKDIRS : MKDIR, 0, name);
+      if (init_attrs)
+        op.attrs = *init_attrs;
+      return op;
+    }
+    static MultiOp unlink(const String &name) {
+      return MultiOp(UNLINK, 0, name);
+    }
+    static MultiOp exists(const String &name) {
+      return MultiOp(EXISTS, 0, name);
+    }
+    static MultiOp attr_set(uint64_t handle, const String &name,
+                            uint32_t oflags,
+                            const std::vector<Attribute> &attrs) {
+      MultiOp op(ATTR_SET, handle, name);
+      op.oflags = oflags;
+      op.attrs = attrs;
+      return op;
+    }
+    static MultiOp attr_set(uint64_t handle, const String &name,
+                            uint32_t oflags, const char *attr,
+                            const void *value, size_t value_len) {
+      std::vector<Attribute> attrs;
+      attrs.push_back(Attribute(attr, value, value_len));
+      return attr_set(handle, name, oflags, attrs);
+    }
+    static MultiOp attr_get(uint64_t handle, const String &name,
+                            const String &attr) {
+      MultiOp op(ATTR_GET, handle, name);
+      op.attr = attr;
+      return op;
+    }
+    static MultiOp attr_incr(uint64_t handle, const String &name,
+                             const String &attr) {
+      MultiOp op(ATTR_INCR, handle, name);
+      op.attr = attr;
+      return op;
+    }
+    static MultiOp attr_del(uint64_t handle, const String &attr) {
+      MultiOp op(ATTR_DEL, handle, String());
+      op.attr = attr;
+      return op;
+    }
+    static MultiOp attr_exists(uint64_t handle, const String &name,
+                               const String &attr) {
+      MultiOp op(ATTR_EXISTS, handle, name);
+      op.attr = attr;
+      return op;
+    }
+    static MultiOp readdir_attr(uint64_t handle, const String &name,
+                                const String &attr,
+                                bool include_sub_entries) {
+      MultiOp op(READDIR_ATTR, handle, name);
+      op.attr = attr;
+      op.include_sub_entries = include_sub_entries;
+      return op;
+    }
+
+    static MultiOp readpath_attr(uint64_t handle, const String &name,
+                                 const String &attr) {
+      MultiOp op(READPATH_ATTR, handle, name);
+      op.attr = attr;
+      return op;
+    }
+
+    /** Returns true if the operation modifies the namespace */
+    bool is_mutation() const {
+      return type == MKDIR || type == MKDIRS || type == UNLINK ||
+        type == ATTR_SET || type == ATTR_INCR || type == ATTR_DEL;
+    }
+
+    /** Operation type (one of the enum values above) */
+    uint8_t type;
+    /** Handle of the node to operate on, or 0 if addressed by name */
+    uint64_t handle;
+    /** Name of the node to operate on (used when handle is 0) */
+    String name;
+    /** Open flags for a by-name ATTR_SET (e.g. OPEN_FLAG_CREATE) */
+    uint32_t oflags;
+    /** Attribute name for ATTR_GET, ATTR_INCR, ATTR_DEL, ATTR_EXISTS,
+     * READDIR_ATTR and READPATH_ATTR */
+    String attr;
+    /** Attributes for ATTR_SET and initial attributes for MKDIR(S).  The
+     * name and value memory is owned by the caller. */
+    std::vector<Attribute> attrs;
+    /** Whether READDIR_ATTR should descend into sub-directories */
+    bool include_sub_entries;
+
+  private:
+    MultiOp(uint8_t t, uint64_t h, const String &n)
+      : type(t), handle(h), name(h ? String() : n), oflags(0),
+        include_sub_entries(false) { }
+  };
+
+  /**
+   * Result of a single operation of a batched (MULTI) request.  Only the
+   * member corresponding to the operation type is filled in.
+   */
+  struct MultiOpResult {
+    MultiOpResult() : exists(false), attr_val(0) { }
+    /** EXISTS and ATTR_EXISTS */
+    bool exists;
+    /** ATTR_INCR: value of the attribute before it was incremented */
+    uint64_t attr_val;
+    /** ATTR_GET: attribute value (nul-terminated) */
+    DynamicBufferPtr value;
+    /** READDIR_ATTR and READPATH_ATTR: directory listing */
+    std::vector<DirEntryAttr> listing;
+  };
+
+  /** Returns the number of bytes required to encode the given operation */
+  size_t encoded_length_multi_op(const MultiOp &op);
+
+  /** Encodes (serializes) the given operation to a buffer.
+   *
+   * @param bufp address of pointer to buffer (advanced passed the encoded op)
+   * @param op the operation to encode
+   */
+  void encode_multi_op(uint8_t **bufp, const MultiOp &op);
+
+  /** Decodes (unserializes) an operation from a buffer.  The names and values
+   * of op.attrs point into the buffer, which must outlive op.
+   *
+   * @param bufp address of pointer to encoded operation (advanced after decode)
+   * @param remainp address of count of bytes remaining (decremented)
+   * @param op the operation to decode into
+   */
+  MultiOp &decode_multi_op(const uint8_t **bufp, size_t *remainp, MultiOp &op);
+
+  /**
+   * Decodes an i32 operation count followed by that many operations, as
+   * encoded by Protocol::create_multi_request.  Operations are appended as
+   * they are decoded, so the count is never trusted for allocation.
+   *
+   * @param bufp address of pointer to encoded operations (advanced after decode)
+   * @param remainp address of count of bytes remaining (decremented)
+   * @param ops vector to decode the operations into (cleared first)
+   */
+  void decode_multi_ops(const uint8_t **bufp, size_t *remainp,
+                        std::vector<MultiOp> &ops);
+
+  /** Returns the number of bytes required to encode the result of op */
+  size_t encoded_length_multi_op_result(const MultiOp &op,
+                                        const MultiOpResult &result);
+
+  /** Encodes (serializes) the result of the given operation to a buffer */
+  void encode_multi_op_result(uint8_t **bufp, const MultiOp &op,
+                              const MultiOpResult &result);
+
+  /** Decodes (unserializes) the result of the given operation from a buffer */
+  MultiOpResult &decode_multi_op_result(const uint8_t **bufp, size_t *remainp,
+                                        const MultiOp &op,
+                                        MultiOpResult &result);
+
+}
+
+#endif // HYPERSPACE_MULTIOP_H
@@ -29,6 +29,7 @@
 
 #include "AsyncComm/CommHeader.h"
 
+#include "MultiOp.h"
 #include "Protocol.h"
 
 using namespace std;
@@ -62,7 +63,9 @@ const char *Hyperspace::Protocol::command_strs[COMMAND_MAX] = {
   "readdirattr",
   "attrincr",
   "readpathattr",
-  "shutdown"
+  "shutdown",
+  "multi",
+  "replicaread"
 };
 
 
@@ -500,3 +503,44 @@ CommBuf *Hyperspace::Protocol::create_shutdown_request() {
   CommBuf *cbuf = new CommBuf(header, 0);
   return cbuf;
 }
+
+
+CommBuf *
+Hyperspace::Protocol::create_multi_request(const std::vector<MultiOp> &ops) {
+  CommHeader header(COMMAND_MULTI);
+  size_t len = 4;
+  foreach(const MultiOp &op, ops)
+    len += encoded_length_multi_op(op);
+  if (!ops.empty() && !ops.front().name.empty())
+    header.gid = filename_to_group(ops.front().name);
+  CommBuf *cbuf = new CommBuf(header, len);
+  cbuf->append_i32(ops.size());
+  foreach(const MultiOp &op, ops)
+    encode_multi_op(cbuf->get_data_ptr_address(), op);
+  return cbuf;
+}
+
+
+CommBuf *
+Hyperspace::Protocol::create_replica_read_request(uint64_t session_id,
+    uint32_t max_staleness_ms, const std::vector<String> &fence,
+    const std::vector<MultiOp> &ops) {
+  CommHeader header(COMMAND_REPLICA_READ);
+  size_t len = 8 + 4 + 4 + 4;
+  foreach(const String &token, fence)
+    len += encoded_length_vstr(token);
+  foreach(const MultiOp &op, ops)
+    len += encoded_length_multi_op(op);
+  if (!ops.empty() && !ops.front().name.empty())
+    header.gid = filename_to_group(ops.front().name);
+  CommBuf *cbuf = new CommBuf(header, len);
+  cbuf->append_i64(session_id);
+  cbuf->append_i32(max_staleness_ms);
+  cbuf->append_i32(fence.size());
+  foreach(const String &token, fence)
+    cbuf->append_vstr(token);
+  cbuf->append_i32(ops.size());
+  foreach(const MultiOp &op, ops)
+    encode_multi_op(cbuf->get_data_ptr_address(), op);
+  return cbuf;
+}
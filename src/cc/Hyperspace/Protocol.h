@@ -33,6 +33,8 @@
 
 namespace Hyperspace {
 
+  class MultiOp;
+
   /**
    * Structure to hold extended attribute and value
    */
@@ -91,6 +93,11 @@ namespace Hyperspace {
     static CommBuf *create_readpath_attr_request(uint64_t handle, const std::string *name,
                                                  const std::string &attr);
     static CommBuf *create_exists_request(const std::string &name);
+    static CommBuf *create_multi_request(const std::vector<MultiOp> &ops);
+    static CommBuf *
+    create_replica_read_request(uint64_t session_id, uint32_t max_staleness_ms,
+                                const std::vector<String> &fence,
+                                const std::vector<MultiOp> &ops);
 
     static CommBuf *
     create_lock_request(uint64_t handle, uint32_t mode, bool try_lock);
@@ -128,7 +135,9 @@ namespace Hyperspace {
     static const uint64_t COMMAND_ATTRINCR       = 22;
     static const uint64_t COMMAND_READPATHATTR   = 23;
     static const uint64_t COMMAND_SHUTDOWN       = 24;
-    static const uint64_t COMMAND_MAX            = 25;
+    static const uint64_t COMMAND_MULTI          = 25;
+    static const uint64_t COMMAND_REPLICA_READ   = 26;
+    static const uint64_t COMMAND_MAX            = 27;
 
     static const char * command_strs[COMMAND_MAX];
 
@@ -28,6 +28,7 @@
 
 #include "Master.h"
 #include "RequestHandlerAttrDel.h"
+#include "ResponseCallbackCommit.h"
 
 using namespace Hyperspace;
 using namespace Hypertable;
@@ -37,7 +38,7 @@ using namespace Serialization;
  *
  */
 void RequestHandlerAttrDel::run() {
-  ResponseCallback cb(m_comm, m_event_ptr);
+  ResponseCallbackCommit cb(m_comm, m_event_ptr);
   size_t decode_remain = m_event_ptr->payload_len;
   const uint8_t *decode_ptr = m_event_ptr->payload;
 
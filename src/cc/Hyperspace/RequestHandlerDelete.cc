@@ -30,6 +30,7 @@
 
 #include "Master.h"
 #include "RequestHandlerDelete.h"
+#include "ResponseCallbackCommit.h"
 
 using namespace Hyperspace;
 using namespace Hypertable;
@@ -39,7 +40,7 @@ using namespace Serialization;
  *
  */
 void RequestHandlerDelete::run() {
-  ResponseCallback cb(m_comm, m_event_ptr);
+  ResponseCallbackCommit cb(m_comm, m_event_ptr);
   size_t decode_remain = m_event_ptr->payload_len;
   const uint8_t *decode_ptr = m_event_ptr->payload;
 
@@ -35,6 +35,7 @@ using namespace Hypertable;
 void RequestHandlerExpireSessions::run() {
   try {
     m_master->remove_expired_sessions();
+    m_master->write_replica_heartbeat();
   }
   catch (Exception &e) {
     HT_ERROR_OUT << e << HT_END;
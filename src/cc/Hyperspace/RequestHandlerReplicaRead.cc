@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "AsyncComm/ResponseCallback.h"
+#include "Common/Serialization.h"
+
+#include "Master.h"
+#include "RequestHandlerReplicaRead.h"
+#include "ResponseCallbackMulti.h"
+
+using namespace Hyperspace;
+using namespace Hypertable;
+using namespace Serialization;
+
+/**
+ *
+ */
+void RequestHandlerReplicaRead::run() {
+  ResponseCallbackMulti cb(m_comm, m_event_ptr);
+  size_t decode_remain = m_event_ptr->payload_len;
+  const uint8_t *decode_ptr = m_event_ptr->payload;
+
+  try {
+    uint64_t session_id = decode_i64(&decode_ptr, &decode_remain);
+    uint32_t max_staleness_ms = decode_i32(&decode_ptr, &decode_remain);
+    uint32_t fence_count = decode_i32(&decode_ptr, &decode_remain);
+    std::vector<String> fence;
+    while (fence_count--)
+      fence.push_back(decode_vstr<String>(&decode_ptr, &decode_remain));
+    std::vector<MultiOp> ops;
+    decode_multi_ops(&decode_ptr, &decode_remain, ops);
+
+    m_master->replica_read(&cb, session_id, max_staleness_ms, fence, ops);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    cb.error(e.code(), "Error handling REPLICAREAD message");
+  }
+}
@@ -21,6 +21,7 @@
 
 #include "Common/Compat.h"
 #include "Common/Error.h"
+#include "Common/Serialization.h"
 
 #include "AsyncComm/CommBuf.h"
 
@@ -32,12 +33,14 @@ using namespace Hypertable;
 /**
  *
  */
-int ResponseCallbackAttrIncr::response(uint64_t val) {
+int ResponseCallbackAttrIncr::response(uint64_t val, const String &commit_token) {
   CommHeader header;
   header.initialize_from_request_header(m_event_ptr->header);
-  CommBufPtr cbp(new CommBuf(header, 12));
+  CommBufPtr cbp(new CommBuf(header, 12 +
+      Serialization::encoded_length_vstr(commit_token)));
   cbp->append_i32(Error::OK);
   cbp->append_i64(val);
+  cbp->append_vstr(commit_token);
   return m_comm->send_response(m_event_ptr->addr, cbp);
 }
 
@@ -23,6 +23,7 @@
 #define HYPERSPACE_RESPONSECALLBACKATTRINCR_H
 
 #include "Common/Error.h"
+#include "Common/String.h"
 
 #include "AsyncComm/CommBuf.h"
 #include "AsyncComm/ResponseCallback.h"
@@ -37,7 +38,7 @@ namespace Hyperspace {
                              Hypertable::EventPtr &event_ptr)
       : Hypertable::ResponseCallback(comm, event_ptr) { }
 
-    int response(uint64_t val);
+    int response(uint64_t val, const Hypertable::String &commit_token);
   };
 
 }
@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Serialization.h"
+
+#include "AsyncComm/CommBuf.h"
+
+#include "ResponseCallbackMulti.h"
+
+using namespace Hyperspace;
+using namespace Hypertable;
+
+/**
+ *
+ */
+int ResponseCallbackMulti::response(const std::vector<MultiOp> &ops,
+                                    const std::vector<MultiOpResult> &results,
+                                    const String &commit_token) {
+  CommHeader header;
+  uint32_t len = 8 + Serialization::encoded_length_vstr(commit_token);
+
+  header.initialize_from_request_header(m_event_ptr->header);
+
+  for (size_t ii=0; ii<ops.size(); ii++)
+    len += encoded_length_multi_op_result(ops[ii], results[ii]);
+
+  CommBufPtr cbp(new CommBuf(header, len));
+
+  cbp->append_i32(Error::OK);
+  cbp->append_i32(ops.size());
+
+  for (size_t ii=0; ii<ops.size(); ii++)
+    encode_multi_op_result(cbp->get_data_ptr_address(), ops[ii], results[ii]);
+
+  cbp->append_vstr(commit_token);
+
+  return m_comm->send_response(m_event_ptr->addr, cbp);
+}
@@ -21,6 +21,7 @@
 
 #include "Common/Compat.h"
 #include "Common/Error.h"
+#include "Common/Serialization.h"
 
 #include "AsyncComm/CommBuf.h"
 
@@ -31,13 +32,16 @@ using namespace Hypertable;
 
 int
 ResponseCallbackOpen::response(uint64_t handle, bool created,
-                               uint64_t lock_generation) {
+                               uint64_t lock_generation,
+                               const String &commit_token) {
   CommHeader header;
   header.initialize_from_request_header(m_event_ptr->header);
-  CommBufPtr cbp(new CommBuf(header, 21));
+  CommBufPtr cbp(new CommBuf(header, 21 +
+      Serialization::encoded_length_vstr(commit_token)));
   cbp->append_i32(Error::OK);
   cbp->append_i64(handle);
   cbp->append_byte((uint8_t)created);
   cbp->append_i64(lock_generation);
+  cbp->append_vstr(commit_token);
   return m_comm->send_response(m_event_ptr->addr, cbp);
 }
@@ -23,6 +23,7 @@
 #define HYPERSPACE_RESPONSECALLBACKOPEN_H
 
 #include "Common/Error.h"
+#include "Common/String.h"
 
 #include "AsyncComm/CommBuf.h"
 #include "AsyncComm/ResponseCallback.h"
@@ -35,7 +36,8 @@ namespace Hyperspace {
                          Hypertable::EventPtr &event_ptr)
       : Hypertable::ResponseCallback(comm, event_ptr) { }
 
-    int response(uint64_t handle, bool created, uint64_t lock_generation);
+    int response(uint64_t handle, bool created, uint64_t lock_generation,
+                 const Hypertable::String &commit_token);
   };
 
 }
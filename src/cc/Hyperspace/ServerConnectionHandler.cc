@@ -34,6 +34,7 @@
 #include "RequestHandlerAttrExists.h"
 #include "RequestHandlerAttrList.h"
 #include "RequestHandlerMkdir.h"
+#include "RequestHandlerMulti.h"
 #include "RequestHandlerDelete.h"
 #include "RequestHandlerOpen.h"
 #include "RequestHandlerClose.h"
@@ -41,6 +42,7 @@
 #include "RequestHandlerReaddir.h"
 #include "RequestHandlerReaddirAttr.h"
 #include "RequestHandlerReadpathAttr.h"
+#include "RequestHandlerReplicaRead.h"
 #include "RequestHandlerLock.h"
 #include "RequestHandlerRelease.h"
 #include "RequestHandlerStatus.h"
@@ -82,8 +84,9 @@ void ServerConnectionHandler::handle(EventPtr &event) {
                   (Llu)event->header.command);
 
       // if this is not the current replication master then try to return
-      // addr of current master
-      if (!m_master_ptr->is_master())
+      // addr of current master (replicas only serve REPLICAREAD requests)
+      if (!m_master_ptr->is_master() &&
+          event->header.command != Protocol::COMMAND_REPLICA_READ)
         HT_THROW(Error::HYPERSPACE_NOT_MASTER_LOCATION, (String) "Current master=" +
             m_master_ptr->get_current_master());
 
@@ -153,6 +156,14 @@ void ServerConnectionHandler::handle(EventPtr &event) {
         handler = new RequestHandlerReaddirAttr(m_comm, m_master_ptr.get(),
                                                 m_session_id, event);
         break;
+      case Protocol::COMMAND_MULTI:
+        handler = new RequestHandlerMulti(m_comm, m_master_ptr.get(),
+                                          m_session_id, event);
+        break;
+      case Protocol::COMMAND_REPLICA_READ:
+        handler = new RequestHandlerReplicaRead(m_comm, m_master_ptr.get(),
+                                                event);
+        break;
       case Protocol::COMMAND_READPATHATTR:
         handler = new RequestHandlerReadpathAttr(m_comm, m_master_ptr.get(),
                                                  m_session_id, event);
@@ -50,6 +50,8 @@ using namespace Serialization;
 Session::Session(Comm *comm, PropertiesPtr &cfg)
   : m_comm(comm), m_cfg(cfg), m_verbose(false), m_silent(false),
     m_state(STATE_JEOPARDY), m_last_callback_id(0) {
+  int64_t cache_memory;
+  int32_t cache_ttl;
 
   HT_TRY("getting config values",
     m_verbose = cfg->get_bool("Hypertable.Verbose");
@@ -57,7 +59,15 @@ Session::Session(Comm *comm, PropertiesPtr &cfg)
     m_grace_period = cfg->get_i32("Hyperspace.GracePeriod");
     m_lease_interval = cfg->get_i32("Hyperspace.Lease.Interval");
     m_hyperspace_port = cfg->get_i16("Hyperspace.Replica.Port");
-    m_reconnect = cfg->get_bool("Hyperspace.Session.Reconnect"));
+    m_reconnect = cfg->get_bool("Hyperspace.Session.Reconnect");
+    cache_memory = cfg->get_i64("Hyperspace.Client.Cache.MaxMemory");
+    cache_ttl = cfg->get_i32("Hyperspace.Client.Cache.TTL");
+    m_replica_reads = cfg->get_bool("Hyperspace.Client.ReplicaReads");
+    m_replica_max_staleness =
+        cfg->get_i32("Hyperspace.Client.ReplicaReads.MaxStaleness"));
+
+  if (cache_memory > 0)
+    m_cache = new ClientCache(cache_memory, cache_ttl);
 
   if (m_reconnect)
     HT_INFO_OUT << "Hyperspace session setup to reconnect" << HT_END;
@@ -66,6 +76,23 @@ Session::Session(Comm *comm, PropertiesPtr &cfg)
     m_hyperspace_replicas.push_back(replica);
   }
 
+  if (m_replica_reads && m_hyperspace_replicas.size() > 1) {
+    InetAddr addr;
+    m_replica_conn_mgr = new ConnectionManager(m_comm);
+    m_replica_conn_mgr->set_quiet_mode(true);
+    foreach(const String &replica, m_hyperspace_replicas) {
+      if (!InetAddr::initialize(&addr, replica.c_str(), m_hyperspace_port)) {
+        HT_WARNF("Unable to resolve Hyperspace replica '%s'", replica.c_str());
+        continue;
+      }
+      m_replica_addrs.push_back(addr);
+      m_replica_conn_mgr->add(addr, m_lease_interval, "Hyperspace.Replica");
+    }
+  }
+  else
+    m_replica_reads = false;
+  m_next_replica = 0;
+
   m_timeout_ms = m_lease_interval * 2;
 
   boost::xtime_get(&m_expire_time, boost::TIME_UTC);
@@ -142,6 +169,7 @@ Session::open(ClientHandleStatePtr &handle_state, CommBufPtr &cbuf_ptr,
     handle_state->lock_mode = LOCK_MODE_EXCLUSIVE;
   else
     handle_state->lock_mode = 0;
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -163,6 +191,14 @@ Session::open(ClientHandleStatePtr &handle_state, CommBufPtr &cbuf_ptr,
       handle_state->lock_generation = decode_i64(&decode_ptr, &decode_remain);
       /** if (createdp) *createdp = cbyte ? true : false; **/
       m_keepalive_handler_ptr->register_handle(handle_state);
+      if (open_flags & OPEN_FLAG_CREATE)
+        update_write_fence(fence_ticket,
+                           decode_commit_token(decode_ptr, decode_remain));
+      if (m_cache) {
+        if (open_flags & OPEN_FLAG_CREATE)
+          m_cache->invalidate_node(handle_state->normal_name);
+        m_cache->add_watch(handle_state->normal_name, handle_state->event_mask);
+      }
       HT_DEBUG_OUT << "Open succeeded session="
                   << m_keepalive_handler_ptr->get_session_id()
                   << ", name=" << handle_state->normal_name
@@ -239,6 +275,12 @@ void Session::close(uint64_t handle, Timer *timer) {
     if (!sync_handler.wait_for_reply(event_ptr))
       HT_THROW((int)Protocol::response_code(event_ptr.get()),
                "Hyperspace 'close' error");
+    if (m_cache) {
+      ClientHandleStatePtr handle_state;
+      if (m_keepalive_handler_ptr->get_handle_state(handle, handle_state))
+        m_cache->remove_watch(handle_state->normal_name,
+                              handle_state->event_mask);
+    }
     m_keepalive_handler_ptr->unregister_handle(handle);
   }
   else {
@@ -253,6 +295,11 @@ void Session::close_nowait(uint64_t handle) {
     if (m_state != STATE_SAFE)
       return;
   }
+  if (m_cache) {
+    ClientHandleStatePtr handle_state;
+    if (m_keepalive_handler_ptr->get_handle_state(handle, handle_state))
+      m_cache->remove_watch(handle_state->normal_name, handle_state->event_mask);
+  }
   CommBufPtr cbuf_ptr(Protocol::create_close_request(handle));
   send_message(cbuf_ptr, 0, 0);
 }
@@ -286,6 +333,7 @@ void Session::unlink(const std::string &name, Timer *timer) {
   normalize_name(name, normal_name);
 
   CommBufPtr cbuf_ptr(Protocol::create_delete_request(normal_name));
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -296,6 +344,9 @@ void Session::unlink(const std::string &name, Timer *timer) {
     if (!sync_handler.wait_for_reply(event_ptr))
       HT_THROWF((int)Protocol::response_code(event_ptr.get()),
                 "Hyperspace 'unlink' error, name=%s", normal_name.c_str());
+    update_write_fence(fence_ticket, decode_commit_token(event_ptr));
+    if (m_cache)
+      m_cache->invalidate_node(normal_name);
   }
   else {
     state_transition(Session::STATE_JEOPARDY);
@@ -312,6 +363,18 @@ bool Session::exists(const std::string &name, Timer *timer) {
 
   normalize_name(name, normal_name);
 
+  bool cached_exists;
+  if (m_cache && m_cache->exists(normal_name, &cached_exists))
+    return cached_exists;
+
+  if (m_replica_reads) {
+    std::vector<MultiOp> ops(1, MultiOp::exists(normal_name));
+    std::vector<MultiOpResult> results;
+    if (replica_read(ops, results, timer))
+      return results[0].exists;
+  }
+
+  uint64_t generation = m_cache ? m_cache->generation() : 0;
   CommBufPtr cbuf_ptr(Protocol::create_exists_request(normal_name));
 
  try_again:
@@ -328,6 +391,8 @@ bool Session::exists(const std::string &name, Timer *timer) {
       const uint8_t *decode_ptr = event_ptr->payload + 4;
       size_t decode_remain = event_ptr->payload_len - 4;
       uint8_t bval = decode_byte(&decode_ptr, &decode_remain);
+      if (m_cache)
+        m_cache->put_exists(normal_name, bval != 0, generation);
       return (bval == 0) ? false : true;
     }
   }
@@ -345,6 +410,7 @@ void Session::attr_set(uint64_t handle, const std::string &attr,
   Hypertable::EventPtr event_ptr;
   CommBufPtr cbuf_ptr(Protocol::create_attr_set_request(handle, 0, 0, attr, value,
                       value_len));
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -361,6 +427,10 @@ void Session::attr_set(uint64_t handle, const std::string &attr,
                 "Problem setting attribute '%s' of hyperspace file '%s'",
                 attr.c_str(), fname.c_str());
     }
+    update_write_fence(fence_ticket, decode_commit_token(event_ptr));
+    String normal_name;
+    if (m_cache && get_handle_name(handle, normal_name))
+      m_cache->invalidate_attr(normal_name, attr);
     return;
   }
 
@@ -375,6 +445,7 @@ void Session::attr_set(uint64_t handle, const std::vector<Attribute> &attrs,
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
   CommBufPtr cbuf_ptr(Protocol::create_attr_set_request(handle, 0, 0, attrs));
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -390,6 +461,12 @@ void Session::attr_set(uint64_t handle, const std::vector<Attribute> &attrs,
       HT_THROWF((int)Protocol::response_code(event_ptr.get()),
                 "Problem setting attributes of hyperspace file '%s'", fname.c_str());
     }
+    update_write_fence(fence_ticket, decode_commit_token(event_ptr));
+    String normal_name;
+    if (m_cache && get_handle_name(handle, normal_name)) {
+      foreach(const Attribute &a, attrs)
+        m_cache->invalidate_attr(normal_name, a.name);
+    }
     return;
   }
 
@@ -410,6 +487,7 @@ void Session::attr_set(const std::string &name, uint32_t oflags, const std::stri
   Hypertable::EventPtr event_ptr;
   CommBufPtr cbuf_ptr(Protocol::create_attr_set_request(0, &name, oflags, attr, value,
                       value_len));
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -422,6 +500,15 @@ void Session::attr_set(const std::string &name, uint32_t oflags, const std::stri
                 "Problem setting attribute '%s' of hyperspace file '%s'",
                 attr.c_str(), name.c_str());
     }
+    update_write_fence(fence_ticket, decode_commit_token(event_ptr));
+    if (m_cache) {
+      String normal_name;
+      normalize_name(name, normal_name);
+      if (oflags & OPEN_FLAG_CREATE)
+        m_cache->invalidate_node(normal_name);
+      else
+        m_cache->invalidate_attr(normal_name, attr);
+    }
     return;
   }
 
@@ -435,6 +522,7 @@ void Session::attr_set(const std::string &name, uint32_t oflags,
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
   CommBufPtr cbuf_ptr(Protocol::create_attr_set_request(0, &name, oflags, attrs));
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -446,6 +534,17 @@ void Session::attr_set(const std::string &name, uint32_t oflags,
       HT_THROWF((int)Protocol::response_code(event_ptr.get()),
                 "Problem setting attributes of hyperspace file '%s'", name.c_str());
     }
+    update_write_fence(fence_ticket, decode_commit_token(event_ptr));
+    if (m_cache) {
+      String normal_name;
+      normalize_name(name, normal_name);
+      if (oflags & OPEN_FLAG_CREATE)
+        m_cache->invalidate_node(normal_name);
+      else {
+        foreach(const Attribute &a, attrs)
+          m_cache->invalidate_attr(normal_name, a.name);
+      }
+    }
     return;
   }
 
@@ -459,6 +558,7 @@ uint64_t Session::attr_incr(uint64_t handle, const std::string &attr, Timer *tim
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
   CommBufPtr cbuf_ptr(Protocol::create_attr_incr_request(handle, 0, attr));
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -479,7 +579,11 @@ uint64_t Session::attr_incr(uint64_t handle, const std::string &attr, Timer *tim
       const uint8_t *decode_ptr = event_ptr->payload + 4;
       size_t decode_remain = event_ptr->payload_len - 4;
       uint64_t attr_val = decode_i64(&decode_ptr, &decode_remain);
-
+      update_write_fence(fence_ticket,
+                         decode_commit_token(decode_ptr, decode_remain));
+      String normal_name;
+      if (m_cache && get_handle_name(handle, normal_name))
+        m_cache->invalidate_attr(normal_name, attr);
       return attr_val;
     }
   }
@@ -496,6 +600,7 @@ uint64_t Session::attr_incr(const std::string &name, const std::string &attr, Ti
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
   CommBufPtr cbuf_ptr(Protocol::create_attr_incr_request(0, &name, attr));
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -512,7 +617,13 @@ uint64_t Session::attr_incr(const std::string &name, const std::string &attr, Ti
       const uint8_t *decode_ptr = event_ptr->payload + 4;
       size_t decode_remain = event_ptr->payload_len - 4;
       uint64_t attr_val = decode_i64(&decode_ptr, &decode_remain);
-
+      update_write_fence(fence_ticket,
+                         decode_commit_token(decode_ptr, decode_remain));
+      if (m_cache) {
+        String normal_name;
+        normalize_name(name, normal_name);
+        m_cache->invalidate_attr(normal_name, attr);
+      }
       return attr_val;
     }
   }
@@ -528,6 +639,13 @@ Session::attr_get(uint64_t handle, const std::string &attr,
                   DynamicBuffer &value, Timer *timer) {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+  String normal_name;
+
+  if (m_cache && get_handle_name(handle, normal_name) &&
+      m_cache->get_attr(normal_name, attr, value))
+    return;
+
+  uint64_t generation = m_cache ? m_cache->generation() : 0;
   CommBufPtr cbuf_ptr(Protocol::create_attr_get_request(handle, 0, attr));
 
  try_again:
@@ -545,8 +663,11 @@ Session::attr_get(uint64_t handle, const std::string &attr,
                 "Problem getting attribute '%s' of hyperspace file '%s'",
                 attr.c_str(), fname.c_str());
     }
-    else
+    else {
       decode_value(event_ptr, value);
+      if (m_cache && !normal_name.empty())
+        m_cache->put_attr(normal_name, attr, value, generation);
+    }
   }
   else {
     state_transition(Session::STATE_JEOPARDY);
@@ -559,6 +680,27 @@ Session::attr_get(const std::string &name, const std::string &attr,
                   DynamicBuffer &value, Timer *timer) {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+  String normal_name;
+
+  normalize_name(name, normal_name);
+
+  if (m_cache && m_cache->get_attr(normal_name, attr, value))
+    return;
+
+  if (m_replica_reads) {
+    std::vector<MultiOp> ops(1, MultiOp::attr_get(0, normal_name, attr));
+    std::vector<MultiOpResult> results;
+    if (replica_read(ops, results, timer)) {
+      value.clear();
+      value.ensure(results[0].value->fill() + 1);
+      value.add_unchecked(results[0].value->base, results[0].value->fill());
+      // nul-terminate to make caller's lives easier
+      *value.ptr = 0;
+      return;
+    }
+  }
+
+  uint64_t generation = m_cache ? m_cache->generation() : 0;
   CommBufPtr cbuf_ptr(Protocol::create_attr_get_request(0, &name, attr));
 
  try_again:
@@ -572,8 +714,11 @@ Session::attr_get(const std::string &name, const std::string &attr,
                 "Problem getting attribute '%s' of hyperspace file '%s'",
                 attr.c_str(), name.c_str());
     }
-    else
+    else {
       decode_value(event_ptr, value);
+      if (m_cache)
+        m_cache->put_attr(normal_name, attr, value, generation);
+    }
   }
   else {
     state_transition(Session::STATE_JEOPARDY);
@@ -690,6 +835,15 @@ Session::attr_exists(const std::string& name, const std::string& attr, Timer *ti
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
 
+  if (m_replica_reads) {
+    String normal_name;
+    normalize_name(name, normal_name);
+    std::vector<MultiOp> ops(1, MultiOp::attr_exists(0, normal_name, attr));
+    std::vector<MultiOpResult> results;
+    if (replica_read(ops, results, timer))
+      return results[0].exists;
+  }
+
   CommBufPtr cbuf_ptr(Protocol::create_attr_exists_request(0, &name, attr));
 
  try_again:
@@ -721,6 +875,7 @@ void Session::attr_del(uint64_t handle, const std::string &name, Timer *timer) {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
   CommBufPtr cbuf_ptr(Protocol::create_attr_del_request(handle, name));
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -737,6 +892,10 @@ void Session::attr_del(uint64_t handle, const std::string &name, Timer *timer) {
                 "Problem deleting attribute '%s' of hyperspace file '%s'",
                 name.c_str(), fname.c_str());
     }
+    update_write_fence(fence_ticket, decode_commit_token(event_ptr));
+    String normal_name;
+    if (m_cache && get_handle_name(handle, normal_name))
+      m_cache->invalidate_attr(normal_name, name);
   }
   else {
     state_transition(Session::STATE_JEOPARDY);
@@ -791,6 +950,13 @@ Session::readdir(uint64_t handle, std::vector<DirEntry> &listing,
                  Timer *timer) {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+  String normal_name;
+
+  if (m_cache && get_handle_name(handle, normal_name) &&
+      m_cache->get_listing(normal_name, listing))
+    return;
+
+  uint64_t generation = m_cache ? m_cache->generation() : 0;
   CommBufPtr cbuf_ptr(Protocol::create_readdir_request(handle));
 
  try_again:
@@ -825,6 +991,8 @@ Session::readdir(uint64_t handle, std::vector<DirEntry> &listing,
         }
         listing.push_back(dentry);
       }
+      if (m_cache && !normal_name.empty())
+        m_cache->put_listing(normal_name, listing, generation);
     }
   }
   else {
@@ -864,6 +1032,19 @@ Session::readdir_attr(const std::string &name, const std::string &attr, bool inc
                       std::vector<DirEntryAttr> &listing, Timer *timer) {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+
+  if (m_replica_reads) {
+    String normal_name;
+    normalize_name(name, normal_name);
+    std::vector<MultiOp> ops(1, MultiOp::readdir_attr(0, normal_name, attr,
+                                                      include_sub_entries));
+    std::vector<MultiOpResult> results;
+    if (replica_read(ops, results, timer)) {
+      listing.swap(results[0].listing);
+      return;
+    }
+  }
+
   CommBufPtr cbuf_ptr(Protocol::create_readdir_attr_request(0, &name, attr, include_sub_entries));
 
  try_again:
@@ -916,6 +1097,18 @@ Session::readpath_attr(const std::string &name, const std::string &attr,
                       std::vector<DirEntryAttr> &listing, Timer *timer) {
   DispatchHandlerSynchronizer sync_handler;
   Hypertable::EventPtr event_ptr;
+
+  if (m_replica_reads) {
+    String normal_name;
+    normalize_name(name, normal_name);
+    std::vector<MultiOp> ops(1, MultiOp::readpath_attr(0, normal_name, attr));
+    std::vector<MultiOpResult> results;
+    if (replica_read(ops, results, timer)) {
+      listing.swap(results[0].listing);
+      return;
+    }
+  }
+
   CommBufPtr cbuf_ptr(Protocol::create_readpath_attr_request(0, &name, attr));
 
  try_again:
@@ -937,6 +1130,78 @@ Session::readpath_attr(const std::string &name, const std::string &attr,
   }
 }
 
+void
+Session::multi(const std::vector<MultiOp> &ops,
+               std::vector<MultiOpResult> &results, Timer *timer) {
+  DispatchHandlerSynchronizer sync_handler;
+  Hypertable::EventPtr event_ptr;
+  std::vector<MultiOp> normal_ops(ops);
+  String normal_name, commit_token;
+
+  foreach(MultiOp &op, normal_ops) {
+    if (!op.handle) {
+      normalize_name(op.name, normal_name);
+      op.name = normal_name;
+    }
+  }
+
+  CommBufPtr cbuf_ptr(Protocol::create_multi_request(normal_ops));
+  uint64_t fence_ticket = m_write_fence.begin();
+
+ try_again:
+  if (!wait_for_safe())
+    HT_THROW(Error::HYPERSPACE_EXPIRED_SESSION, "");
+
+  int error = send_message(cbuf_ptr, &sync_handler, timer);
+  if (error == Error::OK) {
+    if (!sync_handler.wait_for_reply(event_ptr)) {
+      HT_THROWF((int)Protocol::response_code(event_ptr.get()),
+                "Hyperspace 'multi' error - %s",
+                Protocol::string_format_message(event_ptr).c_str());
+    }
+    else
+      decode_results(event_ptr, normal_ops, results, &commit_token);
+  }
+  else {
+    state_transition(Session::STATE_JEOPARDY);
+    goto try_again;
+  }
+
+  foreach(const MultiOp &op, normal_ops) {
+    if (op.is_mutation()) {
+      update_write_fence(fence_ticket, commit_token);
+      break;
+    }
+  }
+
+  if (m_cache) {
+    foreach(const MultiOp &op, normal_ops) {
+      if (!op.is_mutation())
+        continue;
+      if (op.handle) {
+        if (!get_handle_name(op.handle, normal_name))
+          continue;
+      }
+      else
+        normal_name = op.name;
+      if (op.type == MultiOp::ATTR_INCR || op.type == MultiOp::ATTR_DEL)
+        m_cache->invalidate_attr(normal_name, op.attr);
+      else if (op.type == MultiOp::ATTR_SET &&
+               !(op.oflags & OPEN_FLAG_CREATE)) {
+        foreach(const Attribute &a, op.attrs)
+          m_cache->invalidate_attr(normal_name, a.name);
+      }
+      else {
+        String path = normal_name;
+        do {
+          m_cache->invalidate_node(path);
+          path = path.substr(0, path.rfind('/'));
+        } while (op.type == MultiOp::MKDIRS && !path.empty());
+      }
+    }
+  }
+}
+
 void
 Session::lock(uint64_t handle, uint32_t mode, LockSequencer *sequencerp,
               Timer *timer) {
@@ -1150,6 +1415,14 @@ int Session::state_transition(int state) {
   ScopedLock lock(m_mutex);
   int old_state = m_state;
   m_state = state;
+  // notifications may be lost while the lease is in doubt, and handles
+  // are gone once the session has expired
+  if (m_cache) {
+    if (m_state == STATE_EXPIRED || m_state == STATE_DISCONNECTED)
+      m_cache->clear_watches();
+    else if (m_state != STATE_SAFE)
+      m_cache->clear();
+  }
   if (m_state == STATE_SAFE) {
     m_cond.notify_all();
     if (old_state == STATE_JEOPARDY) {
@@ -1245,6 +1518,7 @@ void Session::mkdir(const std::string &name, bool create_intermediate, const std
   normalize_name(name, normal_name);
 
   CommBufPtr cbuf_ptr(Protocol::create_mkdir_request(normal_name, create_intermediate, init_attrs));
+  uint64_t fence_ticket = m_write_fence.begin();
 
  try_again:
   if (!wait_for_safe())
@@ -1255,6 +1529,15 @@ void Session::mkdir(const std::string &name, bool create_intermediate, const std
     if (!sync_handler.wait_for_reply(event_ptr))
       HT_THROWF((int)Protocol::response_code(event_ptr.get()),
                 "Hyperspace 'mkdir' error, name=%s", normal_name.c_str());
+    update_write_fence(fence_ticket, decode_commit_token(event_ptr));
+    if (m_cache) {
+      // intermediate directories may have been created as well
+      String path = normal_name;
+      do {
+        m_cache->invalidate_node(path);
+        path = path.substr(0, path.rfind('/'));
+      } while (create_intermediate && !path.empty());
+    }
   }
   else {
     state_transition(Session::STATE_JEOPARDY);
@@ -1331,6 +1614,37 @@ void Session::decode_listing(Hypertable::EventPtr& event_ptr, std::vector<DirEnt
   }
 }
 
+void Session::decode_results(Hypertable::EventPtr& event_ptr,
+                             const std::vector<MultiOp> &ops,
+                             std::vector<MultiOpResult> &results,
+                             String *commit_token) {
+  const uint8_t *decode_ptr = event_ptr->payload + 4;
+  size_t decode_remain = event_ptr->payload_len - 4;
+  uint32_t result_cnt;
+  try {
+    result_cnt = decode_i32(&decode_ptr, &decode_remain);
+  }
+  catch (Exception &e) {
+    HT_THROW2(Error::PROTOCOL_ERROR, e, "");
+  }
+  if (result_cnt != ops.size())
+    HT_THROWF(Error::PROTOCOL_ERROR, "MULTI response has %u results, expected %u",
+              (unsigned)result_cnt, (unsigned)ops.size());
+  results.clear();
+  results.resize(result_cnt);
+  for (uint32_t ii=0; ii<result_cnt; ii++) {
+    try {
+      decode_multi_op_result(&decode_ptr, &decode_remain, ops[ii], results[ii]);
+    }
+    catch (Exception &e) {
+      HT_THROW2F(Error::PROTOCOL_ERROR, e,
+                 "Problem decoding result %d of MULTI return packet", ii);
+    }
+  }
+  if (commit_token)
+    *commit_token = decode_commit_token(decode_ptr, decode_remain);
+}
+
 bool Session::wait_for_safe() {
   ScopedLock lock(m_mutex);
   while (m_state != STATE_SAFE) {
@@ -1359,6 +1673,94 @@ Session::send_message(CommBufPtr &cbuf_ptr, DispatchHandler *handler,
 }
 
 
+bool Session::replica_read(const std::vector<MultiOp> &ops,
+                           std::vector<MultiOpResult> &results, Timer *timer) {
+  DispatchHandlerSynchronizer sync_handler;
+  Hypertable::EventPtr event_ptr;
+  InetAddr addr;
+  std::vector<String> fence;
+
+  if (!m_write_fence.get(fence))
+    return false;
+
+  {
+    ScopedLock lock(m_mutex);
+    if (m_state != STATE_SAFE)
+      return false;
+    // spread reads over the replicas, leaving the master alone
+    addr = m_replica_addrs[m_next_replica++ % m_replica_addrs.size()];
+    if (addr == m_master_addr)
+      addr = m_replica_addrs[m_next_replica++ % m_replica_addrs.size()];
+  }
+
+  CommBufPtr cbuf_ptr(Protocol::create_replica_read_request(
+      m_keepalive_handler_ptr->get_session_id(), m_replica_max_staleness,
+      fence, ops));
+  uint32_t timeout_ms = timer ? (time_t)timer->remaining() : m_timeout_ms;
+
+  if (m_comm->send_request(addr, timeout_ms, cbuf_ptr, &sync_handler)
+      != Error::OK)
+    return false;
+
+  if (!sync_handler.wait_for_reply(event_ptr)) {
+    int error = (int)Protocol::response_code(event_ptr.get());
+    // definitive answers, anything else is retried on the master
+    if (error == Error::HYPERSPACE_FILE_NOT_FOUND ||
+        error == Error::HYPERSPACE_ATTR_NOT_FOUND ||
+        error == Error::HYPERSPACE_BAD_PATHNAME)
+      HT_THROW(error, Protocol::string_format_message(event_ptr));
+    return false;
+  }
+
+  decode_results(event_ptr, ops, results);
+  return true;
+}
+
+
+void Session::update_write_fence(uint64_t ticket, const String &commit_token) {
+  if (m_replica_reads)
+    m_write_fence.complete(ticket, commit_token);
+}
+
+
+String Session::decode_commit_token(const uint8_t *decode_ptr,
+                                    size_t decode_remain) {
+  if (decode_remain == 0)
+    return String();
+  try {
+    return decode_vstr<String>(&decode_ptr, &decode_remain);
+  }
+  catch (Exception &e) {
+    HT_WARN_OUT << "Problem decoding commit token - " << e << HT_END;
+  }
+  return String();
+}
+
+
+bool Session::get_handle_name(uint64_t handle, String &normal_name) {
+  ClientHandleStatePtr handle_state;
+  if (!m_keepalive_handler_ptr->get_handle_state(handle, handle_state))
+    return false;
+  normal_name = handle_state->normal_name;
+  return true;
+}
+
+
+void Session::notify_cache(const String &normal_name, uint32_t event_mask,
+                           const String &name) {
+  if (m_cache)
+    m_cache->notify(normal_name, event_mask, name);
+}
+
+
+bool Session::get_cache_stats(ClientCache::Stats &stats) {
+  if (!m_cache)
+    return false;
+  m_cache->get_stats(stats);
+  return true;
+}
+
+
 void Session::normalize_name(const String &name, String &normal) {
 
   if (name == "/") {
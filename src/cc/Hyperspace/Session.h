@@ -39,13 +39,16 @@
 #include "Common/String.h"
 #include "Common/HashMap.h"
 
+#include "ClientCache.h"
 #include "ClientKeepaliveHandler.h"
 #include "HandleCallback.h"
 #include "LockSequencer.h"
+#include "MultiOp.h"
 #include "Protocol.h"
 #include "DirEntry.h"
 #include "DirEntryAttr.h"
 #include "HsCommandInterpreter.h"
+#include "WriteFence.h"
 
 namespace Hyperspace {
 
@@ -529,6 +532,21 @@ namespace Hyperspace {
     void readpath_attr(const std::string &name, const std::string &attr,
                        std::vector<DirEntryAttr> &listing, Timer *timer=0);
 
+    /** Executes a batch of operations in a single request.  The master runs
+     * all of the operations, in order, inside one transaction, so either all
+     * of them take effect or none do.  If any operation fails an exception
+     * is thrown with the error code of the failed operation and its position
+     * in the batch in the message.  Results are returned in the same order as
+     * the operations; see MultiOpResult for which member is filled in for
+     * each operation type.
+     *
+     * @param ops vector of operations to execute
+     * @param results reference to vector to hold the operation results
+     * @param timer maximum wait timer
+     */
+    void multi(const std::vector<MultiOp> &ops,
+               std::vector<MultiOpResult> &results, Timer *timer=0);
+
     /** Locks a file.  The mode argument indicates the type of lock to be
      * acquired and takes a value of either LOCK_MODE_SHARED
      * or LOCK_MODE_EXCLUSIVE (see \ref LockMode).  Upon success, the structure
@@ -665,6 +683,24 @@ namespace Hyperspace {
 
     void update_master_addr(const String &host);
 
+    /** Applies a change notification to the client cache.  Called by the
+     * keepalive handler for every attribute or child node event received
+     * on a handle opened on <code>normal_name</code>.
+     *
+     * @param normal_name normalized name of the node the event refers to
+     * @param event_mask event type
+     * @param name attribute or child node name carried by the event
+     */
+    void notify_cache(const String &normal_name, uint32_t event_mask,
+                      const String &name);
+
+    /** Gets client cache hit/miss/eviction counters and memory usage.
+     *
+     * @param stats reference to stats structure to fill in
+     * @return false if the client cache is disabled
+     */
+    bool get_cache_stats(ClientCache::Stats &stats);
+
     /** Attempts to shutdown the Hyperspace server and destroys this session.
      *
      * @param timer maximum wait timer
@@ -677,11 +713,41 @@ namespace Hyperspace {
 
     void mkdir(const std::string &name, bool create_intermediate, const std::vector<Attribute> *init_attrs, Timer *timer);
     void decode_listing(Hypertable::EventPtr& event_ptr, std::vector<DirEntryAttr> &listing);
+    void decode_results(Hypertable::EventPtr& event_ptr,
+                        const std::vector<MultiOp> &ops,
+                        std::vector<MultiOpResult> &results,
+                        String *commit_token=0);
     void decode_value(Hypertable::EventPtr& event_ptr, DynamicBuffer &value);
     void decode_values(Hypertable::EventPtr& event_ptr, std::vector<DynamicBufferPtr> &values);
     bool wait_for_safe();
     int send_message(CommBufPtr &, DispatchHandler *, Timer *timer);
     void normalize_name(const std::string &name, std::string &normal);
+    bool get_handle_name(uint64_t handle, String &normal_name);
+
+    /** Attempts to execute read-only by-name operations on a replica.
+     * Returns false if no replica could serve them within the staleness
+     * bound, in which case the caller should ask the master.
+     */
+    bool replica_read(const std::vector<MultiOp> &ops,
+                      std::vector<MultiOpResult> &results, Timer *timer);
+
+    /** Records the commit token of a completed mutation so that subsequent
+     * replica reads are only served by replicas that have applied it
+     * (read-your-writes).
+     *
+     * @param ticket value of m_write_fence.begin() before the request was sent
+     * @param commit_token commit token returned by the master
+     */
+    void update_write_fence(uint64_t ticket, const String &commit_token);
+
+    /** Decodes the commit token that ends a mutation response; returns an
+     * empty token if the master did not send one */
+    static String decode_commit_token(const uint8_t *decode_ptr,
+                                      size_t decode_remain);
+    static String decode_commit_token(Hypertable::EventPtr &event_ptr) {
+      return decode_commit_token(event_ptr->payload + 4,
+                                 event_ptr->payload_len - 4);
+    }
     uint64_t open(ClientHandleStatePtr &, CommBufPtr &, Timer *timer);
 
     Mutex                     m_mutex;
@@ -704,6 +770,13 @@ namespace Hyperspace {
     Mutex                     m_callback_mutex;
     vector<String>            m_hyperspace_replicas;
     String                    m_hyperspace_master;
+    ClientCachePtr            m_cache;
+    bool                      m_replica_reads;
+    uint32_t                  m_replica_max_staleness;
+    ConnectionManagerPtr      m_replica_conn_mgr;
+    std::vector<InetAddr>     m_replica_addrs;
+    size_t                    m_next_replica;
+    WriteFence                m_write_fence;
   };
 
   typedef boost::intrusive_ptr<Session> SessionPtr;
@@ -0,0 +1,59 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include "WriteFence.h"
+
+using namespace Hyperspace;
+
+
+uint64_t WriteFence::begin() {
+  ScopedLock lock(m_mutex);
+  return m_completed;
+}
+
+
+void WriteFence::complete(uint64_t ticket, const String &token) {
+  ScopedLock lock(m_mutex);
+  std::vector<Entry>::iterator iter = m_entries.begin();
+
+  // mutations that completed before this one was sent are superseded
+  while (iter != m_entries.end()) {
+    if (iter->first <= ticket)
+      iter = m_entries.erase(iter);
+    else
+      ++iter;
+  }
+  m_entries.push_back(Entry(++m_completed, token));
+}
+
+
+bool WriteFence::get(std::vector<String> &tokens) {
+  ScopedLock lock(m_mutex);
+  tokens.clear();
+  for (size_t i=0; i<m_entries.size(); i++) {
+    if (m_entries[i].second.empty())
+      return false;
+    tokens.push_back(m_entries[i].second);
+  }
+  return true;
+}
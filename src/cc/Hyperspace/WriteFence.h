@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERSPACE_WRITEFENCE_H
+#define HYPERSPACE_WRITEFENCE_H
+
+#include <utility>
+#include <vector>
+
+#include "Common/Mutex.h"
+#include "Common/String.h"
+
+namespace Hyperspace {
+
+  using namespace Hypertable;
+
+  /**
+   * Tracks the commit tokens of the mutations a session has completed, so
+   * that reads served by a replica can be required to reflect them
+   * (read-your-writes).
+   *
+   * The master returns an opaque commit token with every mutation.  A
+   * replica applies the replicated log in commit order, so once it has
+   * applied a mutation it has also applied every mutation that completed
+   * before that one was sent.  The fence therefore keeps, for each
+   * mutation that completes, only the tokens of mutations that were still
+   * outstanding when it was sent; without concurrent mutations it holds a
+   * single token.  A mutation answered without a token (e.g. by a master
+   * that is not replicated) makes the fence unknown until a later mutation
+   * supersedes it.
+   */
+  class WriteFence {
+  public:
+    WriteFence() : m_completed(0) { }
+
+    /**
+     * Called before a mutation is sent.
+     *
+     * @return ticket to pass to complete()
+     */
+    uint64_t begin();
+
+    /**
+     * Records the completion of a mutation.
+     *
+     * @param ticket value returned by begin() before the mutation was sent
+     * @param token commit token returned by the master, empty if none
+     */
+    void complete(uint64_t ticket, const String &token);
+
+    /**
+     * Gets the commit tokens a replica must have applied before it serves
+     * a read for this session.
+     *
+     * @param tokens filled in with the tokens
+     * @return false if the fence is unknown and reads must go to the master
+     */
+    bool get(std::vector<String> &tokens);
+
+  private:
+    typedef std::pair<uint64_t, String> Entry;
+
+    Mutex m_mutex;
+    /** Number of mutations completed so far */
+    uint64_t m_completed;
+    /** Completion number and token of the mutations not yet superseded */
+    std::vector<Entry> m_entries;
+  };
+
+} // namespace Hyperspace
+
+#endif // HYPERSPACE_WRITEFENCE_H
@@ -0,0 +1,200 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include <cstring>
+
+extern "C" {
+#include <poll.h>
+}
+
+#include "Hyperspace/ClientCache.h"
+#include "Hyperspace/HandleCallback.h"
+
+using namespace Hypertable;
+using namespace Hyperspace;
+
+namespace {
+
+  const uint32_t ATTR_EVENTS = EVENT_MASK_ATTR_SET | EVENT_MASK_ATTR_DEL;
+  const uint32_t DIR_EVENTS = EVENT_MASK_CHILD_NODE_ADDED |
+                              EVENT_MASK_CHILD_NODE_REMOVED;
+
+  void set_value(DynamicBuffer &buf, const char *str) {
+    buf.clear();
+    buf.ensure(strlen(str)+1);
+    buf.add_unchecked(str, strlen(str));
+  }
+
+  bool has_attr(ClientCache &cache, const char *name, const char *attr,
+                const char *expected=0) {
+    DynamicBuffer value;
+    if (!cache.get_attr(name, attr, value))
+      return false;
+    if (expected)
+      HT_ASSERT(value.fill() == strlen(expected) &&
+                !memcmp(value.base, expected, value.fill()));
+    return true;
+  }
+
+  void test_watched_attrs() {
+    ClientCache cache(1024*1024);
+    DynamicBuffer value;
+    uint64_t generation;
+
+    set_value(value, "1");
+
+    // not watched and no time-to-live, so nothing is cached
+    cache.put_attr("/t/1", "schema", value, cache.generation());
+    HT_ASSERT(!has_attr(cache, "/t/1", "schema"));
+
+    cache.add_watch("/t/1", ATTR_EVENTS);
+    cache.put_attr("/t/1", "schema", value, cache.generation());
+    HT_ASSERT(has_attr(cache, "/t/1", "schema", "1"));
+
+    // a notification invalidates the entry
+    cache.notify("/t/1", EVENT_MASK_ATTR_SET, "schema");
+    HT_ASSERT(!has_attr(cache, "/t/1", "schema"));
+
+    // an invalidation between the request and the fill drops the fill
+    generation = cache.generation();
+    cache.notify("/t/1", EVENT_MASK_ATTR_SET, "schema");
+    cache.put_attr("/t/1", "schema", value, generation);
+    HT_ASSERT(!has_attr(cache, "/t/1", "schema"));
+
+    generation = cache.generation();
+    cache.invalidate_attr("/t/1", "schema");
+    cache.put_attr("/t/1", "schema", value, generation);
+    HT_ASSERT(!has_attr(cache, "/t/1", "schema"));
+
+    // closing the last watching handle drops the entries
+    cache.put_attr("/t/1", "schema", value, cache.generation());
+    HT_ASSERT(has_attr(cache, "/t/1", "schema"));
+    cache.remove_watch("/t/1", ATTR_EVENTS);
+    HT_ASSERT(!has_attr(cache, "/t/1", "schema"));
+  }
+
+  void test_unwatched_ttl() {
+    ClientCache cache(1024*1024, 100);
+    DynamicBuffer value;
+    uint64_t generation;
+    bool exists;
+
+    set_value(value, "42");
+    cache.put_attr("/names/foo", "id", value, cache.generation());
+    HT_ASSERT(has_attr(cache, "/names/foo", "id", "42"));
+
+    cache.put_exists("/names/bar", true, cache.generation());
+    HT_ASSERT(cache.exists("/names/bar", &exists) && exists);
+    cache.put_exists("/names/baz", false, cache.generation());
+    HT_ASSERT(cache.exists("/names/baz", &exists) && !exists);
+
+    // stale fills are dropped for unwatched nodes too
+    generation = cache.generation();
+    cache.invalidate_node("/names/qux");
+    cache.put_exists("/names/qux", false, generation);
+    HT_ASSERT(!cache.exists("/names/qux", &exists));
+
+    // local mutations invalidate
+    cache.invalidate_node("/names/baz");
+    HT_ASSERT(!cache.exists("/names/baz", &exists));
+
+    poll(0, 0, 200);
+
+    HT_ASSERT(!has_attr(cache, "/names/foo", "id"));
+    HT_ASSERT(!cache.exists("/names/bar", &exists));
+
+    ClientCache::Stats stats;
+    cache.get_stats(stats);
+    HT_ASSERT(stats.entries == 0 && stats.memory_used == 0);
+  }
+
+  void test_existence() {
+    ClientCache cache(1024*1024);
+    std::vector<DirEntry> listing;
+    DirEntry entry;
+    bool exists;
+
+    // coherent only while the parent directory is watched
+    cache.put_exists("/names/foo", true, cache.generation());
+    HT_ASSERT(!cache.exists("/names/foo", &exists));
+
+    cache.add_watch("/names", DIR_EVENTS);
+    cache.put_exists("/names/foo", true, cache.generation());
+    HT_ASSERT(cache.exists("/names/foo", &exists) && exists);
+
+    cache.notify("/names", EVENT_MASK_CHILD_NODE_REMOVED, "foo");
+    HT_ASSERT(!cache.exists("/names/foo", &exists));
+
+    // answered from the listing of the parent
+    entry.name = "bar";
+    entry.is_dir = false;
+    listing.push_back(entry);
+    cache.put_listing("/names", listing, cache.generation());
+    HT_ASSERT(cache.exists("/names/bar", &exists) && exists);
+    HT_ASSERT(cache.exists("/names/foo", &exists) && !exists);
+
+    cache.notify("/names", EVENT_MASK_CHILD_NODE_ADDED, "foo");
+    HT_ASSERT(!cache.get_listing("/names", listing));
+
+    // a fill that raced with the notification is dropped
+    uint64_t generation = cache.generation();
+    cache.notify("/names", EVENT_MASK_CHILD_NODE_ADDED, "baz");
+    cache.put_exists("/names/baz", false, generation);
+    HT_ASSERT(!cache.exists("/names/baz", &exists));
+
+    // unwatching the parent drops existence entries of its children
+    cache.put_exists("/names/baz", true, cache.generation());
+    HT_ASSERT(cache.exists("/names/baz", &exists) && exists);
+    cache.remove_watch("/names", DIR_EVENTS);
+    HT_ASSERT(!cache.exists("/names/baz", &exists));
+  }
+
+  void test_clear_watches() {
+    ClientCache cache(1024*1024);
+    DynamicBuffer value;
+
+    set_value(value, "v");
+    cache.add_watch("/a", ATTR_EVENTS);
+    cache.put_attr("/a", "x", value, cache.generation());
+    HT_ASSERT(has_attr(cache, "/a", "x"));
+
+    // handles are gone after the session expires
+    cache.clear_watches();
+    HT_ASSERT(!has_attr(cache, "/a", "x"));
+    cache.put_attr("/a", "x", value, cache.generation());
+    HT_ASSERT(!has_attr(cache, "/a", "x"));
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  test_watched_attrs();
+  test_unwatched_ttl();
+  test_existence();
+  test_clear_watches();
+
+  return 0;
+}
@@ -0,0 +1,206 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+
+#include <cstring>
+#include <vector>
+
+#include "Hyperspace/MultiOp.h"
+
+using namespace Hypertable;
+using namespace Hyperspace;
+
+namespace {
+
+  void round_trip(const MultiOp &op, MultiOp &decoded,
+                  DynamicBuffer &buf) {
+    size_t len = encoded_length_multi_op(op);
+    buf.clear();
+    buf.ensure(len);
+    encode_multi_op(&buf.ptr, op);
+    HT_ASSERT(buf.fill() == len);
+
+    const uint8_t *ptr = buf.base;
+    size_t remain = buf.fill();
+    decode_multi_op(&ptr, &remain, decoded);
+    HT_ASSERT(remain == 0);
+    HT_ASSERT(decoded.type == op.type);
+    HT_ASSERT(decoded.handle == op.handle);
+    HT_ASSERT(decoded.name == op.name);
+    HT_ASSERT(decoded.oflags == op.oflags);
+    HT_ASSERT(decoded.attr == op.attr);
+    HT_ASSERT(decoded.include_sub_entries == op.include_sub_entries);
+    HT_ASSERT(decoded.attrs.size() == op.attrs.size());
+    for (size_t i=0; i<op.attrs.size(); i++) {
+      HT_ASSERT(!strcmp(decoded.attrs[i].name, op.attrs[i].name));
+      HT_ASSERT(decoded.attrs[i].value_len == op.attrs[i].value_len);
+      HT_ASSERT(!memcmp(decoded.attrs[i].value, op.attrs[i].value,
+                        op.attrs[i].value_len));
+    }
+  }
+
+  void result_round_trip(const MultiOp &op, const MultiOpResult &result,
+                         MultiOpResult &decoded) {
+    DynamicBuffer buf;
+    size_t len = encoded_length_multi_op_result(op, result);
+    buf.ensure(len);
+    encode_multi_op_result(&buf.ptr, op, result);
+    HT_ASSERT(buf.fill() == len);
+
+    const uint8_t *ptr = buf.base;
+    size_t remain = buf.fill();
+    decode_multi_op_result(&ptr, &remain, op, decoded);
+    HT_ASSERT(remain == 0);
+  }
+
+  void test_ops() {
+    std::vector<Attribute> attrs;
+    DynamicBuffer buf;
+    MultiOp decoded;
+
+    attrs.push_back(Attribute("name", "foo", 3));
+    attrs.push_back(Attribute("nid", "0", 1));
+
+    round_trip(MultiOp::mkdir("/a/b", false, &attrs), decoded, buf);
+    HT_ASSERT(decoded.type == MultiOp::MKDIR);
+    HT_ASSERT(decoded.is_mutation());
+    round_trip(MultiOp::mkdir("/a/b/c", true), decoded, buf);
+    HT_ASSERT(decoded.type == MultiOp::MKDIRS);
+    round_trip(MultiOp::unlink("/a/b"), decoded, buf);
+    round_trip(MultiOp::exists("/a"), decoded, buf);
+    HT_ASSERT(!decoded.is_mutation());
+    round_trip(MultiOp::attr_set(0, "/a/f", 0x13, "id", "42", 2), decoded, buf);
+    HT_ASSERT(decoded.oflags == 0x13);
+    round_trip(MultiOp::attr_set(17, "ignored", 0, attrs), decoded, buf);
+    HT_ASSERT(decoded.handle == 17 && decoded.name.empty());
+    round_trip(MultiOp::attr_get(0, "/a/f", "id"), decoded, buf);
+    round_trip(MultiOp::attr_incr(0, "/a", "nid"), decoded, buf);
+    round_trip(MultiOp::attr_del(5, "id"), decoded, buf);
+    round_trip(MultiOp::attr_exists(0, "/a/f", "id"), decoded, buf);
+    round_trip(MultiOp::readdir_attr(0, "/a", "name", true), decoded, buf);
+    HT_ASSERT(decoded.include_sub_entries);
+    round_trip(MultiOp::readpath_attr(0, "/a/f", "id"), decoded, buf);
+  }
+
+  void test_results() {
+    MultiOpResult result, decoded;
+
+    result.exists = true;
+    result_round_trip(MultiOp::exists("/a"), result, decoded);
+    HT_ASSERT(decoded.exists);
+
+    result.attr_val = 1234567890123LL;
+    result_round_trip(MultiOp::attr_incr(0, "/a", "nid"), result, decoded);
+    HT_ASSERT(decoded.attr_val == 1234567890123LL);
+
+    result.value = new DynamicBuffer(8);
+    result.value->add_unchecked("value", 5);
+    result_round_trip(MultiOp::attr_get(0, "/a", "x"), result, decoded);
+    HT_ASSERT(decoded.value->fill() == 5);
+    HT_ASSERT(!strcmp((const char *)decoded.value->base, "value"));
+
+    DirEntryAttr entry;
+    DynamicBuffer attr_buf(4);
+    attr_buf.add_unchecked("7", 1);
+    entry.name = "t1";
+    entry.is_dir = false;
+    entry.has_attr = true;
+    entry.attr = attr_buf;
+    result.listing.push_back(entry);
+    entry.name = "ns";
+    entry.is_dir = true;
+    entry.has_attr = false;
+    entry.attr.free();
+    result.listing.push_back(entry);
+    result_round_trip(MultiOp::readdir_attr(0, "/a", "id", false), result,
+                      decoded);
+    HT_ASSERT(decoded.listing.size() == 2);
+    HT_ASSERT(decoded.listing[0].name == "t1" && decoded.listing[0].has_attr &&
+              !decoded.listing[0].is_dir);
+    HT_ASSERT(!strcmp((const char *)decoded.listing[0].attr.base, "7"));
+    HT_ASSERT(decoded.listing[1].name == "ns" && !decoded.listing[1].has_attr &&
+              decoded.listing[1].is_dir);
+
+    // mutations other than ATTR_INCR carry no result
+    MultiOp unlink = MultiOp::unlink("/a");
+    HT_ASSERT(encoded_length_multi_op_result(unlink, result) == 0);
+  }
+
+  bool decode_overruns(const DynamicBuffer &buf, std::vector<MultiOp> &ops) {
+    const uint8_t *ptr = buf.base;
+    size_t remain = buf.fill();
+    try {
+      decode_multi_ops(&ptr, &remain, ops);
+    }
+    catch (Exception &e) {
+      return e.code() == Error::SERIALIZATION_INPUT_OVERRUN;
+    }
+    return false;
+  }
+
+  void test_bogus_counts() {
+    MultiOp op = MultiOp::exists("/a");
+    std::vector<MultiOp> ops;
+    DynamicBuffer buf;
+
+    // well-formed batch
+    buf.ensure(4 + 2*encoded_length_multi_op(op));
+    Serialization::encode_i32(&buf.ptr, 2);
+    encode_multi_op(&buf.ptr, op);
+    encode_multi_op(&buf.ptr, op);
+    const uint8_t *ptr = buf.base;
+    size_t remain = buf.fill();
+    decode_multi_ops(&ptr, &remain, ops);
+    HT_ASSERT(remain == 0 && ops.size() == 2);
+    HT_ASSERT(ops[1].type == MultiOp::EXISTS && ops[1].name == "/a");
+
+    // op count far beyond what the payload holds
+    buf.clear();
+    buf.ensure(4 + encoded_length_multi_op(op));
+    Serialization::encode_i32(&buf.ptr, 0xffffffff);
+    encode_multi_op(&buf.ptr, op);
+    HT_ASSERT(decode_overruns(buf, ops));
+
+    // attribute count far beyond what the payload holds
+    buf.clear();
+    buf.ensure(4 + encoded_length_multi_op(op));
+    Serialization::encode_i32(&buf.ptr, 1);
+    encode_multi_op(&buf.ptr, op);
+    uint8_t *attr_count = buf.ptr - 4;  // trailing field of an op without attrs
+    Serialization::encode_i32(&attr_count, 0xffffffff);
+    HT_ASSERT(decode_overruns(buf, ops));
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  test_ops();
+  test_results();
+  test_bogus_counts();
+
+  return 0;
+}
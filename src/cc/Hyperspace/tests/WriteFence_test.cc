@@ -0,0 +1,111 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include <vector>
+
+#include "Hyperspace/WriteFence.h"
+
+using namespace Hypertable;
+using namespace Hyperspace;
+
+namespace {
+
+  bool fence_is(WriteFence &fence, const char *t1, const char *t2=0) {
+    std::vector<String> tokens;
+    HT_ASSERT(fence.get(tokens));
+    if (tokens.size() != (t2 ? 2U : 1U) || tokens[0] != t1)
+      return false;
+    return !t2 || tokens[1] == t2;
+  }
+
+  void test_sequential() {
+    WriteFence fence;
+    std::vector<String> tokens;
+
+    HT_ASSERT(fence.get(tokens) && tokens.empty());
+
+    uint64_t ticket = fence.begin();
+    fence.complete(ticket, "a");
+    HT_ASSERT(fence_is(fence, "a"));
+
+    // a later mutation supersedes the earlier one
+    ticket = fence.begin();
+    fence.complete(ticket, "b");
+    HT_ASSERT(fence_is(fence, "b"));
+  }
+
+  void test_concurrent() {
+    WriteFence fence;
+
+    // a and b overlap, so neither commit is known to precede the other
+    uint64_t ticket_a = fence.begin();
+    uint64_t ticket_b = fence.begin();
+    fence.complete(ticket_b, "b");
+    fence.complete(ticket_a, "a");
+    HT_ASSERT(fence_is(fence, "b", "a"));
+
+    // c was sent after both completed
+    uint64_t ticket_c = fence.begin();
+    fence.complete(ticket_c, "c");
+    HT_ASSERT(fence_is(fence, "c"));
+
+    // d was sent before c completed, e after, f overlaps e
+    uint64_t ticket_d = fence.begin();
+    fence.complete(fence.begin(), "x");
+    uint64_t ticket_e = fence.begin();
+    uint64_t ticket_f = fence.begin();
+    fence.complete(ticket_d, "d");
+    HT_ASSERT(fence_is(fence, "x", "d"));
+    fence.complete(ticket_e, "e");
+    HT_ASSERT(fence_is(fence, "d", "e"));
+    fence.complete(ticket_f, "f");
+    std::vector<String> tokens;
+    HT_ASSERT(fence.get(tokens) && tokens.size() == 3);
+    HT_ASSERT(tokens[0] == "d" && tokens[1] == "e" && tokens[2] == "f");
+  }
+
+  void test_missing_token() {
+    WriteFence fence;
+    std::vector<String> tokens;
+
+    // a mutation answered without a token makes the fence unknown
+    fence.complete(fence.begin(), "");
+    HT_ASSERT(!fence.get(tokens));
+
+    // until a later mutation supersedes it
+    fence.complete(fence.begin(), "a");
+    HT_ASSERT(fence_is(fence, "a"));
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  test_sequential();
+  test_concurrent();
+  test_missing_token();
+
+  return 0;
+}
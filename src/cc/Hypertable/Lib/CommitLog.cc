@@ -184,6 +184,11 @@ int CommitLog::write(DynamicBuffer &buffer, int64_t revision, bool sync) {
 int CommitLog::link_log(CommitLogBase *log_base) {
   int error;
   int64_t link_revision = log_base->get_latest_revision();
+
+  // Log just rolled, its current fragment is empty
+  if (link_revision == TIMESTAMP_MIN)
+    link_revision = log_base->get_latest_fragment_revision();
+
   BlockCompressionHeaderCommitLog header(MAGIC_LINK, link_revision);
 
   DynamicBuffer input;
@@ -75,6 +75,11 @@ namespace Hypertable {
 
     int64_t get_latest_revision() { return m_latest_revision; }
 
+    int64_t get_latest_fragment_revision() {
+      return m_fragment_queue.empty() ? TIMESTAMP_MIN
+                                      : m_fragment_queue.back().revision;
+    }
+
     bool empty() { return m_fragment_queue.empty(); }
 
     std::set<int64_t> &get_linked_log_set() { return m_linked_logs; }
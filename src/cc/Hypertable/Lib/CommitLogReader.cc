@@ -128,6 +128,13 @@ CommitLogReader::next_raw_block(CommitLogBlockInfo *infop,
     goto try_again;
   }
 
+  if (infop->error == Error::OK) {
+    if (header->get_revision() > m_latest_revision)
+      m_latest_revision = header->get_revision();
+    if (header->get_revision() > m_revision)
+      m_revision = header->get_revision();
+  }
+
   return true;
 }
 
@@ -342,6 +342,7 @@ namespace {
     "      | REPLICATION '=' int",
     "      | COMPRESSOR '=' compressor_spec",
     "      | BLOOMFILTER '=' bloom_filter_spec",
+    "      | COMPACTION_POLICY '=' compaction_policy_spec",
     "",
     "    compressor_spec:",
     "      bmz [ bmz_options ]",
@@ -363,6 +364,8 @@ namespace {
     "    bloom_filter_spec:",
     "      rows [ bloom_filter_options ]",
     "      | rows+cols [ bloom_filter_options ]",
+    "      | rows+cols+qualifiers [ bloom_filter_options ]",
+    "      | row-prefix --prefix-length int [ bloom_filter_options ]",
     "      | none ",
     "",
     "    bloom_filter_options:",
@@ -370,6 +373,20 @@ namespace {
     "      --bits-per-item float",
     "      --num-hashes int",
     "      --max-approx-items int",
+    "      --blocked",
+    "      --filter-type bloom|xor",
+    "",
+    "    compaction_policy_spec:",
+    "      default",
+    "      | size-tiered [ size_tiered_options ]",
+    "      | leveled [ --fanout int ]",
+    "      | time-window [ --window int ] [ --min-threshold int ]",
+    "",
+    "    size_tiered_options:",
+    "      --min-threshold int",
+    "      --max-threshold int",
+    "      --bucket-low float",
+    "      --bucket-high float",
     "",
     "Description",
     "-----------",
@@ -506,6 +523,7 @@ namespace {
     "      | REPLICATION '=' int",
     "      | COMPRESSOR '=' compressor_spec",
     "      | BLOOMFILTER '=' bloom_filter_spec",
+    "      | COMPACTION_POLICY '=' compaction_policy_spec",
     "",
     "    compressor_spec:",
     "      bmz [ bmz_options ]",
@@ -527,6 +545,8 @@ namespace {
     "    bloom_filter_spec:",
     "      rows [ bloom_filter_options ]",
     "      | rows+cols [ bloom_filter_options ]",
+    "      | rows+cols+qualifiers [ bloom_filter_options ]",
+    "      | row-prefix --prefix-length int [ bloom_filter_options ]",
     "      | none ",
     "",
     "    bloom_filter_options:",
@@ -534,6 +554,20 @@ namespace {
     "      --bits-per-item float",
     "      --num-hashes int",
     "      --max-approx-items int",
+    "      --blocked",
+    "      --filter-type bloom|xor",
+    "",
+    "    compaction_policy_spec:",
+    "      default",
+    "      | size-tiered [ size_tiered_options ]",
+    "      | leveled [ --fanout int ]",
+    "      | time-window [ --window int ] [ --min-threshold int ]",
+    "",
+    "    size_tiered_options:",
+    "      --min-threshold int",
+    "      --max-threshold int",
+    "      --bucket-low float",
+    "      --bucket-high float",
     "",
     "    table_option:",
     "      MAX_VERSIONS '=' int",
@@ -736,6 +770,7 @@ namespace {
     "  * REPLICATION '=' int",
     "  * COMPRESSOR '=' compressor_spec",
     "  * BLOOMFILTER '=' bloom_filter_spec",
+    "  * COMPACTION_POLICY '=' compaction_policy_spec",
     "",
     "The COUNTER option makes all column families in the access group",
     "counter columns (see COUNTER description under Column Family Options",
@@ -784,11 +819,18 @@ namespace {
     "The bloom filter specification can take one of the following forms.  The rows",
     "form, which is the default, causes only row keys to be inserted into the bloom",
     "filter.  The rows+cols form causes the row key concatenated with the column",
-    "family to be inserted into the bloom filter.  none disables the bloom",
-    "filter.",
+    "family to be inserted into the bloom filter.  The rows+cols+qualifiers form",
+    "additionally inserts the row key concatenated with the column family and",
+    "qualifier, so lookups of exact column qualifiers within a row only probe",
+    "the cell stores that contain them.  The row-prefix form inserts the first",
+    "--prefix-length bytes of each row key, which lets scans over a row prefix",
+    "at least that long skip cell stores that do not contain the prefix.  none",
+    "disables the bloom filter.",
     "",
     "  * rows [ bloom_filter_options ]",
     "  * rows+cols [ bloom_filter_options ]",
+    "  * rows+cols+qualifiers [ bloom_filter_options ]",
+    "  * row-prefix --prefix-length int [ bloom_filter_options ]",
     "  * none",
     "",
     "The following describes the bloom filter options:",
@@ -811,6 +853,65 @@ namespace {
     "  --max-approx-items arg  Number of cell store items used to guess the number",
     "                          of actual bloom filter entries (default = 1000)",
     "",
+    "  --blocked               Place all of the bits for each item within a single",
+    "                          cache line (default = false)",
+    "",
+    "  --prefix-length arg     Number of leading row key bytes inserted into a",
+    "                          row-prefix bloom filter.  Required by the row-prefix",
+    "                          form.",
+    "",
+    "  --filter-type arg       Filter structure, bloom (default) or xor.  An xor",
+    "                          filter needs about 9.8 bits per item for a 0.4%",
+    "                          false positive rate, roughly 15% less memory than",
+    "                          a bloom filter with the same rate.  It ignores the",
+    "                          --false-positive, --bits-per-item, --num-hashes,",
+    "                          --max-approx-items and --blocked options.",
+    "",
+    "The COMPACTION_POLICY option selects how the cell stores of an access group",
+    "are chosen for merging compactions.  The default policy merges adjacent runs",
+    "of small cell stores until they reach the target cell store size.  The",
+    "size-tiered policy waits until several cell stores of similar size have",
+    "accumulated and merges them into one store of the next tier, which keeps",
+    "write amplification low for append-mostly (e.g. time-series) data.  The",
+    "leveled policy keeps each cell store at least --fanout times larger than",
+    "the next newer one, which bounds the number of cell stores (and hence the",
+    "read amplification) at the cost of rewriting data more often.  The",
+    "time-window policy groups cell stores by the window (of --window seconds)",
+    "containing their newest cell and merges each window into a single cell",
+    "store once the window has closed.",
+    "",
+    "Independent of the policy, when every column family in an access group has",
+    "a TTL, a cell store whose newest cell has expired is dropped as a whole",
+    "without being read.  Combined with the time-window policy this reclaims",
+    "expired data from time-series tables with almost no compaction I/O.",
+    "",
+    "  * default",
+    "  * size-tiered [ size_tiered_options ]",
+    "  * leveled [ --fanout arg ]",
+    "  * time-window [ --window arg ] [ --min-threshold arg ]",
+    "",
+    "The following describes the compaction policy options:",
+    "",
+    "  --min-threshold arg     Minimum number of similarly sized cell stores that",
+    "                          trigger a size-tiered merge (default = 4)",
+    "",
+    "  --max-threshold arg     Maximum number of cell stores merged by a single",
+    "                          size-tiered merge (default = 32)",
+    "",
+    "  --bucket-low arg        Cell stores smaller than this fraction of the tier's",
+    "                          average size fall out of the tier (default = 0.5)",
+    "",
+    "  --bucket-high arg       Cell stores larger than this multiple of the tier's",
+    "                          average size fall out of the tier (default = 1.5)",
+    "",
+    "  --fanout arg            Size ratio between adjacent cell stores for the",
+    "                          leveled policy (default = 10)",
+    "",
+    "  --window arg            Width in seconds of the time-window policy's",
+    "                          windows (default = 86400).  --min-threshold is",
+    "                          the number of stores in the current window that",
+    "                          triggers a merge before the window closes",
+    "",
     "Compressors",
     "-----------",
     "",
@@ -1791,6 +1892,7 @@ namespace {
     "      (REVS revision_count",
     "      | INTO FILE filename[.gz]",
     "      | BUCKETS <n>",
+    "      | SHARDS <n>",
     "      | NO_ESCAPE)*",
     "",
     "    timestamp:",
@@ -1839,6 +1941,15 @@ namespace {
     "20.  It is recommended that <n> is at least as large as the number of nodes",
     "in the cluster that the backup with be restored to.",
     "",
+    "SHARDS <n>",
+    "",
+    "This option, which requires INTO FILE, causes the ranges of the table to be",
+    "divided among <n> output files which are written concurrently.  For an",
+    "output file of 'backup.gz', the shards are named 'backup.00000.gz',",
+    "'backup.00001.gz', etc. and a manifest named 'backup.manifest' is written",
+    "listing each shard and the number of cells it holds.  The shards can be",
+    "restored in parallel with one LOAD DATA INFILE command per shard.",
+    "",
     "NO_ESCAPE",
     "",
     "The output format of a DUMP TABLE command comprises tab delimited lines, one",
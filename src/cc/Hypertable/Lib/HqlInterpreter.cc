@@ -32,6 +32,7 @@ extern "C" {
 }
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/iostreams/device/file_descriptor.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
@@ -43,6 +44,7 @@ extern "C" {
 #include "Common/Stopwatch.h"
 #include "Common/ScopeGuard.h"
 #include "Common/String.h"
+#include "Common/Thread.h"
 
 #include "Client.h"
 #include "Namespace.h"
@@ -52,6 +54,7 @@ extern "C" {
 #include "Key.h"
 #include "LoadDataEscape.h"
 #include "LoadDataFlags.h"
+#include "LoadDataParser.h"
 #include "LoadDataSource.h"
 #include "LoadDataSourceFactory.h"
 #include "ScanSpec.h"
@@ -190,6 +193,7 @@ cmd_create_table(NamespacePtr &ns, ParserState &state,
     foreach(Schema::AccessGroup *ag, state.ag_list) {
       schema->validate_compressor(ag->compressor);
       schema->validate_bloom_filter(ag->bloom_filter);
+      schema->validate_compaction_policy(ag->compaction_policy);
       if (state.table_in_memory)
         ag->in_memory = true;
       if (state.table_blocksize != 0 && ag->blocksize == 0)
@@ -447,40 +451,201 @@ cmd_select(NamespacePtr &ns, ConnectionManagerPtr &conn_manager,
 }
 
 
+const std::streamsize DUMP_BUFFER_SIZE = 1024*1024;
+
+void
+push_dump_sink(boost::iostreams::filtering_ostream &fout, const String &fname,
+               ConnectionManagerPtr &conn_manager,
+               DfsBroker::ClientPtr &dfs_client) {
+  String dfs = "dfs://";
+  String localfs = "file://";
+
+  if (boost::algorithm::ends_with(fname, ".gz"))
+    fout.push(boost::iostreams::gzip_compressor());
+  if (boost::algorithm::starts_with(fname, dfs)) {
+    // init Dfs client if not done yet
+    if (!dfs_client)
+      dfs_client = new DfsBroker::Client(conn_manager, Config::properties);
+    fout.push(DfsBroker::FileSink(dfs_client, fname.substr(dfs.size())),
+              DUMP_BUFFER_SIZE);
+  }
+  else if (boost::algorithm::starts_with(fname, localfs))
+    fout.push(boost::iostreams::file_descriptor_sink(fname.substr(localfs.size())),
+              DUMP_BUFFER_SIZE);
+  else
+    fout.push(boost::iostreams::file_descriptor_sink(fname), DUMP_BUFFER_SIZE);
+}
+
+void
+dump_cell(std::ostream &fout, Cell &cell, bool escape,
+          LoadDataEscape &row_escaper, LoadDataEscape &escaper) {
+  const char *unescaped_buf, *row_unescaped_buf;
+  size_t unescaped_len, row_unescaped_len;
+
+  fout << cell.timestamp << "\t";
+
+  if (escape)
+    row_escaper.escape(cell.row_key, strlen(cell.row_key),
+           &row_unescaped_buf, &row_unescaped_len);
+  else
+    row_unescaped_buf = cell.row_key;
+
+  if (cell.column_family) {
+    fout << row_unescaped_buf << "\t" << cell.column_family;
+    if (cell.column_qualifier && *cell.column_qualifier) {
+      if (escape)
+        escaper.escape(cell.column_qualifier, strlen(cell.column_qualifier),
+                 &unescaped_buf, &unescaped_len);
+      else
+        unescaped_buf = cell.column_qualifier;
+      fout << ":" << unescaped_buf;
+    }
+  }
+  else
+    fout << row_unescaped_buf;
+
+  if (escape)
+    escaper.escape((const char *)cell.value, (size_t)cell.value_len,
+           &unescaped_buf, &unescaped_len);
+  else {
+    unescaped_buf = (const char *)cell.value;
+    unescaped_len = (size_t)cell.value_len;
+  }
+
+  HT_ASSERT(cell.flag == FLAG_INSERT);
+
+  fout << "\t" ;
+  fout.write(unescaped_buf, unescaped_len);
+  fout << "\n";
+}
+
+/**
+ * One output file of a DUMP TABLE ... SHARDS n command, written by its own
+ * thread.
+ */
+class DumpShard : public ReferenceCount {
+public:
+  DumpShard() : cells(0), keys_size(0), values_size(0), error(Error::OK) { }
+  String filename;
+  boost::iostreams::filtering_ostream fout;
+  TableDumperPtr dumper;
+  ::uint64_t cells;
+  ::uint64_t keys_size;
+  ::uint64_t values_size;
+  int error;
+  String error_msg;
+};
+typedef intrusive_ptr<DumpShard> DumpShardPtr;
+
+void dump_shard(DumpShard *shard, bool escape) {
+  LoadDataEscape row_escaper;
+  LoadDataEscape escaper;
+  Cell cell;
+
+  try {
+    shard->fout << "#timestamp\trow\tcolumn\tvalue\n";
+    while (shard->dumper->next(cell)) {
+      ++shard->cells;
+      shard->keys_size += strlen(cell.row_key);
+      if (cell.column_family && cell.column_qualifier)
+        shard->keys_size += strlen(cell.column_qualifier) + 1;
+      shard->values_size += cell.value_len;
+      dump_cell(shard->fout, cell, escape, row_escaper, escaper);
+    }
+    shard->fout.strict_sync();
+  }
+  catch (Exception &e) {
+    shard->error = e.code();
+    shard->error_msg = e.what();
+  }
+  catch (std::exception &e) {
+    shard->error = Error::EXTERNAL;
+    shard->error_msg = format("caught std::exception: %s", e.what());
+  }
+}
+
+void
+cmd_dump_table_shards(NamespacePtr &ns, ConnectionManagerPtr &conn_manager,
+                      DfsBroker::ClientPtr &dfs_client, ParserState &state,
+                      HqlInterpreter::Callback &cb) {
+  TablePtr table = ns->open_table(state.table_name);
+  TableSplitsContainer splits;
+  std::vector<DumpShardPtr> shards;
+  String stem = state.scan.outfile;
+  String suffix;
+  ThreadGroup threads;
+
+  if (boost::algorithm::ends_with(stem, ".gz")) {
+    stem = stem.substr(0, stem.length() - 3);
+    suffix = ".gz";
+  }
+
+  ns->get_table_splits(state.table_name, splits);
+
+  for (int i=0; i<state.scan.shards; i++) {
+    DumpShardPtr shard = new DumpShard();
+    shard->filename = stem + format(".%05d", i) + suffix;
+    push_dump_sink(shard->fout, shard->filename, conn_manager, dfs_client);
+    shard->dumper = new TableDumper(table, splits, state.scan.builder.get(),
+                                    i, state.scan.shards);
+    shards.push_back(shard);
+  }
+
+  foreach (DumpShardPtr &shard, shards)
+    threads.create_thread(boost::bind(&dump_shard, shard.get(),
+                                      state.escape));
+  threads.join_all();
+
+  foreach (DumpShardPtr &shard, shards) {
+    if (shard->error != Error::OK)
+      HT_THROWF(shard->error, "Problem writing shard '%s' - %s",
+                shard->filename.c_str(), shard->error_msg.c_str());
+  }
+
+  // the manifest lists the shards so they can be loaded in parallel
+  boost::iostreams::filtering_ostream fout;
+  push_dump_sink(fout, stem + ".manifest", conn_manager, dfs_client);
+  fout << "#file\tcells\n";
+  foreach (DumpShardPtr &shard, shards) {
+    fout << shard->filename << "\t" << shard->cells << "\n";
+    if (cb.normal_mode) {
+      cb.total_cells += shard->cells;
+      cb.total_keys_size += shard->keys_size;
+      cb.total_values_size += shard->values_size;
+    }
+  }
+  fout.strict_sync();
+
+  cb.on_finish((TableMutator*)0);
+}
+
 void
 cmd_dump_table(NamespacePtr &ns,
                ConnectionManagerPtr &conn_manager, DfsBroker::ClientPtr &dfs_client,
                ParserState &state, HqlInterpreter::Callback &cb) {
   if (!ns)
     HT_THROW(Error::BAD_NAMESPACE, "Null namespace");
-  TablePtr table;
   boost::iostreams::filtering_ostream fout;
   FILE *outf = cb.output;
   int out_fd = -1;
-  String dfs = "dfs://";
-  String localfs = "file://";
 
   // verify parameters
 
+  if (state.scan.shards > 1) {
+    if (state.scan.outfile.empty())
+      HT_THROW(Error::HQL_PARSE_ERROR,
+               "DUMP TABLE ... SHARDS requires INTO FILE");
+    FileUtils::expand_tilde(state.scan.outfile);
+    cmd_dump_table_shards(ns, conn_manager, dfs_client, state, cb);
+    return;
+  }
+
   TableDumperPtr dumper = new TableDumper(ns, state.table_name, state.scan.builder.get());
 
   // whether it's select into file
   if (!state.scan.outfile.empty()) {
     FileUtils::expand_tilde(state.scan.outfile);
-
-    if (boost::algorithm::ends_with(state.scan.outfile, ".gz"))
-      fout.push(boost::iostreams::gzip_compressor());
-    if (boost::algorithm::starts_with(state.scan.outfile, dfs)) {
-      // init Dfs client if not done yet
-      if (!dfs_client)
-        dfs_client = new DfsBroker::Client(conn_manager, Config::properties);
-      fout.push(DfsBroker::FileSink(dfs_client, state.scan.outfile.substr(dfs.size())));
-    }
-    else if (boost::algorithm::starts_with(state.scan.outfile, localfs))
-      fout.push(boost::iostreams::file_descriptor_sink(state.scan.outfile.substr(localfs.size())));
-    else
-      fout.push(boost::iostreams::file_descriptor_sink(state.scan.outfile));
-
+    push_dump_sink(fout, state.scan.outfile, conn_manager, dfs_client);
     fout << "#timestamp\trow\tcolumn\tvalue\n";
   }
   else if (!outf) {
@@ -496,8 +661,6 @@ cmd_dump_table(NamespacePtr &ns,
   Cell cell;
   LoadDataEscape row_escaper;
   LoadDataEscape escaper;
-  const char *unescaped_buf, *row_unescaped_buf;
-  size_t unescaped_len, row_unescaped_len;
 
   while (dumper->next(cell)) {
     if (cb.normal_mode) {
@@ -511,41 +674,7 @@ cmd_dump_table(NamespacePtr &ns,
       cb.total_values_size += cell.value_len;
     }
 
-    fout << cell.timestamp << "\t";
-
-    if (state.escape)
-      row_escaper.escape(cell.row_key, strlen(cell.row_key),
-             &row_unescaped_buf, &row_unescaped_len);
-    else
-      row_unescaped_buf = cell.row_key;
-
-    if (cell.column_family) {
-      fout << row_unescaped_buf << "\t" << cell.column_family;
-      if (cell.column_qualifier && *cell.column_qualifier) {
-        if (state.escape)
-          escaper.escape(cell.column_qualifier, strlen(cell.column_qualifier),
-                   &unescaped_buf, &unescaped_len);
-        else
-          unescaped_buf = cell.column_qualifier;
-        fout << ":" << unescaped_buf;
-      }
-    }
-    else
-      fout << row_unescaped_buf;
-
-    if (state.escape)
-      escaper.escape((const char *)cell.value, (size_t)cell.value_len,
-             &unescaped_buf, &unescaped_len);
-    else {
-      unescaped_buf = (const char *)cell.value;
-      unescaped_len = (size_t)cell.value_len;
-    }
-
-    HT_ASSERT(cell.flag == FLAG_INSERT);
-
-    fout << "\t" ;
-    fout.write(unescaped_buf, unescaped_len);
-    fout << "\n";
+    dump_cell(fout, cell, state.escape, row_escaper, escaper);
   }
 
   fout.strict_sync();
@@ -600,7 +729,6 @@ cmd_load_data(NamespacePtr &ns, ::uint32_t mutator_flags,
 
 
   LoadDataSourcePtr lds;
-  bool is_delete;
 
   // init Dfs client if not done yet
   if(state.input_file_src == DFS_FILE && !dfs_client)
@@ -629,72 +757,60 @@ cmd_load_data(NamespacePtr &ns, ::uint32_t mutator_flags,
       fout << "row\tcolumn\tvalue\n";
   }
 
-  KeySpec key;
-  ::uint8_t *value;
-  ::uint32_t value_len;
+  LoadDataParser::BatchPtr batch;
   ::uint32_t consumed = 0;
-  LoadDataEscape row_escaper;
-  LoadDataEscape qualifier_escaper;
-  LoadDataEscape value_escaper;
-  const char *escaped_buf;
-  size_t escaped_len;
+  int32_t parse_threads =
+    Config::properties->get_i32("Hypertable.HqlInterpreter.LoadData.ParseThreads");
+  int32_t chunk_size =
+    Config::properties->get_i32("Hypertable.HqlInterpreter.LoadData.ChunkSize");
+  LoadDataParser parser(lds, state.columns, state.timestamp_column,
+                        state.row_uniquify_chars, state.load_flags,
+                        state.escape, parse_threads, chunk_size);
 
   try {
 
-    while (lds->next(&key, &value, &value_len, &is_delete, &consumed)) {
-
-      ++cb.total_cells;
-      cb.total_values_size += value_len;
-      cb.total_keys_size += key.row_len;
-
-      if (state.escape) {
-        row_escaper.unescape((const char *)key.row, (size_t)key.row_len,
-            &escaped_buf, &escaped_len);
-        key.row = escaped_buf;
-        key.row_len = escaped_len;
-        qualifier_escaper.unescape(key.column_qualifier, 
-                (size_t)key.column_qualifier_len, &escaped_buf, &escaped_len);
-        key.column_qualifier = escaped_buf;
-        key.column_qualifier_len = escaped_len;
-        value_escaper.unescape((const char *)value, 
-                (size_t)value_len, &escaped_buf, &escaped_len);
-      }
-      else {
-        escaped_buf = (const char *)value;
-        escaped_len = (size_t)value_len;
-      }
-
-      if (into_table) {
-        try {
-          bool skip = false;
-          if (ignore_unknown_columns) {
-            SchemaPtr schema = table->schema();
-            if (!schema->get_column_family(key.column_family))
-              skip = true;
+    while (parser.next(batch)) {
+
+      foreach (LoadDataParser::Cell &cell, batch->cells) {
+        KeySpec &key = cell.key;
+
+        ++cb.total_cells;
+        cb.total_values_size += cell.value_len;
+        cb.total_keys_size += key.row_len;
+
+        if (into_table) {
+          try {
+            bool skip = false;
+            if (ignore_unknown_columns) {
+              SchemaPtr schema = table->schema();
+              if (!schema->get_column_family(key.column_family))
+                skip = true;
+            }
+            if (!skip) {
+              if (cell.is_delete)
+                mutator->set_delete(key);
+              else
+                mutator->set(key, cell.value, cell.value_len);
+            }
           }
-          if (!skip) {
-            if (is_delete)
-              mutator->set_delete(key);
-            else
-              mutator->set(key, escaped_buf, escaped_len);
+          catch (Exception &e) {
+            do {
+              mutator->show_failed(e);
+            } while (!mutator->retry());
           }
         }
-        catch (Exception &e) {
-          do {
-            mutator->show_failed(e);
-          } while (!mutator->retry());
+        else {
+          if (display_timestamps)
+            fout << key.timestamp << "\t" << (const char *)key.row << "\t"
+                 << key.column_family << "\t" << cell.value << "\n";
+          else
+            fout << (const char *)key.row << "\t" << key.column_family << "\t"
+                 << cell.value << "\n";
         }
       }
-      else {
-        if (display_timestamps)
-          fout << key.timestamp << "\t" << key.row << "\t" 
-               << key.column_family << "\t" << escaped_buf << "\n";
-        else
-          fout << key.row << "\t" << key.column_family << "\t" 
-               << escaped_buf << "\n";
-      }
 
       if (cb.normal_mode && state.input_file_src != STDIN) {
+        consumed = batch->consumed;
         if (largefile_mode == true) {
           running_total += consumed;
           if (running_total >= consume_threshold) {
@@ -710,7 +826,8 @@ cmd_load_data(NamespacePtr &ns, ::uint32_t mutator_flags,
     }
   }
   catch (Exception &e) {
-    HT_THROW2F(e.code(), e, "line number %lld", (Lld)lds->get_current_lineno());
+    HT_THROW2F(e.code(), e, "line number %lld",
+               (Lld)parser.get_current_lineno());
   }
 
   fout.strict_sync();
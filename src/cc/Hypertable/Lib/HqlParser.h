@@ -226,7 +226,7 @@ namespace Hypertable {
       ScanState() : display_timestamps(false), keys_only(false),
           current_rowkey_set(false), start_time_set(false),
           end_time_set(false), current_timestamp_set(false),
-	  current_relop(0), buckets(0) { }
+	  current_relop(0), buckets(0), shards(0) { }
 
       void set_time_interval(::int64_t start, ::int64_t end) {
         HQL_DEBUG("("<< start <<", "<< end <<")");
@@ -262,6 +262,7 @@ namespace Hypertable {
       bool    current_timestamp_set;
       int current_relop;
       int buckets;
+      int shards;
     };
 
     class ParserState {
@@ -730,6 +731,16 @@ namespace Hypertable {
       ParserState &state;
     };
 
+    struct set_access_group_compaction_policy {
+      set_access_group_compaction_policy(ParserState &state) : state(state) { }
+      void operator()(char const * str, char const *end) const {
+        state.ag->compaction_policy = String(str, end-str);
+        trim_if(state.ag->compaction_policy, boost::is_any_of("'\""));
+        to_lower(state.ag->compaction_policy);
+      }
+      ParserState &state;
+    };
+
     struct access_group_add_column_family {
       access_group_add_column_family(ParserState &state) : state(state) { }
       void operator()(char const *str, char const *end) const {
@@ -1231,6 +1242,17 @@ namespace Hypertable {
       ParserState &state;
     };
 
+    struct scan_set_shards {
+      scan_set_shards(ParserState &state) : state(state) { }
+      void operator()(int ival) const {
+        if (state.scan.shards != 0)
+          HT_THROW(Error::HQL_PARSE_ERROR,
+                   "DUMP TABLE SHARDS option multiply defined.");
+        state.scan.shards = ival;
+      }
+      ParserState &state;
+    };
+
     struct scan_set_max_versions {
       scan_set_max_versions(ParserState &state) : state(state) { }
       void operator()(int ival) const {
@@ -1944,6 +1966,7 @@ namespace Hypertable {
           Token COMMIT       = as_lower_d["commit"];
           Token LOG          = as_lower_d["log"];
           Token BLOOMFILTER  = as_lower_d["bloomfilter"];
+          Token COMPACTION_POLICY = as_lower_d["compaction_policy"];
           Token TRUE         = as_lower_d["true"];
           Token FALSE        = as_lower_d["false"];
           Token YES          = as_lower_d["yes"];
@@ -1958,6 +1981,7 @@ namespace Hypertable {
           Token NOKEYS       = as_lower_d["nokeys"];
           Token SINGLE_CELL_FORMAT = as_lower_d["single_cell_format"];
           Token BUCKETS      = as_lower_d["buckets"];
+          Token SHARDS       = as_lower_d["shards"];
           Token REPLICATION  = as_lower_d["replication"];
           Token WAIT         = as_lower_d["wait"];
           Token FOR          = as_lower_d["for"];
@@ -2173,6 +2197,7 @@ namespace Hypertable {
           dump_table_option_spec
             = MAX_VERSIONS >> *EQUAL >> uint_p[scan_set_max_versions(self.state)]
             | BUCKETS >> uint_p[scan_set_buckets(self.state)]
+            | SHARDS >> uint_p[scan_set_shards(self.state)]
             | REVS >> !EQUAL >> uint_p[scan_set_max_versions(self.state)]
             | INTO >> FILE >> string_literal[scan_set_outfile(self.state)]
             ;
@@ -2434,6 +2459,7 @@ namespace Hypertable {
             | COMPRESSOR >> EQUAL >> string_literal[
                 set_access_group_compressor(self.state)]
             | bloom_filter_option
+            | compaction_policy_option
             ;
 
           bloom_filter_option
@@ -2441,6 +2467,11 @@ namespace Hypertable {
               >> string_literal[set_access_group_bloom_filter(self.state)]
             ;
 
+          compaction_policy_option
+            = COMPACTION_POLICY >> EQUAL
+              >> string_literal[set_access_group_compaction_policy(self.state)]
+            ;
+
           in_memory_option
             = IN_MEMORY
             ;
@@ -2698,6 +2729,7 @@ namespace Hypertable {
           BOOST_SPIRIT_DEBUG_RULE(index_definition);
           BOOST_SPIRIT_DEBUG_RULE(access_group_option);
           BOOST_SPIRIT_DEBUG_RULE(bloom_filter_option);
+          BOOST_SPIRIT_DEBUG_RULE(compaction_policy_option);
           BOOST_SPIRIT_DEBUG_RULE(in_memory_option);
           BOOST_SPIRIT_DEBUG_RULE(blocksize_option);
           BOOST_SPIRIT_DEBUG_RULE(replication_option);
@@ -2785,7 +2817,7 @@ namespace Hypertable {
           single_string_literal, double_string_literal, string_literal, 
           parameter_list, regexp_literal, ttl_option, counter_option, 
           access_group_definition, index_definition, access_group_option,
-          bloom_filter_option, in_memory_option,
+          bloom_filter_option, compaction_policy_option, in_memory_option,
           blocksize_option, replication_option, help_statement,
           describe_table_statement, show_statement, select_statement,
           where_clause, where_predicate,
@@ -0,0 +1,264 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/iostreams/device/array.hpp>
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+
+#include "LoadDataEscape.h"
+#include "LoadDataParser.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  /**
+   * LoadDataSource that parses lines previously read into memory by
+   * LoadDataSource::read_chunk.  Each parsing thread owns one.
+   */
+  class ChunkParser : public LoadDataSource {
+  public:
+    ChunkParser(int row_uniquify_chars, int load_flags)
+      : LoadDataSource("", row_uniquify_chars, load_flags) { }
+
+    void setup(const String &header, const std::vector<String> &key_columns,
+               const String &timestamp_column) {
+      // parse_header() tokenizes its argument in place
+      String header_copy(header.c_str(), header.length());
+      parse_header(header_copy, key_columns, timestamp_column);
+    }
+
+    void reset(const char *base, size_t len, int64_t first_line) {
+      m_fin.reset();
+      m_fin.clear();
+      m_fin.push(boost::iostreams::array_source(base, len));
+      m_cur_line = first_line;
+      m_next_value = m_column_info.size();
+      m_limit = 0;
+    }
+
+    uint64_t incr_consumed() { return 0; }
+
+  protected:
+    void init_src() { }
+  };
+
+  const char *
+  copy_string(CharArena &arena, const char *str, size_t len) {
+    char *copy = arena.alloc(len + 1);
+    if (len)
+      memcpy(copy, str, len);
+    copy[len] = 0;
+    return copy;
+  }
+
+  void
+  parse_chunk(ChunkParser &parser, LoadDataEscape *escapers, bool escape,
+              LoadDataParser::Batch *batch) {
+    LoadDataParser::Cell cell;
+    ::uint8_t *value;
+    ::uint32_t value_len;
+    const char *buf;
+    size_t len;
+
+    parser.reset((const char *)batch->input.base, batch->input.fill(),
+                 batch->first_line);
+
+    batch->cells.reserve(std::count(batch->input.base, batch->input.ptr,
+                                    (::uint8_t)'\n') + 1);
+
+    while (true) {
+      cell.key.clear();
+      if (!parser.next(&cell.key, &value, &value_len, &cell.is_delete, 0))
+        break;
+
+      if (escape) {
+        escapers[0].unescape((const char *)cell.key.row,
+                             (size_t)cell.key.row_len, &buf, &len);
+        cell.key.row = copy_string(batch->arena, buf, len);
+        cell.key.row_len = len;
+        if (cell.key.column_qualifier) {
+          escapers[1].unescape(cell.key.column_qualifier,
+                  (size_t)cell.key.column_qualifier_len, &buf, &len);
+          cell.key.column_qualifier = copy_string(batch->arena, buf, len);
+          cell.key.column_qualifier_len = len;
+        }
+        escapers[2].unescape((const char *)value, (size_t)value_len,
+                             &buf, &len);
+      }
+      else {
+        cell.key.row = copy_string(batch->arena, (const char *)cell.key.row,
+                                   cell.key.row_len);
+        if (cell.key.column_qualifier)
+          cell.key.column_qualifier = copy_string(batch->arena,
+                  cell.key.column_qualifier, cell.key.column_qualifier_len);
+        buf = (const char *)value;
+        len = value_len;
+      }
+
+      if (cell.key.column_family)
+        cell.key.column_family = batch->arena.dup(cell.key.column_family);
+
+      if (buf) {
+        cell.value = copy_string(batch->arena, buf, len);
+        cell.value_len = len;
+      }
+      else {
+        cell.value = 0;
+        cell.value_len = 0;
+      }
+
+      batch->cells.push_back(cell);
+    }
+
+    // the raw input is no longer referenced
+    batch->input.free();
+  }
+
+}
+
+
+LoadDataParser::LoadDataParser(LoadDataSourcePtr &lds,
+                               const std::vector<String> &key_columns,
+                               const String &timestamp_column,
+                               int row_uniquify_chars, int load_flags,
+                               bool escape, size_t threads,
+                               size_t chunk_size)
+  : m_lds(lds), m_key_columns(key_columns),
+    m_timestamp_column(timestamp_column),
+    m_row_uniquify_chars(row_uniquify_chars), m_load_flags(load_flags),
+    m_escape(escape), m_chunk_size(chunk_size), m_next_sequence(0),
+    m_next_delivery(0), m_current_line(lds->get_current_lineno()),
+    m_eof(false), m_shutdown(false), m_error(Error::OK) {
+
+  if (threads == 0)
+    threads = 1;
+
+  // bound the amount of input held in memory
+  m_max_outstanding = 2 * threads;
+
+  for (size_t i=0; i<threads; i++)
+    m_threads.push_back(new Thread(boost::bind(&LoadDataParser::worker,
+                                               this)));
+}
+
+
+LoadDataParser::~LoadDataParser() {
+  {
+    ScopedLock lock(m_mutex);
+    m_shutdown = true;
+    m_read_cond.notify_all();
+  }
+  foreach(Thread *thread, m_threads) {
+    thread->join();
+    delete thread;
+  }
+}
+
+
+bool LoadDataParser::next(BatchPtr &batchp) {
+  ScopedLock lock(m_mutex);
+  std::map<int64_t, BatchPtr>::iterator iter;
+
+  while (true) {
+    if (m_error != Error::OK)
+      HT_THROW(m_error, m_error_msg);
+    if ((iter = m_completed.find(m_next_delivery)) != m_completed.end())
+      break;
+    if (m_eof && m_next_delivery == m_next_sequence)
+      return false;
+    m_deliver_cond.wait(lock);
+  }
+
+  batchp = iter->second;
+  m_completed.erase(iter);
+  m_next_delivery++;
+  m_current_line = batchp->first_line;
+  m_read_cond.notify_one();
+  return true;
+}
+
+
+void LoadDataParser::worker() {
+  ChunkParser parser(m_row_uniquify_chars, m_load_flags);
+  LoadDataEscape escapers[3];
+
+  try {
+
+    parser.setup(m_lds->get_header_line(), m_key_columns,
+                 m_timestamp_column);
+
+    while (true) {
+      BatchPtr batch = new Batch();
+
+      {
+        ScopedLock lock(m_mutex);
+        while (!m_shutdown && !m_eof && m_error == Error::OK &&
+               m_next_sequence - m_next_delivery >= (int64_t)m_max_outstanding)
+          m_read_cond.wait(lock);
+        if (m_shutdown || m_eof || m_error != Error::OK)
+          break;
+        if (!m_lds->read_chunk(batch->input, m_chunk_size, &batch->consumed,
+                               &batch->first_line)) {
+          m_eof = true;
+          m_read_cond.notify_all();
+          m_deliver_cond.notify_all();
+          break;
+        }
+        batch->sequence = m_next_sequence++;
+      }
+
+      parse_chunk(parser, escapers, m_escape, batch.get());
+
+      {
+        ScopedLock lock(m_mutex);
+        m_completed[batch->sequence] = batch;
+        m_deliver_cond.notify_all();
+      }
+    }
+  }
+  catch (Exception &e) {
+    ScopedLock lock(m_mutex);
+    if (m_error == Error::OK) {
+      m_error = e.code();
+      m_error_msg = e.what();
+      m_current_line = parser.get_current_lineno();
+    }
+    m_read_cond.notify_all();
+    m_deliver_cond.notify_all();
+  }
+  catch (std::exception &e) {
+    ScopedLock lock(m_mutex);
+    if (m_error == Error::OK) {
+      m_error = Error::EXTERNAL;
+      m_error_msg = format("caught std::exception: %s", e.what());
+      m_current_line = parser.get_current_lineno();
+    }
+    m_read_cond.notify_all();
+    m_deliver_cond.notify_all();
+  }
+}
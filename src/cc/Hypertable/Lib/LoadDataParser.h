@@ -0,0 +1,118 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_LOADDATAPARSER_H
+#define HYPERTABLE_LOADDATAPARSER_H
+
+#include <map>
+#include <vector>
+
+#include <boost/thread/condition.hpp>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/Mutex.h"
+#include "Common/PageArena.h"
+#include "Common/ReferenceCount.h"
+#include "Common/String.h"
+#include "Common/Thread.h"
+
+#include "KeySpec.h"
+#include "LoadDataSource.h"
+
+namespace Hypertable {
+
+  /**
+   * Parses the input of a LoadDataSource with a pool of threads.  The
+   * source is read in chunks of whole lines, each chunk is parsed (and
+   * optionally unescaped) by one of the threads into a Batch of cells, and
+   * the batches are handed back by next() in input order.
+   */
+  class LoadDataParser {
+
+  public:
+
+    struct Cell {
+      KeySpec key;
+      const char *value;
+      uint32_t value_len;
+      bool is_delete;
+    };
+
+    class Batch : public ReferenceCount {
+    public:
+      Batch() : sequence(0), consumed(0), first_line(0) { }
+      int64_t sequence;
+      uint32_t consumed;
+      int64_t first_line;
+      DynamicBuffer input;
+      CharArena arena;
+      std::vector<Cell> cells;
+    };
+    typedef boost::intrusive_ptr<Batch> BatchPtr;
+
+    LoadDataParser(LoadDataSourcePtr &lds,
+                   const std::vector<String> &key_columns,
+                   const String &timestamp_column, int row_uniquify_chars,
+                   int load_flags, bool escape, size_t threads,
+                   size_t chunk_size);
+
+    ~LoadDataParser();
+
+    /** Fetches the next batch of parsed cells.  Re-throws any exception
+     * encountered by the parsing threads.
+     *
+     * @param batchp reference to batch pointer to fill in
+     * @return false if the input is exhausted
+     */
+    bool next(BatchPtr &batchp);
+
+    /** Returns the line number of the first line of the most recently
+     * delivered batch */
+    int64_t get_current_lineno() { return m_current_line; }
+
+  private:
+    void worker();
+
+    Mutex m_mutex;
+    boost::condition m_read_cond;
+    boost::condition m_deliver_cond;
+    LoadDataSourcePtr m_lds;
+    std::vector<String> m_key_columns;
+    String m_timestamp_column;
+    int m_row_uniquify_chars;
+    int m_load_flags;
+    bool m_escape;
+    size_t m_chunk_size;
+    size_t m_max_outstanding;
+    int64_t m_next_sequence;
+    int64_t m_next_delivery;
+    int64_t m_current_line;
+    bool m_eof;
+    bool m_shutdown;
+    int m_error;
+    String m_error_msg;
+    std::map<int64_t, BatchPtr> m_completed;
+    std::vector<Thread *> m_threads;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_LOADDATAPARSER_H
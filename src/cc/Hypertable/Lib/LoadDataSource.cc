@@ -146,9 +146,47 @@ LoadDataSource::init(const std::vector<String> &key_columns, const String &times
   String header;
   init_src();
   header = get_header();
+  // parse_header() tokenizes its argument in place
+  m_header = String(header.c_str(), header.length());
   parse_header(header, key_columns, timestamp_column);
 }
 
+bool
+LoadDataSource::read_chunk(DynamicBuffer &buf, size_t size,
+                           uint32_t *consumedp, int64_t *linep)
+{
+  String line;
+  size_t start = buf.fill();
+  size_t nread;
+
+  *linep = m_cur_line;
+
+  if (m_first_line_cached) {
+    buf.add(m_first_line.c_str(), m_first_line.length());
+    buf.add("\n", 1);
+    m_first_line_cached = false;
+  }
+
+  buf.ensure(size);
+  m_fin.read((char *)buf.ptr, size);
+  nread = m_fin.gcount();
+  buf.ptr += nread;
+
+  // complete the last line
+  if (nread == size && getline(m_fin, line)) {
+    buf.add(line.c_str(), line.length());
+    buf.add("\n", 1);
+  }
+
+  for (const uint8_t *ptr = buf.base + start, *end = buf.ptr;
+       (ptr = (const uint8_t *)memchr(ptr, '\n', end - ptr)) != 0; ptr++)
+    m_cur_line++;
+
+  *consumedp = m_zipped ? incr_consumed() : buf.fill() - start;
+
+  return buf.fill() > start;
+}
+
 void
 LoadDataSource::parse_header(const String &header, 
                              const std::vector<String> &key_columns,
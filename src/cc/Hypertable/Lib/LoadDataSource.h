@@ -68,6 +68,23 @@ namespace Hypertable {
                       const String &timestamp_column);
 
     int64_t get_current_lineno() { return m_cur_line; }
+
+    /** Returns the header line determined by init() */
+    const String &get_header_line() { return m_header; }
+
+    /** Reads roughly <code>size</code> bytes of whole lines from the source
+     * into <code>buf</code> without parsing them, so that they can be parsed
+     * elsewhere (see LoadDataParser).
+     *
+     * @param buf buffer to append lines to
+     * @param size number of bytes to read before completing the last line
+     * @param consumedp address of number of source bytes consumed
+     * @param linep address of line number of the first line read
+     * @return false if the source is exhausted
+     */
+    bool read_chunk(DynamicBuffer &buf, size_t size, uint32_t *consumedp,
+                    int64_t *linep);
+
     unsigned long get_source_size() const { return m_source_size; }
 
   protected:
@@ -142,6 +159,7 @@ namespace Hypertable {
     int m_row_uniquify_chars;
     int m_load_flags;
     String m_first_line;
+    String m_header;
     bool m_first_line_cached;
     unsigned long m_source_size;
   };
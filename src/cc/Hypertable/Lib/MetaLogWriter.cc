@@ -46,7 +46,8 @@ bool Writer::skip_recover_entry = false;
 
 Writer::Writer(FilesystemPtr &fs, DefinitionPtr &definition, const String &path,
                std::vector<EntityPtr> &initial_entities) :
-  m_fs(fs), m_definition(definition), m_offset(0) {
+  m_fs(fs), m_definition(definition), m_offset(0), m_buffered_sequence(0),
+  m_completed_sequence(0), m_writing(false), m_entity_count(0), m_write_count(0) {
 
   HT_EXPECT(Config::properties, Error::FAILED_EXPECTATION);
 
@@ -84,8 +85,12 @@ Writer::Writer(FilesystemPtr &fs, DefinitionPtr &definition, const String &path,
   write_header();
 
   // Write existing entries
-  foreach (EntityPtr &entity, initial_entities)
-    record_state(entity.get());
+  if (!initial_entities.empty()) {
+    std::vector<Entity *> entities;
+    foreach (EntityPtr &entity, initial_entities)
+      entities.push_back(entity.get());
+    record_state(entities);
+  }
 
   // Write "Recover" entity
   if (!skip_recover_entry) {
@@ -102,6 +107,8 @@ Writer::~Writer() {
 
 void Writer::close() {
   ScopedLock lock(m_mutex);
+  while (m_writing)
+    m_cond.wait(lock);
   try {
     if (m_fd != -1) {
       m_fs->close(m_fd, (DispatchHandler *)0);
@@ -172,89 +179,135 @@ void Writer::write_header() {
 
 void Writer::record_state(Entity *entity) {
   ScopedLock lock(m_mutex);
-  StaticBuffer buf(EntityHeader::LENGTH + entity->encoded_length());
-  boost::shared_array<uint8_t> backup_buf( new uint8_t [EntityHeader::LENGTH + entity->encoded_length()] );
-  uint8_t *ptr = buf.base;
+  size_t length = EntityHeader::LENGTH + entity->encoded_length();
+  uint8_t *start;
 
-  entity->encode_entry( &ptr );
+  m_buffer.ensure(length);
+  start = m_buffer.ptr;
+  entity->encode_entry( &m_buffer.ptr );
+  HT_ASSERT((m_buffer.ptr-start) == (ptrdiff_t)length);
+  m_entity_count++;
 
-  HT_ASSERT((ptr-buf.base) == (ptrdiff_t)buf.size);
-  memcpy(backup_buf.get(), buf.base, buf.size);
-
-  m_fs->append(m_fd, buf, Filesystem::O_FLUSH);
-  FileUtils::write(m_backup_fd, backup_buf.get(), buf.size);
-  m_offset += buf.size;
+  write_buffered(lock, ++m_buffered_sequence);
 }
 
 void Writer::record_state(std::vector<Entity *> &entities) {
   ScopedLock lock(m_mutex);
   size_t length = 0;
+  uint8_t *start;
 
   for (size_t i=0; i<entities.size(); i++)
     length += EntityHeader::LENGTH + entities[i]->encoded_length();
 
-  {
-    StaticBuffer buf(length);
-    boost::shared_array<uint8_t> backup_buf( new uint8_t [length] );
-    uint8_t *ptr = buf.base;
-
-    for (size_t i=0; i<entities.size(); i++)
-      entities[i]->encode_entry( &ptr );
-
-    HT_ASSERT((ptr-buf.base) == (ptrdiff_t)buf.size);
-    memcpy(backup_buf.get(), buf.base, buf.size);
+  m_buffer.ensure(length);
+  start = m_buffer.ptr;
+  for (size_t i=0; i<entities.size(); i++)
+    entities[i]->encode_entry( &m_buffer.ptr );
+  HT_ASSERT((m_buffer.ptr-start) == (ptrdiff_t)length);
+  m_entity_count += entities.size();
 
-    m_fs->append(m_fd, buf, Filesystem::O_FLUSH);
-    FileUtils::write(m_backup_fd, backup_buf.get(), buf.size);
-    m_offset += buf.size;
-  }
+  write_buffered(lock, ++m_buffered_sequence);
 }
 
 
 void Writer::record_removal(Entity *entity) {
   ScopedLock lock(m_mutex);
-  StaticBuffer buf(EntityHeader::LENGTH);
-  uint8_t backup_buf[EntityHeader::LENGTH];
-  uint8_t *ptr = buf.base;
 
   entity->header.flags |= EntityHeader::FLAG_REMOVE;
   entity->header.length = 0;
   entity->header.checksum = 0;
 
-  entity->header.encode( &ptr );
-
-  HT_ASSERT((ptr-buf.base) == (ptrdiff_t)buf.size);
-  memcpy(backup_buf, buf.base, buf.size);
-
-  m_fs->append(m_fd, buf, Filesystem::O_FLUSH);
-  FileUtils::write(m_backup_fd, backup_buf, buf.size);
-  m_offset += buf.size;
+  m_buffer.ensure(EntityHeader::LENGTH);
+  entity->header.encode( &m_buffer.ptr );
+  m_entity_count++;
 
+  write_buffered(lock, ++m_buffered_sequence);
 }
 
 
 void Writer::record_removal(std::vector<Entity *> &entities) {
   ScopedLock lock(m_mutex);
-  size_t length = entities.size() * EntityHeader::LENGTH;
 
-  {
-    StaticBuffer buf(length);
-    boost::shared_array<uint8_t> backup_buf( new uint8_t [length] );
-    uint8_t *ptr = buf.base;
+  m_buffer.ensure(entities.size() * EntityHeader::LENGTH);
+  for (size_t i=0; i<entities.size(); i++) {
+    entities[i]->header.flags |= EntityHeader::FLAG_REMOVE;
+    entities[i]->header.length = 0;
+    entities[i]->header.checksum = 0;
+    entities[i]->header.encode( &m_buffer.ptr );
+  }
+  m_entity_count += entities.size();
+
+  write_buffered(lock, ++m_buffered_sequence);
+}
+
 
-    for (size_t i=0; i<entities.size(); i++) {
-      entities[i]->header.flags |= EntityHeader::FLAG_REMOVE;
-      entities[i]->header.length = 0;
-      entities[i]->header.checksum = 0;
-      entities[i]->header.encode( &ptr );
+/**
+ * Waits until the entries buffered up to and including <code>sequence</code>
+ * have been written.  Called with m_mutex held; the lock is released while
+ * this thread writes on behalf of all waiting threads.  Every sequence
+ * number belongs to exactly one waiting caller, so a failed write is
+ * forgotten once all callers whose entries it contained have seen it.
+ */
+void Writer::write_buffered(ScopedLock &lock, uint64_t sequence) {
+
+  while (true) {
+
+    FailedWriteMap::iterator iter = m_failed_writes.lower_bound(sequence);
+    if (iter != m_failed_writes.end() && iter->second.first < sequence) {
+      int error = iter->second.error;
+      if (--iter->second.waiters == 0)
+        m_failed_writes.erase(iter);
+      HT_THROWF(error, "Error writing %s metalog file %s",
+                m_definition->name(), m_filename.c_str());
+    }
+
+    if (sequence <= m_completed_sequence)
+      break;
+
+    if (m_writing) {
+      m_cond.wait(lock);
+      continue;
     }
 
-    HT_ASSERT((ptr-buf.base) == (ptrdiff_t)buf.size);
-    memcpy(backup_buf.get(), buf.base, buf.size);
+    m_writing = true;
+    uint64_t last_sequence = m_buffered_sequence;
+    StaticBuffer buf(m_buffer);
+    size_t length = buf.size;
+    boost::shared_array<uint8_t> backup_buf( new uint8_t [length] );
+    memcpy(backup_buf.get(), buf.base, length);
+
+    lock.unlock();
+    int error = Error::OK;
+    try {
+      m_fs->append(m_fd, buf, Filesystem::O_FLUSH);
+      FileUtils::write(m_backup_fd, backup_buf.get(), length);
+    }
+    catch (Exception &e) {
+      HT_ERROR_OUT << e << HT_END;
+      error = e.code();
+    }
+    lock.lock();
 
-    m_fs->append(m_fd, buf, Filesystem::O_FLUSH);
-    FileUtils::write(m_backup_fd, backup_buf.get(), buf.size);
-    m_offset += buf.size;
+    m_writing = false;
+    if (error == Error::OK) {
+      m_offset += length;
+      m_write_count++;
+    }
+    else {
+      FailedWrite &failed = m_failed_writes[last_sequence];
+      failed.first = m_completed_sequence;
+      failed.error = error;
+      failed.waiters = last_sequence - m_completed_sequence;
+    }
+    m_completed_sequence = last_sequence;
+    m_cond.notify_all();
   }
 
 }
+
+
+void Writer::get_counters(uint64_t *entitiesp, uint64_t *writesp) {
+  ScopedLock lock(m_mutex);
+  *entitiesp = m_entity_count;
+  *writesp = m_write_count;
+}
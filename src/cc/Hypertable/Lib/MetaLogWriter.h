@@ -22,12 +22,16 @@
 #ifndef HYPERTABLE_METALOGWRITER_H
 #define HYPERTABLE_METALOGWRITER_H
 
+#include "Common/DynamicBuffer.h"
 #include "Common/Filesystem.h"
 #include "Common/Mutex.h"
 #include "Common/ReferenceCount.h"
 
+#include <map>
 #include <vector>
 
+#include <boost/thread/condition.hpp>
+
 #include "MetaLogDefinition.h"
 #include "MetaLogEntity.h"
 
@@ -35,6 +39,14 @@ namespace Hypertable {
 
   namespace MetaLog {
 
+    /**
+     * Appends entity state changes to a MetaLog.  Entries recorded
+     * concurrently by different threads are group committed: the first
+     * thread to find no write in progress writes (and flushes) everything
+     * buffered so far, the others wait for that write to cover their
+     * entries.  If a write fails, every caller whose entries it contained
+     * gets the error, even if later writes succeed.
+     */
     class Writer : public ReferenceCount {
     public:
       Writer(FilesystemPtr &fs, DefinitionPtr &definition, const String &path,
@@ -45,14 +57,24 @@ namespace Hypertable {
       void record_state(std::vector<Entity *> &entities);
       void record_removal(Entity *entity);
       void record_removal(std::vector<Entity *> &entities);
+      void get_counters(uint64_t *entitiesp, uint64_t *writesp);
 
       static bool skip_recover_entry;
 
     private:
       void write_header();
+      void write_buffered(ScopedLock &lock, uint64_t sequence);
       void purge_old_log_files(std::vector<int32_t> &file_ids, size_t keep_count);
       void initialize_new_log_file(int32_t next_id);
 
+      /** Sequence range (first, last] of a failed write */
+      struct FailedWrite {
+        uint64_t first;
+        int error;
+        size_t waiters;
+      };
+      typedef std::map<uint64_t, FailedWrite> FailedWriteMap;
+
       Mutex m_mutex;
       FilesystemPtr m_fs;
       DefinitionPtr m_definition;
@@ -64,6 +86,14 @@ namespace Hypertable {
       String  m_backup_filename;
       int m_backup_fd;
       int m_offset;
+      boost::condition m_cond;
+      DynamicBuffer m_buffer;
+      uint64_t m_buffered_sequence;
+      uint64_t m_completed_sequence;
+      FailedWriteMap m_failed_writes;
+      bool m_writing;
+      uint64_t m_entity_count;
+      uint64_t m_write_count;
     };
     typedef intrusive_ptr<Writer> WriterPtr;
     
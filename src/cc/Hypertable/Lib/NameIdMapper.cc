@@ -104,6 +104,44 @@ void NameIdMapper::add_entry(const String &names_parent, const String &names_ent
   attrs.push_back(Attribute("name", names_entry.c_str(), names_entry.length()));
   attrs.push_back(Attribute("nid", "0", 1));
 
+  char buf[16];
+  sprintf(buf, "%llu", (Llu)id);
+
+  std::vector<Attribute> init_attr;
+  init_attr.push_back(Attribute("id", buf, strlen(buf)));
+
+  /**
+   * Create the ID file and the names file in a single batch.  If the ID file
+   * was left behind by an earlier attempt, the batch fails without changing
+   * anything and we fall back to creating the files one at a time.
+   */
+  {
+    std::vector<MultiOp> ops;
+    std::vector<MultiOpResult> results;
+    int oflags = OPEN_FLAG_READ|OPEN_FLAG_WRITE|OPEN_FLAG_CREATE|OPEN_FLAG_EXCL;
+
+    if (is_namespace) {
+      ops.push_back(MultiOp::mkdir(ids_file, false, &attrs));
+      ops.push_back(MultiOp::mkdir(names_file, false, &init_attr));
+    }
+    else {
+      ops.push_back(MultiOp::attr_set(0, ids_file, oflags, "name",
+                                      names_entry.c_str(), names_entry.length()));
+      ops.push_back(MultiOp::attr_set(0, names_file, oflags, "id",
+                                      buf, strlen(buf)));
+    }
+
+    try {
+      m_hyperspace->multi(ops, results);
+      ids.push_back(id);
+      return;
+    }
+    catch (Exception &e) {
+      if (e.code() != Error::HYPERSPACE_FILE_EXISTS)
+        throw;
+    }
+  }
+
   if (m_hyperspace->exists(ids_file)) {
     if (is_namespace) {
       if (!m_hyperspace->attr_exists(ids_file, "nid")) {
@@ -129,14 +167,8 @@ void NameIdMapper::add_entry(const String &names_parent, const String &names_ent
   // At this point the ID file exists, we now need to
   // create the names file/dir and update the "id" attribute
 
-  char buf[16];
-  sprintf(buf, "%llu", (Llu)id);
-
-  if (is_namespace) {
-    std::vector<Attribute> init_attr;
-    init_attr.push_back(Attribute("id", buf, strlen(buf)));
+  if (is_namespace)
     m_hyperspace->mkdir(names_file, init_attr);
-  }
   else {
     // Set the "id" attribute of the names file
     m_hyperspace->attr_set(names_file, OPEN_FLAG_READ|OPEN_FLAG_WRITE|OPEN_FLAG_CREATE|OPEN_FLAG_EXCL,
@@ -225,10 +257,13 @@ void NameIdMapper::rename(const String &curr_name, const String &next_name) {
     new_name_last_comp = new_name;
 
   if (do_mapping(old_name, false, id, 0)) {
+    std::vector<Hyperspace::MultiOp> ops;
+    std::vector<Hyperspace::MultiOpResult> results;
+
     // Set the name attribute of the id file to be the last path component of new_name
     String id_file = m_ids_dir + "/" + id;
-    m_hyperspace->attr_set(id_file, oflags, "name", new_name_last_comp.c_str(),
-                           new_name_last_comp.length());
+    ops.push_back(Hyperspace::MultiOp::attr_set(0, id_file, oflags, "name",
+                  new_name_last_comp.c_str(), new_name_last_comp.length()));
 
     // Create the name file and set its id attribute
     id_last_component_pos = id.find_last_of('/');
@@ -237,11 +272,15 @@ void NameIdMapper::rename(const String &curr_name, const String &next_name) {
     else
       id_last_component = id;
 
-    m_hyperspace->attr_set(m_names_dir + "/" + new_name, oflags|OPEN_FLAG_CREATE, "id", id_last_component.c_str(),
-                           id_last_component.length());
+    ops.push_back(Hyperspace::MultiOp::attr_set(0, m_names_dir + "/" + new_name,
+                  oflags|OPEN_FLAG_CREATE, "id", id_last_component.c_str(),
+                  id_last_component.length()));
 
     // Delete the existing name file
-    m_hyperspace->unlink(m_names_dir + "/" + old_name);
+    ops.push_back(Hyperspace::MultiOp::unlink(m_names_dir + "/" + old_name));
+
+    // All three updates are applied atomically in one round trip
+    m_hyperspace->multi(ops, results);
   }
 
 }
@@ -250,10 +289,27 @@ void NameIdMapper::drop_mapping(const String &name) {
   ScopedLock lock(m_mutex);
   String id;
   String table_name = name;
+  bool have_id;
 
   boost::trim_if(table_name, boost::is_any_of("/ "));
 
-  if (do_mapping(name, false, id, 0)) {
+  have_id = do_mapping(name, false, id, 0);
+
+  // Normally both files exist and are removed in a single batch
+  if (have_id) {
+    std::vector<MultiOp> ops;
+    std::vector<MultiOpResult> results;
+    ops.push_back(MultiOp::unlink(m_ids_dir + "/" + id));
+    ops.push_back(MultiOp::unlink(m_names_dir + "/" + table_name));
+    try {
+      m_hyperspace->multi(ops, results);
+      return;
+    }
+    catch (Exception &e) {
+      if (e.code() != Error::HYPERSPACE_FILE_NOT_FOUND &&
+          e.code() != Error::HYPERSPACE_BAD_PATHNAME)
+        throw;
+    }
     try {
       m_hyperspace->unlink(m_ids_dir + "/" + id);
     }
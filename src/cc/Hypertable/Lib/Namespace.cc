@@ -138,6 +138,7 @@ void Namespace::alter_table(const String &table_name, const String &alter_schema
       final_ag->blocksize = alter_ag->blocksize;
       final_ag->compressor = alter_ag->compressor;
       final_ag->bloom_filter = alter_ag->bloom_filter;
+      final_ag->compaction_policy = alter_ag->compaction_policy;
       if (!final_schema->add_access_group(final_ag)) {
         String error_msg = final_schema->get_error_string();
         delete final_ag;
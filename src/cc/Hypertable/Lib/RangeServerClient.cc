@@ -566,19 +566,20 @@ RangeServerClient::replay_begin(const CommAddress &addr, uint16_t group,
 void
 RangeServerClient::replay_load_range(const CommAddress &addr,
     const TableIdentifier &table, const RangeSpec &range,
-    const RangeState &range_state, DispatchHandler *handler) {
+    const RangeState &range_state, bool needs_compaction,
+    DispatchHandler *handler) {
   CommBufPtr cbp(RangeServerProtocol::create_request_replay_load_range(table,
-                 range, range_state));
+                 range, range_state, needs_compaction));
   send_message(addr, cbp, handler, m_default_timeout_ms);
 }
 
 void
 RangeServerClient::replay_load_range(const CommAddress &addr,
     const TableIdentifier &table, const RangeSpec &range,
-    const RangeState &range_state, DispatchHandler *handler,
-    Timer &timer) {
+    const RangeState &range_state, bool needs_compaction,
+    DispatchHandler *handler, Timer &timer) {
   CommBufPtr cbp(RangeServerProtocol::create_request_replay_load_range(table,
-                 range, range_state));
+                 range, range_state, needs_compaction));
   send_message(addr, cbp, handler, timer.remaining());
 }
 
@@ -653,6 +654,24 @@ RangeServerClient::do_relinquish_range(const CommAddress &addr, const TableIdent
              + Protocol::string_format_message(event));
 }
 
+void
+RangeServerClient::adopt_cellstores(const CommAddress &addr,
+                                    const TableIdentifier &table,
+                                    const RangeSpec &range,
+                                    const String &access_group,
+                                    const std::vector<String> &files) {
+  DispatchHandlerSynchronizer sync_handler;
+  EventPtr event;
+  CommBufPtr cbp(RangeServerProtocol::create_request_adopt_cellstores(table,
+                                      range, access_group, files));
+  send_message(addr, cbp, &sync_handler, m_default_timeout_ms);
+
+  if (!sync_handler.wait_for_reply(event))
+    HT_THROW((int)Protocol::response_code(event),
+             String("RangeServer adopt_cellstores() failure : ")
+             + Protocol::string_format_message(event));
+}
+
 void RangeServerClient::heapcheck(const CommAddress &addr, String &outfile) {
   DispatchHandlerSynchronizer sync_handler;
   EventPtr event;
@@ -513,12 +513,13 @@ namespace Hypertable {
      * @param table table identifier
      * @param range range specification
      * @param state range state object
+     * @param needs_compaction if true, range needs compaction after load
      * @param handler response handler
      */
     void replay_load_range(const CommAddress &addr,
                            const TableIdentifier &table,
                            const RangeSpec &range, const RangeState &state,
-                           DispatchHandler *handler);
+                           bool needs_compaction, DispatchHandler *handler);
 
     /** Issues an asynchronous "replay load range" request with timer.
      *
@@ -526,13 +527,15 @@ namespace Hypertable {
      * @param table table identifier
      * @param range range specification
      * @param state range state object
+     * @param needs_compaction if true, range needs compaction after load
      * @param handler response handler
      * @param timer timer
      */
     void replay_load_range(const CommAddress &addr,
                            const TableIdentifier &table,
                            const RangeSpec &range, const RangeState &state,
-                           DispatchHandler *handler, Timer &timer);
+                           bool needs_compaction, DispatchHandler *handler,
+                           Timer &timer);
 
     /** Issues an asynchronous "replay update" request.
      *
@@ -618,6 +621,21 @@ namespace Hypertable {
      */
     void heapcheck(const CommAddress &addr, String &outfile);
 
+    /** Issues an "adopt cellstores" request synchronously.  The RangeServer
+     * moves the given CellStore files into the range's access group
+     * directory and adds them to the access group, as if they had been
+     * produced by a compaction.
+     *
+     * @param addr address of RangeServer
+     * @param table table identifier
+     * @param range range specification
+     * @param access_group name of access group to adopt the files into
+     * @param files vector of CellStore file names
+     */
+    void adopt_cellstores(const CommAddress &addr, const TableIdentifier &table,
+                          const RangeSpec &range, const String &access_group,
+                          const std::vector<String> &files);
+
 
   private:
 
@@ -54,6 +54,7 @@ namespace Hypertable {
     "relinquish range",
     "heapcheck",
     "metadata sync",
+    "adopt cellstores",
     (const char *)0
   };
 
@@ -263,13 +264,15 @@ namespace Hypertable {
 
   CommBuf *RangeServerProtocol::
   create_request_replay_load_range(const TableIdentifier &table,
-      const RangeSpec &range, const RangeState &range_state) {
+      const RangeSpec &range, const RangeState &range_state,
+      bool needs_compaction) {
     CommHeader header(COMMAND_REPLAY_LOAD_RANGE);
     CommBuf *cbuf = new CommBuf(header, table.encoded_length()
-        + range.encoded_length() + range_state.encoded_length());
+        + range.encoded_length() + range_state.encoded_length() + 1);
     table.encode(cbuf->get_data_ptr_address());
     range.encode(cbuf->get_data_ptr_address());
     range_state.encode(cbuf->get_data_ptr_address());
+    Serialization::encode_bool(cbuf->get_data_ptr_address(), needs_compaction);
     return cbuf;
   }
 
@@ -327,6 +330,26 @@ namespace Hypertable {
     return cbuf;
   }
 
+  CommBuf *
+  RangeServerProtocol::create_request_adopt_cellstores(const TableIdentifier &table,
+                                                       const RangeSpec &range,
+                                                       const String &access_group,
+                                                       const std::vector<String> &files) {
+    CommHeader header(COMMAND_ADOPT_CELLSTORES);
+    size_t length = table.encoded_length() + range.encoded_length()
+      + Serialization::encoded_length_vstr(access_group) + 4;
+    for (size_t i=0; i<files.size(); i++)
+      length += Serialization::encoded_length_vstr(files[i]);
+    CommBuf *cbuf = new CommBuf(header, length);
+    table.encode(cbuf->get_data_ptr_address());
+    range.encode(cbuf->get_data_ptr_address());
+    Serialization::encode_vstr(cbuf->get_data_ptr_address(), access_group);
+    Serialization::encode_i32(cbuf->get_data_ptr_address(), files.size());
+    for (size_t i=0; i<files.size(); i++)
+      Serialization::encode_vstr(cbuf->get_data_ptr_address(), files[i]);
+    return cbuf;
+  }
+
   CommBuf *RangeServerProtocol::create_request_heapcheck(const String &outfile) {
     CommHeader header(COMMAND_HEAPCHECK);
     header.flags |= CommHeader::FLAGS_BIT_URGENT;
@@ -60,7 +60,8 @@ namespace Hypertable {
     static const uint64_t COMMAND_RELINQUISH_RANGE     = 21;
     static const uint64_t COMMAND_HEAPCHECK            = 22;
     static const uint64_t COMMAND_METADATA_SYNC        = 23;
-    static const uint64_t COMMAND_MAX                  = 24;
+    static const uint64_t COMMAND_ADOPT_CELLSTORES     = 24;
+    static const uint64_t COMMAND_MAX                  = 25;
 
     static const char *m_command_strings[];
 
@@ -226,7 +227,8 @@ namespace Hypertable {
      * @return protocol message
      */
     static CommBuf *create_request_replay_load_range(const TableIdentifier &,
-        const RangeSpec &range, const RangeState &range_state);
+        const RangeSpec &range, const RangeState &range_state,
+        bool needs_compaction);
 
     /** Creates a "replay update" request message.  The data argument holds a
      * sequence of blocks.  Each block consists of ...
@@ -282,6 +284,19 @@ namespace Hypertable {
      */
     static CommBuf *create_request_heapcheck(const String &outfile);
 
+    /** Creates an "adopt cellstores" request message.
+     *
+     * @param table table identifier
+     * @param range range specification
+     * @param access_group name of access group to adopt the files into
+     * @param files vector of CellStore file names
+     * @return protocol message
+     */
+    static CommBuf *create_request_adopt_cellstores(const TableIdentifier &table,
+                                                    const RangeSpec &range,
+                                                    const String &access_group,
+                                                    const std::vector<String> &files);
+
 
 
     virtual const char *command_text(uint64_t command);
@@ -74,13 +74,19 @@ bool desc_inited = false;
 PropertiesDesc
   compressor_desc("  bmz|lzo|quicklz|zlib|snappy|none [compressor_options]\n\n"
       "compressor_options"),
-  bloom_filter_desc("  rows|rows+cols|none [bloom_filter_options]\n\n"
+  bloom_filter_desc("  rows|rows+cols|rows+cols+qualifiers|row-prefix|none "
+      "[bloom_filter_options]\n\n"
       "  Default bloom filter is defined by the config property:\n"
       "  Hypertable.RangeServer.CellStore.DefaultBloomFilter.\n\n"
-      "bloom_filter_options");
+      "bloom_filter_options"),
+  compaction_policy_desc("  default|size-tiered|leveled|time-window "
+      "[compaction_policy_options]\n\n"
+      "compaction_policy_options");
 
-PropertiesDesc compressor_hidden_desc, bloom_filter_hidden_desc;
-PositionalDesc compressor_pos_desc, bloom_filter_pos_desc;
+PropertiesDesc compressor_hidden_desc, bloom_filter_hidden_desc,
+  compaction_policy_hidden_desc;
+PositionalDesc compressor_pos_desc, bloom_filter_pos_desc,
+  compaction_policy_pos_desc;
 
 void init_schema_options_desc() {
   ScopedLock lock(desc_mutex);
@@ -109,11 +115,39 @@ void init_schema_options_desc() {
      "probability for the Bloom filter")
     ("max-approx-items", i32()->default_value(1000), "Number of cell store "
         "items used to guess the number of actual Bloom filter entries")
+    ("blocked", boo()->zero_tokens()->default_value(false), "Keep the bits "
+        "for each item within a single cache line")
+    ("prefix-length", i32(), "Number of leading row key bytes inserted into "
+        "a row-prefix Bloom filter")
+    ("filter-type", str()->default_value("bloom"), "Filter structure "
+        "(bloom|xor), xor filters use less memory but ignore the sizing "
+        "options")
     ;
   bloom_filter_hidden_desc.add_options()
-    ("bloom-filter-mode", str(), "Bloom filter mode (rows|rows+cols|none)")
+    ("bloom-filter-mode", str(), "Bloom filter mode "
+        "(rows|rows+cols|rows+cols+qualifiers|row-prefix|none)")
     ;
   bloom_filter_pos_desc.add("bloom-filter-mode", 1);
+
+  compaction_policy_desc.add_options()
+    ("min-threshold", i32()->default_value(4), "Minimum number of similarly "
+        "sized CellStores required to trigger a size-tiered merge")
+    ("max-threshold", i32()->default_value(32), "Maximum number of "
+        "CellStores merged by a single size-tiered merge")
+    ("bucket-low", f64()->default_value(0.5), "CellStores smaller than this "
+        "fraction of the average tier size fall out of the tier")
+    ("bucket-high", f64()->default_value(1.5), "CellStores larger than this "
+        "multiple of the average tier size fall out of the tier")
+    ("fanout", i32()->default_value(10), "Size ratio between adjacent "
+        "levels for the leveled policy")
+    ("window", i32()->default_value(86400), "Width in seconds of the "
+        "timestamp windows used by the time-window policy")
+    ;
+  compaction_policy_hidden_desc.add_options()
+    ("compaction-policy-type", str(),
+        "Compaction policy type (default|size-tiered|leveled|time-window)")
+    ;
+  compaction_policy_pos_desc.add("compaction-policy-type", 1);
   desc_inited = true;
 }
 
@@ -155,6 +189,7 @@ Schema::Schema(const Schema &src_schema)
     ag->blocksize = src_ag->blocksize;
     ag->compressor = src_ag->compressor;
     ag->bloom_filter = src_ag->bloom_filter;
+    ag->compaction_policy = src_ag->compaction_policy;
 
     m_access_group_map.insert(make_pair(ag->name, ag));
     m_access_groups.push_back(ag);
@@ -231,6 +266,11 @@ Schema::parse_bloom_filter(const String &bloom_filter, PropertiesPtr &props) {
                       &bloom_filter_pos_desc));
 
   String mode = props->get_str("bloom-filter-mode");
+  String filter_type = props->get_str("filter-type");
+
+  if (filter_type != "bloom" && filter_type != "xor")
+    HT_THROWF(Error::BAD_SCHEMA, "unknown bloom filter type: '%s'",
+              filter_type.c_str());
 
   if (mode == "none" || mode == "disabled")
     props->set("bloom-filter-mode", BLOOM_FILTER_DISABLED);
@@ -240,6 +280,18 @@ Schema::parse_bloom_filter(const String &bloom_filter, PropertiesPtr &props) {
            || mode == "rows-cols" || mode == "row-col"
            || mode == "rows_cols" || mode == "row_col")
     props->set("bloom-filter-mode", BLOOM_FILTER_ROWS_COLS);
+  else if (mode == "rows+cols+qualifiers" || mode == "row+col+qualifier"
+           || mode == "rows-cols-qualifiers" || mode == "row-col-qualifier"
+           || mode == "rows_cols_qualifiers" || mode == "row_col_qualifier")
+    props->set("bloom-filter-mode", BLOOM_FILTER_ROWS_COLS_QUALIFIERS);
+  else if (mode == "row-prefix" || mode == "rows-prefix"
+           || mode == "row_prefix" || mode == "rows_prefix") {
+    if (!props->has("prefix-length") || props->get_i32("prefix-length") <= 0
+        || props->get_i32("prefix-length") > 65535)
+      HT_THROW(Error::BAD_SCHEMA, "row-prefix bloom filter requires "
+               "--prefix-length between 1 and 65535");
+    props->set("bloom-filter-mode", BLOOM_FILTER_ROW_PREFIX);
+  }
   else HT_THROWF(Error::BAD_SCHEMA, "unknown bloom filter mode: '%s'",
                  mode.c_str());
 }
@@ -251,6 +303,53 @@ const PropertiesDesc &Schema::bloom_filter_spec_desc() {
 }
 
 
+void
+Schema::parse_compaction_policy(const String &policy, PropertiesPtr &props) {
+  init_schema_options_desc();
+
+  vector<String> args;
+
+  boost::split(args, policy, boost::is_any_of(" \t"));
+  HT_TRY("parsing compaction policy spec",
+    props->parse_args(args, compaction_policy_desc,
+                      &compaction_policy_hidden_desc,
+                      &compaction_policy_pos_desc));
+
+  String type = props->get_str("compaction-policy-type");
+
+  if (type == "default" || type == "merge-run" || type == "merge_run")
+    props->set("compaction-policy-type", String("default"));
+  else if (type == "size-tiered" || type == "size_tiered" || type == "tiered")
+    props->set("compaction-policy-type", String("size-tiered"));
+  else if (type == "leveled" || type == "levelled")
+    props->set("compaction-policy-type", String("leveled"));
+  else if (type == "time-window" || type == "time_window")
+    props->set("compaction-policy-type", String("time-window"));
+  else HT_THROWF(Error::BAD_SCHEMA, "unknown compaction policy: '%s'",
+                 type.c_str());
+
+  if (props->get_i32("min-threshold") < 2)
+    HT_THROWF(Error::BAD_SCHEMA, "invalid compaction policy min-threshold "
+              "(%d), must be at least 2", props->get_i32("min-threshold"));
+  if (props->get_i32("max-threshold") < props->get_i32("min-threshold"))
+    HT_THROWF(Error::BAD_SCHEMA, "invalid compaction policy max-threshold "
+              "(%d), must not be less than min-threshold",
+              props->get_i32("max-threshold"));
+  if (props->get_i32("fanout") < 2)
+    HT_THROWF(Error::BAD_SCHEMA, "invalid compaction policy fanout (%d), "
+              "must be at least 2", props->get_i32("fanout"));
+  if (props->get_i32("window") <= 0)
+    HT_THROWF(Error::BAD_SCHEMA, "invalid compaction policy window (%d), "
+              "must be positive", props->get_i32("window"));
+}
+
+
+const PropertiesDesc &Schema::compaction_policy_spec_desc() {
+  init_schema_options_desc();
+  return compaction_policy_desc;
+}
+
+
 void Schema::validate_compressor(const String &compressor) {
   if (compressor.empty())
     return;
@@ -283,6 +382,22 @@ void Schema::validate_bloom_filter(const String &bloom_filter) {
 }
 
 
+void Schema::validate_compaction_policy(const String &policy) {
+  if (policy.empty())
+    return;
+
+  try {
+    PropertiesPtr props = new Properties();
+    parse_compaction_policy(policy, props);
+  }
+  catch (Exception &e) {
+    ostringstream oss;
+    oss << e;
+    set_error_string(oss.str());
+  }
+}
+
+
 /**
  */
 void Schema::start_element_handler(void *userdata,
@@ -494,6 +609,11 @@ void Schema::set_access_group_parameter(const char *param, const char *value) {
       boost::trim(m_open_access_group->bloom_filter);
       validate_bloom_filter(m_open_access_group->bloom_filter);
     }
+    else if (!strcasecmp(param, "compactionPolicy")) {
+      m_open_access_group->compaction_policy = value;
+      boost::trim(m_open_access_group->compaction_policy);
+      validate_compaction_policy(m_open_access_group->compaction_policy);
+    }
     else
       set_error_string((string)"Invalid AccessGroup attribute '" + param + "'");
   }
@@ -673,6 +793,9 @@ void Schema::render(String &output, bool with_ids) {
     if (ag->bloom_filter != "")
       output += (String)" bloomFilter=\"" + ag->bloom_filter + "\"";
 
+    if (ag->compaction_policy != "")
+      output += (String)" compactionPolicy=\"" + ag->compaction_policy + "\"";
+
     output += ">\n";
 
     foreach(const ColumnFamily *cf, ag->columns) {
@@ -807,6 +930,10 @@ void Schema::render_hql_create_table(const String &table_name, String &output) {
       ag_string += format(" BLOOMFILTER=\"%s\"",
           ag->bloom_filter.c_str());
 
+    if (ag->compaction_policy != "")
+      ag_string += format(" COMPACTION_POLICY=\"%s\"",
+          ag->compaction_policy.c_str());
+
     if (!ag->columns.empty()) {
       bool display_comma = false;
       ag_string += " (";
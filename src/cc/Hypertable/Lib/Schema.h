@@ -38,7 +38,9 @@ namespace Hypertable {
   enum BloomFilterMode {
     BLOOM_FILTER_DISABLED,
     BLOOM_FILTER_ROWS,
-    BLOOM_FILTER_ROWS_COLS
+    BLOOM_FILTER_ROWS_COLS,
+    BLOOM_FILTER_ROW_PREFIX,
+    BLOOM_FILTER_ROWS_COLS_QUALIFIERS
   };
 
   class Schema : public ReferenceCount {
@@ -70,7 +72,7 @@ namespace Hypertable {
     struct AccessGroup {
       AccessGroup() : name(), in_memory(false), counter(false), 
         replication(-1), blocksize(0),
-        bloom_filter(), columns() { }
+        bloom_filter(), compaction_policy(), columns() { }
 
       String   name;
       bool     in_memory;
@@ -79,6 +81,7 @@ namespace Hypertable {
       uint32_t blocksize;
       String compressor;
       String bloom_filter;
+      String compaction_policy;
       ColumnFamilies columns;
     };
 
@@ -98,6 +101,10 @@ namespace Hypertable {
     void validate_bloom_filter(const String &spec);
     static const PropertiesDesc &bloom_filter_spec_desc();
 
+    static void parse_compaction_policy(const String &spec, PropertiesPtr &);
+    void validate_compaction_policy(const String &spec);
+    static const PropertiesDesc &compaction_policy_spec_desc();
+
     void open_access_group();
     void close_access_group();
     void open_column_family();
@@ -41,11 +41,40 @@ using namespace Hypertable;
 TableDumper::TableDumper(NamespacePtr &ns, const String &name,
 			 ScanSpec &scan_spec, size_t target_node_count)
   : m_scan_spec(scan_spec), m_eod(false), m_rows_seen(0), m_bytes_scanned(0) {
+  ns->get_table_splits(name, m_splits);
+  m_table = ns->open_table(name);
+  initialize(target_node_count);
+}
+
+
+/**
+ */
+TableDumper::TableDumper(TablePtr &table, TableSplitsContainer &splits,
+                         ScanSpec &scan_spec, size_t shard,
+                         size_t shard_count, size_t target_node_count)
+  : m_scan_spec(scan_spec), m_table(table), m_eod(false), m_rows_seen(0),
+    m_bytes_scanned(0) {
+  TableSplitBuilder builder(m_splits.arena());
+
+  HT_ASSERT(shard < shard_count);
+
+  for (size_t i=shard; i<splits.size(); i+=shard_count) {
+    builder.clear();
+    if (splits[i].start_row)
+      builder.set_start_row(splits[i].start_row);
+    if (splits[i].end_row)
+      builder.set_end_row(splits[i].end_row);
+    m_splits.push_back(builder.get());
+  }
+
+  initialize(target_node_count);
+}
+
+
+void TableDumper::initialize(size_t target_node_count) {
   TableScannerPtr scanner;
   RowInterval ri;
 
-  ns->get_table_splits(name, m_splits);
-
   // Create random m_ordering
   m_ordering.reserve(m_splits.size());
   for (size_t i=0; i<m_splits.size(); ++i)
@@ -60,8 +89,6 @@ TableDumper::TableDumper(NamespacePtr &ns, const String &name,
     }
   }
 
-  m_table = ns->open_table(name);
-
   for (m_next=0; m_next<target_node_count && m_next < m_ordering.size(); m_next++) {
     m_scan_spec.row_intervals.clear();
     ri.start = m_splits[m_ordering[m_next]].start_row;
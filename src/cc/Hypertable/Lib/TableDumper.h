@@ -45,6 +45,23 @@ namespace Hypertable {
     TableDumper(NamespacePtr &ns, const String &name, ScanSpec &scan_spec,
 		size_t target_node_count=20);
 
+    /**
+     * Constructs a TableDumper object that dumps one shard of a table.
+     * Split <i>i</i> of <code>splits</code> belongs to shard
+     * <code>i % shard_count</code>, so dumpers constructed with the same
+     * splits and each shard number together cover the table exactly once.
+     *
+     * @param table table to dump
+     * @param splits splits of the table
+     * @param scan_spec scan specification
+     * @param shard shard number
+     * @param shard_count total number of shards
+     * @param target_node_count target node count
+     */
+    TableDumper(TablePtr &table, TableSplitsContainer &splits,
+                ScanSpec &scan_spec, size_t shard, size_t shard_count,
+                size_t target_node_count=20);
+
     /**
      * Get the next cell.
      *
@@ -61,6 +78,8 @@ namespace Hypertable {
     int64_t bytes_scanned() { return m_bytes_scanned; }
 
   private:
+    void initialize(size_t target_node_count);
+
     ScanSpec  m_scan_spec;
     TableSplitsContainer m_splits;
     TablePtr m_table;
@@ -87,6 +87,44 @@ bool TableScanner::next(Cell &cell) {
   }
 }
 
+bool TableScanner::next(ScanCellsPtr &cells, size_t *first) {
+
+  // the ungot cell is always the last one served out of the current block
+  if (m_ungot.row_key) {
+    HT_ASSERT(m_cur_cells_index > 0);
+    m_cur_cells_index--;
+    m_ungot.row_key = 0;
+  }
+
+  if (m_eos)
+    return false;
+
+  while (true) {
+
+    if (m_cur_cells_index < m_cur_cells_size) {
+      cells = m_cur_cells;
+      *first = m_cur_cells_index;
+      m_cur_cells_index = m_cur_cells_size;
+      return true;
+    }
+
+    if (m_cur_cells != 0) {
+      m_eos = m_cur_cells->get_eos();
+      if (m_eos)
+        return false;
+    }
+
+    m_queue->next_result(m_cur_cells, &m_error, m_error_msg);
+    if (m_error != Error::OK) {
+      m_eos = true;
+      HT_THROW(m_error, m_error_msg);
+    }
+
+    m_cur_cells_size = m_cur_cells->size();
+    m_cur_cells_index= 0;
+  }
+}
+
 void TableScanner::unget(const Cell &cell) {
   if (m_ungot.row_key)
     HT_THROW_(Error::DOUBLE_UNGET);
@@ -90,6 +90,22 @@ namespace Hypertable {
      */
     void unget(const Cell &cell);
 
+    /**
+     * Get the remaining cells of the current scan block.
+     *
+     * Hands out the unconsumed portion of the current ScanCells block (or
+     * the next block, fetching it if necessary) so that callers can process
+     * an entire block of results without going through #next one cell at
+     * a time.  A cell previously returned to the scanner with #unget is
+     * included at the beginning of the returned range.  Calls to this
+     * method may be freely interleaved with calls to #next.
+     *
+     * @param cells reference to ScanCells smart pointer to hold the block
+     * @param first index of the first unconsumed cell in <code>cells</code>
+     * @return true if a block was returned, false at end of scan
+     */
+    bool next(ScanCellsPtr &cells, size_t *first);
+
     /**
      * Returns number of bytes scanned
      *
@@ -26,6 +26,7 @@
 #include "Common/Random.h"
 #include "Common/StringExt.h"
 #include "Common/Serialization.h"
+#include "Common/Thread.h"
 #include "DfsBroker/Lib/Client.h"
 #include "AsyncComm/Comm.h"
 #include "AsyncComm/ReactorFactory.h"
@@ -33,6 +34,11 @@
 
 #include <iostream>
 #include <fstream>
+#include <map>
+
+extern "C" {
+#include <poll.h>
+}
 
 
 #include "Hypertable/Lib/Config.h"
@@ -63,6 +69,8 @@ namespace Hypertable {
       }
       virtual void display(ostream &os) { os << "value=" << value; }
       void increment() { value++; }
+      int32_t get_value() { return value; }
+      int32_t get_type() { return header.type; }
 
     private:
       String m_name;
@@ -122,6 +130,116 @@ namespace {
     }
   }
 
+  /**
+   * DFS client whose appends can be held until released and made to fail
+   */
+  class GatedClient : public DfsBroker::Client {
+  public:
+    GatedClient(const String &host, int port, uint32_t timeout_ms)
+      : DfsBroker::Client(host, port, timeout_ms), m_hold(false),
+        m_held(0), m_fail(0) { }
+
+    using DfsBroker::Client::append;
+
+    virtual size_t append(int32_t fd, StaticBuffer &buffer, uint32_t flags) {
+      bool fail = false;
+      {
+        ScopedLock lock(m_mutex);
+        if (m_fail > 0) {
+          m_fail--;
+          fail = true;
+        }
+        m_held++;
+        m_cond.notify_all();
+        while (m_hold)
+          m_cond.wait(lock);
+        m_held--;
+      }
+      if (fail)
+        HT_THROW(Error::DFSBROKER_IO_ERROR, "Injected append failure");
+      return DfsBroker::Client::append(fd, buffer, flags);
+    }
+
+    void hold() {
+      ScopedLock lock(m_mutex);
+      m_hold = true;
+    }
+
+    void release() {
+      ScopedLock lock(m_mutex);
+      m_hold = false;
+      m_cond.notify_all();
+    }
+
+    void wait_for_held() {
+      ScopedLock lock(m_mutex);
+      while (m_held == 0)
+        m_cond.wait(lock);
+    }
+
+    /** Fails the next <code>count</code> appends that start */
+    void fail_next(int count) {
+      ScopedLock lock(m_mutex);
+      m_fail = count;
+    }
+
+  private:
+    Mutex m_mutex;
+    boost::condition m_cond;
+    bool m_hold;
+    int m_held;
+    int m_fail;
+  };
+
+  struct RecordState {
+    RecordState(MetaLog::WriterPtr &writer_, MetaLog::EntityGeneric *entity_,
+                int count_, int *failuresp_)
+      : writer(writer_), entity(entity_), count(count_),
+        failuresp(failuresp_) { }
+    void operator()() {
+      for (int i=0; i<count; i++) {
+        entity->increment();
+        try {
+          writer->record_state(entity);
+        }
+        catch (Exception &e) {
+          (*failuresp)++;
+        }
+      }
+    }
+    MetaLog::WriterPtr writer;
+    MetaLog::EntityGeneric *entity;
+    int count;
+    int *failuresp;
+  };
+
+  void wait_for_entities(MetaLog::WriterPtr &writer, uint64_t count) {
+    uint64_t entities, writes;
+    while (true) {
+      writer->get_counters(&entities, &writes);
+      if (entities >= count)
+        break;
+      poll(0, 0, 10);
+    }
+  }
+
+  /**
+   * Reads back the log in <code>logdir</code> and returns the value of
+   * each entity by type
+   */
+  void read_values(FilesystemPtr &fs, const String &logdir,
+                   std::map<int32_t, int32_t> &values) {
+    MetaLog::ReaderPtr reader = new MetaLog::Reader(fs, g_test_definition,
+                                                    logdir);
+    vector<MetaLog::EntityPtr> entities;
+    reader->get_entities(entities);
+    values.clear();
+    foreach (MetaLog::EntityPtr &entity, entities) {
+      MetaLog::EntityGeneric *generic = (MetaLog::EntityGeneric *)entity.get();
+      values[generic->get_type()] = generic->get_value();
+    }
+  }
+
   void display_entities(ofstream &out) {
     for (size_t i=0; i<g_entities.size(); i++) {
       if (g_entities[i])
@@ -225,6 +343,91 @@ main(int ac, char *av[]) {
       HT_ASSERT(FileUtils::size("metalog_test3.out") == FileUtils::size("metalog_test2.golden"));
     }
 
+    /**
+     *  Concurrent writers
+     */
+
+    {
+      String logdir = testdir + "/concurrent";
+      vector<MetaLog::EntityPtr> entities;
+      vector<int> failures(8, 0);
+      std::map<int32_t, int32_t> values;
+      uint64_t entity_count, write_count;
+      ThreadGroup threads;
+
+      writer = new MetaLog::Writer(fs, g_test_definition, logdir, entities);
+      for (int i=0; i<8; i++) {
+        entities.push_back(new MetaLog::EntityGeneric(1000+i));
+        threads.create_thread(RecordState(writer,
+            (MetaLog::EntityGeneric *)entities[i].get(), 100, &failures[i]));
+      }
+      threads.join_all();
+      writer->get_counters(&entity_count, &write_count);
+      HT_ASSERT(entity_count == 800);
+      HT_ASSERT(write_count <= entity_count);
+      writer = 0;
+
+      read_values(fs, logdir, values);
+      HT_ASSERT(values.size() == 8);
+      for (int i=0; i<8; i++) {
+        HT_ASSERT(failures[i] == 0);
+        HT_ASSERT(values[1000+i] == 101);
+      }
+    }
+
+    /**
+     *  Failed group commit is reported to every caller it contained, and
+     *  later writes succeed
+     */
+
+    {
+      String logdir = testdir + "/failure";
+      GatedClient *gated = new GatedClient(host, port, timeout);
+      FilesystemPtr gated_fs = gated;
+      vector<MetaLog::EntityPtr> entities;
+      vector<int> failures(4, 0);
+      std::map<int32_t, int32_t> values;
+
+      HT_ASSERT(gated->wait_for_connection(timeout));
+
+      writer = new MetaLog::Writer(gated_fs, g_test_definition, logdir,
+                                   entities);
+      for (int i=0; i<4; i++)
+        entities.push_back(new MetaLog::EntityGeneric(2000+i));
+
+      // hold the first write while two more entries get buffered
+      gated->hold();
+      Thread first(RecordState(writer,
+          (MetaLog::EntityGeneric *)entities[0].get(), 1, &failures[0]));
+      gated->wait_for_held();
+      Thread second(RecordState(writer,
+          (MetaLog::EntityGeneric *)entities[1].get(), 1, &failures[1]));
+      Thread third(RecordState(writer,
+          (MetaLog::EntityGeneric *)entities[2].get(), 1, &failures[2]));
+      wait_for_entities(writer, 3);
+
+      // the write covering the second and third entries fails
+      gated->fail_next(1);
+      gated->release();
+      first.join();
+      second.join();
+      third.join();
+
+      RecordState(writer, (MetaLog::EntityGeneric *)entities[3].get(), 1,
+                  &failures[3])();
+
+      HT_ASSERT(failures[0] == 0);
+      HT_ASSERT(failures[1] == 1);
+      HT_ASSERT(failures[2] == 1);
+      HT_ASSERT(failures[3] == 0);
+      writer = 0;
+
+      read_values(fs, logdir, values);
+      HT_ASSERT(values.size() == 2);
+      HT_ASSERT(values[2000] == 2);
+      HT_ASSERT(values[2003] == 2);
+    }
+
     if (!has("save"))
       fs->rmdir(testdir);
   }
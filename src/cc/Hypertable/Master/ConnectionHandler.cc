@@ -215,6 +215,9 @@ void ConnectionHandler::handle(EventPtr &event) {
         HT_ERROR_OUT << e << HT_END;
     }
 
+    // Retry recoveries waiting on a server lock or a destination
+    m_context->op->unblock(Dependency::RECOVERY);
+
     if ((error = m_context->comm->set_timer(m_context->timer_interval, this)) != Error::OK)
       HT_FATALF("Problem setting timer - %s", Error::get_text(error));
 
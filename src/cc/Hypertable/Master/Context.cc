@@ -22,6 +22,7 @@
 #include "Common/Compat.h"
 
 #include "Context.h"
+#include "GcWorker.h"
 #include "LoadBalancer.h"
 #include "Operation.h"
 #include "OperationBalance.h"
@@ -36,6 +37,7 @@ Context::~Context() {
     master_file_handle = 0;
   }
   delete balancer;
+  delete gc_worker;
 }
 
 void Context::add_server(RangeServerConnectionPtr &rsc) {
@@ -53,6 +53,7 @@ namespace Hypertable {
 
   using namespace boost::multi_index;
 
+  class GcWorker;
   class LoadBalancer;
   class Operation;
   class OperationProcessor;
@@ -62,7 +63,7 @@ namespace Hypertable {
 
   class Context : public ReferenceCount {
   public:
-    Context() : timer_interval(0), monitoring_interval(0), gc_interval(0),
+    Context() : gc_worker(0), timer_interval(0), monitoring_interval(0), gc_interval(0),
                 next_monitoring_time(0), next_gc_time(0), conn_count(0),
                 test_mode(false), in_operation(false) {
       m_server_list_iter = m_server_list.end();
@@ -83,6 +84,7 @@ namespace Hypertable {
     MetaLog::DefinitionPtr mml_definition;
     MetaLog::WriterPtr mml_writer;
     LoadBalancer *balancer;
+    GcWorker *gc_worker;
     MonitoringPtr monitoring;
     ResponseManager *response_manager;
     RemovalManager *removal_manager;
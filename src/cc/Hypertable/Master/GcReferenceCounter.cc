@@ -0,0 +1,155 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include <cstring>
+
+#include "GcReferenceCounter.h"
+
+using namespace Hypertable;
+
+void GcReferenceCounter::start_scan(bool full) {
+  m_full = full;
+  if (full) {
+    m_refs.clear();
+    m_files.clear();
+    m_candidates.clear();
+  }
+  m_last_row.clear();
+  m_last_cq.clear();
+  m_last_time = 0;
+  m_found_valid_files = true;
+}
+
+
+void GcReferenceCounter::add_cell(const Cell &cell, DeleteHandler &handler) {
+
+  if (m_last_row != cell.row_key || m_last_cq != cell.column_qualifier) {
+    if (m_last_row != cell.row_key) {
+      // new row; rows are only known to be empty after a full scan
+      if (m_full && !m_found_valid_files)
+        handler.delete_row(m_last_row);
+      m_last_row = cell.row_key;
+      m_found_valid_files = false;
+    }
+    // new access group, the first cell is its current Files value
+    m_last_cq = cell.column_qualifier;
+    m_last_time = cell.timestamp;
+
+    bool is_valid_files = *cell.value != '!';
+    m_found_valid_files |= is_valid_files;
+
+    String value;
+    if (is_valid_files)
+      value = String((const char *)cell.value, cell.value_len);
+
+    String key = m_last_row + "\t" + m_last_cq;
+    FilesMap::iterator iter = m_files.find(key);
+    if (iter == m_files.end()) {
+      add_refs(value, 1);
+      m_files[key] = value;
+    }
+    else if (iter->second != value) {
+      add_refs(value, 1);
+      add_refs(iter->second, -1);
+      iter->second = value;
+    }
+  }
+  else {
+    // cruft to delete
+    if (cell.timestamp > m_last_time) {
+      HT_ERROR("Unexpected timestamp order while scanning METADATA");
+      return;
+    }
+    if (*cell.value != '!') {
+      add_refs(String((const char *)cell.value, cell.value_len), 0);
+      handler.delete_cell(cell);
+    }
+  }
+}
+
+
+void GcReferenceCounter::finish_scan(DeleteHandler &handler) {
+  // for last table
+  if (m_full && !m_found_valid_files && !m_last_row.empty())
+    handler.delete_row(m_last_row);
+}
+
+
+void GcReferenceCounter::take_unreferenced(std::vector<String> &files) {
+  foreach (const String &fname, m_candidates) {
+    RefMap::iterator iter = m_refs.find(fname);
+    if (iter != m_refs.end() && iter->second > 0)
+      continue;
+    if (iter != m_refs.end())
+      m_refs.erase(iter);
+    files.push_back(fname);
+  }
+  m_candidates.clear();
+}
+
+
+int GcReferenceCounter::references(const String &fname) const {
+  RefMap::const_iterator iter = m_refs.find(fname);
+  return iter == m_refs.end() ? 0 : iter->second;
+}
+
+
+void GcReferenceCounter::parse_files(const char *buf, size_t len,
+                                     std::vector<String> &files) {
+  const char *p = buf, *pn = p, *endp = p + len - 1;
+
+  while (p < endp) {
+    while (p < endp && (*p != ';' ||  p[1] != '\n'))
+      ++p;
+
+    if (p == endp)
+      break;
+
+    if (*pn == '#')
+      ++pn;
+    files.push_back(String(pn, p - pn));
+    p += 2;
+    pn = p;
+  }
+}
+
+/**
+ * Adjusts the reference count of each file in a Files value by
+ * <code>c</code>.  Files left with no references become removal candidates.
+ */
+void GcReferenceCounter::add_refs(const String &value, int c) {
+  std::vector<String> files;
+
+  if (value.empty())
+    return;
+
+  parse_files(value.c_str(), value.length(), files);
+
+  foreach (const String &fname, files) {
+    RefMap::iterator iter = m_refs.insert(RefMap::value_type(fname, 0)).first;
+    iter->second += c;
+    if (iter->second <= 0)
+      m_candidates.insert(fname);
+  }
+}
@@ -0,0 +1,118 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_GCREFERENCECOUNTER_H
+#define HYPERTABLE_GCREFERENCECOUNTER_H
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "Common/String.h"
+
+#include "Hypertable/Lib/Cell.h"
+
+namespace Hypertable {
+
+  /**
+   * Reference counts of CellStore files, maintained from the Files cells of
+   * METADATA.  A scan is fed one cell at a time, in METADATA order (newest
+   * version first within each row and access group).  The first cell of
+   * each access group is its current Files value; it replaces the value
+   * remembered from earlier scans and the counts are adjusted by the
+   * difference, so an incremental scan only needs the cells written since
+   * the previous one.  Older versions are cruft and are deleted.  A full
+   * scan starts from empty counts and also deletes rows that no longer
+   * reference any file.
+   */
+  class GcReferenceCounter {
+  public:
+
+    /** Receives the METADATA deletes decided on during a scan */
+    class DeleteHandler {
+    public:
+      virtual ~DeleteHandler() { }
+      virtual void delete_row(const String &row) = 0;
+      virtual void delete_cell(const Cell &cell) = 0;
+    };
+
+    GcReferenceCounter() : m_full(false), m_last_time(0),
+                           m_found_valid_files(true) { }
+
+    /**
+     * Starts a scan.  A full scan forgets all counts and Files values.
+     *
+     * @param full true if the whole Files column is about to be scanned
+     */
+    void start_scan(bool full);
+
+    /**
+     * Applies one Files cell of the scan.
+     *
+     * @param cell METADATA Files cell
+     * @param handler receives the deletes for cruft cells
+     */
+    void add_cell(const Cell &cell, DeleteHandler &handler);
+
+    /**
+     * Finishes a scan.
+     *
+     * @param handler receives the delete for the last row, if empty
+     */
+    void finish_scan(DeleteHandler &handler);
+
+    /**
+     * Hands out the files left without references and stops tracking them.
+     *
+     * @param files vector to receive the file names
+     */
+    void take_unreferenced(std::vector<String> &files);
+
+    /** Returns the reference count of a file, 0 if it is not tracked */
+    int references(const String &fname) const;
+
+    /** Returns the number of files being tracked */
+    size_t size() const { return m_refs.size(); }
+
+    static void parse_files(const char *buf, size_t len,
+                            std::vector<String> &files);
+
+  private:
+    typedef std::map<String, int> RefMap; // filename -> reference count
+    typedef std::map<String, String> FilesMap; // row \t ag -> Files value
+
+    void add_refs(const String &value, int c);
+
+    RefMap m_refs;
+    FilesMap m_files;
+    std::set<String> m_candidates;
+
+    // scan state
+    bool m_full;
+    String m_last_row;
+    String m_last_cq;
+    int64_t m_last_time;
+    bool m_found_valid_files;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_GCREFERENCECOUNTER_H
@@ -22,6 +22,11 @@
 #include "Common/Compat.h"
 #include <unistd.h>
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+
+#include "Common/Stopwatch.h"
+#include "Common/Thread.h"
+#include "Common/Time.h"
 
 #include "Context.h"
 #include "GcWorker.h"
@@ -33,43 +38,109 @@ extern "C" {
 using namespace Hypertable;
 using namespace std;
 
-GcWorker::GcWorker(ContextPtr &context) : m_context(context) {
+namespace {
+
+  /** Deletes empty rows and cruft cells from METADATA */
+  class MutatorDeleteHandler : public GcReferenceCounter::DeleteHandler {
+  public:
+    MutatorDeleteHandler(TableMutatorPtr &mutator) : m_mutator(mutator) { }
+
+    virtual void delete_row(const String &row) {
+      KeySpec key;
+
+      if (row.empty())
+        return;
+
+      key.row = row.c_str();
+      key.row_len = row.length();
+      key.flag = FLAG_DELETE_ROW;
+
+      HT_DEBUGF("MasterGc: Deleting row %s", (char *)key.row);
+
+      m_mutator->set_delete(key);
+    }
+
+    virtual void delete_cell(const Cell &cell) {
+      HT_DEBUG_OUT <<"MasterGc: Deleting cell: ("<< cell.row_key <<", "
+                   << cell.column_family <<", "<< cell.column_qualifier <<", "
+                   << cell.timestamp <<')'<< HT_END;
+
+      KeySpec key(cell.row_key, cell.column_family, cell.column_qualifier,
+                  cell.timestamp, FLAG_DELETE_CELL);
+      m_mutator->set_delete(key);
+    }
+
+  private:
+    TableMutatorPtr m_mutator;
+  };
+
+}
+
+GcWorker::GcWorker(ContextPtr &context) : m_context(context),
+    m_last_pass_time(0), m_passes_since_full(0), m_files_removed(0),
+    m_bytes_reclaimed(0) {
   m_tables_dir = context->props->get_str("Hypertable.Directory");
   boost::trim_if(m_tables_dir, boost::is_any_of("/"));
   m_tables_dir = String("/") + m_tables_dir + "/tables/";
+  m_full_scan_interval =
+    context->props->get_i32("Hypertable.Master.Gc.FullScanInterval");
+  m_scan_overlap = (int64_t)context->props->get_i32(
+      "Hypertable.Master.Gc.Incremental.Overlap") * 1000000LL;
+  m_removal_threads =
+    context->props->get_i32("Hypertable.Master.Gc.RemovalThreads");
+  if (m_removal_threads < 1)
+    m_removal_threads = 1;
 }
 
 void GcWorker::gc() {
+  ScopedLock lock(m_mutex);
   try {
-    CountMap files_map;
-    scan_metadata(files_map);
+    Stopwatch stopwatch;
+    int64_t pass_start = get_ts64();
+    bool full = m_last_pass_time == 0 ||
+      m_passes_since_full >= m_full_scan_interval;
+
+    scan_metadata(full);
     // TODO: scan_directories(files_map); // fsckish, slower
-    reap(files_map);
+    reap();
+
+    m_last_pass_time = pass_start;
+    m_passes_since_full = full ? 0 : m_passes_since_full + 1;
+
+    stopwatch.stop();
+    HT_INFOF("MasterGc: %s pass removed %llu files (%llu bytes) in %.3f "
+             "seconds, tracking %llu files", full ? "full" : "incremental",
+             (Llu)m_files_removed, (Llu)m_bytes_reclaimed, stopwatch.elapsed(),
+             (Llu)m_refs.size());
   }
   catch (Exception &e) {
+    // state may be inconsistent, start over with a full scan
+    m_last_pass_time = 0;
     HT_ERRORF("Error: caught exception while gc'ing: %s", e.what());
   }
 }
 
 
-void GcWorker::scan_metadata(CountMap &files_map) {
+void GcWorker::scan_metadata(bool full) {
   TableScannerPtr scanner;
   ScanSpec scan_spec;
 
   scan_spec.columns.clear();
   scan_spec.columns.push_back("Files");
 
+  if (!full)
+    scan_spec.time_interval.first = m_last_pass_time - m_scan_overlap;
+
   scanner = m_context->metadata_table->create_scanner(scan_spec);
 
   TableMutatorPtr mutator = m_context->metadata_table->create_mutator();
+  MutatorDeleteHandler handler(mutator);
 
   Cell cell;
-  string last_row;
-  string last_cq;
-  int64_t last_time = 0;
-  bool found_valid_files = true;
 
-  HT_DEBUG("MasterGc: scanning metadata...");
+  HT_DEBUGF("MasterGc: scanning metadata (%s)...", full ? "full" : "incremental");
+
+  m_refs.start_scan(full);
 
   while (scanner->next(cell)) {
     if (strcmp("Files", cell.column_family)) {
@@ -77,124 +148,60 @@ void GcWorker::scan_metadata(CountMap &files_map) {
                 cell.column_family);
       continue;
     }
-    if (last_row != cell.row_key) {
-      // new row
-      if (!found_valid_files)
-        delete_row(last_row, mutator);
-
-      last_row = cell.row_key;
-      last_cq = cell.column_qualifier;
-      last_time = cell.timestamp;
-      found_valid_files = *cell.value != '!';
-
-      if (found_valid_files)
-        insert_files(files_map, (char *)cell.value, cell.value_len, 1);
-    }
-    else if (last_cq != cell.column_qualifier) {
-      // new access group
-      last_cq = cell.column_qualifier;
-      last_time = cell.timestamp;
-      bool is_valid_files = *cell.value != '!';
-      found_valid_files |= is_valid_files;
-
-      if (is_valid_files)
-        insert_files(files_map, (char *)cell.value, cell.value_len, 1);
-    }
-    else {
-      // cruft to delete
-      if (cell.timestamp > last_time) {
-        HT_ERROR("Unexpected timestamp order while scanning METADATA");
-        continue;
-      }
-      if (*cell.value != '!') {
-        insert_files(files_map, (char *)cell.value, cell.value_len);
-        delete_cell(cell, mutator);
-      }
-    }
+    m_refs.add_cell(cell, handler);
   }
-  // for last table
-  if (!found_valid_files)
-    delete_row(last_row, mutator);
-
-  mutator->flush();
-}
 
-void GcWorker::delete_row(const std::string &row, TableMutatorPtr &mutator) {
-  KeySpec key;
+  m_refs.finish_scan(handler);
 
-  if (row.empty())
-    return;
-
-  key.row = row.c_str();
-  key.row_len = row.length();
-  key.flag = FLAG_DELETE_ROW;
-
-  HT_DEBUGF("MasterGc: Deleting row %s", (char *)key.row);
-
-  mutator->set_delete(key);
-}
-
-void GcWorker::delete_cell(const Cell &cell, TableMutatorPtr &mutator) {
-  HT_DEBUG_OUT <<"MasterGc: Deleting cell: ("<< cell.row_key <<", "
-               << cell.column_family <<", "<< cell.column_qualifier <<", "
-               << cell.timestamp <<')'<< HT_END;
-
-  KeySpec key(cell.row_key, cell.column_family, cell.column_qualifier,
-              cell.timestamp, FLAG_DELETE_CELL);
-  mutator->set_delete(key);
+  mutator->flush();
 }
 
+/**
+ * Currently only stale cs files and range directories are reaped
+ * Table directories probably should be obtained when removing
+ * rows in METADATA
+ */
+void GcWorker::reap() {
+  std::vector<String> files;
+  ThreadGroup threads;
 
-void GcWorker::insert_files(CountMap &map, const char *buf, size_t len, int c) {
-  const char *p = buf, *pn = p, *endp = p + len - 1;
-
-  while (p < endp) {
-    while (p < endp && (*p != ';' ||  p[1] != '\n'))
-      ++p;
-
-    if (p == endp)
-      break;
+  m_refs.take_unreferenced(files);
 
-    string name(pn, p - pn);
-    p += 2;
-    insert_file(map, name.c_str(), c);
-    pn = p;
-  }
-}
+  m_files_removed = 0;
+  m_bytes_reclaimed = 0;
 
-void GcWorker::insert_file(CountMap &map, const char *fname, int c) {
-  if (*fname == '#')
-    ++fname;
+  if (files.empty())
+    return;
 
-  CountMap::InsRet ret = map.insert(fname, c);
+  size_t nthreads = std::min(files.size(), (size_t)m_removal_threads);
+  for (size_t i=0; i<nthreads; i++)
+    threads.create_thread(boost::bind(&GcWorker::remove_files, this,
+                                      &files, i, nthreads));
+  threads.join_all();
 
-  if (!ret.second)
-    (*ret.first).second += c;
+  HT_DEBUGF("MasterGc: removed %lu/%lu files",
+            (Lu)m_files_removed, (Lu)files.size());
 }
 
-/**
- * Currently only stale cs files and range directories are reaped
- * Table directories probably should be obtained when removing
- * rows in METADATA
- */
-void GcWorker::reap(CountMap &files_map) {
-  size_t nf = 0, nf_done = 0, nd = 0, nd_done = 0;
-
-  foreach (const CountMap::value_type &v, files_map) {
-    if (!v.second) {
-      HT_INFOF("MasterGc: removing file %s", v.first);
-      try {
-        m_context->dfs->remove(m_tables_dir + v.first);
-        ++nf_done;
-      }
-      catch (Exception &e) {
-        HT_WARNF("%s", e.what());
-      }
-      ++nf;
+void GcWorker::remove_files(std::vector<String> *files, size_t first,
+                            size_t stride) {
+  uint64_t removed = 0, reclaimed = 0;
+
+  for (size_t i=first; i<files->size(); i+=stride) {
+    String path = m_tables_dir + (*files)[i];
+    HT_INFOF("MasterGc: removing file %s", (*files)[i].c_str());
+    try {
+      int64_t length = m_context->dfs->length(path);
+      m_context->dfs->remove(path);
+      ++removed;
+      reclaimed += length;
+    }
+    catch (Exception &e) {
+      HT_WARNF("%s", e.what());
     }
   }
 
-  HT_DEBUGF("MasterGc: removed %lu/%lu files; %lu/%lu directories",
-            (Lu)nf_done, (Lu)nf, (Lu)nd_done, (Lu)nd);
+  ScopedLock lock(m_stats_mutex);
+  m_files_removed += removed;
+  m_bytes_reclaimed += reclaimed;
 }
-
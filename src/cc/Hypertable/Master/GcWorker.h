@@ -22,31 +22,50 @@
 #ifndef HYPERTABLE_GCWORKER_H
 #define HYPERTABLE_GCWORKER_H
 
-#include "Common/CstrHashMap.h"
+#include <vector>
+
+#include "Common/Mutex.h"
 
 #include "Hypertable/Lib/Client.h"
 
 #include "Context.h"
+#include "GcReferenceCounter.h"
 
 namespace Hypertable {
 
-  typedef CstrHashMap<int> CountMap; // filename -> reference count
-
+  /**
+   * Removes CellStore files that are no longer referenced by the Files
+   * column of METADATA.  The first pass, and every
+   * Hypertable.Master.Gc.FullScanInterval passes thereafter, scans all of
+   * METADATA.  The passes in between only scan the Files cells written
+   * since the previous pass and update the reference counts kept from
+   * earlier passes (see GcReferenceCounter), so a GcWorker should be kept
+   * for the life of the Master.  Unreferenced files are removed by a pool of threads.
+   */
   class GcWorker {
   public:
     GcWorker(ContextPtr &context);
     void gc();
 
   private:
-    void scan_metadata(CountMap &files_map);
-    void delete_row(const std::string &row, TableMutatorPtr &mutator);
-    void delete_cell(const Cell &cell, TableMutatorPtr &mutator);
-    void insert_files(CountMap &map, const char *buf, size_t len, int c=0);
-    void insert_file(CountMap &map, const char *fname, int c);
-    void reap(CountMap &files_map);
+    void scan_metadata(bool full);
+    void reap();
+    void remove_files(std::vector<String> *files, size_t first, size_t stride);
 
+    Mutex      m_mutex;
     ContextPtr m_context;
     String     m_tables_dir;
+    GcReferenceCounter m_refs;
+    int64_t    m_last_pass_time;
+    int32_t    m_passes_since_full;
+    int32_t    m_full_scan_interval;
+    int64_t    m_scan_overlap;
+    int32_t    m_removal_threads;
+
+    // per-pass removal counters
+    Mutex      m_stats_mutex;
+    uint64_t   m_files_removed;
+    uint64_t   m_bytes_reclaimed;
   };
 
 } // namespace Hypertable
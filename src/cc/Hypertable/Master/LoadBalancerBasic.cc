@@ -23,6 +23,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include "LoadBalancerBasic.h"
+#include "LoadBalancerBasicDistributeCost.h"
 #include "LoadBalancerBasicDistributeLoad.h"
 #include "LoadBalancerBasicDistributeTableRanges.h"
 #include "LoadBalancerBasicOffloadServers.h"
@@ -37,6 +38,7 @@ using namespace std;
 
 LoadBalancerBasic::LoadBalancerBasic(ContextPtr context) : LoadBalancer(context), m_waiting_for_servers(false) {
   m_enabled = context->props->get_bool("Hypertable.LoadBalancer.Enable");
+  m_cost_based = context->props->get_bool("Hypertable.LoadBalancer.CostBased");
 }
 
 
@@ -132,6 +134,8 @@ void LoadBalancerBasic::calculate_balance_plan(const String &algo, BalancePlanPt
     }
     else if (algorithm.compare("load")==0)
       mode = BALANCE_MODE_DISTRIBUTE_LOAD;
+    else if (algorithm.compare("cost")==0)
+      mode = BALANCE_MODE_DISTRIBUTE_COST;
     else if (boost::starts_with(algorithm, "offload ")) {
       String list(algorithm, 8);
       boost::trim(list);
@@ -140,7 +144,7 @@ void LoadBalancerBasic::calculate_balance_plan(const String &algo, BalancePlanPt
     }
     else
       HT_THROW(Error::NOT_IMPLEMENTED, (String)"Unknown LoadBalancer algorithm '" + algorithm
-          + "' supported algorithms are 'TABLE_RANGES', 'LOAD'");
+          + "' supported algorithms are 'TABLE_RANGES', 'LOAD', 'COST'");
   }
 
   // TODO: write a factory class to create the sub balancer objects
@@ -158,12 +162,18 @@ void LoadBalancerBasic::calculate_balance_plan(const String &algo, BalancePlanPt
   else if (mode == BALANCE_MODE_OFFLOAD_SERVERS) {
     offload_servers(range_server_stats, offload, balance_plan);
   }
+  else if (mode == BALANCE_MODE_DISTRIBUTE_COST) {
+    distribute_cost(balance_plan);
+  }
 
   if (balance_plan->moves.size()) {
     get_unbalanced_servers(range_server_stats);
     if (mode == BALANCE_MODE_DISTRIBUTE_LOAD) {
       HT_INFO_OUT << "LoadBalancerBasic mode=BALANCE_MODE_DISTRIBUTE_LOAD" << HT_END;
     }
+    else if (mode == BALANCE_MODE_DISTRIBUTE_COST) {
+      HT_INFO_OUT << "LoadBalancerBasic mode=BALANCE_MODE_DISTRIBUTE_COST" << HT_END;
+    }
     else
       HT_INFO_OUT << "LoadBalancerBasic mode=BALANCE_MODE_DISTRIBUTE_TABLE_RANGES" << HT_END;
     HT_INFO_OUT << "BalancePlan created, move " << balance_plan->moves.size() << " ranges"
@@ -185,12 +195,24 @@ void LoadBalancerBasic::distribute_load(const ptime &now, BalancePlanPtr &balanc
       << m_balance_window_start << ", m_balance_window_end="
       << m_balance_window_end << HT_END;
 
+  if (m_cost_based) {
+    distribute_cost(balance_plan);
+    return;
+  }
+
   LoadBalancerBasicDistributeLoad planner(m_balance_loadavg_threshold,
                                           m_context->rs_metrics_table);
   planner.compute_plan(balance_plan);
   return;
 }
 
+void LoadBalancerBasic::distribute_cost(BalancePlanPtr &balance_plan) {
+  LoadBalancerBasicDistributeCost planner(m_context->props,
+                                          m_context->rs_metrics_table);
+  planner.compute_plan(balance_plan);
+  return;
+}
+
 void LoadBalancerBasic::distribute_table_ranges(vector<RangeServerStatistics> &range_server_stats, BalancePlanPtr &balance_plan) {
   // no need to check if its time to do balance, we have empty servers, so do balance
   LoadBalancerBasicDistributeTableRanges  planner(m_context->metadata_table);
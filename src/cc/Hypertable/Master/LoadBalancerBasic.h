@@ -40,7 +40,8 @@ namespace Hypertable {
     enum {
       BALANCE_MODE_DISTRIBUTE_LOAD             = 1,
       BALANCE_MODE_DISTRIBUTE_TABLE_RANGES     = 2,
-      BALANCE_MODE_OFFLOAD_SERVERS             = 3
+      BALANCE_MODE_OFFLOAD_SERVERS             = 3,
+      BALANCE_MODE_DISTRIBUTE_COST             = 4
     };
     LoadBalancerBasic(ContextPtr context);
 
@@ -54,6 +55,7 @@ namespace Hypertable {
     private:
       void calculate_balance_plan(const String &algorithm, BalancePlanPtr &plan);
       void distribute_load(const boost::posix_time::ptime &now, BalancePlanPtr &plan);
+      void distribute_cost(BalancePlanPtr &plan);
       void distribute_table_ranges(vector<RangeServerStatistics> &range_server_stats,
                                    BalancePlanPtr &plan);
       void offload_servers(vector<RangeServerStatistics> &range_server_stats,
@@ -63,6 +65,7 @@ namespace Hypertable {
 
       Mutex m_data_mutex;
       bool m_enabled;
+      bool m_cost_based;
       bool  m_waiting_for_servers;
       std::vector <RangeServerStatistics> m_range_server_stats;
       ptime m_wait_time_start;
@@ -0,0 +1,199 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include "Common/Compat.h"
+
+#include <algorithm>
+
+#include "LoadBalancerBasicDistributeCost.h"
+
+using namespace Hypertable;
+using namespace std;
+
+LoadBalancerBasicDistributeCost::LoadBalancerBasicDistributeCost(PropertiesPtr &props,
+    TablePtr &table) : m_table(table) {
+  m_cpu_weight = props->get_f64("Hypertable.LoadBalancer.Cost.CpuWeight");
+  m_disk_weight = props->get_f64("Hypertable.LoadBalancer.Cost.DiskWeight");
+  m_network_weight = props->get_f64("Hypertable.LoadBalancer.Cost.NetworkWeight");
+  m_tolerance = props->get_f64("Hypertable.LoadBalancer.Cost.Tolerance");
+  m_move_cost = props->get_f64("Hypertable.LoadBalancer.Cost.MoveCost");
+  m_max_moves = props->get_i32("Hypertable.LoadBalancer.Cost.MaxMoves");
+}
+
+void LoadBalancerBasicDistributeCost::compute_plan(BalancePlanPtr &balance_plan) {
+
+  vector<ServerMetrics> server_metrics;
+  RSMetrics rs_metrics(m_table);
+  rs_metrics.get_server_metrics(server_metrics);
+
+  size_t num_servers = server_metrics.size();
+  m_servers.clear();
+
+  if (num_servers < 2) {
+    HT_INFO_OUT << "No balancing required, num_servers=" << num_servers << HT_END;
+    return;
+  }
+
+  // range strings in the summaries point into these maps
+  vector<RangeMetricsMap> range_metrics(num_servers);
+  vector< vector<RangeCostSummary> > ranges(num_servers);
+  double mean_cpu=0, mean_disk=0, mean_network=0;
+
+  for (size_t i=0; i<num_servers; i++) {
+    rs_metrics.get_range_metrics(server_metrics[i].get_id().c_str(), range_metrics[i]);
+    foreach(const RangeMetricsMap::value_type &vv, range_metrics[i]) {
+      RangeCostSummary summary;
+      calculate_range_summary(vv.second, summary);
+      mean_cpu += summary.cpu;
+      mean_disk += summary.disk;
+      mean_network += summary.network;
+      ranges[i].push_back(summary);
+    }
+  }
+  mean_cpu /= num_servers;
+  mean_disk /= num_servers;
+  mean_network /= num_servers;
+
+  // normalize each dimension by the mean per-server load
+  double mean_cost = 0;
+  m_servers.resize(num_servers);
+  for (size_t i=0; i<num_servers; i++) {
+    m_servers[i].server_id = server_metrics[i].get_id();
+    foreach(RangeCostSummary &range, ranges[i]) {
+      range.cost = 0;
+      if (mean_cpu > 0)
+        range.cost += m_cpu_weight * range.cpu / mean_cpu;
+      if (mean_disk > 0)
+        range.cost += m_disk_weight * range.disk / mean_disk;
+      if (mean_network > 0)
+        range.cost += m_network_weight * range.network / mean_network;
+      m_servers[i].cost += range.cost;
+    }
+    m_servers[i].planned_cost = m_servers[i].cost;
+    mean_cost += m_servers[i].cost;
+    sort(ranges[i].begin(), ranges[i].end(), GtRangeCostSummary());
+  }
+  mean_cost /= num_servers;
+
+  if (mean_cost == 0) {
+    HT_INFO_OUT << "No balancing required, no load recorded in RS_METRICS" << HT_END;
+    return;
+  }
+
+  double ceiling = mean_cost * (1.0 + m_tolerance);
+  double penalty = mean_cost * m_move_cost;
+  vector<bool> done(num_servers, false);
+  int32_t moves = 0;
+
+  HT_INFO_OUT << "mean_cost=" << mean_cost << ", ceiling=" << ceiling
+      << ", move_penalty=" << penalty << ", num_servers=" << num_servers << HT_END;
+
+  while (moves < m_max_moves) {
+    size_t source = num_servers, destination = num_servers;
+
+    for (size_t i=0; i<num_servers; i++) {
+      if (!done[i] && (source == num_servers ||
+                       m_servers[i].planned_cost > m_servers[source].planned_cost))
+        source = i;
+    }
+    if (source == num_servers || m_servers[source].planned_cost <= ceiling)
+      break;
+
+    for (size_t i=0; i<num_servers; i++) {
+      if (i != source && (destination == num_servers ||
+          m_servers[i].planned_cost < m_servers[destination].planned_cost))
+        destination = i;
+    }
+
+    ServerCostSummary &src = m_servers[source];
+    ServerCostSummary &dst = m_servers[destination];
+    double excess = src.planned_cost - mean_cost;
+    RangeCostSummary *best = 0;
+
+    // largest range that fits: fewest moves to bring the source down
+    foreach(RangeCostSummary &range, ranges[source]) {
+      if (!range.moveable || range.moved)
+        continue;
+      if (range.cost > excess + mean_cost * m_tolerance)
+        continue;
+      if (dst.planned_cost + range.cost > ceiling)
+        continue;
+      double gain = src.planned_cost -
+          max(src.planned_cost - range.cost, dst.planned_cost + range.cost);
+      if (gain <= penalty)
+        continue;
+      best = &range;
+      break;
+    }
+
+    if (best == 0) {
+      HT_DEBUG_OUT << "No viable move off of " << src << HT_END;
+      done[source] = true;
+      continue;
+    }
+
+    RangeMoveSpecPtr move = new RangeMoveSpec(src.server_id.c_str(),
+        dst.server_id.c_str(), best->table_id, best->start_row, best->end_row);
+    HT_DEBUG_OUT << "Added move to plan: " << *(move.get()) << " cost="
+        << best->cost << HT_END;
+    balance_plan->moves.push_back(move);
+
+    best->moved = true;
+    src.planned_cost -= best->cost;
+    dst.planned_cost += best->cost;
+    moves++;
+  }
+
+  foreach(const ServerCostSummary &summary, m_servers)
+    HT_INFO_OUT << summary << HT_END;
+}
+
+void LoadBalancerBasicDistributeCost::calculate_range_summary(const RangeMetrics &metrics,
+    RangeCostSummary &summary) {
+
+  bool start_row_set;
+  summary.table_id  = metrics.get_table_id().c_str();
+  summary.start_row = metrics.get_start_row(&start_row_set).c_str();
+  summary.end_row   = metrics.get_end_row().c_str();
+  summary.moveable  = metrics.is_moveable();
+
+  // calculate the average rates for this range
+  const vector<RangeMeasurement> &measurements = metrics.get_measurements();
+  if (measurements.size() > 0) {
+    foreach(const RangeMeasurement &measurement, measurements) {
+      summary.cpu += measurement.cell_read_rate + measurement.cell_write_rate
+          + measurement.scan_rate + measurement.update_rate;
+      // written bytes arrive over the network and are only charged there;
+      // they reach disk later through the shared commit log and compactions
+      summary.disk += measurement.disk_byte_read_rate;
+      summary.network += measurement.byte_read_rate + measurement.byte_write_rate;
+    }
+    summary.cpu /= measurements.size();
+    summary.disk /= measurements.size();
+    summary.network /= measurements.size();
+  }
+}
+
+ostream &Hypertable::operator<<(ostream &out,
+    const LoadBalancerBasicDistributeCost::ServerCostSummary &summary) {
+  out << "{ServerCostSummary: server_id=" << summary.server_id << ", cost="
+      << summary.cost << ", planned_cost=" << summary.planned_cost << "}";
+  return out;
+}
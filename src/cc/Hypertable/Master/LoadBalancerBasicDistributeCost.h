@@ -0,0 +1,109 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_LOADBALANCERBASICDISTRIBUTECOST_H
+#define HYPERTABLE_LOADBALANCERBASICDISTRIBUTECOST_H
+
+#include <map>
+#include <vector>
+#include <iostream>
+
+#include "Common/Properties.h"
+#include "Common/String.h"
+#include "Hypertable/Lib/Client.h"
+
+#include "RSMetrics.h"
+
+namespace Hypertable {
+
+  /**
+   * Computes a balance plan from the per-range rates in sys/RS_METRICS.
+   * The cost a range imposes on its server is modeled as a weighted sum of
+   * its CPU (cells and operations per second), disk (bytes read from disk
+   * per second) and network (bytes scanned and written per second) load,
+   * each rate counted in exactly one dimension and normalized by the mean
+   * per-server load in that dimension.  Ranges are moved from servers
+   * whose cost exceeds the mean by more than a tolerance, largest-that-fits
+   * first, and a move is only made if the reduction in peak cost outweighs
+   * a fixed per-move penalty, so the plan moves as few ranges as possible.
+   */
+  class LoadBalancerBasicDistributeCost {
+
+    public:
+      LoadBalancerBasicDistributeCost(PropertiesPtr &props, TablePtr &table);
+
+      void compute_plan(BalancePlanPtr &balance_plan);
+
+      class ServerCostSummary {
+      public:
+        ServerCostSummary() : cost(0), planned_cost(0) { }
+        String server_id;
+        double cost;
+        double planned_cost;
+      };
+
+      /** Returns the modeled cost of each server before and after the
+       * most recently computed plan */
+      const std::vector<ServerCostSummary> &get_server_summaries() const {
+        return m_servers;
+      }
+
+    private:
+      class RangeCostSummary {
+      public:
+        RangeCostSummary() : cost(0), cpu(0), disk(0), network(0),
+                             moveable(false), moved(false), table_id(0),
+                             start_row(0), end_row(0) { }
+        double cost;
+        double cpu;
+        double disk;
+        double network;
+        bool moveable;
+        bool moved;
+        const char *table_id;
+        const char *start_row;
+        const char *end_row;
+      };
+      struct GtRangeCostSummary {
+        bool operator() (const RangeCostSummary &x, const RangeCostSummary &y) const {
+          return x.cost > y.cost;
+        }
+      };
+
+      void calculate_range_summary(const RangeMetrics &metrics,
+                                   RangeCostSummary &summary);
+
+      double m_cpu_weight;
+      double m_disk_weight;
+      double m_network_weight;
+      double m_tolerance;
+      double m_move_cost;
+      int32_t m_max_moves;
+      TablePtr &m_table;
+      std::vector<ServerCostSummary> m_servers;
+  }; // LoadBalancerBasicDistributeCost
+
+  std::ostream &operator<<(std::ostream &out,
+      const LoadBalancerBasicDistributeCost::ServerCostSummary &summary);
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_LOADBALANCERBASICDISTRIBUTECOST_H
@@ -30,6 +30,7 @@
 #include "OperationDropNamespace.h"
 #include "OperationInitialize.h"
 #include "OperationMoveRange.h"
+#include "OperationRecoverServer.h"
 #include "OperationRenameTable.h"
 #include "RangeServerConnection.h"
 
@@ -72,6 +73,8 @@ Entity *DefinitionMaster::create(uint16_t log_version, const EntityHeader &heade
     return new OperationMoveRange(m_context, header);
   else if (header.type == EntityType::OPERATION_BALANCE)
     return new OperationBalance(m_context, header);
+  else if (header.type == EntityType::OPERATION_RECOVER_SERVER)
+    return new OperationRecoverServer(m_context, header);
 
   HT_THROWF(Error::METALOG_ENTRY_BAD_TYPE,
             "Unrecognized type (%d) encountered in mml",
@@ -34,6 +34,7 @@ const char *Dependency::SERVERS = "SERVERS";
 const char *Dependency::ROOT = "ROOT";
 const char *Dependency::METADATA = "METADATA";
 const char *Dependency::SYSTEM = "SYSTEM";
+const char *Dependency::RECOVERY = "RECOVERY";
 
 
 const char *OperationState::get_text(int32_t state);
@@ -69,6 +69,7 @@ namespace Hypertable {
     extern const char *ROOT;
     extern const char *METADATA;
     extern const char *SYSTEM;
+    extern const char *RECOVERY;
   }
 
   namespace NamespaceFlag {
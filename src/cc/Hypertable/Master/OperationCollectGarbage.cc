@@ -37,8 +37,13 @@ OperationCollectGarbage::OperationCollectGarbage(ContextPtr &context)
 void OperationCollectGarbage::execute() {
   HT_INFOF("Entering CollectGarbage-%lld", (Lld)header.id);
   try {
-    GcWorker worker(m_context);
-    worker.gc();
+    {
+      // the worker carries reference counts over from one pass to the next
+      ScopedLock lock(m_context->mutex);
+      if (m_context->gc_worker == 0)
+        m_context->gc_worker = new GcWorker(m_context);
+    }
+    m_context->gc_worker->gc();
   }
   catch (Exception &e) {
     HT_THROW2(e.code(), e, "Garbage Collection");
@@ -67,8 +67,11 @@ void OperationInitialize::execute() {
     {
       handle = 0;
       HT_ON_SCOPE_EXIT(&Hyperspace::close_handle_ptr, m_context->hyperspace, &handle);
-      m_context->hyperspace->mkdirs(m_context->toplevel_dir + "/servers");
-      m_context->hyperspace->mkdirs(m_context->toplevel_dir + "/tables");
+      std::vector<Hyperspace::MultiOp> ops;
+      std::vector<Hyperspace::MultiOpResult> results;
+      ops.push_back(Hyperspace::MultiOp::mkdir(m_context->toplevel_dir + "/servers", true));
+      ops.push_back(Hyperspace::MultiOp::mkdir(m_context->toplevel_dir + "/tables", true));
+      m_context->hyperspace->multi(ops, results);
       handle = m_context->hyperspace->open(m_context->toplevel_dir + "/master",
                                            OPEN_FLAG_READ|OPEN_FLAG_WRITE|OPEN_FLAG_CREATE);
       m_context->hyperspace->close(handle);
@@ -38,7 +38,9 @@ using namespace boost;
 
 OperationProcessor::ThreadContext::ThreadContext(ContextPtr &mctx)
   : master_context(mctx), current_blocked(0), busy_count(0),
-    need_order_recompute(false), shutdown(false), paused(false) {
+    need_order_recompute(false), shutdown(false), paused(false),
+    retired_count(0), update_count(0), requeue_count(0), update_total(0),
+    requeue_total(0), report_time(time(0)) {
   current_iter = current.end();
   execution_order_iter = execution_order.end();
 }
@@ -163,6 +165,12 @@ bool OperationProcessor::empty() {
   return num_vertices(m_context.graph) == 0;
 }
 
+void OperationProcessor::get_counters(uint64_t *updatesp, uint64_t *requeuesp) {
+  ScopedLock lock(m_context.mutex);
+  *updatesp = m_context.update_total;
+  *requeuesp = m_context.requeue_total;
+}
+
 void OperationProcessor::wake_up() {
   ScopedLock lock(m_context.mutex);
   m_context.need_order_recompute = true;
@@ -265,6 +273,7 @@ void OperationProcessor::Worker::operator()() {
             m_context.current_blocked++;
           else
             update_operation(vertex, operation);
+          report_throughput();
         }
       }
       catch (Exception &e) {
@@ -359,7 +368,8 @@ void OperationProcessor::add_exclusivity(Vertex v, const String &name) {
     }
   }
 
-  m_context.exclusivity_index.insert(DependencyIndex::value_type(name, v));
+  m_context.exclusivity_entries[v].push_back(
+    m_context.exclusivity_index.insert(DependencyIndex::value_type(name, v)));
 }
 
 
@@ -400,7 +410,8 @@ void OperationProcessor::add_dependency(Vertex v, const String &name) {
        bound.first != bound.second; ++bound.first)
     add_edge(v, bound.first->second);
 
-  m_context.dependency_index.insert(DependencyIndex::value_type(name, v));
+  m_context.dependency_entries[v].push_back(
+    m_context.dependency_index.insert(DependencyIndex::value_type(name, v)));
 }
 
 
@@ -424,55 +435,95 @@ void OperationProcessor::add_obstruction(Vertex v, const String &name) {
        bound.first != bound.second; ++bound.first)
     add_edge(bound.first->second, v);
 
-  m_context.obstruction_index.insert(DependencyIndex::value_type(name, v));
+  m_context.obstruction_entries[v].push_back(
+    m_context.obstruction_index.insert(DependencyIndex::value_type(name, v)));
 }
 
 
 void OperationProcessor::purge_from_dependency_index(Vertex v) {
-  DependencyIndex::iterator iter, del_iter;
-
-  // Purge from dependency index
-  iter = m_context.dependency_index.begin();
-  while (iter != m_context.dependency_index.end()) {
-    if (iter->second == v) {
-      del_iter = iter++;
-      m_context.dependency_index.erase(del_iter);
-    }
-    else
-      ++iter;
-  }
+  purge_from_index(m_context.dependency_index, m_context.dependency_entries, v);
 }
 
 
 void OperationProcessor::purge_from_exclusivity_index(Vertex v) {
-  DependencyIndex::iterator iter, del_iter;
-
-  // Purge from exclusivity index
-  iter = m_context.exclusivity_index.begin();
-  while (iter != m_context.exclusivity_index.end()) {
-    if (iter->second == v) {
-      del_iter = iter++;
-      m_context.exclusivity_index.erase(del_iter);
-    }
-    else
-      ++iter;
-  }
+  purge_from_index(m_context.exclusivity_index, m_context.exclusivity_entries, v);
 }
 
 
 void OperationProcessor::purge_from_obstruction_index(Vertex v) {
-  DependencyIndex::iterator iter, del_iter;
-
-  // Purge from obstruction index
-  iter = m_context.obstruction_index.begin();
-  while (iter != m_context.obstruction_index.end()) {
-    if (iter->second == v) {
-      del_iter = iter++;
-      m_context.obstruction_index.erase(del_iter);
+  purge_from_index(m_context.obstruction_index, m_context.obstruction_entries, v);
+}
+
+
+void OperationProcessor::purge_from_index(DependencyIndex &index,
+                                          IndexEntryMap &entries, Vertex v) {
+  IndexEntryMap::iterator iter = entries.find(v);
+
+  if (iter == entries.end())
+    return;
+
+  foreach(DependencyIndex::iterator &entry, iter->second)
+    index.erase(entry);
+
+  entries.erase(iter);
+}
+
+
+bool OperationProcessor::index_matches(IndexEntryMap &entries, Vertex v,
+                                       DependencySet &names) {
+  IndexEntryMap::iterator iter = entries.find(v);
+  size_t count = (iter == entries.end()) ? 0 : iter->second.size();
+
+  if (count != names.size())
+    return false;
+
+  for (size_t i=0; i<count; i++) {
+    if (names.count(iter->second[i]->first) == 0)
+      return false;
+  }
+  return true;
+}
+
+
+/**
+ * Returns true if the operation's exclusivities, dependencies and
+ * obstructions are the ones already indexed for vertex v, it has no new
+ * sub-operations and none of its dependencies would bring back a perpetual
+ * operation.  Such an operation can keep its edges and position in the
+ * execution order.
+ */
+bool OperationProcessor::dependencies_unchanged(Vertex v, OperationPtr &operation) {
+  DependencySet names;
+  std::vector<Operation *> sub_ops;
+
+  operation->swap_sub_operations(sub_ops);
+  if (!sub_ops.empty()) {
+    operation->swap_sub_operations(sub_ops);
+    return false;
+  }
+
+  operation->exclusivities(names);
+  if (!index_matches(m_context.exclusivity_entries, v, names))
+    return false;
+
+  operation->obstructions(names);
+  if (!index_matches(m_context.obstruction_entries, v, names))
+    return false;
+
+  operation->dependencies(names);
+  if (!index_matches(m_context.dependency_entries, v, names))
+    return false;
+
+  foreach(const OperationPtr &perpetual_op, m_context.perpetual_ops) {
+    DependencySet obstructions;
+    perpetual_op->obstructions(obstructions);
+    foreach(const String &name, obstructions) {
+      if (names.count(name) > 0)
+        return false;
     }
-    else
-      ++iter;
   }
+
+  return true;
 }
 
 
@@ -505,6 +556,7 @@ void OperationProcessor::Worker::retire_operation(Vertex v, OperationPtr &operat
   clear_vertex(v, m_context.graph);
   remove_vertex(v, m_context.graph);
   m_context.live.erase(v);
+  m_context.retired_count++;
   if (operation->exclusive())
     m_context.exclusive_ops.erase(operation->name());
   //HT_INFOF("Retiring op %p vertex %p", operation.get(), v);
@@ -524,6 +576,27 @@ void OperationProcessor::Worker::retire_operation(Vertex v, OperationPtr &operat
 void OperationProcessor::Worker::update_operation(Vertex v, OperationPtr &operation) {
   not_permanent np(m_context);
 
+  m_context.update_count++;
+  m_context.update_total++;
+
+  /**
+   * If nothing the ordering depends on has changed, put the operation back
+   * into the current time slot instead of rebuilding its edges and
+   * recomputing the execution order
+   */
+  if (!m_context.need_order_recompute &&
+      m_context.op->dependencies_unchanged(v, operation)) {
+    ExecutionList::iterator iter =
+      m_context.current.insert(m_context.current.end(), vertex_info(v));
+    m_context.current_active.insert(v);
+    if (m_context.current_iter == m_context.current.end())
+      m_context.current_iter = iter;
+    m_context.requeue_count++;
+    m_context.requeue_total++;
+    m_context.cond.notify_all();
+    return;
+  }
+
   m_context.op->purge_from_obstruction_index(v);
   m_context.op->purge_from_dependency_index(v);
 
@@ -634,3 +707,29 @@ bool OperationProcessor::Worker::load_current() {
   }
   return false;
 }
+
+
+void OperationProcessor::Worker::report_throughput() {
+  time_t now = time(0);
+
+  if (now - m_context.report_time < 60 ||
+      (m_context.retired_count == 0 && m_context.update_count == 0))
+    return;
+
+  uint64_t entities = 0, writes = 0;
+  if (m_context.master_context->mml_writer)
+    m_context.master_context->mml_writer->get_counters(&entities, &writes);
+
+  double elapsed = (double)(now - m_context.report_time);
+  HT_INFOF("OperationProcessor: %llu operations completed (%.1f/s), %llu state "
+           "changes (%.1f/s, %llu without reordering), %lu outstanding; MetaLog "
+           "totals %llu entries in %llu writes", (Llu)m_context.retired_count,
+           (double)m_context.retired_count / elapsed, (Llu)m_context.update_count,
+           (double)m_context.update_count / elapsed, (Llu)m_context.requeue_count,
+           (Lu)num_vertices(m_context.graph), (Llu)entities, (Llu)writes);
+
+  m_context.retired_count = 0;
+  m_context.update_count = 0;
+  m_context.requeue_count = 0;
+  m_context.report_time = now;
+}
@@ -24,6 +24,7 @@
 
 #include <list>
 #include <map>
+#include <vector>
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/properties.hpp>
@@ -61,6 +62,7 @@ namespace Hypertable {
     void unblock(const String &name);
     void remove_operation(int64_t hash_code);
     bool operation_complete(int64_t hash_code);
+    void get_counters(uint64_t *updatesp, uint64_t *requeuesp);
 
   private:
 
@@ -113,6 +115,10 @@ namespace Hypertable {
 
     typedef std::multimap<const String, Vertex> DependencyIndex;
 
+    // Vertex -> its entries in a DependencyIndex, so that purging a vertex
+    // doesn't require a scan of the whole index
+    typedef std::map<Vertex, std::vector<DependencyIndex::iterator> > IndexEntryMap;
+
     void add_dependencies(Vertex v, OperationPtr &operation);
     void add_exclusivity(Vertex v, const String &name);
     void add_dependency(Vertex v, const String &name);
@@ -120,6 +126,9 @@ namespace Hypertable {
     void purge_from_dependency_index(Vertex v);
     void purge_from_exclusivity_index(Vertex v);
     void purge_from_obstruction_index(Vertex v);
+    void purge_from_index(DependencyIndex &index, IndexEntryMap &entries, Vertex v);
+    bool index_matches(IndexEntryMap &entries, Vertex v, DependencySet &names);
+    bool dependencies_unchanged(Vertex v, OperationPtr &operation);
     void add_edge(Vertex v, Vertex u);
     void add_edge_permanent(Vertex v, Vertex u);
 
@@ -145,6 +154,9 @@ namespace Hypertable {
       DependencyIndex exclusivity_index;
       DependencyIndex dependency_index;
       DependencyIndex obstruction_index;
+      IndexEntryMap exclusivity_entries;
+      IndexEntryMap dependency_entries;
+      IndexEntryMap obstruction_entries;
       PerpetualSet perpetual_ops;
       size_t busy_count;
       bool need_order_recompute;
@@ -152,6 +164,12 @@ namespace Hypertable {
       bool paused;
       VertexSet live;
       ResponseManager *response_manager;
+      uint64_t retired_count;
+      uint64_t update_count;
+      uint64_t requeue_count;
+      uint64_t update_total;
+      uint64_t requeue_total;
+      time_t report_time;
       boost::property_map<OperationGraph, execution_time_t>::type exec_time;
       boost::property_map<OperationGraph, operation_t>::type ops;
       boost::property_map<OperationGraph, label_t>::type label;
@@ -184,6 +202,7 @@ namespace Hypertable {
     private:
       void retire_operation(Vertex v, OperationPtr &operation);
       void update_operation(Vertex v, OperationPtr &operation);
+      void report_throughput();
       void recompute_order();
       bool load_current();
       ThreadContext &m_context;
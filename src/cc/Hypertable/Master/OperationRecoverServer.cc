@@ -21,35 +21,309 @@
 
 #include "Common/Compat.h"
 #include "Common/Error.h"
+#include "Common/Serialization.h"
+#include "Common/Stopwatch.h"
 #include "Common/md5.h"
 
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/MetaLogReader.h"
+#include "Hypertable/Lib/RangeServerProtocol.h"
+#include "Hypertable/Lib/TableMutator.h"
+#include "Hypertable/RangeServer/MetaLogDefinitionRangeServer.h"
+#include "Hypertable/RangeServer/MetaLogEntityRange.h"
+
 #include "OperationRecoverServer.h"
 
 using namespace Hypertable;
+using namespace Hyperspace;
+
+namespace {
+
+  // Commit log groups in the order they must be recovered
+  struct {
+    uint16_t group;
+    const char *log_name;
+  } recovery_groups[] = {
+    { RangeServerProtocol::GROUP_METADATA_ROOT, "root" },
+    { RangeServerProtocol::GROUP_METADATA, "metadata" },
+    { RangeServerProtocol::GROUP_SYSTEM, "system" },
+    { RangeServerProtocol::GROUP_USER, "user" }
+  };
+
+  enum { ROOT = 0, METADATA = 1, SYSTEM = 2, USER = 3, GROUP_COUNT = 4 };
+
+}
 
 OperationRecoverServer::OperationRecoverServer(ContextPtr &context, RangeServerConnectionPtr &rsc)
-  : Operation(context, MetaLog::EntityType::OPERATION_RECOVER_SERVER), m_rsc(rsc) {
-  m_exclusivities.insert(m_rsc->location());
-  m_hash_code = md5_hash("RecoverServer") ^ md5_hash(m_rsc->location().c_str());
+  : Operation(context, MetaLog::EntityType::OPERATION_RECOVER_SERVER),
+    m_location(rsc->location()), m_rsc(rsc), m_lock_handle(0),
+    m_lock_deadline(0) {
+  initialize_dependencies();
+}
+
+OperationRecoverServer::OperationRecoverServer(ContextPtr &context,
+                                               const MetaLog::EntityHeader &header_)
+  : Operation(context, header_), m_lock_handle(0), m_lock_deadline(0) {
+}
+
+void OperationRecoverServer::initialize_dependencies() {
+  m_exclusivities.insert(Dependency::RECOVERY);
+  m_exclusivities.insert(m_location);
+  m_dependencies.insert(Dependency::SERVERS);
+  m_hash_code = md5_hash("RecoverServer") ^ md5_hash(m_location.c_str());
 }
 
 
 void OperationRecoverServer::execute() {
+  int32_t state = get_state();
+
+  HT_INFOF("Entering RecoverServer-%lld('%s') state=%s", (Lld)header.id,
+           m_location.c_str(), OperationState::get_text(state));
+
+  switch (state) {
+
+  case OperationState::INITIAL:
+    {
+      ScopedLock lock(m_mutex);
+      m_lock_deadline = time(0) +
+        m_context->props->get_i32("Hypertable.Master.Recovery.GracePeriod") / 1000;
+      m_state = OperationState::STARTED;
+    }
+    m_context->mml_writer->record_state(this);
+
+  case OperationState::STARTED:
+    if (server_connected())
+      break;
+    /**
+     * Obtaining the lock guarantees the server can no longer write to its
+     * commit log.  Until the grace period expires, retry on the next
+     * unblock (timer tick or server registration).
+     */
+    if (!try_server_lock()) {
+      if (time(0) < m_lock_deadline) {
+        block();
+        return;
+      }
+      HT_INFOF("Unable to obtain lock on server %s within grace period, "
+               "not recovering", m_location.c_str());
+      break;
+    }
+    set_state(OperationState::ISSUE_REQUESTS);
+    m_context->mml_writer->record_state(this);
+
+  case OperationState::ISSUE_REQUESTS:
+    // The lock handle does not survive a master restart
+    if (m_lock_handle == 0 && !try_server_lock()) {
+      block();
+      return;
+    }
+    try {
+      if (!recover()) {
+        block();
+        return;
+      }
+    }
+    catch (Exception &e) {
+      release_server_lock();
+      throw;
+    }
+    release_server_lock();
+    break;
+
+  default:
+    HT_FATALF("Unrecognized state %d", state);
+  }
+
+  complete_ok();
+
+  HT_INFOF("Leaving RecoverServer-%lld('%s')", (Lld)header.id,
+           m_location.c_str());
+}
+
+
+bool OperationRecoverServer::server_connected() {
+  if (!m_rsc && !m_context->find_server_by_location(m_location, m_rsc))
+    return false;
+  return m_rsc->connected();
+}
+
+
+/**
+ * Makes a single, non-blocking attempt to lock the server's Hyperspace
+ * file.  Returns true if the lock is held on return.
+ */
+bool OperationRecoverServer::try_server_lock() {
+  String path = m_context->toplevel_dir + "/servers/" + m_location;
+  uint32_t oflags = OPEN_FLAG_READ | OPEN_FLAG_WRITE | OPEN_FLAG_LOCK;
+  uint32_t lock_status = LOCK_STATUS_BUSY;
+  LockSequencer sequencer;
+
+  if (m_lock_handle)
+    return true;
+
+  m_lock_handle = m_context->hyperspace->open(path, oflags);
+  m_context->hyperspace->try_lock(m_lock_handle, LOCK_MODE_EXCLUSIVE,
+                                  &lock_status, &sequencer);
+  if (lock_status == LOCK_STATUS_GRANTED)
+    return true;
+
+  m_context->hyperspace->close(m_lock_handle);
+  m_lock_handle = 0;
+  return false;
+}
+
+
+void OperationRecoverServer::release_server_lock() {
+  if (m_lock_handle) {
+    m_context->hyperspace->close(m_lock_handle);
+    m_lock_handle = 0;
+  }
+}
+
 
-  if (!m_rsc->connected()) {
-    block();
+/**
+ * Replays the server's commit logs onto the surviving servers.  Returns
+ * false, without doing anything, if no other server is connected.
+ */
+bool OperationRecoverServer::recover() {
+  String location = m_location;
+  String log_dir = m_context->toplevel_dir + "/servers/" + location + "/log";
+  MetaLog::DefinitionPtr rsml_definition =
+    new MetaLog::DefinitionRangeServer(location.c_str());
+  String rsml_dir = log_dir + "/" + rsml_definition->name();
+  std::vector<MetaLog::EntityPtr> entities;
+  std::vector<RecoveryReplayer::RangeAssignment> groups[GROUP_COUNT];
+  std::vector<RangeServerConnectionPtr> servers;
+  std::vector<String> destinations;
+  MetaLog::EntityRange *range_entity;
+  Stopwatch stopwatch;
+  size_t range_count = 0;
+
+  if (!m_context->dfs->exists(rsml_dir)) {
+    HT_INFOF("No RSML found for %s, nothing to recover", location.c_str());
+    return true;
+  }
+
+  {
+    MetaLog::ReaderPtr rsml_reader =
+      new MetaLog::Reader(m_context->dfs, rsml_definition, rsml_dir);
+    rsml_reader->get_entities(entities);
+  }
+
+  foreach(MetaLog::EntityPtr &entity, entities) {
+    if ((range_entity = dynamic_cast<MetaLog::EntityRange *>(entity.get())) == 0)
+      continue;
+    int group;
+    if (range_entity->table.is_metadata())
+      group = (range_entity->spec.end_row &&
+               !strcmp(range_entity->spec.end_row, Key::END_ROOT_ROW)) ? ROOT : METADATA;
+    else if (range_entity->table.is_system())
+      group = SYSTEM;
+    else
+      group = USER;
+    groups[group].push_back(RecoveryReplayer::RangeAssignment());
+    RecoveryReplayer::RangeAssignment &assignment = groups[group].back();
+    assignment.table = range_entity->table;
+    assignment.range = range_entity->spec;
+    assignment.state = range_entity->state;
+    assignment.needs_compaction = range_entity->needs_compaction;
+    assignment.skip = false;
+    range_count++;
+  }
+
+  if (range_count == 0) {
+    HT_INFOF("No ranges to recover for %s", location.c_str());
+    return true;
+  }
+
+  m_context->get_servers(servers);
+  foreach(RangeServerConnectionPtr &rsc, servers) {
+    if (rsc->connected() && rsc->location() != location)
+      destinations.push_back(rsc->location());
+  }
+  if (destinations.empty()) {
+    HT_INFOF("Waiting for a RangeServer to recover %s onto ...", location.c_str());
+    return false;
+  }
+
+  HT_INFOF("Recovering %u ranges of %s onto %u servers", (unsigned)range_count,
+           location.c_str(), (unsigned)destinations.size());
+
+  size_t next = m_hash_code % destinations.size();
+  for (int i=0; i<GROUP_COUNT; i++) {
+    if (groups[i].empty())
+      continue;
+    foreach(RecoveryReplayer::RangeAssignment &assignment, groups[i]) {
+      assignment.location = destinations[next];
+      next = (next + 1) % destinations.size();
+    }
+    RecoveryReplayer replayer(m_context, log_dir + "/" + recovery_groups[i].log_name,
+                              recovery_groups[i].group, groups[i]);
+    replayer.run();
+    take_ownership(i, groups[i]);
+  }
+
+  /**
+   * Move the RSML aside so that the server, if it comes back, doesn't
+   * recover the ranges a second time
+   */
+  m_context->dfs->rename(rsml_dir, format("%s.recovered.%lld", rsml_dir.c_str(),
+                                          (Lld)time(0)));
+
+  HT_INFOF("Recovered %u ranges of %s in %.3f seconds", (unsigned)range_count,
+           location.c_str(), stopwatch.elapsed());
+  return true;
+}
+
+
+void OperationRecoverServer::take_ownership(int group,
+        std::vector<RecoveryReplayer::RangeAssignment> &ranges) {
+
+  if (group == ROOT) {
+    uint32_t oflags = OPEN_FLAG_READ | OPEN_FLAG_WRITE | OPEN_FLAG_CREATE;
+    String &location = ranges.front().location;
+    m_context->hyperspace->attr_set(m_context->toplevel_dir + "/root", oflags,
+                                    "Location", location.c_str(), location.length());
     return;
   }
 
-  set_state(OperationState::COMPLETE);
+  TableMutatorPtr mutator = m_context->metadata_table->create_mutator();
+  KeySpec key;
+
+  foreach(RecoveryReplayer::RangeAssignment &assignment, ranges) {
+    String metadata_key_str = format("%s:%s", assignment.table.id,
+                                     assignment.range.end_row);
+    key.row = metadata_key_str.c_str();
+    key.row_len = metadata_key_str.length();
+    key.column_family = "Location";
+    key.column_qualifier = 0;
+    key.column_qualifier_len = 0;
+    mutator->set(key, assignment.location.c_str(), assignment.location.length());
+  }
+  mutator->flush();
+}
+
+
+size_t OperationRecoverServer::encoded_state_length() const {
+  return Serialization::encoded_length_vstr(m_location) + 8;
+}
+
+void OperationRecoverServer::encode_state(uint8_t **bufp) const {
+  Serialization::encode_vstr(bufp, m_location);
+  Serialization::encode_i64(bufp, m_lock_deadline);
+}
 
-  HT_INFOF("Leaving RecoverServer-%lld('%s') state=%s",
-           (Lld)header.id, m_rsc->location().c_str(), OperationState::get_text(get_state()));
+void OperationRecoverServer::decode_state(const uint8_t **bufp, size_t *remainp) {
+  m_location = Serialization::decode_vstr(bufp, remainp);
+  m_lock_deadline = Serialization::decode_i64(bufp, remainp);
+  initialize_dependencies();
 }
 
+void OperationRecoverServer::decode_request(const uint8_t **bufp, size_t *remainp) {
+}
 
 void OperationRecoverServer::display_state(std::ostream &os) {
-  os << " location=" << m_rsc->location() << " ";
+  os << " location=" << m_location << " ";
 }
 
 const String OperationRecoverServer::name() {
@@ -57,6 +331,5 @@ const String OperationRecoverServer::name() {
 }
 
 const String OperationRecoverServer::label() {
-  return String("RecoverServer ") + m_rsc->location();
+  return String("RecoverServer ") + m_location;
 }
-
@@ -24,25 +24,53 @@
 
 #include "Operation.h"
 #include "RangeServerConnection.h"
+#include "RecoveryReplayer.h"
 
 namespace Hypertable {
 
+  /**
+   * Recovers the ranges of a RangeServer that has disconnected and whose
+   * Hyperspace lock can be obtained (i.e. its session has expired).  The
+   * ranges listed in the server's RSML are spread round-robin over the
+   * surviving servers and each commit log group is replayed onto them in
+   * parallel (see RecoveryReplayer), after which the Location of every
+   * recovered range is updated.
+   *
+   * Recoveries are mutually exclusive (Dependency::RECOVERY) because a
+   * RangeServer holds a single replay session.  While the failed server's
+   * lock is still held, or no destination server is connected, the
+   * operation blocks instead of waiting; it is unblocked by the master's
+   * timer and by server registration.
+   */
   class OperationRecoverServer : public Operation {
   public:
     OperationRecoverServer(ContextPtr &context, RangeServerConnectionPtr &rsc);
+    OperationRecoverServer(ContextPtr &context, const MetaLog::EntityHeader &header_);
     virtual ~OperationRecoverServer() { }
 
     virtual void execute();
     virtual const String name();
     virtual const String label();
     virtual void display_state(std::ostream &os);
-    virtual size_t encoded_state_length() const { return 0; }
-    virtual void encode_state(uint8_t **bufp) const { }
-    virtual void decode_state(const uint8_t **bufp, size_t *remainp) { }
-    virtual void decode_request(const uint8_t **bufp, size_t *remainp) { }
+    virtual size_t encoded_state_length() const;
+    virtual void encode_state(uint8_t **bufp) const;
+    virtual void decode_state(const uint8_t **bufp, size_t *remainp);
+    virtual void decode_request(const uint8_t **bufp, size_t *remainp);
+
+    const String &location() { return m_location; }
 
   private:
+    void initialize_dependencies();
+    bool server_connected();
+    bool try_server_lock();
+    void release_server_lock();
+    bool recover();
+    void take_ownership(int group, std::vector<RecoveryReplayer::RangeAssignment> &ranges);
+
+    String m_location;
     RangeServerConnectionPtr m_rsc;
+    uint64_t m_lock_handle;
+    int64_t m_lock_deadline;
   };
   typedef intrusive_ptr<OperationRecoverServer> OperationRecoverServerPtr;
 
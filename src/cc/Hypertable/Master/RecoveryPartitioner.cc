@@ -0,0 +1,105 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Serialization.h"
+
+#include "Hypertable/Lib/SerializedKey.h"
+#include "Hypertable/Lib/Types.h"
+
+#include "RecoveryPartitioner.h"
+
+using namespace Hypertable;
+using namespace Serialization;
+
+
+void RecoveryPartitioner::add_range(const String &table_id, const String &start_row,
+                                    const String &end_row, size_t dest) {
+  m_lookup[table_id].insert(EndRowMap::value_type(end_row,
+                                                  Target(start_row, dest)));
+}
+
+
+size_t RecoveryPartitioner::partition(const uint8_t *block, size_t len,
+        int64_t revision, std::vector<DynamicBuffer *> &fragments) const {
+  const uint8_t *ptr = block;
+  const uint8_t *end = block + len;
+  const uint8_t *cell;
+  size_t remaining = len;
+  TableIdentifier table_id;
+  RangeLookupMap::const_iterator table_iter;
+  EndRowMap::const_iterator iter;
+  SerializedKey key;
+  ByteString value;
+  size_t cells = 0;
+
+  table_id.decode(&ptr, &remaining);
+
+  // Table has no ranges in this group or was dropped
+  if ((table_iter = m_lookup.find(table_id.id)) == m_lookup.end())
+    return 0;
+
+  size_t header_len = 12 + table_id.encoded_length();
+
+  while (ptr < end) {
+
+    cell = ptr;
+
+    // extract the key
+    key.ptr = ptr;
+    ptr += key.length();
+    if (ptr > end)
+      HT_THROW(Error::REQUEST_TRUNCATED, "Problem decoding key");
+
+    // extract the value
+    value.ptr = ptr;
+    ptr += value.length();
+    if (ptr > end)
+      HT_THROW(Error::REQUEST_TRUNCATED, "Problem decoding value");
+
+    // Find the range with the smallest end row >= row
+    const char *row = key.row();
+    iter = table_iter->second.lower_bound(row);
+    if (iter == table_iter->second.end() ||
+        strcmp(row, iter->second.start_row.c_str()) <= 0)
+      continue;
+
+    DynamicBuffer *fragment = fragments[iter->second.dest];
+    if (fragment->fill() == 0) {
+      fragment->ensure(header_len + (end - cell));
+      fragment->ptr += 4;  // skip size
+      encode_i64(&fragment->ptr, revision);
+      table_id.encode(&fragment->ptr);
+    }
+    fragment->add(cell, ptr - cell);
+    cells++;
+  }
+
+  for (size_t i=0; i<fragments.size(); i++) {
+    if (fragments[i]->fill() == 0)
+      continue;
+    uint8_t *base = fragments[i]->base;
+    encode_i32(&base, fragments[i]->fill() - header_len);
+  }
+
+  return cells;
+}
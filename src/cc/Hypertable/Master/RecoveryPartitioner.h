@@ -0,0 +1,86 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_RECOVERYPARTITIONER_H
+#define HYPERTABLE_RECOVERYPARTITIONER_H
+
+#include <map>
+#include <vector>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/String.h"
+
+namespace Hypertable {
+
+  /**
+   * Splits the cells of an inflated commit log block by the range that
+   * contains them.  The cells for each destination are written into a
+   * fragment in the format expected by RangeServer::replay_update():
+   *
+   *   [i32 length of cells][i64 revision][table identifier][cells]
+   *
+   * Ranges are registered with add_range() before partitioning starts,
+   * after which partition() may be called from several threads.
+   */
+  class RecoveryPartitioner {
+  public:
+
+    /**
+     * Routes cells of table_id with start_row < row <= end_row to the
+     * fragment with index dest.
+     */
+    void add_range(const String &table_id, const String &start_row,
+                   const String &end_row, size_t dest);
+
+    /**
+     * Partitions one block.  Cells of unknown tables or outside every
+     * registered range are dropped.  Non-empty fragments are complete on
+     * return, empty ones are left untouched.
+     *
+     * @param block inflated block (table identifier followed by cells)
+     * @param len length of block
+     * @param revision revision of the block
+     * @param fragments one (initially empty) buffer per destination
+     * @return number of cells written to fragments
+     */
+    size_t partition(const uint8_t *block, size_t len, int64_t revision,
+                     std::vector<DynamicBuffer *> &fragments) const;
+
+  private:
+
+    class Target {
+    public:
+      Target(const String &start, size_t index)
+        : start_row(start), dest(index) { }
+      String start_row;
+      size_t dest;
+    };
+
+    // table id -> (end row -> range)
+    typedef std::map<String, Target> EndRowMap;
+    typedef std::map<String, EndRowMap> RangeLookupMap;
+
+    RangeLookupMap m_lookup;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_RECOVERYPARTITIONER_H
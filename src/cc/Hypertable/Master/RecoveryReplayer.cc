@@ -0,0 +1,380 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Stopwatch.h"
+#include "Common/Thread.h"
+
+#include <boost/bind.hpp>
+
+#include "AsyncComm/DispatchHandlerSynchronizer.h"
+#include "AsyncComm/Protocol.h"
+
+#include "Hypertable/Lib/CommitLogReader.h"
+#include "Hypertable/Lib/CompressorFactory.h"
+#include "Hypertable/Lib/RangeServerClient.h"
+
+#include "RecoveryReplayer.h"
+
+using namespace Hypertable;
+
+namespace {
+  // Outstanding raw blocks per partitioning thread
+  const size_t QUEUE_DEPTH_PER_THREAD = 4;
+}
+
+
+RecoveryReplayer::RecoveryReplayer(ContextPtr &context, const String &log_dir,
+                                   uint16_t group, std::vector<RangeAssignment> &ranges)
+  : m_context(context), m_log_dir(log_dir), m_group(group), m_ranges(ranges),
+    m_eos(false), m_blocks(0), m_cells(0), m_error(Error::OK) {
+  m_read_threads = context->props->get_i32("Hypertable.Master.Recovery.ReadThreads");
+  if (m_read_threads <= 0)
+    m_read_threads = 1;
+  m_buffer_size = (size_t)context->props->get_i32("Hypertable.Master.Recovery.UpdateBufferSize");
+  m_timeout_ms = context->props->get_i32("Hypertable.Request.Timeout");
+}
+
+
+void RecoveryReplayer::run() {
+  std::map<String, Destination *> destinations;
+
+  foreach(RangeAssignment &assignment, m_ranges) {
+    Destination *&dest = destinations[assignment.location];
+    if (dest == 0) {
+      dest = new Destination();
+      dest->location = assignment.location;
+      m_destinations.push_back(dest);
+    }
+    dest->ranges.push_back(&assignment);
+  }
+
+  try {
+    Stopwatch stopwatch;
+
+    fan_out(&RecoveryReplayer::prepare);
+    HT_INFOF("Recovery of %s prepared %u ranges on %u servers in %.3f seconds",
+             m_log_dir.c_str(), (unsigned)m_ranges.size(),
+             (unsigned)m_destinations.size(), stopwatch.elapsed());
+
+    // Only ranges that were loaded by prepare() receive updates
+    for (size_t i=0; i<m_destinations.size(); i++) {
+      foreach(RangeAssignment *assignment, m_destinations[i]->ranges) {
+        if (!assignment->skip)
+          m_partitioner.add_range(assignment->table.id,
+              assignment->range.start_row, assignment->range.end_row, i);
+      }
+    }
+
+    stopwatch.reset();
+    replay_blocks();
+
+    uint64_t sent_bytes = 0;
+    uint32_t sent_requests = 0;
+    foreach(Destination *dest, m_destinations) {
+      sent_bytes += dest->sent_bytes;
+      sent_requests += dest->sent_requests;
+    }
+    HT_INFOF("Recovery of %s replayed %llu blocks (%llu cells, %llu bytes in "
+             "%u requests) in %.3f seconds", m_log_dir.c_str(), (Llu)m_blocks,
+             (Llu)m_cells, (Llu)sent_bytes, (unsigned)sent_requests,
+             stopwatch.elapsed());
+
+    stopwatch.reset();
+    fan_out(&RecoveryReplayer::commit);
+    HT_INFOF("Recovery of %s committed on %u servers in %.3f seconds",
+             m_log_dir.c_str(), (unsigned)m_destinations.size(),
+             stopwatch.elapsed());
+  }
+  catch (Exception &e) {
+    foreach(Destination *dest, m_destinations)
+      delete dest;
+    m_destinations.clear();
+    throw;
+  }
+
+  foreach(Destination *dest, m_destinations)
+    delete dest;
+  m_destinations.clear();
+}
+
+
+void RecoveryReplayer::fan_out(void (RecoveryReplayer::*fn)(Destination *)) {
+  ThreadGroup threads;
+
+  foreach(Destination *dest, m_destinations)
+    threads.create_thread(boost::bind(fn, this, dest));
+  threads.join_all();
+
+  if (m_error != Error::OK)
+    HT_THROW(m_error, m_error_msg);
+}
+
+
+void RecoveryReplayer::prepare(Destination *dest) {
+  RangeServerClient rsc(m_context->comm, m_timeout_ms);
+  CommAddress addr;
+
+  addr.set_proxy(dest->location);
+
+  try {
+    {
+      DispatchHandlerSynchronizer sync_handler;
+      rsc.replay_begin(addr, m_group, &sync_handler);
+      wait_for_reply(sync_handler, dest, "replay_begin");
+    }
+
+    foreach(RangeAssignment *assignment, dest->ranges) {
+      DispatchHandlerSynchronizer sync_handler;
+      rsc.replay_load_range(addr, assignment->table, assignment->range,
+                            assignment->state, assignment->needs_compaction,
+                            &sync_handler);
+      try {
+        wait_for_reply(sync_handler, dest, "replay_load_range");
+      }
+      catch (Exception &e) {
+        // Loaded by an earlier, interrupted attempt of this recovery
+        if (e.code() != Error::RANGESERVER_RANGE_ALREADY_LOADED)
+          throw;
+        HT_INFOF("Range %s[%s..%s] already loaded on %s, skipping replay",
+                 assignment->table.id, assignment->range.start_row,
+                 assignment->range.end_row, dest->location.c_str());
+        assignment->skip = true;
+      }
+    }
+  }
+  catch (Exception &e) {
+    record_error(e.code(), e.what());
+  }
+}
+
+
+void RecoveryReplayer::replay_blocks() {
+  ThreadGroup threads;
+  CommitLogReaderPtr log_reader;
+  CommitLogBlockInfo binfo;
+  BlockCompressionHeaderCommitLog header;
+  size_t queue_limit = QUEUE_DEPTH_PER_THREAD * m_read_threads;
+
+  m_eos = false;
+
+  for (int32_t i=0; i<m_read_threads; i++)
+    threads.create_thread(boost::bind(&RecoveryReplayer::partition_blocks, this));
+
+  try {
+    log_reader = new CommitLogReader(m_context->dfs, m_log_dir);
+
+    while (log_reader->next_raw_block(&binfo, &header)) {
+
+      if (binfo.error != Error::OK) {
+        HT_WARNF("Corruption detected in CommitLog fragment %s/%s starting at "
+                 "postion %lld for %lld bytes - %s", binfo.log_dir,
+                 binfo.file_fragment, (Lld)binfo.start_offset,
+                 (Lld)(binfo.end_offset - binfo.start_offset),
+                 Error::get_text(binfo.error));
+        continue;
+      }
+
+      RawBlock *block = new RawBlock();
+      block->header = header;
+      block->zblock.add(binfo.block_ptr, binfo.block_len);
+
+      ScopedLock lock(m_mutex);
+      while (m_queue.size() >= queue_limit && m_error == Error::OK)
+        m_cond.wait(lock);
+      if (m_error != Error::OK) {
+        delete block;
+        break;
+      }
+      m_queue.push_back(block);
+      m_blocks++;
+      m_cond.notify_all();
+    }
+  }
+  catch (Exception &e) {
+    record_error(e.code(), e.what());
+  }
+
+  {
+    ScopedLock lock(m_mutex);
+    m_eos = true;
+    m_cond.notify_all();
+  }
+
+  threads.join_all();
+
+  foreach(RawBlock *block, m_queue)
+    delete block;
+  m_queue.clear();
+
+  if (m_error != Error::OK)
+    HT_THROW(m_error, m_error_msg);
+
+  // Send whatever is left in the per-destination buffers
+  fan_out(&RecoveryReplayer::flush);
+}
+
+
+void RecoveryReplayer::partition_blocks() {
+  BlockCompressionCodecPtr codec;
+  uint16_t codec_type = 0;
+  DynamicBuffer inflated;
+  std::vector<DynamicBuffer *> fragments;
+  RawBlock *block;
+
+  for (size_t i=0; i<m_destinations.size(); i++)
+    fragments.push_back(new DynamicBuffer());
+
+  while (true) {
+    {
+      ScopedLock lock(m_mutex);
+      while (m_queue.empty() && !m_eos && m_error == Error::OK)
+        m_cond.wait(lock);
+      if (m_queue.empty() || m_error != Error::OK)
+        break;
+      block = m_queue.front();
+      m_queue.pop_front();
+      m_cond.notify_all();
+    }
+
+    try {
+      partition(block, codec, &codec_type, inflated, fragments);
+    }
+    catch (Exception &e) {
+      record_error(e.code(), e.what());
+    }
+    delete block;
+  }
+
+  foreach(DynamicBuffer *fragment, fragments)
+    delete fragment;
+}
+
+
+void RecoveryReplayer::partition(RawBlock *block, BlockCompressionCodecPtr &codec,
+                                 uint16_t *codec_type, DynamicBuffer &inflated,
+                                 std::vector<DynamicBuffer *> &fragments) {
+  uint16_t ztype = block->header.get_compression_type();
+  size_t cells;
+
+  if (!codec || ztype != *codec_type) {
+    if (ztype >= BlockCompressionCodec::COMPRESSION_TYPE_LIMIT)
+      HT_THROWF(Error::BLOCK_COMPRESSOR_UNSUPPORTED_TYPE,
+                "Invalid compression type '%d'", (int)ztype);
+    codec = CompressorFactory::create_block_codec((BlockCompressionCodec::Type)ztype);
+    *codec_type = ztype;
+  }
+
+  inflated.clear();
+  codec->inflate(block->zblock, inflated, block->header);
+
+  cells = m_partitioner.partition(inflated.base, inflated.fill(),
+                                  block->header.get_revision(), fragments);
+
+  for (size_t i=0; i<fragments.size(); i++) {
+    if (fragments[i]->fill() == 0)
+      continue;
+    append(m_destinations[i], *fragments[i]);
+    fragments[i]->clear();
+  }
+
+  ScopedLock lock(m_mutex);
+  m_cells += cells;
+}
+
+
+void RecoveryReplayer::append(Destination *dest, DynamicBuffer &fragment) {
+  {
+    ScopedLock lock(dest->mutex);
+    dest->buffer.add(fragment.base, fragment.fill());
+    if (dest->buffer.fill() < m_buffer_size)
+      return;
+  }
+  flush(dest);
+}
+
+
+void RecoveryReplayer::flush(Destination *dest) {
+  ScopedLock send_lock(dest->send_mutex);
+  RangeServerClient rsc(m_context->comm, m_timeout_ms);
+  DispatchHandlerSynchronizer sync_handler;
+  CommAddress addr;
+
+  addr.set_proxy(dest->location);
+
+  try {
+    StaticBuffer buffer;
+    {
+      ScopedLock lock(dest->mutex);
+      if (dest->buffer.fill() == 0)
+        return;
+      buffer = dest->buffer;
+    }
+    dest->sent_bytes += buffer.size;
+    dest->sent_requests++;
+    rsc.replay_update(addr, buffer, &sync_handler);
+    wait_for_reply(sync_handler, dest, "replay_update");
+  }
+  catch (Exception &e) {
+    record_error(e.code(), e.what());
+  }
+}
+
+
+void RecoveryReplayer::commit(Destination *dest) {
+  RangeServerClient rsc(m_context->comm, m_timeout_ms);
+  DispatchHandlerSynchronizer sync_handler;
+  CommAddress addr;
+
+  addr.set_proxy(dest->location);
+
+  try {
+    rsc.replay_commit(addr, &sync_handler);
+    wait_for_reply(sync_handler, dest, "replay_commit");
+  }
+  catch (Exception &e) {
+    record_error(e.code(), e.what());
+  }
+}
+
+
+void RecoveryReplayer::wait_for_reply(DispatchHandlerSynchronizer &sync_handler,
+                                      Destination *dest, const char *what) {
+  EventPtr event;
+
+  if (!sync_handler.wait_for_reply(event))
+    HT_THROWF((int)Protocol::response_code(event), "RangeServer %s %s() failure : %s",
+              dest->location.c_str(), what,
+              Protocol::string_format_message(event).c_str());
+}
+
+
+void RecoveryReplayer::record_error(int error, const String &msg) {
+  ScopedLock lock(m_mutex);
+  HT_ERRORF("Recovery of %s - %s - %s", m_log_dir.c_str(),
+            Error::get_text(error), msg.c_str());
+  if (m_error == Error::OK) {
+    m_error = error;
+    m_error_msg = msg;
+  }
+  m_cond.notify_all();
+}
@@ -0,0 +1,134 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_RECOVERYREPLAYER_H
+#define HYPERTABLE_RECOVERYREPLAYER_H
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <boost/thread/condition.hpp>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/Mutex.h"
+#include "Common/StringExt.h"
+
+#include "Hypertable/Lib/BlockCompressionCodec.h"
+#include "Hypertable/Lib/BlockCompressionHeaderCommitLog.h"
+#include "Hypertable/Lib/RangeState.h"
+#include "Hypertable/Lib/Types.h"
+
+#include "Context.h"
+#include "RecoveryPartitioner.h"
+
+namespace Hypertable {
+
+  class DispatchHandlerSynchronizer;
+
+  /**
+   * Replays one commit log group (root, metadata, system or user) of a
+   * failed RangeServer onto the surviving servers its ranges have been
+   * assigned to.  Replay happens in three phases, each fanned out over the
+   * destination servers in parallel:
+   *
+   *   1. prepare - replay_begin and replay_load_range on every destination
+   *   2. replay  - raw log blocks are read sequentially and handed to a pool
+   *                of threads that inflate them and partition the cells by
+   *                range; each destination is only sent its own cells
+   *   3. commit  - replay_commit on every destination
+   */
+  class RecoveryReplayer {
+  public:
+
+    class RangeAssignment {
+    public:
+      TableIdentifierManaged table;
+      RangeSpecManaged range;
+      RangeStateManaged state;
+      bool needs_compaction;
+      String location;
+      bool skip;
+    };
+
+    RecoveryReplayer(ContextPtr &context, const String &log_dir, uint16_t group,
+                     std::vector<RangeAssignment> &ranges);
+
+    /** Runs all three phases, throws if any destination fails */
+    void run();
+
+  private:
+
+    class RawBlock {
+    public:
+      BlockCompressionHeaderCommitLog header;
+      DynamicBuffer zblock;
+    };
+
+    class Destination {
+    public:
+      Destination() : sent_bytes(0), sent_requests(0) { }
+      String location;
+      std::vector<RangeAssignment *> ranges;
+      Mutex mutex;
+      Mutex send_mutex;
+      DynamicBuffer buffer;
+      uint64_t sent_bytes;
+      uint32_t sent_requests;
+    };
+
+    void prepare(Destination *dest);
+    void replay_blocks();
+    void partition_blocks();
+    void partition(RawBlock *block, BlockCompressionCodecPtr &codec,
+                   uint16_t *codec_type, DynamicBuffer &inflated,
+                   std::vector<DynamicBuffer *> &fragments);
+    void append(Destination *dest, DynamicBuffer &fragment);
+    void flush(Destination *dest);
+    void commit(Destination *dest);
+    void wait_for_reply(DispatchHandlerSynchronizer &sync_handler,
+                        Destination *dest, const char *what);
+    void fan_out(void (RecoveryReplayer::*fn)(Destination *));
+    void record_error(int error, const String &msg);
+
+    ContextPtr m_context;
+    String m_log_dir;
+    uint16_t m_group;
+    std::vector<RangeAssignment> &m_ranges;
+    std::vector<Destination *> m_destinations;
+    RecoveryPartitioner m_partitioner;
+    int32_t m_read_threads;
+    size_t m_buffer_size;
+    uint32_t m_timeout_ms;
+
+    Mutex m_mutex;
+    boost::condition m_cond;
+    std::deque<RawBlock *> m_queue;
+    bool m_eos;
+    uint64_t m_blocks;
+    uint64_t m_cells;
+    int m_error;
+    String m_error_msg;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_RECOVERYREPLAYER_H
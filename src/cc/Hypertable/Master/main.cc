@@ -21,6 +21,8 @@
 
 #include "Common/Compat.h"
 
+#include <set>
+
 extern "C" {
 #include <poll.h>
 }
@@ -171,6 +173,15 @@ int main(int argc, char **argv) {
     context->op->add_operation(operation);
     context->op->wait_for_empty();
 
+    // Servers whose recovery was already under way
+    std::set<String> recovering;
+    for (size_t i=0; i<entities.size(); i++) {
+      OperationRecoverServer *recover_op =
+        dynamic_cast<OperationRecoverServer *>(entities[i].get());
+      if (recover_op && recover_op->get_state() != OperationState::COMPLETE)
+        recovering.insert(recover_op->location());
+    }
+
     // Then reconstruct state and start execution
     context->op_balance = NULL;
     for (size_t i=0; i<entities.size(); i++) {
@@ -190,7 +201,8 @@ int main(int argc, char **argv) {
         rsc->set_mml_writer(context->mml_writer);
         context->add_server(rsc);
         HT_ASSERT(rsc);
-        operations.push_back( new OperationRecoverServer(context, rsc) );
+        if (recovering.count(rsc->location()) == 0)
+          operations.push_back( new OperationRecoverServer(context, rsc) );
       }
     }
     if (operations.empty()) {
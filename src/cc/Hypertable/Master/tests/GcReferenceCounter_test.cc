@@ -0,0 +1,198 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "Hypertable/Master/GcReferenceCounter.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  /** One Files cell of a fake METADATA scan */
+  struct FilesCell {
+    const char *row;
+    const char *ag;
+    int64_t timestamp;
+    const char *value;
+  };
+
+  class RecordingDeleteHandler : public GcReferenceCounter::DeleteHandler {
+  public:
+    virtual void delete_row(const String &row) {
+      rows.push_back(row);
+    }
+    virtual void delete_cell(const Cell &cell) {
+      cells.push_back(String(cell.row_key) + "\t" + cell.column_qualifier);
+    }
+    std::vector<String> rows;
+    std::vector<String> cells;
+  };
+
+  /**
+   * Feeds the cells to the counter as a METADATA scan would return them
+   * and returns the files that are left without references
+   */
+  void scan(GcReferenceCounter &refs, bool full, const FilesCell *cells,
+            size_t count, RecordingDeleteHandler &handler,
+            std::vector<String> &unreferenced) {
+    refs.start_scan(full);
+    for (size_t i=0; i<count; i++) {
+      Cell cell(cells[i].row, "Files", cells[i].ag, cells[i].timestamp, 0,
+                (uint8_t *)cells[i].value, strlen(cells[i].value),
+                FLAG_INSERT);
+      refs.add_cell(cell, handler);
+    }
+    refs.finish_scan(handler);
+    unreferenced.clear();
+    refs.take_unreferenced(unreferenced);
+    std::sort(unreferenced.begin(), unreferenced.end());
+  }
+
+  void check_files(const std::vector<String> &files, const char **expected,
+                   size_t count) {
+    HT_ASSERT(files.size() == count);
+    for (size_t i=0; i<count; i++)
+      HT_ASSERT(files[i] == expected[i]);
+  }
+
+  void test_parse_files() {
+    const char *value = "t/a/cs0;\n#t/a/cs1;\nt/a/cs2;\n";
+    std::vector<String> files;
+
+    GcReferenceCounter::parse_files(value, strlen(value), files);
+    HT_ASSERT(files.size() == 3);
+    HT_ASSERT(files[0] == "t/a/cs0");
+    HT_ASSERT(files[1] == "t/a/cs1");
+    HT_ASSERT(files[2] == "t/a/cs2");
+  }
+
+  void test_reconciliation() {
+    GcReferenceCounter refs;
+    RecordingDeleteHandler handler;
+    std::vector<String> unreferenced;
+
+    // full scan: stale version of 1:a, empty rows 1:b and 1:z
+    const FilesCell full_cells[] = {
+      { "1:a", "default", 30, "t/a/cs1;\nt/a/cs2;\n" },
+      { "1:a", "default", 10, "t/a/cs0;\n" },
+      { "1:b", "default", 30, "!" },
+      { "1:c", "default", 30, "t/c/cs1;\n" },
+      { "1:c", "meta", 30, "t/c/cs9;\n" },
+      { "1:z", "default", 30, "!" },
+    };
+    scan(refs, true, full_cells, 6, handler, unreferenced);
+
+    const char *full_unreferenced[] = { "t/a/cs0" };
+    check_files(unreferenced, full_unreferenced, 1);
+    HT_ASSERT(refs.references("t/a/cs1") == 1);
+    HT_ASSERT(refs.references("t/a/cs2") == 1);
+    HT_ASSERT(refs.references("t/c/cs1") == 1);
+    HT_ASSERT(refs.references("t/c/cs9") == 1);
+    HT_ASSERT(refs.size() == 4);
+    HT_ASSERT(handler.cells.size() == 1 && handler.cells[0] == "1:a\tdefault");
+    HT_ASSERT(handler.rows.size() == 2);
+    HT_ASSERT(handler.rows[0] == "1:b" && handler.rows[1] == "1:z");
+
+    // incremental scan: 1:a compacted cs1 away, the previous value is
+    // still in the scanned window; 1:c split and 2:c shares its file;
+    // 1:c meta is unchanged and seen again because of the overlap
+    handler = RecordingDeleteHandler();
+    const FilesCell incremental_cells[] = {
+      { "1:a", "default", 50, "t/a/cs2;\nt/a/cs3;\n" },
+      { "1:a", "default", 30, "t/a/cs1;\nt/a/cs2;\n" },
+      { "1:c", "meta", 30, "t/c/cs9;\n" },
+      { "1:d", "default", 50, "!" },
+      { "2:c", "default", 50, "t/c/cs1;\n" },
+    };
+    scan(refs, false, incremental_cells, 5, handler, unreferenced);
+
+    const char *incremental_unreferenced[] = { "t/a/cs1" };
+    check_files(unreferenced, incremental_unreferenced, 1);
+    HT_ASSERT(refs.references("t/a/cs2") == 1);
+    HT_ASSERT(refs.references("t/a/cs3") == 1);
+    HT_ASSERT(refs.references("t/c/cs1") == 2);
+    HT_ASSERT(refs.references("t/c/cs9") == 1);
+    HT_ASSERT(handler.cells.size() == 1 && handler.cells[0] == "1:a\tdefault");
+    // rows are only known to be empty after a full scan
+    HT_ASSERT(handler.rows.empty());
+
+    // incremental scan: 1:c compacts away the shared file, which stays
+    // referenced by 2:c
+    handler = RecordingDeleteHandler();
+    const FilesCell shared_cells[] = {
+      { "1:c", "default", 70, "t/c/cs4;\n" },
+    };
+    scan(refs, false, shared_cells, 1, handler, unreferenced);
+    HT_ASSERT(unreferenced.empty());
+    HT_ASSERT(refs.references("t/c/cs1") == 1);
+    HT_ASSERT(refs.references("t/c/cs4") == 1);
+
+    // incremental scan: 2:c drops the shared file, now unreferenced
+    const FilesCell drop_cells[] = {
+      { "2:c", "default", 90, "!" },
+    };
+    scan(refs, false, drop_cells, 1, handler, unreferenced);
+    const char *drop_unreferenced[] = { "t/c/cs1" };
+    check_files(unreferenced, drop_unreferenced, 1);
+
+    // a full scan of the resulting METADATA agrees with the counts the
+    // incremental scans arrived at
+    GcReferenceCounter rebuilt;
+    handler = RecordingDeleteHandler();
+    const FilesCell final_cells[] = {
+      { "1:a", "default", 50, "t/a/cs2;\nt/a/cs3;\n" },
+      { "1:c", "default", 70, "t/c/cs4;\n" },
+      { "1:c", "meta", 30, "t/c/cs9;\n" },
+      { "1:d", "default", 50, "!" },
+      { "2:c", "default", 90, "!" },
+    };
+    scan(rebuilt, true, final_cells, 5, handler, unreferenced);
+    HT_ASSERT(unreferenced.empty());
+    HT_ASSERT(rebuilt.size() == refs.size());
+    const char *live[] = { "t/a/cs2", "t/a/cs3", "t/c/cs4", "t/c/cs9" };
+    for (size_t i=0; i<4; i++)
+      HT_ASSERT(rebuilt.references(live[i]) == 1 &&
+                refs.references(live[i]) == 1);
+    HT_ASSERT(handler.rows.size() == 2);
+    HT_ASSERT(handler.rows[0] == "1:d" && handler.rows[1] == "2:c");
+
+    // running the same full scan on the incremental counter starts over
+    scan(refs, true, final_cells, 5, handler, unreferenced);
+    HT_ASSERT(unreferenced.empty());
+    HT_ASSERT(refs.size() == 4);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  test_parse_files();
+  test_reconciliation();
+
+  return 0;
+}
@@ -37,7 +37,8 @@ using namespace Hypertable;
 OperationTest::OperationTest(ContextPtr &context, std::vector<String> &results, const String &name,
                              DependencySet &dependencies, DependencySet &exclusivities,
                              DependencySet &obstructions)
-  : Operation(context, MetaLog::EntityType::OPERATION_TEST), m_results(results), m_name(name), m_is_perpetual(false) {
+  : Operation(context, MetaLog::EntityType::OPERATION_TEST), m_results(results), m_name(name), m_is_perpetual(false),
+    m_steps(0), m_step(0), m_change_dependencies(false) {
   m_dependencies = dependencies;
   m_exclusivities = exclusivities;
   m_obstructions = obstructions;
@@ -48,7 +49,8 @@ OperationTest::OperationTest(ContextPtr &context, std::vector<String> &results,
 OperationTest::OperationTest(ContextPtr &context, std::vector<String> &results,
                              const String &name, int32_t state) :
   Operation(context, MetaLog::EntityType::OPERATION_TEST), m_results(results),
-  m_name(name), m_is_perpetual(false) {
+  m_name(name), m_is_perpetual(false), m_steps(0), m_step(0),
+  m_change_dependencies(false) {
   set_state(state);
 }
 
@@ -72,6 +74,13 @@ void OperationTest::execute() {
     }
     else if (state == OperationState::STARTED) {
       ScopedLock lock(m_context->mutex);
+      if (m_step < m_steps) {
+        ++m_step;
+        m_results.push_back(format("%s:%d", m_name.c_str(), (int)m_step));
+        if (m_change_dependencies)
+          m_dependencies.insert(format("%s-step%d", m_name.c_str(), (int)m_step));
+        return;
+      }
       m_results.push_back(m_name);
       set_state(OperationState::COMPLETE);
     }
@@ -56,10 +56,24 @@ namespace Hypertable {
 
     void set_is_perpetual(bool b) { m_is_perpetual = b; }
 
+    /**
+     * Makes the operation stay in the STARTED state for <code>steps</code>
+     * executions, recording "name:step" each time; if
+     * <code>change_dependencies</code> is set, a new dependency is added at
+     * every step
+     */
+    void set_steps(int32_t steps, bool change_dependencies=false) {
+      m_steps = steps;
+      m_change_dependencies = change_dependencies;
+    }
+
   private:
     std::vector<String> &m_results;
     String m_name;
     bool m_is_perpetual;
+    int32_t m_steps;
+    int32_t m_step;
+    bool m_change_dependencies;
   };
   typedef intrusive_ptr<OperationTest> OperationTestPtr;
 
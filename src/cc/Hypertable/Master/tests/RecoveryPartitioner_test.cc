@@ -0,0 +1,174 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+#include "Common/System.h"
+
+#include <vector>
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/SerializedKey.h"
+#include "Hypertable/Lib/Types.h"
+
+#include "Hypertable/Master/RecoveryPartitioner.h"
+
+using namespace Hypertable;
+using namespace Serialization;
+
+namespace {
+
+  void add_cell(DynamicBuffer &block, const char *row, const char *value) {
+    create_key_and_append(block, FLAG_INSERT, row, 1, "q", 1, 1);
+    append_as_byte_string(block, value, strlen(value));
+  }
+
+  void start_block(DynamicBuffer &block, const char *table) {
+    TableIdentifier table_id(table);
+    block.clear();
+    block.ensure(table_id.encoded_length());
+    table_id.encode(&block.ptr);
+  }
+
+  /**
+   * Decodes a fragment, checking the header and returning the rows of its
+   * cells in order
+   */
+  void decode_fragment(DynamicBuffer *fragment, int64_t revision,
+                       const char *table, std::vector<String> &rows) {
+    const uint8_t *ptr = fragment->base;
+    size_t remaining = fragment->fill();
+    TableIdentifier table_id;
+    SerializedKey key;
+    ByteString value;
+
+    uint32_t len = decode_i32(&ptr, &remaining);
+    HT_ASSERT(decode_i64(&ptr, &remaining) == revision);
+    table_id.decode(&ptr, &remaining);
+    HT_ASSERT(!strcmp(table_id.id, table));
+    HT_ASSERT(len == remaining);
+
+    const uint8_t *end = ptr + remaining;
+    rows.clear();
+    while (ptr < end) {
+      key.ptr = ptr;
+      ptr += key.length();
+      value.ptr = ptr;
+      ptr += value.length();
+      HT_ASSERT(ptr <= end);
+      rows.push_back(key.row());
+    }
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  RecoveryPartitioner partitioner;
+  std::vector<DynamicBuffer *> fragments;
+  std::vector<String> rows;
+  DynamicBuffer block;
+  size_t cells;
+
+  System::initialize(System::locate_install_dir(argv[0]));
+
+  for (size_t i=0; i<3; i++)
+    fragments.push_back(new DynamicBuffer());
+
+  // table 2 is split at "m" across two servers, table 3 lives on a third
+  partitioner.add_range("2", "", "m", 0);
+  partitioner.add_range("2", "m", Key::END_ROW_MARKER, 1);
+  partitioner.add_range("3", "", Key::END_ROW_MARKER, 2);
+
+  /**
+   * Cells are routed by end row, inclusive, and keep their block order
+   */
+  start_block(block, "2");
+  add_cell(block, "a", "1");
+  add_cell(block, "z", "2");
+  add_cell(block, "m", "3");
+  add_cell(block, "n", "4");
+  add_cell(block, "b", "5");
+
+  cells = partitioner.partition(block.base, block.fill(), 42, fragments);
+  HT_ASSERT(cells == 5);
+
+  decode_fragment(fragments[0], 42, "2", rows);
+  HT_ASSERT(rows.size() == 3);
+  HT_ASSERT(rows[0] == "a" && rows[1] == "m" && rows[2] == "b");
+
+  decode_fragment(fragments[1], 42, "2", rows);
+  HT_ASSERT(rows.size() == 2);
+  HT_ASSERT(rows[0] == "z" && rows[1] == "n");
+
+  HT_ASSERT(fragments[2]->fill() == 0);
+
+  for (size_t i=0; i<fragments.size(); i++)
+    fragments[i]->clear();
+
+  /**
+   * Tables without recovered ranges are dropped
+   */
+  start_block(block, "4");
+  add_cell(block, "a", "1");
+  cells = partitioner.partition(block.base, block.fill(), 43, fragments);
+  HT_ASSERT(cells == 0);
+  for (size_t i=0; i<fragments.size(); i++)
+    HT_ASSERT(fragments[i]->fill() == 0);
+
+  /**
+   * Rows outside of every recovered range are dropped
+   */
+  {
+    RecoveryPartitioner partial;
+    partial.add_range("2", "c", "f", 0);
+    start_block(block, "2");
+    add_cell(block, "c", "1");
+    add_cell(block, "d", "2");
+    add_cell(block, "g", "3");
+    cells = partial.partition(block.base, block.fill(), 44, fragments);
+    HT_ASSERT(cells == 1);
+    decode_fragment(fragments[0], 44, "2", rows);
+    HT_ASSERT(rows.size() == 1 && rows[0] == "d");
+    fragments[0]->clear();
+  }
+
+  /**
+   * A truncated block is reported as an error
+   */
+  start_block(block, "3");
+  add_cell(block, "a", "value");
+  try {
+    partitioner.partition(block.base, block.fill() - 2, 45, fragments);
+    HT_ASSERT(!"truncated block not detected");
+  }
+  catch (Exception &e) {
+    HT_ASSERT(e.code() == Error::REQUEST_TRUNCATED);
+  }
+
+  for (size_t i=0; i<fragments.size(); i++)
+    delete fragments[i];
+
+  return 0;
+}
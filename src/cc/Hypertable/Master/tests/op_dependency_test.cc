@@ -24,6 +24,7 @@
 #include "Common/Init.h"
 #include "Common/Thread.h"
 
+#include <map>
 #include <set>
 
 #include "DfsBroker/Lib/Client.h"
@@ -349,7 +350,71 @@ int main(int argc, char **argv) {
     HT_ASSERT(context->op->empty());
 
     /**
-     *  TEST 4 (perpetual)
+     *  TEST 4 (state changes with and without dependency changes)
+     */
+    {
+      uint64_t updates_before, requeues_before, updates, requeues;
+      std::map<String, int> last_step;
+      const int steps = 5;
+
+      // a lone operation whose dependencies never change is requeued
+      // without reordering at every step
+      context->op->get_counters(&updates_before, &requeues_before);
+      results.clear();
+      dependencies.clear();
+      exclusivities.clear();
+      obstructions.clear();
+      OperationTest *op = new OperationTest(context, results, "S", dependencies,
+                                            exclusivities, obstructions);
+      op->set_state(OperationState::STARTED);
+      op->set_steps(steps);
+      operation = op;
+      context->op->add_operation(operation);
+      context->op->wait_for_empty();
+
+      HT_ASSERT(results.size() == (size_t)steps + 1);
+      context->op->get_counters(&updates, &requeues);
+      HT_ASSERT(updates - updates_before == (uint64_t)steps);
+      HT_ASSERT(requeues - requeues_before == (uint64_t)steps);
+
+      // concurrent operations, one of which changes its dependencies at
+      // every step
+      updates_before = updates;
+      requeues_before = requeues;
+      results.clear();
+      operations.clear();
+      for (int i=0; i<4; i++) {
+        exclusivities.clear();
+        exclusivities.insert(format("step%d", i));
+        op = new OperationTest(context, results, format("S%d", i),
+                               dependencies, exclusivities, obstructions);
+        op->set_state(OperationState::STARTED);
+        op->set_steps(steps, i == 3);
+        operations.push_back(op);
+      }
+      context->op->add_operations(operations);
+      context->op->wait_for_empty();
+
+      HT_ASSERT(results.size() == 4 * (steps + 1));
+      foreach (const String &result, results) {
+        size_t colon = result.find(':');
+        if (colon == String::npos) {
+          HT_ASSERT(last_step[result] == steps);
+          continue;
+        }
+        String name = result.substr(0, colon);
+        int step = atoi(result.c_str() + colon + 1);
+        HT_ASSERT(step == last_step[name] + 1);
+        last_step[name] = step;
+      }
+
+      context->op->get_counters(&updates, &requeues);
+      HT_ASSERT(updates - updates_before == 4 * (uint64_t)steps);
+      HT_ASSERT(requeues - requeues_before <= 3 * (uint64_t)steps);
+    }
+
+    /**
+     *  TEST 5 (perpetual)
      */
     dependencies.clear();
     exclusivities.clear();
@@ -26,7 +26,11 @@
 #include <iterator>
 #include <vector>
 
+#include <boost/bind.hpp>
+
 #include "Common/Error.h"
+#include "Common/Thread.h"
+#include "Common/Time.h"
 #include "Common/md5.h"
 
 #include "AccessGroup.h"
@@ -34,7 +38,7 @@
 #include "CellCacheScanner.h"
 #include "CellStoreFactory.h"
 #include "CellStoreReleaseCallback.h"
-#include "CellStoreV6.h"
+#include "CellStoreV7.h"
 #include "Global.h"
 #include "MaintenanceFlag.h"
 #include "MergeScannerAccessGroup.h"
@@ -53,7 +57,7 @@ AccessGroup::AccessGroup(const TableIdentifier *identifier,
     m_earliest_cached_revision_saved(TIMESTAMP_MAX),
     m_latest_stored_revision(TIMESTAMP_MIN), m_collisions(0),
     m_file_tracker(identifier, schema, range, ag->name), m_is_root(false),
-    m_recovering(false), m_needs_merging(false) {
+    m_recovering(false), m_needs_merging(false), m_store_ttl(0) {
 
   m_table_name = m_identifier.id;
   m_start_row = range->start_row;
@@ -90,6 +94,9 @@ AccessGroup::AccessGroup(const TableIdentifier *identifier,
   }
   m_bloom_filter_disabled = BLOOM_FILTER_DISABLED ==
       m_cellstore_props->get<BloomFilterMode>("bloom-filter-mode");
+
+  create_compaction_policy(ag);
+  compute_store_ttl(ag);
 }
 
 
@@ -125,6 +132,9 @@ void AccessGroup::update_schema(SchemaPtr &schema,
       }
     }
 
+    create_compaction_policy(ag);
+    compute_store_ttl(ag);
+
     // Update schema ptr
     m_schema = schema;
   }
@@ -181,6 +191,7 @@ CellListScanner *AccessGroup::create_scanner(ScanContextPtr &scan_context) {
 
     if (!m_in_memory) {
       bool bloom_filter_disabled;
+      uint8_t bloom_filter_mode;
 
       for (size_t i=0; i<m_stores.size(); ++i) {
 
@@ -188,14 +199,17 @@ CellListScanner *AccessGroup::create_scanner(ScanContextPtr &scan_context) {
             scan_context->time_interval.second < m_stores[i].timestamp_min)
           continue;
 
-        bloom_filter_disabled = boost::any_cast<uint8_t>(m_stores[i].cs->get_trailer()->get("bloom_filter_mode")) == BLOOM_FILTER_DISABLED;
+        bloom_filter_mode = boost::any_cast<uint8_t>(m_stores[i].cs->get_trailer()->get("bloom_filter_mode"));
+        bloom_filter_disabled = bloom_filter_mode == BLOOM_FILTER_DISABLED;
 
         initial_bytes_read = m_stores[i].cs->bytes_read();
 
         // Query bloomfilter only if it is enabled and a start row has been specified
-        // (ie query is not something like select bar from foo;)
+        // (ie query is not something like select bar from foo;).  Row prefix
+        // filters can also prune scans over a range of rows
         if (bloom_filter_disabled ||
-            !scan_context->single_row ||
+            (!scan_context->single_row &&
+             bloom_filter_mode != BLOOM_FILTER_ROW_PREFIX) ||
             scan_context->start_row == "") {
           if (m_stores[i].shadow_cache) {
             scanner->add_scanner(m_stores[i].shadow_cache->create_scanner(scan_context));
@@ -357,8 +371,12 @@ AccessGroup::MaintenanceData *AccessGroup::get_maintenance_data(ByteArena &arena
   mdata->in_memory = m_in_memory;
 
   CellStoreMaintenanceData **tailp = 0;
+  bool have_expired = false;
+  int64_t now_ns = m_store_ttl ? get_ts64() : 0;
   mdata->csdata = 0;
   for (size_t i=0; i<m_stores.size(); i++) {
+    if (!have_expired && !m_in_memory && cellstore_expired(m_stores[i], now_ns))
+      have_expired = true;
     if (mdata->csdata == 0) {
       mdata->csdata = (CellStoreMaintenanceData *)arena.alloc(sizeof(CellStoreMaintenanceData));
       mdata->csdata->cs = m_stores[i].cs.get();
@@ -400,7 +418,7 @@ AccessGroup::MaintenanceData *AccessGroup::get_maintenance_data(ByteArena &arena
   mdata->file_count = m_stores.size();
 
   mdata->gc_needed = m_garbage_tracker.check_needed(mdata->deletes, mdata->mem_used, now);
-  mdata->needs_merging = m_needs_merging;
+  mdata->needs_merging = m_needs_merging || have_expired;
 
   mdata->maintenance_flags = 0;
 
@@ -436,6 +454,96 @@ void AccessGroup::add_cell_store(CellStorePtr &cellstore) {
   m_file_tracker.add_live_noupdate(cellstore->get_filename(), total_index_entries);
 }
 
+/**
+ * Moves externally written CellStores into this access group's range
+ * directory under new CellStore ids and adds them as the newest stores.
+ * The 'Files' column is updated once, after all of the stores have been
+ * opened, so a failure part way through leaves the live set unchanged and
+ * moves any already renamed files back to their original location.  Stores
+ * with a revision newer than <i>max_revision</i> (the RangeServer clock when
+ * updates were last blocked) are rejected, since later updates could be
+ * assigned older revisions and be dropped by commit log replay.
+ */
+void AccessGroup::adopt_cellstores(const std::vector<String> &files,
+                                   int64_t max_revision) {
+  std::vector<CellStorePtr> cellstores;
+  std::vector<String> added_files, removed_files;
+  std::vector<String> renamed_files;
+  int64_t total_index_entries = 0;
+  String cs_file;
+
+  if (m_in_memory)
+    HT_THROWF(Error::NOT_ALLOWED, "Cannot adopt CellStores into IN_MEMORY "
+              "access group %s(%s)", m_range_name.c_str(), m_name.c_str());
+
+  try {
+    for (size_t i=0; i<files.size(); i++) {
+      {
+        ScopedLock lock(m_mutex);
+        cs_file = format("%s/tables/%s/%s/%s/cs%d",
+                         Global::toplevel_dir.c_str(),
+                         m_identifier.id, m_name.c_str(),
+                         m_range_dir.c_str(),
+                         m_next_cs_id++);
+      }
+      Global::dfs->rename(files[i], cs_file);
+      renamed_files.push_back(cs_file);
+      cellstores.push_back(CellStoreFactory::open(cs_file, m_start_row.c_str(),
+                                                  m_end_row.c_str()));
+    }
+
+    ScopedLock lock(m_mutex);
+    int64_t revision;
+    for (size_t i=0; i<cellstores.size(); i++) {
+      revision = boost::any_cast<int64_t>
+        (cellstores[i]->get_trailer()->get("revision"));
+      if (revision > max_revision)
+        HT_THROWF(Error::RANGESERVER_REVISION_ORDER_ERROR,
+                  "Adopted CellStore %s has revision %lld which is ahead of "
+                  "the RangeServer clock (%lld)", files[i].c_str(),
+                  (Lld)revision, (Lld)max_revision);
+      if (revision >= m_earliest_cached_revision)
+        HT_THROWF(Error::RANGESERVER_REVISION_ORDER_ERROR,
+                  "Adopted CellStore %s has revision %lld which is not older "
+                  "than cached revision %lld", files[i].c_str(),
+                  (Lld)revision, (Lld)m_earliest_cached_revision);
+    }
+    for (size_t i=0; i<cellstores.size(); i++) {
+      revision = boost::any_cast<int64_t>
+        (cellstores[i]->get_trailer()->get("revision"));
+      if (revision > m_latest_stored_revision)
+        m_latest_stored_revision = revision;
+      m_stores.push_back( CellStoreInfo(cellstores[i]) );
+      m_garbage_tracker.accumulate_expirable( m_stores.back().expirable_data );
+      added_files.push_back(cellstores[i]->get_filename());
+    }
+    recompute_compression_ratio(&total_index_entries);
+    m_needs_merging = find_merge_run();
+  }
+  catch (Exception &e) {
+    // put the files back where the caller left them
+    cellstores.clear();
+    for (size_t i=0; i<renamed_files.size(); i++) {
+      try {
+        Global::dfs->rename(renamed_files[i], files[i]);
+      }
+      catch (Exception &e2) {
+        HT_ERRORF("Unable to move %s back to %s - %s",
+                  renamed_files[i].c_str(), files[i].c_str(),
+                  Error::get_text(e2.code()));
+      }
+    }
+    throw;
+  }
+
+  m_file_tracker.update_live(added_files, removed_files, m_next_cs_id, total_index_entries);
+  m_file_tracker.update_files_column();
+
+  HT_INFOF("Adopted %d CellStores into %s(%s)", (int)added_files.size(),
+           m_range_name.c_str(), m_name.c_str());
+}
+
+
 void AccessGroup::compute_garbage_stats(uint64_t *input_bytesp, uint64_t *output_bytesp) {
   ScanContextPtr scan_context = new ScanContext(m_schema);
   MergeScannerPtr mscanner = new MergeScannerAccessGroup(m_table_name,
@@ -478,6 +586,14 @@ void AccessGroup::run_compaction(int maintenance_flags) {
   size_t merge_offset=0, merge_length=0;
   String added_file;
 
+  // Expired CellStores are dropped without being read by the compactions
+  // that would otherwise rewrite them
+  if (!m_in_memory &&
+      (MaintenanceFlag::major_compaction(maintenance_flags) ||
+       MaintenanceFlag::move_compaction(maintenance_flags) ||
+       MaintenanceFlag::merging_compaction(maintenance_flags)))
+    drop_expired_cellstores();
+
   while (abort_loop) {
     ScopedLock lock(m_mutex);
     if (m_in_memory) {
@@ -529,6 +645,22 @@ void AccessGroup::run_compaction(int maintenance_flags) {
     return;
   }
 
+  /**
+   * Large major compactions may be divided into row sub-ranges that are
+   * written concurrently, each to its own CellStore
+   */
+  if (major || gc) {
+    std::vector<String> split_rows;
+    {
+      ScopedLock lock(m_mutex);
+      plan_compaction_partitions(split_rows);
+    }
+    if (!split_rows.empty()) {
+      run_partitioned_compaction(maintenance_flags, major, split_rows);
+      return;
+    }
+  }
+
   try {
 
     String cs_file;
@@ -570,7 +702,7 @@ void AccessGroup::run_compaction(int maintenance_flags) {
         }
       }
 
-      cellstore = new CellStoreV6(Global::dfs.get(), m_schema.get());
+      cellstore = new CellStoreV7(Global::dfs.get(), m_schema.get());
 
       max_num_entries = m_cell_cache_manager->immutable_items();
 
@@ -584,14 +716,12 @@ void AccessGroup::run_compaction(int maintenance_flags) {
         mscanner = new MergeScannerAccessGroup(m_table_name, 
                         scan_context, true, true);
         scanner = mscanner;
-        max_num_entries = 0;
         for (size_t i=merge_offset; i<merge_offset+merge_length; i++) {
           HT_ASSERT(m_stores[i].cs);
           mscanner->add_scanner(m_stores[i].cs->create_scanner(scan_context));
-          int divisor = (boost::any_cast<uint32_t>(m_stores[i].cs->get_trailer()->get("flags")) & CellStoreTrailerV6::SPLIT) ? 2: 1;
-          max_num_entries += (boost::any_cast<int64_t>
-              (m_stores[i].cs->get_trailer()->get("total_entries")))/divisor;
         }
+        max_num_entries = estimate_compaction_entries(m_stores, merge_offset,
+                                                      merge_length, 0);
       }
       else if (major || gc) {
         mscanner = new MergeScannerAccessGroup(m_table_name, scan_context, 
@@ -601,10 +731,9 @@ void AccessGroup::run_compaction(int maintenance_flags) {
         for (size_t i=0; i<m_stores.size(); i++) {
           HT_ASSERT(m_stores[i].cs);
           mscanner->add_scanner(m_stores[i].cs->create_scanner(scan_context));
-          int divisor = (boost::any_cast<uint32_t>(m_stores[i].cs->get_trailer()->get("flags")) & CellStoreTrailerV6::SPLIT) ? 2: 1;
-          max_num_entries += (boost::any_cast<int64_t>
-              (m_stores[i].cs->get_trailer()->get("total_entries")))/divisor;
         }
+        max_num_entries = estimate_compaction_entries(m_stores, 0, m_stores.size(),
+                                                      m_cell_cache_manager->immutable_items());
       }
       else {
         scanner = m_cell_cache_manager->create_immutable_scanner(scan_context);
@@ -614,20 +743,42 @@ void AccessGroup::run_compaction(int maintenance_flags) {
 
     cellstore->create(cs_file.c_str(), max_num_entries, m_cellstore_props, &m_identifier);
 
+    /**
+     * Minor compactions free memory and allow commit log purging, and
+     * system tables must not stall, so neither waits on the I/O budget
+     */
+    MaintenanceThrottle::TaskType throttle_type =
+      merging ? MaintenanceThrottle::MERGING_COMPACTION :
+      (major ? MaintenanceThrottle::MAJOR_COMPACTION :
+       (gc ? MaintenanceThrottle::GC_COMPACTION :
+        MaintenanceThrottle::MINOR_COMPACTION));
+    bool throttle_urgent = minor || m_in_memory || m_identifier.is_system();
+    bool throttle_reads = mscanner && (merging || major || gc);
+    int64_t throttle_written = 0;
+    uint64_t throttle_read = 0;
+
     while (scanner->get(key, value)) {
       cellstore->add(key, value);
       if (m_in_memory)
         filtered_cache->add(key, value);
+      throttle_written += key.length + value.length();
+      if (throttle_written >= MaintenanceThrottle::CHARGE_BYTES)
+        charge_throttle(throttle_type, throttle_urgent,
+                        throttle_reads ? mscanner : 0,
+                        &throttle_read, &throttle_written);
       scanner->forward();
     }
+    charge_throttle(throttle_type, throttle_urgent,
+                    throttle_reads ? mscanner : 0,
+                    &throttle_read, &throttle_written);
 
-    CellStoreTrailerV6 *trailer = dynamic_cast<CellStoreTrailerV6 *>(cellstore->get_trailer());
+    CellStoreTrailerV7 *trailer = dynamic_cast<CellStoreTrailerV7 *>(cellstore->get_trailer());
 
     if (major && mscanner)
-      trailer->flags |= CellStoreTrailerV6::MAJOR_COMPACTION;
+      trailer->flags |= CellStoreTrailerV7::MAJOR_COMPACTION;
 
     if (maintenance_flags & MaintenanceFlag::SPLIT)
-      trailer->flags |= CellStoreTrailerV6::SPLIT;
+      trailer->flags |= CellStoreTrailerV7::SPLIT;
 
     cellstore->finalize(&m_identifier);
 
@@ -964,101 +1115,493 @@ void AccessGroup::recompute_compression_ratio(int64_t *total_index_entriesp) {
 }
 
 
-bool AccessGroup::find_merge_run(size_t *indexp, size_t *lenp) {
-  size_t index = 0;
-  size_t count = 0;
-  size_t i = 0;
-  int64_t running_total = 0;
+void AccessGroup::create_compaction_policy(Schema::AccessGroup *ag) {
+  CompactionPolicy::Settings settings;
+  String spec = ag->compaction_policy;
 
-  if (m_in_memory || m_stores.size() == 0)
+  settings.target_size_min = Global::cellstore_target_size_min;
+  settings.target_size_max = Global::cellstore_target_size_max;
+  settings.run_length_threshold = Global::merge_cellstore_run_length_threshold;
+
+  if (spec.empty()) {
+    assert(Config::properties); // requires Config::init* first
+    spec = Config::get_str("Hypertable.RangeServer.AccessGroup"
+                           ".DefaultCompactionPolicy");
+  }
+
+  m_compaction_policy = CompactionPolicy::create(spec, settings);
+}
+
+
+void AccessGroup::charge_throttle(MaintenanceThrottle::TaskType type,
+                                  bool urgent, MergeScanner *mscanner,
+                                  uint64_t *readp, int64_t *writtenp) {
+  int64_t read_bytes = 0;
+
+  if (mscanner) {
+    uint64_t input_bytes, output_bytes;
+    mscanner->get_io_accounting_data(&input_bytes, &output_bytes);
+    read_bytes = (int64_t)(input_bytes - *readp);
+    *readp = input_bytes;
+  }
+
+  if (Global::maintenance_throttle)
+    Global::maintenance_throttle->charge(type, urgent, read_bytes, *writtenp);
+
+  *writtenp = 0;
+}
+
+
+void AccessGroup::compute_store_ttl(Schema::AccessGroup *ag) {
+  int64_t max_ttl = 0;
+
+  /**
+   * Whole CellStores can only be expired if every column family in the
+   * access group has a TTL, and then only by the longest one
+   */
+  foreach(Schema::ColumnFamily *cf, ag->columns) {
+    if (cf->deleted)
+      continue;
+    if (cf->ttl == 0) {
+      m_store_ttl = 0;
+      return;
+    }
+    if ((int64_t)cf->ttl > max_ttl)
+      max_ttl = (int64_t)cf->ttl;
+  }
+  m_store_ttl = max_ttl * 1000000000LL;
+}
+
+
+bool AccessGroup::cellstore_expired(CellStoreInfo &csi, int64_t now) {
+  uint32_t flags = 0;
+
+  if (m_store_ttl == 0 || csi.timestamp_max < csi.timestamp_min ||
+      csi.timestamp_max >= now - m_store_ttl)
     return false;
 
-  do {
-    count++;
-    running_total += m_stores[i].cs->disk_usage();
-
-    if (running_total >= Global::cellstore_target_size_max) {
-      if (count > (size_t)Global::merge_cellstore_run_length_threshold) {
-        if (indexp)
-          *indexp = index;
-        if (lenp)
-           *lenp = count-1;
-        return true;
+  try {
+    flags = boost::any_cast<uint32_t>(csi.cs->get_trailer()->get("flags"));
+  }
+  catch (std::exception &e) {
+    return false;
+  }
+
+  return (flags & CellStoreTrailerV7::EXACT_TIMESTAMPS) != 0;
+}
+
+
+/**
+ * Removes CellStores whose newest cell is past the TTL from the stores
+ * vector and the live file set.  The files themselves are reclaimed by
+ * the garbage collector once they are no longer referenced.
+ */
+bool AccessGroup::drop_expired_cellstores() {
+  std::vector<String> removed_files;
+  int64_t total_index_entries = 0;
+  int64_t dropped_bytes = 0;
+  int64_t dropped_expirable = 0;
+
+  {
+    ScopedLock lock(m_mutex);
+    std::vector<CellStoreInfo> new_stores;
+    int64_t now = get_ts64();
+
+    if (m_store_ttl == 0 || m_stores.empty())
+      return false;
+
+    new_stores.reserve(m_stores.size());
+    for (size_t i=0; i<m_stores.size(); i++) {
+      if (cellstore_expired(m_stores[i], now)) {
+        removed_files.push_back(m_stores[i].cs->get_filename());
+        dropped_bytes += (int64_t)m_stores[i].cs->disk_usage();
+        dropped_expirable += m_stores[i].expirable_data;
       }
-      index = i+1;
-      count = 0;
-      running_total = 0;
+      else
+        new_stores.push_back(m_stores[i]);
     }
-    else if (running_total >= Global::cellstore_target_size_min &&
-             count > 1) {
-      if (indexp)
-        *indexp = index;
-      if (lenp)
-        *lenp = count;
-      return true;
-    }
-    i++;
-  } while (i < m_stores.size());
-
-  if (count > (size_t)Global::merge_cellstore_run_length_threshold) {
-    if (indexp)
-      *indexp = index;
-    if (lenp)
-      *lenp = count;
-    return true;
+
+    if (removed_files.empty())
+      return false;
+
+    m_stores.swap(new_stores);
+    recompute_compression_ratio(&total_index_entries);
+    m_needs_merging = find_merge_run();
+
+    // the expired data went with the stores, so it no longer counts
+    // towards a GC compaction
+    m_garbage_tracker.remove_expirable(dropped_expirable);
   }
 
-  return false;
+  m_file_tracker.update_live("", removed_files, m_next_cs_id, total_index_entries);
+  m_file_tracker.update_files_column();
+
+  HT_INFOF("Dropped %d expired CellStores (%lld bytes) from %s(%s)",
+           (int)removed_files.size(), (Lld)dropped_bytes,
+           m_range_name.c_str(), m_name.c_str());
+
+  return true;
+}
+
+
+void AccessGroup::get_store_info(std::vector<CompactionPolicy::StoreInfo> &stores) {
+  stores.clear();
+  stores.reserve(m_stores.size());
+  for (size_t i=0; i<m_stores.size(); i++)
+    stores.push_back(CompactionPolicy::StoreInfo(m_stores[i].cs->disk_usage(),
+                                                 m_stores[i].timestamp_min,
+                                                 m_stores[i].timestamp_max));
+}
+
+
+bool AccessGroup::find_merge_run(size_t *indexp, size_t *lenp) {
+  std::vector<CompactionPolicy::StoreInfo> stores;
+
+  if (m_in_memory || m_stores.size() == 0)
+    return false;
+
+  get_store_info(stores);
+
+  return m_compaction_policy->find_merge_run(stores, indexp, lenp);
 }
 
 
 bool AccessGroup::needs_merging() {
-  size_t count = 0;
-  int i = 0;
-  int64_t running_total = 0;
+  std::vector<CompactionPolicy::StoreInfo> stores;
 
   if (m_in_memory || m_stores.size() == 0)
     return false;
 
-  for (i = m_stores.size()-1; i>=0; i--) {
-    count++;
-    running_total += m_stores[i].cs->disk_usage();
-    if (running_total >= Global::cellstore_target_size_max)
-      break;
-    else if (running_total >= Global::cellstore_target_size_min &&
-             (m_stores.size() - i) > 1)
-      return true;
+  get_store_info(stores);
+
+  return m_compaction_policy->needs_merging(stores);
+}
+
+namespace {
+
+  /**
+   * Takes up to <code>wanted</code> of the server-wide compaction partition
+   * threads without blocking and returns the number obtained.
+   */
+  size_t reserve_partition_threads(size_t wanted) {
+    ScopedLock lock(Global::mutex);
+    size_t available = Global::major_compaction_threads_available > 0 ?
+      (size_t)Global::major_compaction_threads_available : 0;
+    size_t reserved = std::min(wanted, available);
+    Global::major_compaction_threads_available -= (int32_t)reserved;
+    return reserved;
+  }
+
+  void release_partition_threads(size_t count) {
+    ScopedLock lock(Global::mutex);
+    Global::major_compaction_threads_available += (int32_t)count;
+  }
+
+  /**
+   * Returns reserved partition threads when a partitioned compaction
+   * finishes, whether or not it succeeded
+   */
+  struct PartitionThreadReservation {
+    PartitionThreadReservation(size_t n) : count(n) { }
+    ~PartitionThreadReservation() { release_partition_threads(count); }
+    size_t count;
+  };
+
+  struct LtRowWeight {
+    bool operator()(const std::pair<String, double> &x,
+                    const std::pair<String, double> &y) const {
+      return x.first < y.first;
+    }
+  };
+
+}
+
+
+/**
+ * One row sub-range of a partitioned major compaction
+ */
+struct AccessGroup::CompactionPartition : public ReferenceCount {
+  CompactionPartition() : mscanner(0), max_entries(0), error(Error::OK) { }
+  ScanSpecBuilder scan_spec;
+  ScanContextPtr scan_context;
+  MergeScanner *mscanner;
+  CellListScannerPtr scanner;
+  CellStorePtr cellstore;
+  String filename;
+  int64_t max_entries;
+  int error;
+  String error_msg;
+};
+
+
+/**
+ * Chooses the rows at which a major compaction is divided.  Each CellStore
+ * contributes block index rows that split it into equal pieces, weighted by
+ * its disk usage, and the rows closest to equal shares of the total are
+ * picked.  Partition threads are reserved for each row returned and are
+ * released by run_partitioned_compaction().
+ */
+void AccessGroup::plan_compaction_partitions(std::vector<String> &split_rows) {
+  uint64_t total_disk = 0;
+  size_t count;
+
+  split_rows.clear();
+
+  if (Global::major_compaction_partitions <= 1 || m_stores.empty())
+    return;
+
+  for (size_t i=0; i<m_stores.size(); i++)
+    total_disk += m_stores[i].cs->disk_usage();
+
+  if ((int64_t)total_disk < Global::major_compaction_partition_minimum_size)
+    return;
+
+  // Don't produce CellStores below the target minimum size
+  count = (size_t)Global::major_compaction_partitions;
+  if (Global::cellstore_target_size_min > 0)
+    count = std::min(count, (size_t)(total_disk / Global::cellstore_target_size_min));
+
+  if (count <= 1)
+    return;
+
+  count = 1 + reserve_partition_threads(count - 1);
+  if (count <= 1)
+    return;
+
+  std::vector< std::pair<String, double> > candidates;
+  std::vector<String> rows;
+  for (size_t i=0; i<m_stores.size(); i++) {
+    rows.clear();
+    m_stores[i].cs->get_partition_rows(count, rows);
+    double weight = (double)m_stores[i].cs->disk_usage() / (double)(rows.size()+1);
+    for (size_t j=0; j<rows.size(); j++)
+      candidates.push_back(std::make_pair(rows[j], weight));
   }
+  std::sort(candidates.begin(), candidates.end(), LtRowWeight());
+
+  double cumulative = 0.0;
+  size_t next = 1;
+  for (size_t i=0; i<candidates.size() && next < count; i++) {
+    cumulative += candidates[i].second;
+    if (cumulative < ((double)total_disk * next) / (double)count)
+      continue;
+    if (split_rows.empty() || candidates[i].first > split_rows.back())
+      split_rows.push_back(candidates[i].first);
+    while (next < count && cumulative >= ((double)total_disk * next) / (double)count)
+      next++;
+  }
+
+  release_partition_threads((count - 1) - split_rows.size());
+}
+
+
+int64_t AccessGroup::estimate_compaction_entries(const std::vector<CellStoreInfo> &stores,
+                                                 size_t offset, size_t length,
+                                                 int64_t cached_items,
+                                                 size_t partitions) {
+  int64_t total = cached_items;
 
-  if (i < 0 && count > (size_t)Global::merge_cellstore_run_length_threshold)
-    return true;
+  HT_ASSERT(offset + length <= stores.size() && partitions > 0);
 
-  /** Search from the beginning **/
+  for (size_t i=offset; i<offset+length; i++)
+    total += stores[i].cell_count;
 
-  i = 0;
-  count = 0;
-  running_total = 0;
-  do {
-    count++;
-    running_total += m_stores[i].cs->disk_usage();
+  return (total + (int64_t)partitions - 1) / (int64_t)partitions;
+}
+
+
+void AccessGroup::run_partitioned_compaction(int maintenance_flags, bool major,
+                                             std::vector<String> &split_rows) {
+  PartitionThreadReservation reservation(split_rows.size());
+  std::vector<CompactionPartitionPtr> parts(split_rows.size() + 1);
+  std::vector<String> added_files;
+  std::vector<String> removed_files;
+  int64_t total_index_entries = 0;
+
+  HT_INFOF("Dividing compaction of %s(%s) into %d partitions",
+           m_range_name.c_str(), m_name.c_str(), (int)parts.size());
+
+  try {
 
-    if (running_total >= Global::cellstore_target_size_max) {
-      if (count > (size_t)Global::merge_cellstore_run_length_threshold)
-        return true;
-      count = 0;
-      running_total = 0;
+    {
+      ScopedLock lock(m_mutex);
+      int64_t max_entries =
+        estimate_compaction_entries(m_stores, 0, m_stores.size(),
+                                    m_cell_cache_manager->immutable_items(),
+                                    parts.size());
+
+      for (size_t i=0; i<parts.size(); i++) {
+        CompactionPartition *part = new CompactionPartition();
+        parts[i] = part;
+        part->scan_spec.add_row_interval(i == 0 ? "" : split_rows[i-1].c_str(), i == 0,
+                                         i == split_rows.size() ? "" : split_rows[i].c_str(), true);
+        part->scan_context = new ScanContext(TIMESTAMP_MAX, &part->scan_spec.get(),
+                                             0, m_schema);
+        part->mscanner = new MergeScannerAccessGroup(m_table_name, part->scan_context,
+                                                     false, true);
+        part->scanner = part->mscanner;
+        m_cell_cache_manager->add_immutable_scanner(part->mscanner, part->scan_context);
+        for (size_t j=0; j<m_stores.size(); j++) {
+          HT_ASSERT(m_stores[j].cs);
+          part->mscanner->add_scanner(m_stores[j].cs->create_scanner(part->scan_context));
+        }
+        part->max_entries = max_entries;
+        part->filename = format("%s/tables/%s/%s/%s/cs%d",
+                                Global::toplevel_dir.c_str(),
+                                m_identifier.id, m_name.c_str(),
+                                m_range_dir.c_str(),
+                                m_next_cs_id++);
+        part->cellstore = new CellStoreV7(Global::dfs.get(), m_schema.get());
+      }
     }
-    else if (running_total >= Global::cellstore_target_size_min &&
-             count > 1) {
-      return true;
+
+    // First partition runs on this thread, the rest on their own
+    {
+      std::vector<Thread *> threads;
+      for (size_t i=1; i<parts.size(); i++)
+        threads.push_back(new Thread(boost::bind(&AccessGroup::write_compaction_partition,
+                                                 this, parts[i].get(), major,
+                                                 maintenance_flags)));
+      write_compaction_partition(parts[0].get(), major, maintenance_flags);
+      for (size_t i=0; i<threads.size(); i++) {
+        threads[i]->join();
+        delete threads[i];
+      }
     }
-    i++;
-  } while (i < (int)m_stores.size());
 
-  if (count > (size_t)Global::merge_cellstore_run_length_threshold)
-    return true;
+    for (size_t i=0; i<parts.size(); i++) {
+      if (parts[i]->error != Error::OK) {
+        for (size_t j=0; j<parts.size(); j++) {
+          try {
+            if (Global::dfs->exists(parts[j]->filename))
+              Global::dfs->remove(parts[j]->filename);
+          }
+          catch (Hypertable::Exception &e) {
+            HT_ERROR_OUT << "Problem removing '" << parts[j]->filename << "' "
+                         << e << HT_END;
+          }
+        }
+        HT_THROW(parts[i]->error, parts[i]->error_msg);
+      }
+    }
 
-  return false;
+    /**
+     * Install the new CellStores and update Live file tracker
+     */
+    {
+      ScopedLock lock(m_mutex);
+      uint64_t input_bytes = 0, output_bytes = 0;
+      int64_t revision;
+
+      for (size_t i=0; i<parts.size(); i++) {
+        uint64_t part_input, part_output;
+        parts[i]->mscanner->get_io_accounting_data(&part_input, &part_output);
+        input_bytes += part_input;
+        output_bytes += part_output;
+      }
+      m_garbage_tracker.set_garbage_stats(input_bytes, output_bytes);
+      m_garbage_tracker.clear();
+
+      for (size_t i=0; i<parts.size(); i++) {
+        revision = boost::any_cast<int64_t>
+          (parts[i]->cellstore->get_trailer()->get("revision"));
+        if (i == 0 || revision > m_latest_stored_revision)
+          m_latest_stored_revision = revision;
+      }
+      if (m_latest_stored_revision >= m_earliest_cached_revision)
+        HT_ERROR("Revision (clock) skew detected! May result in data loss.");
+
+      m_cell_cache_manager->drop_immutable_cache();
+
+      for (size_t i=0; i<m_stores.size(); i++)
+        removed_files.push_back(m_stores[i].cs->get_filename());
+      m_stores.clear();
+
+      CellCachePtr no_shadow_cache;
+      for (size_t i=0; i<parts.size(); i++) {
+        if (parts[i]->cellstore->get_total_entries() > 0) {
+          m_stores.push_back( CellStoreInfo(parts[i]->cellstore, no_shadow_cache,
+                                            m_earliest_cached_revision_saved) );
+          m_garbage_tracker.accumulate_expirable( m_stores.back().expirable_data );
+          added_files.push_back(parts[i]->cellstore->get_filename());
+        }
+        else {
+          try {
+            Global::dfs->remove(parts[i]->filename);
+          }
+          catch (Hypertable::Exception &e) {
+            HT_ERROR_OUT << "Problem removing '" << parts[i]->filename << "' "
+                         << e << HT_END;
+          }
+        }
+      }
+      m_needs_merging = needs_merging();
+
+      recompute_compression_ratio(&total_index_entries);
+    }
+
+    m_file_tracker.update_live(added_files, removed_files, m_next_cs_id, total_index_entries);
+    m_file_tracker.update_files_column();
+
+    m_earliest_cached_revision_saved = TIMESTAMP_MAX;
+
+    HT_INFOF("Finished Compaction of %s(%s) to %d partitions", m_range_name.c_str(),
+             m_name.c_str(), (int)added_files.size());
+
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << m_range_name << "(" << m_name << ") " << e << HT_END;
+    throw;
+  }
+}
+
+
+/**
+ * Writes one partition of a partitioned compaction.  Errors are recorded
+ * in the partition so that the caller can clean up after all partitions
+ * have finished.
+ */
+void AccessGroup::write_compaction_partition(CompactionPartition *part,
+                                             bool major, int maintenance_flags) {
+  ByteString value;
+  Key key;
+  MaintenanceThrottle::TaskType throttle_type =
+    major ? MaintenanceThrottle::MAJOR_COMPACTION : MaintenanceThrottle::GC_COMPACTION;
+  bool throttle_urgent = m_identifier.is_system();
+  int64_t throttle_written = 0;
+  uint64_t throttle_read = 0;
+
+  try {
+    part->cellstore->create(part->filename.c_str(), part->max_entries,
+                            m_cellstore_props, &m_identifier);
+
+    while (part->scanner->get(key, value)) {
+      part->cellstore->add(key, value);
+      throttle_written += key.length + value.length();
+      if (throttle_written >= MaintenanceThrottle::CHARGE_BYTES)
+        charge_throttle(throttle_type, throttle_urgent, part->mscanner,
+                        &throttle_read, &throttle_written);
+      part->scanner->forward();
+    }
+    charge_throttle(throttle_type, throttle_urgent, part->mscanner,
+                    &throttle_read, &throttle_written);
+
+    CellStoreTrailerV7 *trailer = dynamic_cast<CellStoreTrailerV7 *>(part->cellstore->get_trailer());
+
+    if (major)
+      trailer->flags |= CellStoreTrailerV7::MAJOR_COMPACTION;
+
+    if (maintenance_flags & MaintenanceFlag::SPLIT)
+      trailer->flags |= CellStoreTrailerV7::SPLIT;
+
+    part->cellstore->finalize(&m_identifier);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << m_full_name << " partition " << part->filename << " - "
+                 << e << HT_END;
+    part->error = e.code();
+    part->error_msg = e.what();
+  }
 }
 
 namespace {
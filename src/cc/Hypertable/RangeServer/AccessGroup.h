@@ -43,14 +43,18 @@
 #include "AccessGroupGarbageTracker.h"
 #include "CellCacheManager.h"
 #include "CellStore.h"
-#include "CellStoreTrailerV6.h"
+#include "CellStoreTrailerV7.h"
 #include "CellStoreInfo.h"
+#include "CompactionPolicy.h"
 #include "LiveFileTracker.h"
 #include "MaintenanceFlag.h"
+#include "MaintenanceThrottle.h"
 
 
 namespace Hypertable {
 
+  class MergeScanner;
+
   class AccessGroup : public CellList {
 
   public:
@@ -139,10 +143,31 @@ namespace Hypertable {
     void space_usage(int64_t *memp, int64_t *diskp);
     void add_cell_store(CellStorePtr &cellstore);
 
+    void adopt_cellstores(const std::vector<String> &files,
+                          int64_t max_revision);
+
     void compute_garbage_stats(uint64_t *input_bytesp, uint64_t *output_bytesp);
 
     void run_compaction(int maintenance_flags);
 
+    /**
+     * Estimates the number of entries each CellStore written by a compaction
+     * will hold, which sizes its bloom filter.  A compaction that is divided
+     * into partitions writes one CellStore per partition.
+     *
+     * @param stores CellStores of the access group
+     * @param offset index of the first CellStore being compacted
+     * @param length number of CellStores being compacted
+     * @param cached_items number of items in the immutable cache being
+     *        compacted along with the CellStores
+     * @param partitions number of CellStores the output is divided into
+     * @return estimated entries per output CellStore
+     */
+    static int64_t estimate_compaction_entries(const std::vector<CellStoreInfo> &stores,
+                                               size_t offset, size_t length,
+                                               int64_t cached_items,
+                                               size_t partitions=1);
+
     uint64_t purge_memory(MaintenanceFlag::Map &subtask_map);
 
     MaintenanceData *get_maintenance_data(ByteArena &arena, time_t now);
@@ -187,6 +212,22 @@ namespace Hypertable {
     bool find_merge_run(size_t *indexp=0, size_t *lenp=0);
     bool needs_merging();
     void sort_cellstores_by_timestamp();
+    void create_compaction_policy(Schema::AccessGroup *ag);
+    void compute_store_ttl(Schema::AccessGroup *ag);
+    bool cellstore_expired(CellStoreInfo &csi, int64_t now);
+    bool drop_expired_cellstores();
+    void charge_throttle(MaintenanceThrottle::TaskType type, bool urgent,
+                         MergeScanner *mscanner, uint64_t *readp,
+                         int64_t *writtenp);
+    void get_store_info(std::vector<CompactionPolicy::StoreInfo> &stores);
+
+    struct CompactionPartition;
+    typedef boost::intrusive_ptr<CompactionPartition> CompactionPartitionPtr;
+    void plan_compaction_partitions(std::vector<String> &split_rows);
+    void run_partitioned_compaction(int maintenance_flags, bool major,
+                                    std::vector<String> &split_rows);
+    void write_compaction_partition(CompactionPartition *part, bool major,
+                                    int maintenance_flags);
 
     Mutex                m_mutex;
     Mutex                m_outstanding_scanner_mutex;
@@ -203,6 +244,8 @@ namespace Hypertable {
     String               m_range_name;
     std::vector<CellStoreInfo> m_stores;
     PropertiesPtr        m_cellstore_props;
+    CompactionPolicyPtr  m_compaction_policy;
+    int64_t              m_store_ttl;
     CellCacheManagerPtr  m_cell_cache_manager;
     uint32_t             m_next_cs_id;
     uint64_t             m_disk_usage;
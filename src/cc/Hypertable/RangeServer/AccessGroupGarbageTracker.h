@@ -39,6 +39,20 @@ namespace Hypertable {
     void accumulate_data(int64_t amount) { m_data_accumulated += amount; }
     void accumulate_expirable(int64_t amount) { m_expirable_accumulated += amount; }
 
+    /**
+     * Removes expirable data that was discarded without a compaction,
+     * e.g. when expired CellStores are dropped whole
+     *
+     * @param amount amount of expirable data removed
+     */
+    void remove_expirable(int64_t amount) {
+      m_expirable_accumulated -= amount;
+      if (m_expirable_accumulated < 0)
+        m_expirable_accumulated = 0;
+    }
+
+    int64_t expirable_accumulated() { return m_expirable_accumulated; }
+
     /**
      * Determines if there is likelihood of needed garbage collection
      *
@@ -31,6 +31,8 @@ const char CellStore::INDEX_FIXED_BLOCK_MAGIC[10]    =
     { 'I','d','x','F','i','x','-','-','-','-' };
 const char CellStore::INDEX_VARIABLE_BLOCK_MAGIC[10] =
     { 'I','d','x','V','a','r','-','-','-','-' };
+const char CellStore::INDEX_PARTITION_BLOCK_MAGIC[10] =
+    { 'I','d','x','P','a','r','t','-','-','-' };
 
 KeyDecompressor *CellStore::create_key_decompressor() {
   return new KeyDecompressorNone();
@@ -63,6 +63,20 @@ namespace Hypertable {
 
     virtual const char *get_split_row() = 0;
 
+    /**
+     * Samples the block index for rows that divide this CellStore into
+     * <code>count</code> pieces of roughly equal on-disk size.  Rows that
+     * fall outside the range, and duplicates, are omitted, so fewer than
+     * <code>count-1</code> rows may be returned.  Formats that cannot
+     * sample their index return no rows.
+     *
+     * @param count number of pieces to divide the CellStore into
+     * @param rows vector to hold the dividing rows, in ascending order
+     */
+    virtual void get_partition_rows(size_t count, std::vector<String> &rows) {
+      rows.clear();
+    }
+
     virtual int64_t get_total_entries() = 0;
 
     virtual CellListScanner *
@@ -278,6 +292,7 @@ namespace Hypertable {
     static const char DATA_BLOCK_MAGIC[10];
     static const char INDEX_FIXED_BLOCK_MAGIC[10];
     static const char INDEX_VARIABLE_BLOCK_MAGIC[10];
+    static const char INDEX_PARTITION_BLOCK_MAGIC[10];
 
     uint64_t m_bytes_read;
     IndexMemoryStats m_index_stats;
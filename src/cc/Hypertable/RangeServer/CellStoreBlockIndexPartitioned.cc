@@ -0,0 +1,325 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+
+#include "Hypertable/Lib/BlockCompressionHeader.h"
+
+#include "CellStore.h"
+#include "CellStoreBlockIndexPartitioned.h"
+#include "Global.h"
+
+using namespace Hypertable;
+
+
+CellStoreBlockIndexPartition::CellStoreBlockIndexPartition(int file_id,
+    uint32_t file_offset, uint8_t *base, uint32_t length, bool cached)
+  : m_file_id(file_id), m_file_offset(file_offset), m_base(base),
+    m_cached(cached) {
+  const uint8_t *ptr = m_base;
+  size_t remaining = length;
+  m_count = Serialization::decode_i32(&ptr, &remaining);
+  if (remaining < m_count * 12)
+    HT_THROWF(Error::RANGESERVER_CORRUPT_CELLSTORE, "Index partition at "
+              "offset %u too short for %llu entries", (unsigned)file_offset,
+              (Llu)m_count);
+  m_offsets = ptr;
+  m_key_positions = ptr + 8*m_count;
+}
+
+
+CellStoreBlockIndexPartition::~CellStoreBlockIndexPartition() {
+  if (m_cached)
+    Global::block_cache->checkin(m_file_id, m_file_offset);
+  else
+    delete [] m_base;
+}
+
+
+size_t CellStoreBlockIndexPartition::lower_bound(const SerializedKey &k) const {
+  size_t lo = 0, hi = m_count, mid;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (key(mid) < k)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+
+size_t CellStoreBlockIndexPartition::upper_bound(const SerializedKey &k) const {
+  size_t lo = 0, hi = m_count, mid;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (k < key(mid))
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return lo;
+}
+
+
+void CellStoreBlockIndexPartition::serialize(std::vector<int64_t> &offsets,
+                                             DynamicBuffer &keys,
+                                             DynamicBuffer &buf) {
+  size_t count = offsets.size();
+  uint32_t header_len = 4 + 12*count;
+  SerializedKey key;
+
+  buf.clear();
+  buf.ensure(header_len + keys.fill());
+  Serialization::encode_i32(&buf.ptr, (uint32_t)count);
+  for (size_t i=0; i<count; i++) {
+    memcpy(buf.ptr, &offsets[i], 8);
+    buf.ptr += 8;
+  }
+  key.ptr = keys.base;
+  for (size_t i=0; i<count; i++) {
+    uint32_t pos = header_len + (key.ptr - keys.base);
+    memcpy(buf.ptr, &pos, 4);
+    buf.ptr += 4;
+    key.ptr += key.length();
+  }
+  buf.add_unchecked(keys.base, keys.fill());
+}
+
+
+CellStoreBlockIndexIteratorPartitioned &
+CellStoreBlockIndexIteratorPartitioned::operator++() {
+  if (++m_pos == m_partition_ptr->size()) {
+    m_pos = 0;
+    if (++m_partition < m_index->partition_count())
+      m_partition_ptr = m_index->load_partition(m_partition);
+    else
+      m_partition_ptr = 0;
+  }
+  return *this;
+}
+
+
+void
+CellStoreBlockIndexPartitioned::load(CellStore *cellstore,
+    DynamicBuffer &fixed, DynamicBuffer &variable, int64_t end_of_partitions,
+    const String &start_row, const String &end_row) {
+  size_t total_entries = fixed.fill() / 8;
+  int64_t next_offset = 0, next_end = 0;
+  bool in_scope = (start_row == "") ? true : false;
+  bool check_for_end_row = end_row != "";
+  const uint8_t *key_ptr;
+  Entry entry;
+
+  assert(variable.own);
+
+  m_cellstore = cellstore;
+  m_partitions.clear();
+  m_keydata = variable;
+  fixed.ptr = fixed.base;
+  key_ptr = m_keydata.base;
+  m_end_of_last_partition = end_of_partitions;
+
+  for (size_t i=0; i<total_entries; i++) {
+    entry.key.ptr = key_ptr;
+    key_ptr += entry.key.length();
+    memcpy(&entry.offset, fixed.ptr, 8);
+    fixed.ptr += 8;
+
+    // partitions are written right after the last data block
+    if (i == 0)
+      m_end_of_data = entry.offset;
+
+    if (!in_scope) {
+      if (strcmp(entry.key.row(), start_row.c_str()) <= 0)
+        continue;
+      in_scope = true;
+    }
+    else if (check_for_end_row && !m_partitions.empty() &&
+             strcmp(m_partitions.back().key.row(), end_row.c_str()) > 0) {
+      m_end_of_last_partition = entry.offset;
+      next_offset = entry.offset;
+      if (i+1 < total_entries)
+        memcpy(&next_end, fixed.ptr, 8);
+      else
+        next_end = end_of_partitions;
+      break;
+    }
+    m_partitions.push_back(entry);
+  }
+
+  HT_ASSERT(key_ptr <= (m_keydata.base + m_keydata.size));
+
+  for (size_t i=0; i<m_partitions.size(); i++)
+    m_partitions[i].end = (i+1 < m_partitions.size())
+      ? m_partitions[i+1].offset : m_end_of_last_partition;
+
+  /**
+   * Blocks are written back to back, so the last block in scope ends where
+   * the first block of the next partition begins
+   */
+  if (next_offset)
+    m_end_of_last_block = load_partition(next_offset, next_end)->offset(0);
+  else
+    m_end_of_last_block = m_end_of_data;
+
+  if (!m_partitions.empty())
+    m_middle_key = m_partitions[m_partitions.size()/2].key;
+}
+
+
+CellStoreBlockIndexPartitionPtr
+CellStoreBlockIndexPartitioned::load_partition(size_t i) {
+  return load_partition(m_partitions[i].offset, m_partitions[i].end);
+}
+
+
+CellStoreBlockIndexPartitionPtr
+CellStoreBlockIndexPartitioned::load_partition(int64_t offset, int64_t end) {
+  int file_id = m_cellstore->get_file_id();
+  uint32_t file_offset = (uint32_t)offset;
+  uint8_t *block;
+  uint32_t length;
+
+  if (Global::block_cache &&
+      Global::block_cache->checkout(file_id, file_offset, &block, &length))
+    return new CellStoreBlockIndexPartition(file_id, file_offset, block,
+                                            length, true);
+
+  BlockCompressionCodecPtr codec = m_cellstore->create_block_compression_codec();
+  BlockCompressionHeader header;
+  DynamicBuffer expand_buf;
+  size_t zlength = end - offset;
+  bool second_try = false;
+  int32_t fd = m_cellstore->get_fd();
+
+ try_again:
+  try {
+    DynamicBuffer buf(zlength);
+    if (second_try)
+      fd = m_cellstore->reopen_fd();
+    Global::dfs->pread(fd, buf.base, zlength, offset, second_try);
+    buf.ptr = buf.base + zlength;
+    codec->inflate(buf, expand_buf, header);
+    if (!header.check_magic(CellStore::INDEX_PARTITION_BLOCK_MAGIC))
+      HT_THROW(Error::BLOCK_COMPRESSOR_BAD_MAGIC,
+               "Bad index partition magic");
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << "Error loading index partition at offset "
+                 << offset << " of " << zlength << " bytes - "
+                 << e << HT_END;
+    if (second_try)
+      throw;
+    second_try = true;
+    goto try_again;
+  }
+
+  length = expand_buf.fill();
+  block = expand_buf.release();
+
+  if (Global::block_cache &&
+      Global::block_cache->insert(file_id, file_offset, block, length, true))
+    return new CellStoreBlockIndexPartition(file_id, file_offset, block,
+                                            length, true);
+
+  return new CellStoreBlockIndexPartition(file_id, file_offset, block,
+                                          length, false);
+}
+
+
+CellStoreBlockIndexPartitioned::iterator
+CellStoreBlockIndexPartitioned::partition_iterator(size_t i, bool upper,
+                                                   const SerializedKey &k) {
+  CellStoreBlockIndexPartitionPtr partition;
+  size_t pos;
+
+  for (; i < m_partitions.size(); i++) {
+    partition = load_partition(i);
+    pos = upper ? partition->upper_bound(k) : partition->lower_bound(k);
+    if (pos < partition->size())
+      return iterator(this, i, partition, pos);
+  }
+  return end();
+}
+
+
+CellStoreBlockIndexPartitioned::iterator
+CellStoreBlockIndexPartitioned::begin() {
+  if (m_partitions.empty())
+    return end();
+  CellStoreBlockIndexPartitionPtr partition = load_partition(0);
+  return iterator(this, 0, partition, 0);
+}
+
+
+CellStoreBlockIndexPartitioned::iterator
+CellStoreBlockIndexPartitioned::end() {
+  CellStoreBlockIndexPartitionPtr null_partition;
+  return iterator(this, m_partitions.size(), null_partition, 0);
+}
+
+
+CellStoreBlockIndexPartitioned::iterator
+CellStoreBlockIndexPartitioned::lower_bound(const SerializedKey& k) {
+  std::vector<Entry>::iterator iter =
+    std::lower_bound(m_partitions.begin(), m_partitions.end(), k, LtEntry());
+  return partition_iterator(iter - m_partitions.begin(), false, k);
+}
+
+
+CellStoreBlockIndexPartitioned::iterator
+CellStoreBlockIndexPartitioned::upper_bound(const SerializedKey& k) {
+  std::vector<Entry>::iterator iter =
+    std::upper_bound(m_partitions.begin(), m_partitions.end(), k, LtEntry());
+  return partition_iterator(iter - m_partitions.begin(), true, k);
+}
+
+
+void CellStoreBlockIndexPartitioned::display() {
+  String last_row;
+  int64_t last_offset = -1;
+  size_t i = 0;
+
+  // keys are only valid while their partition is checked out, so the row
+  // is copied before the iterator moves on
+  for (iterator iter = begin(); iter != end(); ++iter) {
+    if (last_offset >= 0) {
+      std::cout << i << ": offset=" << last_offset << " size="
+                << iter.value() - last_offset << " row=" << last_row << "\n";
+      i++;
+    }
+    last_offset = iter.value();
+    last_row = iter.key().row();
+  }
+  if (last_offset >= 0)
+    std::cout << i << ": offset=" << last_offset << " size="
+              << m_end_of_last_block - last_offset << " row=" << last_row
+              << std::endl;
+  std::cout << "index partitions = " << m_partitions.size() << std::endl;
+}
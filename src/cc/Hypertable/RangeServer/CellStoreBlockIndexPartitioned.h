@@ -0,0 +1,220 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_CELLSTOREBLOCKINDEXPARTITIONED_H
+#define HYPERTABLE_CELLSTOREBLOCKINDEXPARTITIONED_H
+
+#include <vector>
+
+#include <boost/intrusive_ptr.hpp>
+
+#include "Common/DynamicBuffer.h"
+#include "Common/ReferenceCount.h"
+#include "Common/StaticBuffer.h"
+#include "Common/String.h"
+
+#include "Hypertable/Lib/SerializedKey.h"
+
+namespace Hypertable {
+
+  class CellStore;
+
+  /**
+   * One partition of a two-level block index.  A partition holds the
+   * (last key, offset) entries of a run of consecutive data blocks and is
+   * serialized as:
+   *
+   *   entry count (4 bytes) | block offsets (8 bytes each) |
+   *   key positions (4 bytes each) | serialized keys
+   *
+   * The inflated partition lives in the FileBlockCache while it is checked
+   * out, so unused partitions are evicted along with the data blocks.
+   */
+  class CellStoreBlockIndexPartition : public ReferenceCount {
+  public:
+    CellStoreBlockIndexPartition(int file_id, uint32_t file_offset,
+                                 uint8_t *base, uint32_t length, bool cached);
+    virtual ~CellStoreBlockIndexPartition();
+
+    size_t size() const { return m_count; }
+
+    SerializedKey key(size_t i) const {
+      uint32_t pos;
+      memcpy(&pos, m_key_positions + 4*i, 4);
+      return SerializedKey(m_base + pos);
+    }
+
+    int64_t offset(size_t i) const {
+      int64_t offset;
+      memcpy(&offset, m_offsets + 8*i, 8);
+      return offset;
+    }
+
+    size_t lower_bound(const SerializedKey &k) const;
+    size_t upper_bound(const SerializedKey &k) const;
+
+    /**
+     * Serializes a partition from the block offsets and the concatenated
+     * serialized keys of its entries
+     */
+    static void serialize(std::vector<int64_t> &offsets,
+                          DynamicBuffer &keys, DynamicBuffer &buf);
+
+  private:
+    int m_file_id;
+    uint32_t m_file_offset;
+    uint8_t *m_base;
+    bool m_cached;
+    size_t m_count;
+    const uint8_t *m_offsets;
+    const uint8_t *m_key_positions;
+  };
+
+  typedef boost::intrusive_ptr<CellStoreBlockIndexPartition>
+          CellStoreBlockIndexPartitionPtr;
+
+  class CellStoreBlockIndexPartitioned;
+
+  /**
+   * Provides an STL-style iterator on CellStoreBlockIndexPartitioned
+   * objects.  The iterator keeps its partition checked out, so the keys it
+   * returns stay valid for as long as it points into that partition.
+   */
+  class CellStoreBlockIndexIteratorPartitioned {
+  public:
+    CellStoreBlockIndexIteratorPartitioned() : m_index(0), m_partition(0),
+                                               m_pos(0) { }
+    CellStoreBlockIndexIteratorPartitioned(CellStoreBlockIndexPartitioned *index,
+        size_t partition, CellStoreBlockIndexPartitionPtr &partition_ptr,
+        size_t pos) : m_index(index), m_partition(partition),
+                      m_partition_ptr(partition_ptr), m_pos(pos) { }
+    SerializedKey key() { return m_partition_ptr->key(m_pos); }
+    int64_t value() { return m_partition_ptr->offset(m_pos); }
+    CellStoreBlockIndexIteratorPartitioned &operator++();
+    CellStoreBlockIndexIteratorPartitioned operator++(int) {
+      CellStoreBlockIndexIteratorPartitioned copy(*this);
+      ++(*this);
+      return copy;
+    }
+    bool operator==(const CellStoreBlockIndexIteratorPartitioned &other) {
+      return m_partition == other.m_partition && m_pos == other.m_pos;
+    }
+    bool operator!=(const CellStoreBlockIndexIteratorPartitioned &other) {
+      return !(*this == other);
+    }
+  protected:
+    CellStoreBlockIndexPartitioned *m_index;
+    size_t m_partition;
+    CellStoreBlockIndexPartitionPtr m_partition_ptr;
+    size_t m_pos;
+  };
+
+  /**
+   * Two-level block index.  Only the top level, which maps the last key of
+   * each partition to the partition's file offset, is kept in memory; the
+   * partitions themselves are read on demand through the FileBlockCache.
+   * Provides the same interface as CellStoreBlockIndexArray so that it can
+   * be plugged into the cell store scanners.
+   */
+  class CellStoreBlockIndexPartitioned {
+  public:
+    typedef CellStoreBlockIndexIteratorPartitioned iterator;
+
+    CellStoreBlockIndexPartitioned() : m_cellstore(0), m_end_of_data(0),
+        m_end_of_last_block(0), m_end_of_last_partition(0) { }
+
+    /**
+     * Loads the top level index.  When the index is restricted to an end
+     * row, the partition following the last one in scope is read to
+     * determine where the last block in scope ends.
+     *
+     * @param cellstore cell store the partitions are read from
+     * @param fixed partition offsets (8 bytes each)
+     * @param variable last key of each partition
+     * @param end_of_partitions file offset following the last partition
+     * @param start_row start row of the range using the cell store
+     * @param end_row end row of the range using the cell store
+     */
+    void load(CellStore *cellstore, DynamicBuffer &fixed,
+              DynamicBuffer &variable, int64_t end_of_partitions,
+              const String &start_row="", const String &end_row="");
+
+    CellStoreBlockIndexPartitionPtr load_partition(size_t i);
+
+    size_t partition_count() { return m_partitions.size(); }
+
+    /** Returns the last key of partition i */
+    SerializedKey partition_key(size_t i) { return m_partitions[i].key; }
+
+    void display();
+
+    const SerializedKey middle_key() { return m_middle_key; }
+
+    size_t memory_used() {
+      return m_keydata.size + (m_partitions.capacity() * sizeof(Entry));
+    }
+
+    int64_t end_of_last_block() { return m_end_of_last_block; }
+
+    iterator begin();
+    iterator end();
+    iterator lower_bound(const SerializedKey& k);
+    iterator upper_bound(const SerializedKey& k);
+
+    void clear() {
+      m_partitions.clear();
+      m_keydata.free();
+      m_middle_key.ptr = 0;
+    }
+
+  private:
+    struct Entry {
+      SerializedKey key;
+      int64_t offset;
+      int64_t end;
+    };
+
+    struct LtEntry {
+      bool operator()(const Entry &x, const SerializedKey &k) const {
+        return x.key < k;
+      }
+      bool operator()(const SerializedKey &k, const Entry &x) const {
+        return k < x.key;
+      }
+    };
+
+    iterator partition_iterator(size_t i, bool upper, const SerializedKey &k);
+
+    CellStoreBlockIndexPartitionPtr load_partition(int64_t offset,
+                                                   int64_t end);
+
+    CellStore *m_cellstore;
+    std::vector<Entry> m_partitions;
+    StaticBuffer m_keydata;
+    SerializedKey m_middle_key;
+    int64_t m_end_of_data;
+    int64_t m_end_of_last_block;
+    int64_t m_end_of_last_partition;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_CELLSTOREBLOCKINDEXPARTITIONED_H
@@ -28,6 +28,7 @@
 #include "Hypertable/Lib/BlockCompressionHeader.h"
 #include "Global.h"
 #include "CellStoreBlockIndexArray.h"
+#include "CellStoreBlockIndexPartitioned.h"
 #include "CellStoreScanner.h"
 
 #include "CellStoreScannerInterval.h"
@@ -203,3 +204,4 @@ void CellStoreScanner<IndexT>::forward() {
 
 template class CellStoreScanner<CellStoreBlockIndexArray<uint32_t> >;
 template class CellStoreScanner<CellStoreBlockIndexArray<int64_t> >;
+template class CellStoreScanner<CellStoreBlockIndexPartitioned>;
@@ -28,6 +28,7 @@
 #include "Hypertable/Lib/BlockCompressionHeader.h"
 #include "Global.h"
 #include "CellStoreBlockIndexArray.h"
+#include "CellStoreBlockIndexPartitioned.h"
 
 #include "CellStoreScannerIntervalBlockIndex.h"
 
@@ -59,6 +60,9 @@ CellStoreScannerIntervalBlockIndex<IndexT>::CellStoreScannerIntervalBlockIndex(C
 
   if (m_start_key) {
     const uint8_t *ptr;
+    if (m_key_decompressor->less_than(m_start_key) &&
+        (ptr = m_key_decompressor->seek(m_start_key)) != 0)
+      m_cur_value.ptr = ptr;
     while (m_key_decompressor->less_than(m_start_key)) {
       ptr = m_cur_value.ptr + m_cur_value.length();
       if (ptr >= m_block.end) {
@@ -295,8 +299,7 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
     else
       m_cached = true;
 
-    m_key_decompressor->reset();
-    m_block.end = m_block.base + len;
+    m_block.end = m_key_decompressor->load_block(m_block.base, len);
     m_cur_value.ptr = m_key_decompressor->add(m_block.base);
 
     return true;
@@ -307,3 +310,4 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
 
 template class CellStoreScannerIntervalBlockIndex<CellStoreBlockIndexArray<uint32_t> >;
 template class CellStoreScannerIntervalBlockIndex<CellStoreBlockIndexArray<int64_t> >;
+template class CellStoreScannerIntervalBlockIndex<CellStoreBlockIndexPartitioned>;
@@ -29,6 +29,7 @@
 #include "Hypertable/Lib/BlockCompressionHeader.h"
 #include "Global.h"
 #include "CellStoreBlockIndexArray.h"
+#include "CellStoreBlockIndexPartitioned.h"
 
 #include "CellStoreScannerIntervalReadahead.h"
 
@@ -109,6 +110,9 @@ CellStoreScannerIntervalReadahead<IndexT>::CellStoreScannerIntervalReadahead(Cel
 
   if (start_key) {
     const uint8_t *ptr;
+    if (m_key_decompressor->less_than(start_key) &&
+        (ptr = m_key_decompressor->seek(start_key)) != 0)
+      m_cur_value.ptr = ptr;
     while (m_key_decompressor->less_than(start_key)) {
       ptr = m_cur_value.ptr + m_cur_value.length();
       if (ptr >= m_block.end) {
@@ -295,8 +299,7 @@ bool CellStoreScannerIntervalReadahead<IndexT>::fetch_next_block_readahead(bool
     m_block.base = expand_buf.release(&fill);
     len = fill;
 
-    m_key_decompressor->reset();
-    m_block.end = m_block.base + len;
+    m_block.end = m_key_decompressor->load_block(m_block.base, len);
     m_cur_value.ptr = m_key_decompressor->add(m_block.base);
 
     return true;
@@ -306,3 +309,4 @@ bool CellStoreScannerIntervalReadahead<IndexT>::fetch_next_block_readahead(bool
 
 template class CellStoreScannerIntervalReadahead<CellStoreBlockIndexArray<uint32_t> >;
 template class CellStoreScannerIntervalReadahead<CellStoreBlockIndexArray<int64_t> >;
+template class CellStoreScannerIntervalReadahead<CellStoreBlockIndexPartitioned>;
@@ -213,6 +213,10 @@ void CellStoreTrailerV6::display(std::ostream &os) {
     os << " 64BIT_INDEX";
   if (flags & MAJOR_COMPACTION)
     os << " MAJOR_COMPACTION";
+  if (flags & SPLIT)
+    os << " SPLIT";
+  if (flags & EXACT_TIMESTAMPS)
+    os << " EXACT_TIMESTAMPS";
   os << " )";
   os << ", alignment=" << alignment;
   os << ", compression_ratio=" << compression_ratio;
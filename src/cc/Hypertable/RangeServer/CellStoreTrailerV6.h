@@ -77,7 +77,8 @@ namespace Hypertable {
 
     enum Flags { INDEX_64BIT = 1,
                  MAJOR_COMPACTION = 2,
-                 SPLIT = 4
+                 SPLIT = 4,
+                 EXACT_TIMESTAMPS = 8
     };
 
     boost::any get(const String& prop) {
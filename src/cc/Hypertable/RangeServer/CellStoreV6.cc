@@ -109,6 +109,53 @@ const char *CellStoreV6::get_split_row() {
   return 0;
 }
 
+namespace {
+
+  /**
+   * Walks the block index and records the row of the first block at or
+   * beyond each 1/count-th of the data.
+   */
+  template <typename IndexT>
+  void sample_index_rows(IndexT &index, int64_t end_of_data, size_t count,
+                         const String &start_row, const String &end_row,
+                         std::vector<String> &rows) {
+    typename IndexT::iterator iter = index.begin();
+    if (iter == index.end())
+      return;
+    int64_t first_offset = iter.value();
+    int64_t data_size = end_of_data - first_offset;
+    size_t next = 1;
+    String row;
+    for (; iter != index.end() && next < count; ++iter) {
+      if (iter.value() - first_offset < (data_size * (int64_t)next) / (int64_t)count)
+        continue;
+      row = iter.key().row();
+      if (row > start_row && row < end_row &&
+          (rows.empty() || row > rows.back()))
+        rows.push_back(row);
+      while (next < count &&
+             iter.value() - first_offset >= (data_size * (int64_t)next) / (int64_t)count)
+        next++;
+    }
+  }
+
+}
+
+void CellStoreV6::get_partition_rows(size_t count, std::vector<String> &rows) {
+  rows.clear();
+  if (count < 2)
+    return;
+  m_index_stats.block_index_access_counter = ++Global::access_counter;
+  if (m_index_stats.block_index_memory == 0)
+    load_block_index();
+  if (m_64bit_index)
+    sample_index_rows(m_index_map64, m_trailer.fix_index_offset, count,
+                      m_start_row, m_end_row, rows);
+  else
+    sample_index_rows(m_index_map32, m_trailer.fix_index_offset, count,
+                      m_start_row, m_end_row, rows);
+}
+
 CellListScanner *CellStoreV6::create_scanner(ScanContextPtr &scan_ctx) {
   bool need_index =  m_restricted_range || scan_ctx->restricted_range || scan_ctx->single_row;
 
@@ -402,7 +449,7 @@ void CellStoreV6::add(const Key &key, const ByteString value) {
   if (key.timestamp != TIMESTAMP_NULL) {
     if (key.timestamp < m_trailer.timestamp_min)
       m_trailer.timestamp_min = key.timestamp;
-    else if (key.timestamp > m_trailer.timestamp_max)
+    if (key.timestamp > m_trailer.timestamp_max)
       m_trailer.timestamp_max = key.timestamp;
   }
 
@@ -695,6 +742,12 @@ void CellStoreV6::finalize(TableIdentifier *table_identifier) {
   // deallocate fix index data
   m_index_builder.release_fixed_buf();
 
+  /**
+   * Older stores could under-report timestamp_max, so whole-store TTL
+   * expiry only trusts it when this flag is set
+   */
+  m_trailer.flags |= CellStoreTrailerV6::EXACT_TIMESTAMPS;
+
   // Add table information
   m_trailer.table_id = table_identifier->index();
   m_trailer.table_generation = table_identifier->generation;
@@ -0,0 +1,348 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Logger.h"
+#include "Common/Properties.h"
+
+#include "Hypertable/Lib/Schema.h"
+
+#include "CompactionPolicy.h"
+
+using namespace Hypertable;
+
+
+CompactionPolicy *
+CompactionPolicy::create(const String &spec, const Settings &settings) {
+
+  if (spec.empty())
+    return new CompactionPolicyDefault(settings);
+
+  PropertiesPtr props = new Properties();
+  Schema::parse_compaction_policy(spec, props);
+
+  String type = props->get_str("compaction-policy-type");
+
+  if (type == "size-tiered")
+    return new CompactionPolicySizeTiered(settings,
+                                          props->get_i32("min-threshold"),
+                                          props->get_i32("max-threshold"),
+                                          props->get_f64("bucket-low"),
+                                          props->get_f64("bucket-high"));
+  else if (type == "leveled")
+    return new CompactionPolicyLeveled(settings, props->get_i32("fanout"));
+  else if (type == "time-window")
+    return new CompactionPolicyTimeWindow(settings, props->get_i32("window"),
+                                          props->get_i32("min-threshold"),
+                                          props->get_i32("max-threshold"));
+
+  HT_ASSERT(type == "default");
+  return new CompactionPolicyDefault(settings);
+}
+
+
+bool
+CompactionPolicyDefault::find_merge_run(const std::vector<StoreInfo> &stores,
+                                        size_t *indexp, size_t *lenp) {
+  size_t index = 0;
+  size_t count = 0;
+  size_t i = 0;
+  int64_t running_total = 0;
+
+  if (stores.empty())
+    return false;
+
+  do {
+    count++;
+    running_total += stores[i].disk_usage;
+
+    if (running_total >= m_settings.target_size_max) {
+      if (count > (size_t)m_settings.run_length_threshold) {
+        if (indexp)
+          *indexp = index;
+        if (lenp)
+           *lenp = count-1;
+        return true;
+      }
+      index = i+1;
+      count = 0;
+      running_total = 0;
+    }
+    else if (running_total >= m_settings.target_size_min &&
+             count > 1) {
+      if (indexp)
+        *indexp = index;
+      if (lenp)
+        *lenp = count;
+      return true;
+    }
+    i++;
+  } while (i < stores.size());
+
+  if (count > (size_t)m_settings.run_length_threshold) {
+    if (indexp)
+      *indexp = index;
+    if (lenp)
+      *lenp = count;
+    return true;
+  }
+
+  return false;
+}
+
+
+bool
+CompactionPolicyDefault::needs_merging(const std::vector<StoreInfo> &stores) {
+  size_t count = 0;
+  int i = 0;
+  int64_t running_total = 0;
+
+  if (stores.empty())
+    return false;
+
+  for (i = stores.size()-1; i>=0; i--) {
+    count++;
+    running_total += stores[i].disk_usage;
+    if (running_total >= m_settings.target_size_max)
+      break;
+    else if (running_total >= m_settings.target_size_min &&
+             (stores.size() - i) > 1)
+      return true;
+  }
+
+  if (i < 0 && count > (size_t)m_settings.run_length_threshold)
+    return true;
+
+  /** Search from the beginning **/
+
+  i = 0;
+  count = 0;
+  running_total = 0;
+  do {
+    count++;
+    running_total += stores[i].disk_usage;
+
+    if (running_total >= m_settings.target_size_max) {
+      if (count > (size_t)m_settings.run_length_threshold)
+        return true;
+      count = 0;
+      running_total = 0;
+    }
+    else if (running_total >= m_settings.target_size_min &&
+             count > 1) {
+      return true;
+    }
+    i++;
+  } while (i < (int)stores.size());
+
+  if (count > (size_t)m_settings.run_length_threshold)
+    return true;
+
+  return false;
+}
+
+
+namespace {
+
+  /**
+   * Returns true if a store of <i>size</i> bytes belongs to a tier of
+   * <i>count</i> stores totalling <i>total</i> bytes
+   */
+  bool in_size_tier(int64_t size, int64_t total, size_t count,
+                    int64_t target_size_min, double low, double high) {
+    double average = (double)total / (double)count;
+
+    // Everything below the target minimum lands in the lowest tier
+    if (size < target_size_min && average < (double)target_size_min)
+      return true;
+
+    return (double)size >= low * average && (double)size <= high * average;
+  }
+
+}
+
+
+bool CompactionPolicySizeTiered::in_tier(int64_t size, int64_t total,
+                                         size_t count) {
+  return in_size_tier(size, total, count, m_settings.target_size_min,
+                      m_bucket_low, m_bucket_high);
+}
+
+
+bool
+CompactionPolicySizeTiered::find_merge_run(const std::vector<StoreInfo> &stores,
+                                           size_t *indexp, size_t *lenp) {
+  size_t best_index = 0, best_count = 0;
+  double best_average = 0.0;
+  size_t start = 0, count = 0;
+  int64_t total = 0;
+
+  for (size_t i=0; i<=stores.size(); i++) {
+
+    if (i < stores.size() && count &&
+        in_tier(stores[i].disk_usage, total, count)) {
+      count++;
+      total += stores[i].disk_usage;
+      continue;
+    }
+
+    // Close the current tier and remember it if it is the cheapest to merge
+    if (count >= (size_t)m_min_threshold) {
+      double average = (double)total / (double)count;
+      if (best_count == 0 || average < best_average) {
+        best_index = start;
+        best_count = count;
+        best_average = average;
+      }
+    }
+
+    if (i < stores.size()) {
+      start = i;
+      count = 1;
+      total = stores[i].disk_usage;
+    }
+  }
+
+  if (best_count == 0)
+    return false;
+
+  if (indexp)
+    *indexp = best_index;
+  if (lenp)
+    *lenp = std::min(best_count, (size_t)m_max_threshold);
+  return true;
+}
+
+
+bool
+CompactionPolicyLeveled::find_merge_run(const std::vector<StoreInfo> &stores,
+                                        size_t *indexp, size_t *lenp) {
+  size_t level0 = stores.size();
+  int64_t total = 0;
+
+  if (stores.size() < 2)
+    return false;
+
+  // Level 0 is the run of newest stores below the target minimum size
+  while (level0 > 0 &&
+         stores[level0-1].disk_usage < m_settings.target_size_min) {
+    level0--;
+    total += stores[level0].disk_usage;
+  }
+
+  size_t level0_count = stores.size() - level0;
+  if (level0_count > 1 &&
+      (total >= m_settings.target_size_min ||
+       level0_count > (size_t)m_settings.run_length_threshold)) {
+    if (indexp)
+      *indexp = level0;
+    if (lenp)
+      *lenp = level0_count;
+    return true;
+  }
+
+  /**
+   * Find the newest pair of levels that violates the fanout and carry the
+   * merge down into older levels that would be violated by the result
+   */
+  size_t levels = (level0_count > 1) ? level0 : stores.size();
+  if (levels < 2)
+    return false;
+
+  for (size_t i=levels-1; i>0; i--) {
+    if (stores[i-1].disk_usage < (int64_t)m_fanout * stores[i].disk_usage) {
+      size_t start = i-1;
+      total = stores[i-1].disk_usage + stores[i].disk_usage;
+      while (start > 0 &&
+             stores[start-1].disk_usage < (int64_t)m_fanout * total) {
+        start--;
+        total += stores[start].disk_usage;
+      }
+      if (indexp)
+        *indexp = start;
+      if (lenp)
+        *lenp = (i+1) - start;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+bool
+CompactionPolicyTimeWindow::find_merge_run(const std::vector<StoreInfo> &stores,
+                                           size_t *indexp, size_t *lenp) {
+  bool have_current = false;
+  int64_t current = 0;
+  int64_t window = 0;
+  int64_t total = 0;
+  size_t start = 0, count = 0;
+
+  // Stores without any timestamped cells report timestamp_max < timestamp_min
+  foreach(const StoreInfo &store, stores) {
+    if (store.timestamp_max >= store.timestamp_min &&
+        (!have_current || window_of(store) > current)) {
+      current = window_of(store);
+      have_current = true;
+    }
+  }
+
+  for (size_t i=0; i<=stores.size(); i++) {
+    bool valid = i < stores.size() &&
+      stores[i].timestamp_max >= stores[i].timestamp_min;
+
+    /**
+     * A closed window is merged as a whole; the current one is size-tiered
+     * so that its early stores are not rewritten on every merge
+     */
+    if (valid && count && window_of(stores[i]) == window &&
+        (window < current ||
+         in_size_tier(stores[i].disk_usage, total, count,
+                      m_settings.target_size_min, 0.5, 1.5))) {
+      count++;
+      total += stores[i].disk_usage;
+      continue;
+    }
+
+    if (count > 1 &&
+        (window < current || count >= (size_t)m_min_threshold)) {
+      if (indexp)
+        *indexp = start;
+      if (lenp)
+        *lenp = std::min(count, (size_t)m_max_threshold);
+      return true;
+    }
+
+    if (valid) {
+      start = i;
+      count = 1;
+      total = stores[i].disk_usage;
+      window = window_of(stores[i]);
+    }
+    else
+      count = 0;
+  }
+
+  return false;
+}
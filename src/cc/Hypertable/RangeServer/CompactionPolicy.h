@@ -0,0 +1,188 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_COMPACTIONPOLICY_H
+#define HYPERTABLE_COMPACTIONPOLICY_H
+
+#include <vector>
+
+#include "Common/ReferenceCount.h"
+#include "Common/String.h"
+
+namespace Hypertable {
+
+  /**
+   * Decides which adjacent run of CellStores in an access group should be
+   * merged next.  Policies only look at CellStore summaries so that they can
+   * be driven by the compaction simulator without any on-disk state.
+   */
+  class CompactionPolicy : public ReferenceCount {
+  public:
+
+    struct StoreInfo {
+      StoreInfo(int64_t size=0, int64_t ts_min=0, int64_t ts_max=0)
+        : disk_usage(size), timestamp_min(ts_min), timestamp_max(ts_max) { }
+      int64_t disk_usage;
+      int64_t timestamp_min;
+      int64_t timestamp_max;
+    };
+
+    /**
+     * Thresholds shared by all policies, normally taken from the
+     * Hypertable.RangeServer.CellStore.* properties
+     */
+    struct Settings {
+      Settings() : target_size_min(0), target_size_max(0),
+                   run_length_threshold(0) { }
+      int64_t target_size_min;
+      int64_t target_size_max;
+      int32_t run_length_threshold;
+    };
+
+    CompactionPolicy(const Settings &settings) : m_settings(settings) { }
+    virtual ~CompactionPolicy() { }
+
+    virtual const char *name() const = 0;
+
+    /**
+     * Finds the next run of CellStores to merge.  <i>stores</i> is ordered
+     * oldest first, the way AccessGroup keeps them.
+     *
+     * @param stores CellStore summaries
+     * @param indexp address of variable to hold index of first store in run
+     * @param lenp address of variable to hold length of run
+     * @return true if a merge run was found, false otherwise
+     */
+    virtual bool find_merge_run(const std::vector<StoreInfo> &stores,
+                                size_t *indexp=0, size_t *lenp=0) = 0;
+
+    /**
+     * Cheap check used to populate MaintenanceData::needs_merging
+     */
+    virtual bool needs_merging(const std::vector<StoreInfo> &stores) {
+      return find_merge_run(stores);
+    }
+
+    /**
+     * Creates a policy from an access group compactionPolicy spec.  An empty
+     * spec selects the default merge-run policy.
+     */
+    static CompactionPolicy *create(const String &spec,
+                                    const Settings &settings);
+
+  protected:
+    Settings m_settings;
+  };
+
+  typedef intrusive_ptr<CompactionPolicy> CompactionPolicyPtr;
+
+
+  /**
+   * Original heuristic: merge adjacent runs of small CellStores until they
+   * add up to the target CellStore size.
+   */
+  class CompactionPolicyDefault : public CompactionPolicy {
+  public:
+    CompactionPolicyDefault(const Settings &settings)
+      : CompactionPolicy(settings) { }
+    virtual const char *name() const { return "default"; }
+    virtual bool find_merge_run(const std::vector<StoreInfo> &stores,
+                                size_t *indexp=0, size_t *lenp=0);
+    virtual bool needs_merging(const std::vector<StoreInfo> &stores);
+  };
+
+
+  /**
+   * Merges CellStores only once at least <i>min_threshold</i> adjacent
+   * stores of similar size have accumulated, so each byte is rewritten
+   * about once per tier.  Stores below the target minimum size form the
+   * lowest tier regardless of their relative sizes.
+   */
+  class CompactionPolicySizeTiered : public CompactionPolicy {
+  public:
+    CompactionPolicySizeTiered(const Settings &settings, int32_t min_threshold,
+                               int32_t max_threshold, double bucket_low,
+                               double bucket_high)
+      : CompactionPolicy(settings), m_min_threshold(min_threshold),
+        m_max_threshold(max_threshold), m_bucket_low(bucket_low),
+        m_bucket_high(bucket_high) { }
+    virtual const char *name() const { return "size-tiered"; }
+    virtual bool find_merge_run(const std::vector<StoreInfo> &stores,
+                                size_t *indexp=0, size_t *lenp=0);
+  private:
+    bool in_tier(int64_t size, int64_t total, size_t count);
+    int32_t m_min_threshold;
+    int32_t m_max_threshold;
+    double m_bucket_low;
+    double m_bucket_high;
+  };
+
+
+  /**
+   * Keeps every CellStore at least <i>fanout</i> times larger than the next
+   * newer one, which bounds the store count to roughly log_fanout(data size)
+   * and so bounds read amplification.  Stores below the target minimum size
+   * act as level 0 and are merged together before joining the levels.
+   * Ranges have no per-level key partitioning, so the levels here are
+   * whole CellStores ordered by age.
+   */
+  class CompactionPolicyLeveled : public CompactionPolicy {
+  public:
+    CompactionPolicyLeveled(const Settings &settings, int32_t fanout)
+      : CompactionPolicy(settings), m_fanout(fanout) { }
+    virtual const char *name() const { return "leveled"; }
+    virtual bool find_merge_run(const std::vector<StoreInfo> &stores,
+                                size_t *indexp=0, size_t *lenp=0);
+  private:
+    int32_t m_fanout;
+  };
+
+
+  /**
+   * Groups CellStores by the timestamp window holding their newest cell.
+   * Once a newer window has started, all stores of a closed window are
+   * merged into one, so each store covers a single window and expires as a
+   * unit under TTL.  Within the current window stores are size-tiered and
+   * merged once <i>min_threshold</i> similarly sized ones accumulate.
+   */
+  class CompactionPolicyTimeWindow : public CompactionPolicy {
+  public:
+    CompactionPolicyTimeWindow(const Settings &settings, int32_t window,
+                               int32_t min_threshold, int32_t max_threshold)
+      : CompactionPolicy(settings),
+        m_window((int64_t)window * 1000000000LL),
+        m_min_threshold(min_threshold), m_max_threshold(max_threshold) { }
+    virtual const char *name() const { return "time-window"; }
+    virtual bool find_merge_run(const std::vector<StoreInfo> &stores,
+                                size_t *indexp=0, size_t *lenp=0);
+  private:
+    int64_t window_of(const StoreInfo &store) {
+      return store.timestamp_max / m_window;
+    }
+    int64_t m_window;
+    int32_t m_min_threshold;
+    int32_t m_max_threshold;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_COMPACTIONPOLICY_H
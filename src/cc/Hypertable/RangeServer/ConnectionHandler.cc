@@ -48,6 +48,7 @@ extern "C" {
 #include "RequestHandlerHeapcheck.h"
 #include "RequestHandlerDropTable.h"
 #include "RequestHandlerMetadataSync.h"
+#include "RequestHandlerAdoptCellStores.h"
 #include "RequestHandlerStatus.h"
 #include "RequestHandlerReplayBegin.h"
 #include "RequestHandlerReplayLoadRange.h"
@@ -197,6 +198,10 @@ void ConnectionHandler::handle(EventPtr &event) {
         handler = new RequestHandlerMetadataSync(m_comm, m_range_server_ptr.get(),
                                                  event);
         break;
+      case RangeServerProtocol::COMMAND_ADOPT_CELLSTORES:
+        handler = new RequestHandlerAdoptCellStores(m_comm, m_range_server_ptr.get(),
+                                                    event);
+        break;
 
       default:
         HT_THROWF(PROTOCOL_ERROR, "Unimplemented command (%llu)",
@@ -36,6 +36,7 @@ namespace Hypertable {
   FilesystemPtr          Global::dfs;
   FilesystemPtr          Global::log_dfs;
   MaintenanceQueuePtr    Global::maintenance_queue;
+  MaintenanceThrottlePtr Global::maintenance_throttle;
   RangeServerProtocol   *Global::protocol = 0;
   RangeLocatorPtr        Global::range_locator = 0;
   bool                   Global::verbose = false;
@@ -48,6 +49,9 @@ namespace Hypertable {
   LocationInitializerPtr Global::location_initializer;
   int64_t                Global::range_split_size = 0;
   int64_t                Global::range_maximum_size = 0;
+  int32_t                Global::range_hot_split_cell_rate = 0;
+  int32_t                Global::range_hot_split_scan_rate = 0;
+  int64_t                Global::range_hot_split_minimum_size = 0;
   int32_t                Global::access_group_garbage_compaction_threshold = 0;
   int32_t                Global::access_group_max_mem = 0;
   int32_t                Global::cell_cache_scanner_cache_size = 0;
@@ -69,6 +73,9 @@ namespace Hypertable {
   std::string            Global::toplevel_dir;
   int32_t                Global::metrics_interval = 0;
   int32_t                Global::merge_cellstore_run_length_threshold = 0;
+  int32_t                Global::major_compaction_partitions = 1;
+  int64_t                Global::major_compaction_partition_minimum_size = 0;
+  int32_t                Global::major_compaction_threads_available = 0;
   bool                   Global::ignore_clock_skew_errors = false;
   ConnectionManagerPtr   Global::conn_manager;
 }
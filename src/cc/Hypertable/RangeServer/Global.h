@@ -43,6 +43,7 @@
 #include "FileBlockCache.h"
 #include "LocationInitializer.h"
 #include "MaintenanceQueue.h"
+#include "MaintenanceThrottle.h"
 #include "MemoryTracker.h"
 #include "ScannerMap.h"
 #include "TableInfo.h"
@@ -58,6 +59,7 @@ namespace Hypertable {
     static Hypertable::FilesystemPtr dfs;
     static Hypertable::FilesystemPtr log_dfs;
     static Hypertable::MaintenanceQueuePtr maintenance_queue;
+    static Hypertable::MaintenanceThrottlePtr maintenance_throttle;
     static Hypertable::RangeServerProtocol *protocol;
     static Hypertable::RangeLocatorPtr range_locator;
     static bool           verbose;
@@ -70,6 +72,9 @@ namespace Hypertable {
     static LocationInitializerPtr location_initializer;
     static int64_t        range_split_size;
     static int64_t        range_maximum_size;
+    static int32_t        range_hot_split_cell_rate;
+    static int32_t        range_hot_split_scan_rate;
+    static int64_t        range_hot_split_minimum_size;
     static int32_t        access_group_garbage_compaction_threshold;
     static int32_t        access_group_max_mem;
     static int32_t        cell_cache_scanner_cache_size;
@@ -95,6 +100,9 @@ namespace Hypertable {
     static std::string    toplevel_dir;
     static int32_t        metrics_interval;
     static int32_t        merge_cellstore_run_length_threshold;
+    static int32_t        major_compaction_partitions;
+    static int64_t        major_compaction_partition_minimum_size;
+    static int32_t        major_compaction_threads_available;
     static bool           ignore_clock_skew_errors;
     static ConnectionManagerPtr conn_manager;
   };
@@ -0,0 +1,143 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "HotSplitTracker.h"
+
+using namespace Hypertable;
+
+
+HotSplitTracker::HotSplitTracker(int32_t cell_rate, int32_t scan_rate,
+                                 int64_t minimum_size)
+  : m_cell_rate(cell_rate), m_scan_rate(scan_rate),
+    m_minimum_size(minimum_size), m_sample_next(0), m_access_count(0),
+    m_check_time(0), m_check_cells_written(0), m_check_scans(0),
+    m_backoff(0), m_backoff_until(0), m_hot(false) {
+}
+
+
+bool HotSplitTracker::check(time_t now, uint64_t cells_written, uint64_t scans,
+                            int64_t size, const char *start_row,
+                            const char *end_row) {
+  bool over_rate = false;
+
+  if (m_check_time && now > m_check_time) {
+    double elapsed = (double)(now - m_check_time);
+    double cell_rate = (double)(cells_written - m_check_cells_written) / elapsed;
+    double scan_rate = (double)(scans - m_check_scans) / elapsed;
+    over_rate = (m_cell_rate && cell_rate > (double)m_cell_rate) ||
+      (m_scan_rate && scan_rate > (double)m_scan_rate);
+  }
+  else if (m_check_time)
+    return m_hot;
+
+  m_check_time = now;
+  m_check_cells_written = cells_written;
+  m_check_scans = scans;
+
+  // stays hot until the split consumes the split row
+  if (m_hot)
+    return true;
+
+  if (!over_rate || size < m_minimum_size || now < m_backoff_until)
+    return false;
+
+  std::vector<String> samples(m_samples);
+  if (!choose_split_row(samples, start_row, end_row, m_split_row)) {
+    back_off(now);
+    return false;
+  }
+
+  m_hot = true;
+  m_backoff = 0;
+  return true;
+}
+
+
+bool HotSplitTracker::consume_split_row(String &split_row) {
+  if (!m_hot)
+    return false;
+  split_row = m_split_row;
+  m_samples.clear();
+  m_sample_next = 0;
+  m_hot = false;
+  return true;
+}
+
+
+bool HotSplitTracker::choose_split_row(std::vector<String> &samples,
+                                       const char *start_row,
+                                       const char *end_row,
+                                       String &split_row) {
+  std::vector<String>::iterator first, last;
+
+  std::sort(samples.begin(), samples.end());
+
+  // restrict to the samples within (start_row, end_row]
+  first = std::upper_bound(samples.begin(), samples.end(), String(start_row));
+  last = std::upper_bound(first, samples.end(), String(end_row));
+
+  size_t total = last - first;
+  if (total < MINIMUM_SAMPLES)
+    return false;
+
+  size_t distinct = 0;
+  size_t best_count = 0;
+  size_t best_distance = total;
+  std::vector<String>::iterator best = last;
+
+  // consider the last occurrence of each row except the largest one
+  for (std::vector<String>::iterator iter = first; iter != last; ++iter) {
+    std::vector<String>::iterator next = iter + 1;
+    if (next != last && *next == *iter)
+      continue;
+    distinct++;
+    if (next == last)
+      break;
+    size_t lower = next - first;
+    size_t distance = lower > total - lower ? 2*lower - total : total - 2*lower;
+    if (distance < best_distance) {
+      best_distance = distance;
+      best_count = lower;
+      best = iter;
+    }
+  }
+
+  if (distinct < MINIMUM_DISTINCT_SAMPLES || best == last)
+    return false;
+
+  split_row = *best;
+  HT_DEBUGF("Hot split row '%s' divides %d samples %d/%d", split_row.c_str(),
+            (int)total, (int)best_count, (int)(total-best_count));
+  return true;
+}
+
+
+void HotSplitTracker::back_off(time_t now) {
+  m_backoff = m_backoff ? std::min(2*m_backoff, (time_t)MAXIMUM_BACKOFF)
+    : (time_t)INITIAL_BACKOFF;
+  m_backoff_until = now + m_backoff;
+}
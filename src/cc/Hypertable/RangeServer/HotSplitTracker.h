@@ -0,0 +1,144 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef HYPERTABLE_HOTSPLITTRACKER_H
+#define HYPERTABLE_HOTSPLITTRACKER_H
+
+extern "C" {
+#include <time.h>
+}
+
+#include <vector>
+
+#include "Common/String.h"
+
+namespace Hypertable {
+
+  /**
+   * Decides whether a range should be split because it receives too many
+   * cell writes or scans, and if so where.  Rows are sampled as they are
+   * accessed; a range is considered hot only if it is at least the minimum
+   * size and the samples contain enough distinct rows to divide the load.
+   * When no usable split row can be chosen, hot checks are suspended for a
+   * backoff period that doubles with each consecutive failure.  This class
+   * is not thread safe; Range serializes access with its schema mutex.
+   */
+  class HotSplitTracker {
+  public:
+    enum {
+      SAMPLE_CAPACITY = 256,
+      SAMPLE_INTERVAL = 16,
+      MINIMUM_SAMPLES = SAMPLE_CAPACITY / 4,
+      MINIMUM_DISTINCT_SAMPLES = 4,
+      INITIAL_BACKOFF = 60,
+      MAXIMUM_BACKOFF = 3600
+    };
+
+    /**
+     * @param cell_rate cells written per second above which a range is hot
+     *        (0 disables)
+     * @param scan_rate scans per second above which a range is hot
+     *        (0 disables)
+     * @param minimum_size ranges smaller than this are never hot
+     */
+    HotSplitTracker(int32_t cell_rate, int32_t scan_rate, int64_t minimum_size);
+
+    bool enabled() const { return m_cell_rate || m_scan_rate; }
+
+    /** Records an accessed row; every SAMPLE_INTERVAL'th row is kept */
+    void sample(const char *row) {
+      if ((m_access_count++ % SAMPLE_INTERVAL) == 0) {
+        if (m_samples.size() < SAMPLE_CAPACITY)
+          m_samples.push_back(row);
+        else
+          m_samples[m_sample_next] = row;
+        m_sample_next = (m_sample_next+1) % SAMPLE_CAPACITY;
+      }
+    }
+
+    /**
+     * Computes the write and scan rates since the previous check and
+     * determines whether the range is hot.  A hot range has a split row
+     * chosen from the samples and stays hot until the split row is
+     * consumed; if no split row can be chosen, further checks back off.
+     *
+     * @param now current time (seconds since epoch)
+     * @param cells_written total cells written to the range
+     * @param scans total scans of the range
+     * @param size estimated size of the range in bytes
+     * @param start_row start row of the range (exclusive)
+     * @param end_row end row of the range (inclusive)
+     * @return true if the range is hot
+     */
+    bool check(time_t now, uint64_t cells_written, uint64_t scans,
+               int64_t size, const char *start_row, const char *end_row);
+
+    bool is_hot() const { return m_hot; }
+
+    /**
+     * Hands out the split row chosen by the last check and resets the
+     * samples, since they describe the range before the split.
+     *
+     * @param split_row receives the split row
+     * @return false if the range is not hot
+     */
+    bool consume_split_row(String &split_row);
+
+    /** Current backoff in seconds (0 if checks are not backed off) */
+    time_t backoff() const { return m_backoff; }
+
+    /**
+     * Chooses the split row that divides the samples lying within
+     * (start_row, end_row] most evenly.  Samples equal to the split row
+     * end up in the lower half, so the largest sample is never chosen.
+     *
+     * @param samples sampled rows (sorted in place)
+     * @param start_row start row of the range (exclusive)
+     * @param end_row end row of the range (inclusive)
+     * @param split_row receives the split row
+     * @return false if there are fewer than MINIMUM_SAMPLES samples or
+     *         MINIMUM_DISTINCT_SAMPLES distinct rows in the range
+     */
+    static bool choose_split_row(std::vector<String> &samples,
+                                 const char *start_row, const char *end_row,
+                                 String &split_row);
+
+  private:
+    void back_off(time_t now);
+
+    int32_t m_cell_rate;
+    int32_t m_scan_rate;
+    int64_t m_minimum_size;
+    std::vector<String> m_samples;
+    size_t m_sample_next;
+    uint64_t m_access_count;
+    time_t m_check_time;
+    uint64_t m_check_cells_written;
+    uint64_t m_check_scans;
+    time_t m_backoff;
+    time_t m_backoff_until;
+    String m_split_row;
+    bool m_hot;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_HOTSPLITTRACKER_H
@@ -35,6 +35,26 @@ namespace Hypertable {
     virtual const uint8_t *add(const uint8_t *ptr) = 0;
     virtual bool less_than(SerializedKey serialized_key) = 0;
     virtual void load(Key &key) = 0;
+
+    /**
+     * Prepares to decode a freshly loaded block and returns a pointer to
+     * the end of its key/value data.  Formats that store additional
+     * per-block data after the key/value pairs override this.
+     */
+    virtual const uint8_t *load_block(const uint8_t *base, size_t length) {
+      reset();
+      return base + length;
+    }
+
+    /**
+     * Skips ahead within the current block, if the block format allows it,
+     * to the last entry known to precede serialized_key.  Must be called
+     * while positioned on the first entry of the block.
+     *
+     * @return pointer to the value of the new current entry, or 0 if the
+     * current entry was not changed
+     */
+    virtual const uint8_t *seek(SerializedKey serialized_key) { return 0; }
   };
   typedef intrusive_ptr<KeyDecompressor> KeyDecompressorPtr;
 
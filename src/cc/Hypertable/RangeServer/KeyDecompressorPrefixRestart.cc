@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Error.h"
+#include "Common/Serialization.h"
+
+#include "KeyDecompressorPrefixRestart.h"
+
+using namespace Hypertable;
+
+
+const uint8_t *KeyDecompressorPrefixRestart::load_block(const uint8_t *base,
+                                                        size_t length) {
+  const uint8_t *ptr;
+  size_t remaining = 4;
+
+  KeyDecompressorPrefix::reset();
+
+  HT_ASSERT(length >= 4);
+  ptr = base + length - 4;
+  m_restart_count = Serialization::decode_i32(&ptr, &remaining);
+  HT_ASSERT(4 * (m_restart_count + 1) <= length);
+
+  m_block_base = base;
+  m_restarts = base + length - 4 * (m_restart_count + 1);
+  return m_restarts;
+}
+
+
+const uint8_t *KeyDecompressorPrefixRestart::seek(SerializedKey serialized_key) {
+  size_t lo = 0;
+  size_t hi = m_restart_count;
+
+  // Find the last restart point whose key is less than serialized_key
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (restart_key(mid) < serialized_key)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  // The first restart point is the current entry
+  if (lo == 0)
+    return 0;
+
+  KeyDecompressorPrefix::reset();
+  return add(m_block_base + restart_offset(lo));
+}
+
+
+uint32_t KeyDecompressorPrefixRestart::restart_offset(size_t i) {
+  const uint8_t *ptr = m_restarts + 4*i;
+  size_t remaining = 4;
+  return Serialization::decode_i32(&ptr, &remaining);
+}
+
+
+/**
+ * Renders the key stored at restart point <code>i</code>, which has an
+ * empty shared prefix, in ordinary serialized form
+ */
+SerializedKey KeyDecompressorPrefixRestart::restart_key(size_t i) {
+  const uint8_t *ptr;
+  SerializedKey serkey(m_block_base + restart_offset(i));
+  size_t length = serkey.decode_length(&ptr);
+  uint8_t control = *ptr++;
+  size_t remaining = length - 1;
+  uint32_t matching = Serialization::decode_vi32(&ptr, &remaining);
+
+  HT_ASSERT(matching == 0);
+
+  m_restart_key.clear();
+  m_restart_key.ensure(8 + remaining);
+  Serialization::encode_vi32(&m_restart_key.ptr, 1 + remaining);
+  *(m_restart_key.ptr)++ = control;
+  m_restart_key.add_unchecked(ptr, remaining);
+  return SerializedKey(m_restart_key.base);
+}
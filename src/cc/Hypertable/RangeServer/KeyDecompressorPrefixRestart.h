@@ -0,0 +1,55 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_KEYDECOMPRESSORPREFIXRESTART_H
+#define HYPERTABLE_KEYDECOMPRESSORPREFIXRESTART_H
+
+#include "Common/DynamicBuffer.h"
+
+#include "KeyDecompressorPrefix.h"
+
+namespace Hypertable {
+
+  /**
+   * Decompressor for prefix-compressed blocks that end with an array of
+   * restart point offsets (see CellStoreV7).  Keys at restart points are
+   * stored in full, which allows seek() to binary search them.
+   */
+  class KeyDecompressorPrefixRestart : public KeyDecompressorPrefix {
+  public:
+    KeyDecompressorPrefixRestart() : m_block_base(0), m_restarts(0),
+                                     m_restart_count(0) { }
+    virtual const uint8_t *load_block(const uint8_t *base, size_t length);
+    virtual const uint8_t *seek(SerializedKey serialized_key);
+  private:
+    uint32_t restart_offset(size_t i);
+    SerializedKey restart_key(size_t i);
+    const uint8_t *m_block_base;
+    const uint8_t *m_restarts;
+    size_t m_restart_count;
+    DynamicBuffer m_restart_key;
+  };
+  typedef intrusive_ptr<KeyDecompressorPrefixRestart> KeyDecompressorPrefixRestartPtr;
+
+}
+
+#endif // HYPERTABLE_KEYDECOMPRESSORPREFIXRESTART_H
@@ -61,6 +61,16 @@ namespace Hypertable {
      */
     void update_live(const String &add, std::vector<String> &deletes, uint32_t nextcsid, int64_t total_blocks);
 
+    /**
+     * Updates the live file set with several new files at once
+     *
+     * @param adds vector of filenames to add
+     * @param deletes vector of filenames to delete
+     * @param nextcsid Next available CellStore ID
+     * @param total_blocks Total number of cell store blocks in access group
+     */
+    void update_live(const std::vector<String> &adds, std::vector<String> &deletes, uint32_t nextcsid, int64_t total_blocks);
+
     /**
      * Adds a file to the live file set without seting the 'need_update' bit
      *
@@ -142,6 +142,8 @@ void MaintenanceScheduler::schedule() {
       millis_since_last_maintenance < m_maintenance_interval)
     return;
 
+  check_file_throttle_rates();
+
   Global::maintenance_queue->clear();
 
   m_stats_gatherer->fetch(range_data);
@@ -255,6 +257,8 @@ void MaintenanceScheduler::schedule() {
 	     cell_cache_pct, shadow_cache_pct, query_cache_pct);
   }
 
+  log_throttle_statistics(trace_str);
+
   String dummy_str;
   m_prioritizer->prioritize(range_data, memory_state, priority, dummy_str);
 
@@ -387,3 +391,56 @@ void MaintenanceScheduler::check_file_dump_statistics(boost::xtime now, RangeSta
   }
   
 }
+
+
+/**
+ * Allows the maintenance I/O budget to be changed without a restart by
+ * writing "<read-bytes-per-sec> <write-bytes-per-sec>" into
+ * run/maintenance-throttle
+ */
+void MaintenanceScheduler::check_file_throttle_rates() {
+  String fname = System::install_dir + "/run/maintenance-throttle";
+
+  if (!Global::maintenance_throttle || !FileUtils::exists(fname))
+    return;
+
+  ifstream in(fname.c_str());
+  long long read_rate, write_rate;
+  if (in >> read_rate >> write_rate && read_rate >= 0 && write_rate >= 0)
+    Global::maintenance_throttle->set_rates(read_rate, write_rate);
+  else
+    HT_ERRORF("Invalid maintenance throttle rates in %s, expected "
+              "'<read-rate> <write-rate>'", fname.c_str());
+  in.close();
+  FileUtils::unlink(fname);
+}
+
+
+void MaintenanceScheduler::log_throttle_statistics(String &trace_str) {
+  MaintenanceThrottle::Stats stats;
+  int64_t read_rate, write_rate;
+  String throttled;
+
+  if (!Global::maintenance_throttle)
+    return;
+
+  Global::maintenance_throttle->get_rates(&read_rate, &write_rate);
+  Global::maintenance_throttle->get_stats(stats);
+
+  for (int i=0; i<MaintenanceThrottle::TASK_TYPE_MAX; i++) {
+    const char *name = MaintenanceThrottle::task_type_name(i);
+    throttled += format(" %s=%lld", name, (Lld)stats.throttled_millis[i]);
+    trace_str += format("throttle-%s-throttled-millis\t%lld\n", name,
+                        (Lld)stats.throttled_millis[i]);
+    trace_str += format("throttle-%s-bytes-read\t%lld\n", name,
+                        (Lld)stats.bytes_read[i]);
+    trace_str += format("throttle-%s-bytes-written\t%lld\n", name,
+                        (Lld)stats.bytes_written[i]);
+  }
+  trace_str += format("throttle-backoff\t%.2f\n", stats.backoff);
+  trace_str += format("throttle-scan-latency-millis\t%.2f\n", stats.scan_latency);
+
+  HT_INFOF("Maintenance throttle: read=%lld write=%lld bytes/s backoff=%.2f "
+           "throttled-millis:%s", (Lld)read_rate, (Lld)write_rate,
+           stats.backoff, throttled.c_str());
+}
@@ -65,6 +65,10 @@ namespace Hypertable {
     void check_file_dump_statistics(boost::xtime now, RangeStatsVector &range_data,
                                     const String &header_str);
 
+    void check_file_throttle_rates();
+
+    void log_throttle_statistics(String &trace_str);
+
     bool m_initialized;
     bool m_scheduling_needed;
     ApplicationQueuePtr m_app_queue;
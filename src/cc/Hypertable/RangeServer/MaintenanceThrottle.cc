@@ -0,0 +1,179 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+#include "Common/Time.h"
+
+extern "C" {
+#include <poll.h>
+}
+
+#include <algorithm>
+#include <cstring>
+
+#include "MaintenanceThrottle.h"
+
+using namespace Hypertable;
+
+namespace {
+  // Interval between backoff adjustments
+  const int64_t ADJUST_INTERVAL_MILLIS = 250;
+  // Longest single sleep, so rate changes take effect promptly
+  const int64_t MAX_SLEEP_MILLIS = 1000;
+}
+
+
+MaintenanceThrottle::MaintenanceThrottle(int64_t read_rate, int64_t write_rate,
+                                         int32_t update_queue_threshold,
+                                         int32_t scan_latency_threshold,
+                                         double minimum_fraction)
+  : m_scan_latency(0.0),
+    m_update_queue_threshold(update_queue_threshold),
+    m_scan_latency_threshold(scan_latency_threshold),
+    m_minimum_fraction(minimum_fraction), m_backoff(1.0) {
+  atomic_set(&m_update_queue_depth, 0);
+  atomic_set(&m_scan_millis, 0);
+  atomic_set(&m_scan_count, 0);
+  m_read.rate = read_rate;
+  m_write.rate = write_rate;
+  boost::xtime_get(&m_last_refill, boost::TIME_UTC);
+  memcpy(&m_last_adjust, &m_last_refill, sizeof(boost::xtime));
+  memset(m_throttled_millis, 0, sizeof(m_throttled_millis));
+  memset(m_bytes_read, 0, sizeof(m_bytes_read));
+  memset(m_bytes_written, 0, sizeof(m_bytes_written));
+}
+
+
+void MaintenanceThrottle::set_rates(int64_t read_rate, int64_t write_rate) {
+  ScopedLock lock(m_mutex);
+  m_read.rate = read_rate;
+  m_read.tokens = 0.0;
+  m_write.rate = write_rate;
+  m_write.tokens = 0.0;
+  HT_INFOF("Maintenance throttle rates set to read=%lld write=%lld bytes/s",
+           (Lld)read_rate, (Lld)write_rate);
+}
+
+
+void MaintenanceThrottle::refill(Bucket &bucket, double seconds) {
+  if (bucket.rate == 0)
+    return;
+  double rate = (double)bucket.rate * m_backoff;
+  // Allow at most one second worth of burst
+  bucket.tokens = std::min(bucket.tokens + (rate * seconds), rate);
+}
+
+
+int64_t MaintenanceThrottle::deficit_millis(Bucket &bucket) {
+  if (bucket.rate == 0 || bucket.tokens >= 0.0)
+    return 0;
+  double rate = (double)bucket.rate * m_backoff;
+  return (int64_t)((-bucket.tokens * 1000.0) / rate) + 1;
+}
+
+
+void MaintenanceThrottle::adjust_backoff(boost::xtime &now) {
+  if (xtime_diff_millis(m_last_adjust, now) < ADJUST_INTERVAL_MILLIS)
+    return;
+  memcpy(&m_last_adjust, &now, sizeof(boost::xtime));
+
+  // Fold the scan latencies recorded since the last adjustment into the
+  // moving average; with no scans there is no scan pressure
+  int count = atomic_read(&m_scan_count);
+  if (count > 0) {
+    int millis = atomic_read(&m_scan_millis);
+    atomic_sub(millis, &m_scan_millis);
+    atomic_sub(count, &m_scan_count);
+    m_scan_latency = (0.5 * m_scan_latency) + (0.5 * (double)millis / (double)count);
+  }
+  else
+    m_scan_latency *= 0.5;
+
+  bool pressure = (m_update_queue_threshold > 0 &&
+                   atomic_read(&m_update_queue_depth) > m_update_queue_threshold) ||
+    (m_scan_latency_threshold > 0 &&
+     m_scan_latency > (double)m_scan_latency_threshold);
+
+  // Multiplicative decrease under pressure, additive increase otherwise
+  if (pressure)
+    m_backoff = std::max(m_minimum_fraction, m_backoff / 2.0);
+  else
+    m_backoff = std::min(1.0, m_backoff + 0.1);
+}
+
+
+void MaintenanceThrottle::charge(TaskType type, bool urgent,
+                                 int64_t read_bytes, int64_t write_bytes) {
+  boost::xtime now;
+  int64_t wait_millis;
+
+  HT_ASSERT(type < TASK_TYPE_MAX);
+
+  {
+    ScopedLock lock(m_mutex);
+    boost::xtime_get(&now, boost::TIME_UTC);
+    double seconds = (double)xtime_diff_millis(m_last_refill, now) / 1000.0;
+    memcpy(&m_last_refill, &now, sizeof(boost::xtime));
+    adjust_backoff(now);
+    refill(m_read, seconds);
+    refill(m_write, seconds);
+    m_bytes_read[type] += read_bytes;
+    m_bytes_written[type] += write_bytes;
+    if (m_read.rate)
+      m_read.tokens -= (double)read_bytes;
+    if (m_write.rate)
+      m_write.tokens -= (double)write_bytes;
+    if (urgent)
+      return;
+    wait_millis = std::max(deficit_millis(m_read), deficit_millis(m_write));
+    if (wait_millis == 0)
+      return;
+    wait_millis = std::min(wait_millis, MAX_SLEEP_MILLIS);
+    m_throttled_millis[type] += wait_millis;
+  }
+
+  poll(0, 0, (int)wait_millis);
+}
+
+
+void MaintenanceThrottle::get_stats(Stats &stats) {
+  ScopedLock lock(m_mutex);
+  memcpy(stats.throttled_millis, m_throttled_millis, sizeof(m_throttled_millis));
+  memcpy(stats.bytes_read, m_bytes_read, sizeof(m_bytes_read));
+  memcpy(stats.bytes_written, m_bytes_written, sizeof(m_bytes_written));
+  stats.backoff = m_backoff;
+  stats.scan_latency = m_scan_latency;
+}
+
+
+const char *MaintenanceThrottle::task_type_name(int type) {
+  switch (type) {
+  case MINOR_COMPACTION:   return "minor";
+  case MERGING_COMPACTION: return "merging";
+  case MAJOR_COMPACTION:   return "major";
+  case GC_COMPACTION:      return "gc";
+  default:
+    break;
+  }
+  return "unknown";
+}
@@ -0,0 +1,155 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#ifndef HYPERTABLE_MAINTENANCETHROTTLE_H
+#define HYPERTABLE_MAINTENANCETHROTTLE_H
+
+#include <algorithm>
+
+#include <boost/thread/xtime.hpp>
+
+#include "Common/Mutex.h"
+#include "Common/ReferenceCount.h"
+#include "Common/String.h"
+#include "Common/atomic.h"
+
+namespace Hypertable {
+
+  /**
+   * Token bucket I/O budget for maintenance work.  Compactions charge the
+   * bytes they read and write; once the budget is exhausted, background
+   * tasks sleep until enough tokens have accumulated.  Urgent work (minor
+   * compactions, which free memory and let commit logs be purged, and
+   * compactions of system tables) is charged against the budget but never
+   * waits.  The effective rate is scaled down while the update queue is
+   * deep or scans are slow, and recovers once foreground load subsides.
+   */
+  class MaintenanceThrottle : public ReferenceCount {
+  public:
+
+    enum TaskType {
+      MINOR_COMPACTION = 0,
+      MERGING_COMPACTION,
+      MAJOR_COMPACTION,
+      GC_COMPACTION,
+      TASK_TYPE_MAX
+    };
+
+    /** Compactions charge the budget after roughly this many bytes */
+    enum { CHARGE_BYTES = 256 * 1024 };
+
+    /** Scan latency samples kept per backoff adjustment interval, and the
+     * largest latency (ms) a single sample contributes */
+    enum { MAX_SCAN_SAMPLES = 10000, MAX_SCAN_MILLIS = 60000 };
+
+    struct Stats {
+      int64_t throttled_millis[TASK_TYPE_MAX];
+      int64_t bytes_read[TASK_TYPE_MAX];
+      int64_t bytes_written[TASK_TYPE_MAX];
+      double backoff;
+      double scan_latency;
+    };
+
+    /**
+     * @param read_rate maintenance read budget in bytes/sec (0 = unlimited)
+     * @param write_rate maintenance write budget in bytes/sec (0 = unlimited)
+     * @param update_queue_threshold update queue depth considered pressure
+     * @param scan_latency_threshold scan latency (ms) considered pressure
+     * @param minimum_fraction lowest fraction of the rates backoff can reach
+     */
+    MaintenanceThrottle(int64_t read_rate, int64_t write_rate,
+                        int32_t update_queue_threshold,
+                        int32_t scan_latency_threshold,
+                        double minimum_fraction);
+
+    void set_rates(int64_t read_rate, int64_t write_rate);
+
+    void get_rates(int64_t *read_ratep, int64_t *write_ratep) {
+      ScopedLock lock(m_mutex);
+      *read_ratep = m_read.rate;
+      *write_ratep = m_write.rate;
+    }
+
+    /**
+     * Charges maintenance I/O against the budget, sleeping if the task
+     * is not urgent and the budget is exhausted
+     */
+    void charge(TaskType type, bool urgent, int64_t read_bytes,
+                int64_t write_bytes);
+
+    /** Called when an update is added to the update queue */
+    void update_enqueued() { atomic_inc(&m_update_queue_depth); }
+
+    /** Called when an update is removed from the update queue */
+    void update_dequeued() { atomic_dec(&m_update_queue_depth); }
+
+    /**
+     * Records the latency of a scan.  Lock free; the samples are averaged
+     * when the backoff is next adjusted.  Once MAX_SCAN_SAMPLES have been
+     * recorded in an interval, further samples are dropped.
+     */
+    void record_scan_latency(int64_t millis) {
+      if (atomic_read(&m_scan_count) >= MAX_SCAN_SAMPLES)
+        return;
+      atomic_add((int)std::min(millis, (int64_t)MAX_SCAN_MILLIS), &m_scan_millis);
+      atomic_inc(&m_scan_count);
+    }
+
+    void get_stats(Stats &stats);
+
+    static const char *task_type_name(int type);
+
+  private:
+
+    struct Bucket {
+      Bucket() : rate(0), tokens(0.0) { }
+      int64_t rate;
+      double tokens;
+    };
+
+    void refill(Bucket &bucket, double seconds);
+    void adjust_backoff(boost::xtime &now);
+    int64_t deficit_millis(Bucket &bucket);
+
+    Mutex   m_mutex;
+    Bucket  m_read;
+    Bucket  m_write;
+    boost::xtime m_last_refill;
+    boost::xtime m_last_adjust;
+    atomic_t m_update_queue_depth;
+    atomic_t m_scan_millis;
+    atomic_t m_scan_count;
+    double  m_scan_latency;
+    int32_t m_update_queue_threshold;
+    int32_t m_scan_latency_threshold;
+    double  m_minimum_fraction;
+    double  m_backoff;
+    int64_t m_throttled_millis[TASK_TYPE_MAX];
+    int64_t m_bytes_read[TASK_TYPE_MAX];
+    int64_t m_bytes_written[TASK_TYPE_MAX];
+  };
+
+  typedef intrusive_ptr<MaintenanceThrottle> MaintenanceThrottlePtr;
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_MAINTENANCETHROTTLE_H
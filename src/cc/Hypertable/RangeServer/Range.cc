@@ -64,7 +64,10 @@ Range::Range(MasterClientPtr &master_client,
     m_split_off_high(false), m_added_inserts(0), m_range_set(range_set),
     m_error(Error::OK), m_dropped(false), m_capacity_exceeded_throttle(false),
     m_relinquish(false), m_removed_from_working_set(false), m_maintenance_generation(0),
-    m_load_metrics(identifier->id, range->start_row, range->end_row) {
+    m_load_metrics(identifier->id, range->start_row, range->end_row),
+    m_hot_split_tracker(Global::range_hot_split_cell_rate,
+                        Global::range_hot_split_scan_rate,
+                        Global::range_hot_split_minimum_size) {
   m_metalog_entity = new MetaLog::EntityRange(*identifier, *range, *state, needs_compaction);
   initialize();
 }
@@ -78,7 +81,10 @@ Range::Range(MasterClientPtr &master_client, SchemaPtr &schema,
     m_split_threshold(0), m_split_off_high(false), m_added_inserts(0), m_range_set(range_set),
     m_error(Error::OK), m_dropped(false), m_capacity_exceeded_throttle(false),
     m_relinquish(false), m_removed_from_working_set(false), m_maintenance_generation(0),
-    m_load_metrics(range_entity->table.id, range_entity->spec.start_row, range_entity->spec.end_row) {
+    m_load_metrics(range_entity->table.id, range_entity->spec.start_row, range_entity->spec.end_row),
+    m_hot_split_tracker(Global::range_hot_split_cell_rate,
+                        Global::range_hot_split_scan_rate,
+                        Global::range_hot_split_minimum_size) {
   initialize();
 }
 
@@ -367,6 +373,9 @@ void Range::add(const Key &key, const ByteString value) {
   else
     m_added_deletes[key.flag]++;
 
+  if (Global::range_hot_split_cell_rate)
+    m_hot_split_tracker.sample(key.row);
+
   if (key.revision > m_revision)
     m_revision = key.revision;
 }
@@ -380,6 +389,8 @@ CellListScanner *Range::create_scanner(ScanContextPtr &scan_ctx) {
     ScopedLock lock(m_schema_mutex);
     ag_vector = m_access_group_vector;
     m_scans++;
+    if (Global::range_hot_split_scan_rate && !scan_ctx->start_row.empty())
+      m_hot_split_tracker.sample(scan_ctx->start_row.c_str());
   }
 
   try {
@@ -503,7 +514,15 @@ Range::MaintenanceData *Range::get_maintenance_data(ByteArena &arena, time_t now
   if (tailp)
     (*tailp)->next = 0;
 
-  if (size >= m_split_threshold)
+  // check update and scan rates against the hot split thresholds
+  if (m_hot_split_tracker.enabled() && !mdata->is_system) {
+    ScopedLock lock(m_schema_mutex);
+    mdata->is_hot = m_hot_split_tracker.check(now,
+        mdata->load_factors.cells_written, mdata->load_factors.scans, size,
+        m_metalog_entity->spec.start_row, m_metalog_entity->spec.end_row);
+  }
+
+  if (size >= m_split_threshold || mdata->is_hot)
     mdata->needs_split = true;
 
   if (size > Global::range_maximum_size) {
@@ -776,15 +795,26 @@ void Range::split_install_log() {
   if (cancel_maintenance())
     HT_THROW(Error::CANCELLED, "");
 
-  for (size_t i=0; i<ag_vector.size(); i++)
-    ag_vector[i]->get_split_rows(split_rows, false);
+  /**
+   * If the range is being split because it is hot rather than big, split
+   * it at the median of the recently accessed rows so that the load, not
+   * the data, is divided between the two halves.
+   */
+  bool hot_split = determine_split_row_from_access_samples();
+
+  if (hot_split)
+    split_rows.push_back(m_split_row);
+  else {
+    for (size_t i=0; i<ag_vector.size(); i++)
+      ag_vector[i]->get_split_rows(split_rows, false);
+  }
 
   /**
    * If we didn't get at least one row from each Access Group, then try again
    * the hard way (scans CellCache for middle row)
    */
 
-  if (split_rows.size() < ag_vector.size()) {
+  if (!hot_split && split_rows.size() < ag_vector.size()) {
     for (size_t i=0; i<ag_vector.size(); i++)
       ag_vector[i]->get_split_rows(split_rows, true);
   }
@@ -890,6 +920,23 @@ void Range::split_install_log() {
 }
 
 
+bool Range::determine_split_row_from_access_samples() {
+  String split_row;
+
+  {
+    ScopedLock lock(m_schema_mutex);
+    if (!m_hot_split_tracker.consume_split_row(split_row))
+      return false;
+  }
+
+  ScopedLock lock(m_mutex);
+  m_split_row = split_row;
+  HT_INFOF("Hot range %s split row '%s' chosen from access samples",
+           m_name.c_str(), m_split_row.c_str());
+  return true;
+}
+
+
 bool Range::determine_split_row_from_cached_keys(AccessGroupVector &ag_vector) {
   std::vector<String> split_rows;  
 
@@ -1257,6 +1304,60 @@ void Range::compact(MaintenanceFlag::Map &subtask_map) {
 }
 
 
+/**
+ * Adopts CellStore files written outside of the RangeServer (bulk load)
+ * into the given access group.  The access group's cell cache is first
+ * compacted so that the revisions of the adopted stores can never
+ * shadow cached updates that have not yet reached a CellStore, which
+ * would otherwise be skipped during commit log replay.  The adopted
+ * revisions come from the loader's clock, so they are bounded by this
+ * server's clock, read while updates are blocked; the range's latest
+ * revision is raised to that time so every later update is assigned a
+ * newer revision.
+ */
+void Range::adopt_cellstores(const String &access_group,
+                             const std::vector<String> &files) {
+  RangeMaintenanceGuard::Activator activator(m_maintenance_guard);
+  AccessGroupPtr ag;
+
+  {
+    ScopedLock lock(m_schema_mutex);
+    AccessGroupMap::iterator iter = m_access_group_map.find(access_group);
+    if (iter == m_access_group_map.end())
+      HT_THROWF(Error::RANGESERVER_INVALID_COLUMNFAMILY,
+                "Access group '%s' not found in range %s",
+                access_group.c_str(), m_name.c_str());
+    ag = iter->second;
+  }
+
+  int64_t adopt_revision;
+
+  {
+    Barrier::ScopedActivator block_updates(m_update_barrier);
+    ScopedLock lock(m_mutex);
+    adopt_revision = get_ts64();
+    if (adopt_revision > m_latest_revision)
+      m_latest_revision = adopt_revision;
+    ag->stage_compaction();
+  }
+
+  try {
+    ag->run_compaction(MaintenanceFlag::COMPACT_MINOR);
+  }
+  catch (Exception &e) {
+    ag->unstage_compaction();
+    throw;
+  }
+
+  ag->adopt_cellstores(files, adopt_revision);
+
+  {
+    ScopedLock lock(m_mutex);
+    m_maintenance_generation++;
+  }
+}
+
+
 
 void Range::purge_memory(MaintenanceFlag::Map &subtask_map) {
   RangeMaintenanceGuard::Activator activator(m_maintenance_guard);
@@ -1460,5 +1561,6 @@ std::ostream &Hypertable::operator<<(std::ostream &os, const Range::MaintenanceD
   os << "relinquish=" << (mdata.relinquish ? "true" : "false") << "\n";
   os << "needs_major_compaction=" << (mdata.needs_major_compaction ? "true" : "false") << "\n";
   os << "needs_split=" << (mdata.needs_split ? "true" : "false") << "\n";
+  os << "is_hot=" << (mdata.is_hot ? "true" : "false") << "\n";
   return os;
 }
@@ -39,6 +39,7 @@
 
 #include "AccessGroup.h"
 #include "CellStore.h"
+#include "HotSplitTracker.h"
 #include "LoadFactors.h"
 #include "LoadMetricsRange.h"
 #include "MaintenanceFlag.h"
@@ -99,6 +100,7 @@ namespace Hypertable {
       bool     relinquish;
       bool     needs_major_compaction;
       bool     needs_split;
+      bool     is_hot;
     };
 
     typedef std::map<String, AccessGroup *> AccessGroupMap;
@@ -165,6 +167,9 @@ namespace Hypertable {
 
     void compact(MaintenanceFlag::Map &subtask_map);
 
+    void adopt_cellstores(const String &access_group,
+                          const std::vector<String> &files);
+
     void purge_memory(MaintenanceFlag::Map &subtask_map);
 
     void schedule_relinquish() { m_relinquish = true; }
@@ -318,6 +323,7 @@ namespace Hypertable {
     void relinquish_compact_and_finish();
 
     bool determine_split_row_from_cached_keys(AccessGroupVector &ag_vector);
+    bool determine_split_row_from_access_samples();
 
     void split_install_log();
     void split_compact_and_shrink();
@@ -365,6 +371,9 @@ namespace Hypertable {
     bool             m_removed_from_working_set;
     int64_t          m_maintenance_generation;
     LoadMetricsRange m_load_metrics;
+
+    // Hot split state (protected by m_schema_mutex)
+    HotSplitTracker  m_hot_split_tracker;
   };
 
   typedef intrusive_ptr<Range> RangePtr;
@@ -47,6 +47,7 @@ extern "C" {
 #include "Common/FileUtils.h"
 #include "Common/HashMap.h"
 #include "Common/md5.h"
+#include "Common/Path.h"
 #include "Common/Random.h"
 #include "Common/StringExt.h"
 #include "Common/SystemInfo.h"
@@ -61,6 +62,7 @@ extern "C" {
 #include "Hypertable/Lib/old/RangeServerMetaLogEntries.h"
 
 #include "DfsBroker/Lib/Client.h"
+#include "DfsBroker/Lib/MappedClient.h"
 
 #include "FillScanBlock.h"
 #include "Global.h"
@@ -107,6 +109,9 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
   m_verbose = props->get_bool("verbose");
   Global::range_split_size = cfg.get_i64("Range.SplitSize");
   Global::range_maximum_size = cfg.get_i64("Range.MaximumSize");
+  Global::range_hot_split_cell_rate = cfg.get_i32("Range.HotSplit.CellWriteRate");
+  Global::range_hot_split_scan_rate = cfg.get_i32("Range.HotSplit.ScanRate");
+  Global::range_hot_split_minimum_size = cfg.get_i64("Range.HotSplit.MinimumSize");
   Global::range_metadata_split_size = cfg.get_i64("Range.MetadataSplitSize", Global::range_split_size);
   Global::access_group_garbage_compaction_threshold = cfg.get_i32("AccessGroup.GarbageThreshold.Percentage");
   Global::access_group_max_mem = cfg.get_i64("AccessGroup.MaxMemory");
@@ -135,6 +140,12 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
   Global::toplevel_dir = String("/") + Global::toplevel_dir;
 
   Global::merge_cellstore_run_length_threshold = cfg.get_i32("CellStore.Merge.RunLengthThreshold");
+  Global::major_compaction_partitions =
+    cfg.get_i32("Maintenance.MajorCompaction.Partitions");
+  Global::major_compaction_partition_minimum_size =
+    cfg.get_i64("Maintenance.MajorCompaction.PartitionMinimumSize");
+  Global::major_compaction_threads_available =
+    cfg.get_i32("Maintenance.MajorCompaction.ExtraThreads", (int32_t)m_cores);
   Global::ignore_clock_skew_errors = cfg.get_bool("IgnoreClockSkewErrors");
 
   std::vector<int64_t> collector_periods(2);
@@ -257,9 +268,33 @@ RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_mgr,
   else
     Global::log_dfs = Global::dfs;
 
+  /**
+   * When the local broker shares this host, read files by mapping them
+   * directly out of its root directory.  Commit logs and the RSML are
+   * append-only files that grow while open, so log_dfs keeps the plain
+   * broker client.
+   */
+  if (cfg.get_bool("CellStore.Mmap")) {
+    Path root = props->get_str("DfsBroker.Local.Root", "");
+    if (!root.is_complete()) {
+      Path data_dir = props->get_str("Hypertable.DataDirectory");
+      root = data_dir / root;
+    }
+    HT_INFOF("Memory mapping cell stores from %s", root.string().c_str());
+    Global::dfs = new DfsBroker::MappedClient(Global::dfs, root.string());
+  }
+
   // Create the maintenance queue
   Global::maintenance_queue = new MaintenanceQueue(maintenance_threads);
 
+  // Create the maintenance I/O throttle
+  Global::maintenance_throttle =
+    new MaintenanceThrottle(cfg.get_i64("Maintenance.Throttle.ReadRate"),
+                            cfg.get_i64("Maintenance.Throttle.WriteRate"),
+                            cfg.get_i32("Maintenance.Throttle.UpdateQueueThreshold"),
+                            cfg.get_i32("Maintenance.Throttle.ScanLatencyThreshold"),
+                            cfg.get_f64("Maintenance.Throttle.MinimumFraction"));
+
   // Create table info maps
   m_live_map = new TableInfoMap();
   m_replay_map = new TableInfoMap();
@@ -389,6 +424,7 @@ void RangeServer::shutdown() {
     }
 
     Global::maintenance_queue = 0;
+    Global::maintenance_throttle = 0;
     Global::metadata_table = 0;
     Global::rs_metrics_table = 0;
     Global::hyperspace = 0;
@@ -1293,8 +1329,12 @@ RangeServer::create_scanner(ResponseCallbackCreateScanner *cb,
     decrement_needed = false;
 
     uint64_t cells_scanned, cells_returned, bytes_scanned, bytes_returned;
+    boost::xtime fill_start, fill_end;
 
+    boost::xtime_get(&fill_start, TIME_UTC);
     more = FillScanBlock(scanner, rbuf, m_scanner_buffer_size);
+    boost::xtime_get(&fill_end, TIME_UTC);
+    Global::maintenance_throttle->record_scan_latency(xtime_diff_millis(fill_start, fill_end));
 
     MergeScanner *mscanner = dynamic_cast<MergeScanner*>(scanner.get());
 
@@ -1411,8 +1451,12 @@ RangeServer::fetch_scanblock(ResponseCallbackFetchScanblock *cb,
     }
 
     uint64_t cells_scanned, cells_returned, bytes_scanned, bytes_returned;
+    boost::xtime fill_start, fill_end;
 
+    boost::xtime_get(&fill_start, TIME_UTC);
     more = FillScanBlock(scanner, rbuf, m_scanner_buffer_size);
+    boost::xtime_get(&fill_end, TIME_UTC);
+    Global::maintenance_throttle->record_scan_latency(xtime_diff_millis(fill_start, fill_end));
 
     MergeScanner *mscanner = dynamic_cast<MergeScanner*>(scanner.get());
 
@@ -2065,6 +2109,7 @@ RangeServer::batch_update(std::vector<TableUpdate *> &updates, boost::xtime expi
     ScopedLock lock(m_update_qualify_queue_mutex);
     HT_ASSERT(!updates.empty());
     m_update_qualify_queue.push_back(uc);
+    Global::maintenance_throttle->update_enqueued();
     m_update_qualify_queue_cond.notify_all();
   }
 
@@ -2113,6 +2158,7 @@ void RangeServer::update_qualify_and_transform() {
         return;
       uc = queue.front();
       queue.pop_front();
+      Global::maintenance_throttle->update_dequeued();
     }
 
     rulist = 0;
@@ -3243,7 +3289,12 @@ void RangeServer::get_statistics(ResponseCallbackGetStatistics *cb) {
 
 
 void RangeServer::replay_begin(ResponseCallback *cb, uint16_t group) {
-  String replay_log_dir = Global::toplevel_dir + ("/servers/") + Global::location_initializer->get() + "/log/replay";
+  // Each replay session gets its own directory because it is linked into
+  // the group's commit log on commit and must outlive later sessions
+  String replay_log_dir = format("%s/servers/%s/log/replay/%d-%lld",
+                                 Global::toplevel_dir.c_str(),
+                                 Global::location_initializer->get().c_str(),
+                                 (int)group, (Lld)get_ts64());
 
   m_replay_group = group;
 
@@ -3275,10 +3326,15 @@ void RangeServer::replay_begin(ResponseCallback *cb, uint16_t group) {
     return;
   }
 
-  /**
-   * Commented out for now, should be addressed during failover work
-   */
-  //m_replay_log = new CommitLog(Global::log_dfs, replay_log_dir, m_props);
+  try {
+    m_replay_log = new CommitLog(Global::log_dfs, replay_log_dir, m_props, 0,
+                                 group != RangeServerProtocol::GROUP_USER);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << "Problem creating replay log: " << e << HT_END;
+    cb->error(e.code(), format("Problem creating replay log: %s", e.what()));
+    return;
+  }
 
   cb->response_ok();
 }
@@ -3303,7 +3359,7 @@ RangeServer::replay_update(ResponseCallback *cb, const uint8_t *data,
   Key key;
   const uint8_t *ptr = data;
   const uint8_t *end = data + len;
-  const uint8_t *block_end;
+  const uint8_t *block_start, *block_end;
   uint32_t block_size;
   size_t remaining = len;
   const char *row;
@@ -3323,16 +3379,8 @@ RangeServer::replay_update(ResponseCallback *cb, const uint8_t *data,
       block_size = decode_i32(&ptr, &remaining);
       revision = decode_i64(&ptr, &remaining);
 
-      if (m_replay_log) {
-        DynamicBuffer dbuf(0, false);
-        dbuf.base = (uint8_t *)ptr;
-        dbuf.ptr = dbuf.base + remaining;
-
-        if ((error = m_replay_log->write(dbuf, revision)) != Error::OK)
-          HT_THROW(error, "");
-      }
-
       // decode table identifier
+      block_start = ptr;
       table_identifier.decode(&ptr, &remaining);
 
       if (block_size > remaining)
@@ -3340,6 +3388,17 @@ RangeServer::replay_update(ResponseCallback *cb, const uint8_t *data,
                   (Lu)block_size);
 
       block_end = ptr + block_size;
+      remaining -= block_size;
+
+      // log the table identifier and this block only
+      if (m_replay_log) {
+        DynamicBuffer dbuf(0, false);
+        dbuf.base = (uint8_t *)block_start;
+        dbuf.ptr = (uint8_t *)block_end;
+
+        if ((error = m_replay_log->write(dbuf, revision)) != Error::OK)
+          HT_THROW(error, "");
+      }
 
       // Fetch table info
       if (!m_replay_map->get(table_identifier.id, table_info))
@@ -3416,20 +3475,53 @@ void RangeServer::replay_commit(ResponseCallback *cb) {
     CommitLog *log = 0;
     std::vector<RangePtr> rangev;
 
-    if (m_replay_group == RangeServerProtocol::GROUP_METADATA_ROOT)
+    if (!m_replay_log)
+      HT_THROW(Error::FAILED_EXPECTATION, "replay_commit called without replay_begin");
+
+    /**
+     * Create the group's commit log if this server has not hosted a
+     * range of the group before
+     */
+    if (m_replay_group == RangeServerProtocol::GROUP_METADATA_ROOT) {
+      if (Global::root_log == 0) {
+        Global::log_dfs->mkdirs(Global::log_dir + "/root");
+        Global::root_log = new CommitLog(Global::log_dfs, Global::log_dir
+                                         + "/root", m_props);
+      }
       log = Global::root_log;
-    else if (m_replay_group == RangeServerProtocol::GROUP_METADATA)
+    }
+    else if (m_replay_group == RangeServerProtocol::GROUP_METADATA) {
+      if (Global::metadata_log == 0) {
+        Global::log_dfs->mkdirs(Global::log_dir + "/metadata");
+        Global::metadata_log = new CommitLog(Global::log_dfs,
+                                             Global::log_dir + "/metadata", m_props);
+      }
       log = Global::metadata_log;
-    else if (m_replay_group == RangeServerProtocol::GROUP_SYSTEM)
+    }
+    else if (m_replay_group == RangeServerProtocol::GROUP_SYSTEM) {
+      if (Global::system_log == 0) {
+        Global::log_dfs->mkdirs(Global::log_dir + "/system");
+        Global::system_log = new CommitLog(Global::log_dfs,
+                                           Global::log_dir + "/system", m_props);
+      }
       log = Global::system_log;
-    else if (m_replay_group == RangeServerProtocol::GROUP_USER)
+    }
+    else
       log = Global::user_log;
 
-    /** FIX ME - should we link here?  what about stitch_in? **/
-    if ((error = log->link_log(m_replay_log.get())) != Error::OK)
-      HT_THROW(error, String("Problem linking replay log (")
-               + m_replay_log->get_log_dir() + ") into commit log ("
-               + log->get_log_dir() + ")");
+    if ((error = m_replay_log->close()) != Error::OK)
+      HT_THROW(error, String("Problem closing replay log ")
+               + m_replay_log->get_log_dir());
+
+    // An empty replay log has no revision to link at
+    if (m_replay_log->get_latest_revision() != TIMESTAMP_MIN ||
+        !m_replay_log->empty()) {
+      if ((error = log->link_log(m_replay_log.get())) != Error::OK)
+        HT_THROW(error, String("Problem linking replay log (")
+                 + m_replay_log->get_log_dir() + ") into commit log ("
+                 + log->get_log_dir() + ")");
+    }
+    m_replay_log = 0;
 
     // Perform any range specific post-replay tasks
     m_replay_map->get_range_vector(rangev);
@@ -3547,6 +3639,51 @@ RangeServer::relinquish_range(ResponseCallback *cb, const TableIdentifier *table
 }
 
 
+void
+RangeServer::adopt_cellstores(ResponseCallback *cb, const TableIdentifier *table,
+                              const RangeSpec *range_spec,
+                              const char *access_group,
+                              const std::vector<String> &files) {
+  TableInfoPtr table_info;
+  RangePtr range;
+
+  HT_INFO_OUT << "adopt_cellstores access_group=" << access_group
+              << " files=" << files.size() << "\n" << *table << *range_spec
+              << HT_END;
+
+  if (!m_replay_finished) {
+    if (!wait_for_recovery_finish(cb->get_event()->expiration_time()))
+      return;
+  }
+
+  try {
+
+    if (table->is_system())
+      HT_THROW(Error::NOT_ALLOWED, "Cannot adopt CellStores into system tables");
+
+    if (!m_live_map->get(table->id, table_info)) {
+      cb->error(Error::TABLE_NOT_FOUND, table->id);
+      return;
+    }
+
+    if (!table_info->get_range(range_spec, range))
+      HT_THROW(Error::RANGESERVER_RANGE_NOT_FOUND,
+               format("%s[%s..%s]", table->id, range_spec->start_row, range_spec->end_row));
+
+    range->adopt_cellstores(access_group, files);
+
+    cb->response_ok();
+  }
+  catch (Hypertable::Exception &e) {
+    int error = 0;
+    HT_INFO_OUT << e << HT_END;
+    if (cb && (error = cb->error(e.code(), e.what())) != Error::OK)
+      HT_ERRORF("Problem sending error response - %s", Error::get_text(error));
+  }
+
+}
+
+
 void RangeServer::wait_for_maintenance(ResponseCallback *cb) {
   boost::xtime expire_time;
   HT_INFO("wait_for_maintenance");
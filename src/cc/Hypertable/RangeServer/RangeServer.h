@@ -112,6 +112,10 @@ namespace Hypertable {
 
     void metadata_sync(ResponseCallback *, const char *, uint32_t flags, std::vector<const char *> columns);
 
+    void adopt_cellstores(ResponseCallback *, const TableIdentifier *,
+                          const RangeSpec *, const char *access_group,
+                          const std::vector<String> &files);
+
     /**
      * Blocks while the maintenance queue is non-empty
      *
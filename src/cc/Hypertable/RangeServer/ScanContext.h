@@ -138,6 +138,13 @@ namespace Hypertable {
     }
     bool has_qualifier_regexp_filter() const { return filter_by_regexp_qualifier;}
 
+    // true if only cells with one of the exact qualifiers can match
+    bool has_only_exact_qualifiers() const {
+      return filter_by_exact_qualifier && !filter_by_regexp_qualifier
+                && !filter_by_prefix_qualifier && !accept_empty_qualifier;
+    }
+    const StringSet &get_exact_qualifiers() const { return exact_qualifiers; }
+
     int64_t  cutoff_time;
     uint32_t max_versions;
     bool counter;
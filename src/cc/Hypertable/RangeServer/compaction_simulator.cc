@@ -0,0 +1,236 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include "Common/Compat.h"
+#include "Common/Init.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include <boost/algorithm/string.hpp>
+
+#include "Common/Config.h"
+
+#include "CompactionPolicy.h"
+
+using namespace Hypertable;
+using namespace Config;
+using namespace std;
+
+namespace {
+
+  const char *usage =
+    "\n"
+    "Usage: compaction_simulator [options] [<trace-file>]\n\n"
+    "Description:\n"
+    "  This program replays a write trace against one or more access group\n"
+    "  compaction policies and reports the resulting write amplification\n"
+    "  (bytes written to CellStores per byte flushed from the cell cache)\n"
+    "  and read amplification (number of CellStores a lookup must probe).\n"
+    "  Each non-comment line of <trace-file> describes one minor compaction\n"
+    "  as '<bytes> [<timestamp-min> <timestamp-max>]', with timestamps in\n"
+    "  nanoseconds.  If no trace file is given, a synthetic append-only trace\n"
+    "  is generated.  With --ttl, CellStores whose newest cell is older than\n"
+    "  the TTL (relative to the newest flushed cell) are dropped whole.\n\n"
+    "Options";
+
+  struct AppPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc(usage).add_options()
+        ("policy", strs(), "Compaction policy spec to simulate (may be "
+         "repeated, default: default, size-tiered, leveled and time-window)")
+        ("flushes", i32()->default_value(1000),
+         "Number of minor compactions in the synthetic trace")
+        ("flush-size", i64()->default_value(4*1024*1024),
+         "Bytes per minor compaction in the synthetic trace")
+        ("flush-interval", i32()->default_value(60),
+         "Seconds of data per minor compaction in the synthetic trace")
+        ("ttl", i32()->default_value(0),
+         "TTL in seconds of the simulated access group (0 = no TTL)")
+        ("verbose,v", boo()->zero_tokens()->default_value(false),
+         "Show every merge performed")
+        ;
+      cmdline_hidden_desc().add_options()
+        ("trace-file", str(), "Write trace file")
+        ;
+      cmdline_positional_desc().add("trace-file", -1);
+    }
+  };
+
+  typedef Meta::list<AppPolicy, DefaultPolicy> Policies;
+
+  typedef CompactionPolicy::StoreInfo StoreInfo;
+
+  struct SimulationResult {
+    SimulationResult() : ingested(0), written(0), merges(0), dropped(0),
+                         store_sum(0), store_max(0), store_final(0) { }
+    int64_t ingested;
+    int64_t written;
+    int64_t merges;
+    int64_t dropped;
+    int64_t store_sum;
+    size_t store_max;
+    size_t store_final;
+  };
+
+  void load_trace(const String &fname, vector<StoreInfo> &trace) {
+    ifstream in(fname.c_str());
+    String line;
+
+    if (!in)
+      HT_THROWF(Error::FILE_NOT_FOUND, "Unable to open trace file '%s'",
+                fname.c_str());
+
+    while (getline(in, line)) {
+      boost::trim(line);
+      if (line.empty() || line[0] == '#')
+        continue;
+      long long size = 0, ts_min = 0, ts_max = 0;
+      int n = sscanf(line.c_str(), "%lld %lld %lld", &size, &ts_min, &ts_max);
+      if (n < 1 || size < 0)
+        HT_THROWF(Error::COMMAND_PARSE_ERROR, "Bad trace line '%s'", line.c_str());
+      if (n < 3)
+        ts_min = ts_max = (int64_t)trace.size();
+      trace.push_back(StoreInfo(size, ts_min, ts_max));
+    }
+  }
+
+  void generate_trace(vector<StoreInfo> &trace) {
+    int32_t flushes = get_i32("flushes");
+    int64_t flush_size = get_i64("flush-size");
+    int64_t interval = (int64_t)get_i32("flush-interval") * 1000000000LL;
+
+    for (int32_t i=0; i<flushes; i++)
+      trace.push_back(StoreInfo(flush_size, i*interval,
+                                ((i+1)*interval) - 1));
+  }
+
+  void simulate(CompactionPolicy *policy, const vector<StoreInfo> &trace,
+                int64_t ttl, bool verbose, SimulationResult &result) {
+    vector<StoreInfo> stores;
+    size_t index, length;
+
+    foreach(const StoreInfo &flush, trace) {
+      stores.push_back(flush);
+      result.ingested += flush.disk_usage;
+      result.written += flush.disk_usage;
+
+      if (ttl) {
+        vector<StoreInfo> live;
+        foreach(const StoreInfo &store, stores) {
+          if (store.timestamp_max < flush.timestamp_max - ttl)
+            result.dropped++;
+          else
+            live.push_back(store);
+        }
+        stores.swap(live);
+      }
+
+      while (policy->find_merge_run(stores, &index, &length)) {
+        StoreInfo merged(0, stores[index].timestamp_min,
+                         stores[index].timestamp_max);
+        for (size_t i=index; i<index+length; i++) {
+          merged.disk_usage += stores[i].disk_usage;
+          merged.timestamp_min = std::min(merged.timestamp_min,
+                                          stores[i].timestamp_min);
+          merged.timestamp_max = std::max(merged.timestamp_max,
+                                          stores[i].timestamp_max);
+        }
+        if (verbose)
+          cout << policy->name() << ": merge " << length << " stores at "
+               << index << " -> " << merged.disk_usage << " bytes" << endl;
+        stores.erase(stores.begin()+index, stores.begin()+index+length);
+        stores.insert(stores.begin()+index, merged);
+        result.written += merged.disk_usage;
+        result.merges++;
+      }
+
+      result.store_sum += stores.size();
+      if (stores.size() > result.store_max)
+        result.store_max = stores.size();
+    }
+    result.store_final = stores.size();
+  }
+
+} // local namespace
+
+
+int main(int argc, char **argv) {
+  try {
+    init_with_policies<Policies>(argc, argv);
+
+    vector<StoreInfo> trace;
+    vector<String> specs;
+    bool verbose = get_bool("verbose");
+    int64_t ttl = (int64_t)get_i32("ttl") * 1000000000LL;
+    CompactionPolicy::Settings settings;
+
+    settings.target_size_min =
+      get_i64("Hypertable.RangeServer.CellStore.TargetSize.Minimum");
+    settings.target_size_max = settings.target_size_min +
+      get_i64("Hypertable.RangeServer.CellStore.TargetSize.Window");
+    settings.run_length_threshold =
+      get_i32("Hypertable.RangeServer.CellStore.Merge.RunLengthThreshold");
+
+    if (has("trace-file"))
+      load_trace(get_str("trace-file"), trace);
+    else
+      generate_trace(trace);
+
+    if (has("policy"))
+      specs = get_strs("policy");
+    else {
+      specs.push_back("default");
+      specs.push_back("size-tiered");
+      specs.push_back("leveled");
+      specs.push_back("time-window");
+    }
+
+    printf("%-32s %10s %10s %10s %8s %10s %10s %10s\n", "policy",
+           "write-amp", "merges", "dropped", "flushes", "avg-read",
+           "max-read", "final");
+
+    foreach(const String &spec, specs) {
+      CompactionPolicyPtr policy = CompactionPolicy::create(spec, settings);
+      SimulationResult result;
+
+      simulate(policy.get(), trace, ttl, verbose, result);
+
+      double write_amp = result.ingested ?
+        (double)result.written / (double)result.ingested : 0.0;
+      double read_amp = trace.empty() ? 0.0 :
+        (double)result.store_sum / (double)trace.size();
+
+      printf("%-32s %10.2f %10lld %10lld %8lu %10.2f %10lu %10lu\n",
+             spec.c_str(), write_amp, (long long)result.merges,
+             (long long)result.dropped, (unsigned long)trace.size(),
+             read_amp, (unsigned long)result.store_max,
+             (unsigned long)result.store_final);
+    }
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+  return 0;
+}
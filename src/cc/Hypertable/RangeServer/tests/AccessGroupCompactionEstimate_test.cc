@@ -0,0 +1,71 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include <vector>
+
+#include "../AccessGroup.h"
+#include "../CellStoreInfo.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  void add_store(std::vector<CellStoreInfo> &stores, int64_t cell_count) {
+    CellStoreInfo csi;
+    csi.cell_count = cell_count;
+    stores.push_back(csi);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  std::vector<CellStoreInfo> stores;
+
+  add_store(stores, 1000);
+  add_store(stores, 200);
+  add_store(stores, 30);
+
+  // minor compaction, cache only
+  HT_ASSERT(AccessGroup::estimate_compaction_entries(stores, 0, 0, 5) == 5);
+
+  // merging compaction of a run of stores
+  HT_ASSERT(AccessGroup::estimate_compaction_entries(stores, 1, 2, 0) == 230);
+
+  // major compaction includes the immutable cache
+  HT_ASSERT(AccessGroup::estimate_compaction_entries(stores, 0, 3, 4) == 1234);
+
+  // partitioned major compaction divides stores and cache among the
+  // partitions, rounding up so no partition is undersized
+  HT_ASSERT(AccessGroup::estimate_compaction_entries(stores, 0, 3, 4, 2) == 617);
+  HT_ASSERT(AccessGroup::estimate_compaction_entries(stores, 0, 3, 5, 2) == 618);
+  HT_ASSERT(AccessGroup::estimate_compaction_entries(stores, 0, 3, 4, 4) == 309);
+
+  // cache entries count even when the stores are empty
+  stores.clear();
+  add_store(stores, 0);
+  HT_ASSERT(AccessGroup::estimate_compaction_entries(stores, 0, 1, 1000, 3) == 334);
+
+  return 0;
+}
@@ -192,6 +192,16 @@ int main(int argc, char **argv) {
 
     HT_ASSERT(tracker.check_needed(0, 361));
 
+    // dropping expired CellStores whole removes their expirable data
+    tracker.remove_expirable(amount/2);
+    HT_ASSERT(tracker.expirable_accumulated() == amount/4);
+    HT_ASSERT(!tracker.check_needed(0, 361));
+    tracker.remove_expirable(amount);
+    HT_ASSERT(tracker.expirable_accumulated() == 0);
+
+    tracker.accumulate_expirable(amount);
+    HT_ASSERT(tracker.check_needed(0, 361));
+
     tracker.clear(1);
     HT_ASSERT(!tracker.check_needed(0, 361));
 
@@ -0,0 +1,188 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+#include "Common/System.h"
+
+#include <cstring>
+#include <vector>
+
+#include "Hypertable/Lib/Key.h"
+
+#include "../CellStore.h"
+#include "../CellStoreBlockIndexPartitioned.h"
+#include "../FileBlockCache.h"
+#include "../Global.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  const size_t PARTITIONS = 3;
+  const size_t BLOCKS_PER_PARTITION = 4;
+  const int64_t BLOCK_SIZE = 1000;
+  const int64_t PARTITION_SIZE = 500;
+  const int64_t END_OF_DATA = PARTITIONS * BLOCKS_PER_PARTITION * BLOCK_SIZE;
+  const int64_t END_OF_PARTITIONS = END_OF_DATA + PARTITIONS * PARTITION_SIZE;
+
+  /**
+   * Cell store stand-in that only provides a file id; partitions are
+   * served from the block cache so no file is ever read
+   */
+  class DummyCellStore : public CellStore {
+  public:
+    DummyCellStore() : m_file_id(FileBlockCache::get_next_file_id()) { }
+    virtual void add(const Key &key, const ByteString value) { }
+    virtual const char *get_split_row() { return 0; }
+    virtual int64_t get_total_entries() { return 0; }
+    virtual void create(const char *fname, size_t max_entries,
+                        PropertiesPtr &props, const TableIdentifier *table_id=0) { }
+    virtual void finalize(TableIdentifier *table_identifier) { }
+    virtual void open(const String &fname, const String &start_row,
+                      const String &end_row, int32_t fd, int64_t file_length,
+                      CellStoreTrailer *trailer) { }
+    virtual int64_t get_blocksize() { return BLOCK_SIZE; }
+    virtual bool may_contain(const void *key, size_t len) { return true; }
+    virtual bool may_contain(ScanContextPtr &) { return true; }
+    virtual uint64_t disk_usage() { return END_OF_PARTITIONS; }
+    virtual float compression_ratio() { return 1.0; }
+    virtual std::string &get_filename() { return m_filename; }
+    virtual int get_file_id() { return m_file_id; }
+    virtual CellStoreTrailer *get_trailer() { return 0; }
+    virtual BlockCompressionCodec *create_block_compression_codec() {
+      HT_FATAL("Partition not found in block cache");
+      return 0;
+    }
+    virtual void display_block_info() { }
+    virtual size_t bloom_filter_size() { return 0; }
+    virtual int32_t get_fd() { return -1; }
+    virtual int32_t reopen_fd() { return -1; }
+    virtual int64_t bloom_filter_memory_used() { return 0; }
+    virtual int64_t block_index_memory_used() { return 0; }
+    virtual int64_t end_of_last_block() { return END_OF_DATA; }
+    virtual uint64_t purge_indexes() { return 0; }
+    virtual bool restricted_range() { return false; }
+  private:
+    String m_filename;
+    int m_file_id;
+  };
+
+  void append_key(DynamicBuffer &buf, size_t block) {
+    char row[16];
+    sprintf(row, "row%02d", (int)block);
+    create_key_and_append(buf, FLAG_INSERT, row, 1, "", 0, 0);
+  }
+
+  /**
+   * Block b is at offset b*BLOCK_SIZE and holds row b; partition p holds
+   * blocks [p*BLOCKS_PER_PARTITION, (p+1)*BLOCKS_PER_PARTITION) and is
+   * placed in the block cache at END_OF_DATA + p*PARTITION_SIZE
+   */
+  void load_partitions(int file_id) {
+    for (size_t p=0; p<PARTITIONS; p++) {
+      std::vector<int64_t> offsets;
+      DynamicBuffer keys, buf;
+      size_t block = p * BLOCKS_PER_PARTITION;
+      for (size_t i=0; i<BLOCKS_PER_PARTITION; i++, block++) {
+        offsets.push_back(block * BLOCK_SIZE);
+        append_key(keys, block);
+      }
+      CellStoreBlockIndexPartition::serialize(offsets, keys, buf);
+      uint32_t length = buf.fill();
+      HT_ASSERT(Global::block_cache->insert(file_id,
+                (uint32_t)(END_OF_DATA + p * PARTITION_SIZE),
+                buf.release(), length));
+    }
+  }
+
+  /**
+   * Builds the top level index, which maps the last row of each partition
+   * to the partition's offset
+   */
+  void build_index(DynamicBuffer &fixed, DynamicBuffer &variable) {
+    for (size_t p=0; p<PARTITIONS; p++) {
+      int64_t offset = END_OF_DATA + p * PARTITION_SIZE;
+      fixed.ensure(8);
+      memcpy(fixed.ptr, &offset, 8);
+      fixed.ptr += 8;
+      append_key(variable, (p+1) * BLOCKS_PER_PARTITION - 1);
+    }
+  }
+
+  void check(CellStore *cs, const String &start_row, const String &end_row,
+             size_t first_block, size_t last_block) {
+    CellStoreBlockIndexPartitioned index;
+    DynamicBuffer fixed, variable;
+    int64_t last_offset = -1;
+    size_t count = 0;
+
+    build_index(fixed, variable);
+    index.load(cs, fixed, variable, END_OF_PARTITIONS, start_row, end_row);
+
+    for (CellStoreBlockIndexPartitioned::iterator iter = index.begin();
+         iter != index.end(); ++iter) {
+      if (count++ == 0)
+        HT_ASSERT(iter.value() == (int64_t)(first_block * BLOCK_SIZE));
+      last_offset = iter.value();
+    }
+    HT_ASSERT(last_offset == (int64_t)(last_block * BLOCK_SIZE));
+    HT_ASSERT(count == last_block - first_block + 1);
+
+    // the last block in scope must not extend into the next partition
+    HT_ASSERT(index.end_of_last_block() - last_offset == BLOCK_SIZE);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  System::initialize(System::locate_install_dir(argv[0]));
+
+  Global::block_cache = new FileBlockCache(0, 1024*1024, false);
+
+  {
+    DummyCellStore cs;
+
+    load_partitions(cs.get_file_id());
+
+    // whole store
+    check(&cs, "", "", 0, 11);
+
+    // end row in the second partition, third partition out of scope
+    check(&cs, "", "row05", 0, 7);
+
+    // end row is the last row of a partition
+    check(&cs, "", "row03", 0, 7);
+
+    // start and end row
+    check(&cs, "row04", "row06", 4, 7);
+    check(&cs, "row00", "row02", 0, 3);
+
+    // end row in the last partition
+    check(&cs, "", "row09", 0, 11);
+  }
+
+  delete Global::block_cache;
+  Global::block_cache = 0;
+
+  return 0;
+}
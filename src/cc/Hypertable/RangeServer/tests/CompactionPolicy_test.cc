@@ -0,0 +1,232 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include <cstring>
+#include <vector>
+
+#include "../CompactionPolicy.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  typedef CompactionPolicy::StoreInfo StoreInfo;
+
+  const int64_t SECOND = 1000000000LL;
+
+  CompactionPolicy::Settings settings() {
+    CompactionPolicy::Settings settings;
+    settings.target_size_min = 10;
+    settings.target_size_max = 100;
+    settings.run_length_threshold = 3;
+    return settings;
+  }
+
+  /** Builds stores from disk usages, oldest first */
+  std::vector<StoreInfo> stores(size_t count, const int64_t *sizes) {
+    std::vector<StoreInfo> result;
+    for (size_t i=0; i<count; i++)
+      result.push_back(StoreInfo(sizes[i]));
+    return result;
+  }
+
+  /** Returns a store whose newest cell falls in timestamp window (second) w */
+  StoreInfo windowed(int64_t size, int64_t w) {
+    return StoreInfo(size, w * SECOND, w * SECOND + SECOND / 2);
+  }
+
+  void check(CompactionPolicy &policy, const std::vector<StoreInfo> &stores,
+             size_t index, size_t length) {
+    size_t run_index = 0, run_length = 0;
+    HT_ASSERT(policy.find_merge_run(stores, &run_index, &run_length));
+    HT_ASSERT(run_index == index && run_length == length);
+    HT_ASSERT(policy.needs_merging(stores));
+  }
+
+  void check_none(CompactionPolicy &policy,
+                  const std::vector<StoreInfo> &stores) {
+    HT_ASSERT(!policy.find_merge_run(stores));
+    HT_ASSERT(!policy.needs_merging(stores));
+  }
+
+  void test_default() {
+    CompactionPolicyDefault policy(settings());
+
+    check_none(policy, std::vector<StoreInfo>());
+
+    // small stores after a large one add up to the target minimum
+    const int64_t small_tail[] = { 200, 5, 5 };
+    check(policy, stores(3, small_tail), 1, 2);
+
+    // stores at the target maximum are left alone
+    const int64_t large[] = { 200, 300 };
+    check_none(policy, stores(2, large));
+
+    // the pair would overshoot the target maximum
+    const int64_t overshoot[] = { 50, 60 };
+    check_none(policy, stores(2, overshoot));
+
+    // a run longer than the run length threshold is merged even when tiny
+    const int64_t tiny[] = { 1, 1, 1, 1 };
+    check(policy, stores(4, tiny), 0, 4);
+
+    // the store that reaches the target maximum ends the run
+    const int64_t long_run[] = { 1, 1, 1, 1, 200 };
+    check(policy, stores(5, long_run), 0, 4);
+  }
+
+  void test_size_tiered() {
+    CompactionPolicySizeTiered policy(settings(), 3, 4, 0.5, 1.5);
+
+    check_none(policy, std::vector<StoreInfo>());
+
+    const int64_t one_tier[] = { 100, 100, 100 };
+    check(policy, stores(3, one_tier), 0, 3);
+
+    // below the minimum threshold
+    const int64_t two[] = { 100, 100 };
+    check_none(policy, stores(2, two));
+
+    // the tier with the smallest stores is chosen, capped at max-threshold
+    const int64_t tiers[] = { 1000, 100, 110, 90, 5, 5, 5, 5, 5 };
+    check(policy, stores(9, tiers), 4, 4);
+
+    // stores below the target minimum share a tier whatever their ratio
+    const int64_t small[] = { 9, 1, 9 };
+    check(policy, stores(3, small), 0, 3);
+
+    // dissimilar sizes never form a tier
+    const int64_t dissimilar[] = { 1000, 100, 1000, 100 };
+    check_none(policy, stores(4, dissimilar));
+  }
+
+  void test_leveled() {
+    CompactionPolicyLeveled policy(settings(), 10);
+
+    const int64_t single[] = { 5 };
+    check_none(policy, stores(1, single));
+
+    // level 0 stores add up to the target minimum
+    const int64_t level0[] = { 1000, 100, 4, 4, 4 };
+    check(policy, stores(5, level0), 2, 3);
+
+    // level 0 is too small to merge and the levels respect the fanout
+    const int64_t small_level0[] = { 1000, 100, 4, 4 };
+    check_none(policy, stores(4, small_level0));
+
+    // the newest pair violating the fanout is merged
+    const int64_t violation[] = { 1000, 500, 10 };
+    check(policy, stores(3, violation), 0, 2);
+
+    // the merge carries into the older level the result would violate
+    const int64_t carry[] = { 100000, 1500, 150, 20 };
+    check(policy, stores(4, carry), 1, 3);
+
+    const int64_t balanced[] = { 100000, 10000, 1000, 100 };
+    check_none(policy, stores(4, balanced));
+  }
+
+  void test_time_window() {
+    CompactionPolicyTimeWindow policy(settings(), 1, 3, 4);
+    std::vector<StoreInfo> stores;
+
+    // a closed window is merged as a whole, whatever the sizes
+    stores.push_back(windowed(100, 0));
+    stores.push_back(windowed(5, 0));
+    stores.push_back(windowed(100, 1));
+    check(policy, stores, 0, 2);
+
+    // one store per closed window
+    stores.clear();
+    stores.push_back(windowed(100, 0));
+    stores.push_back(windowed(100, 1));
+    check_none(policy, stores);
+
+    // the current window is size-tiered
+    stores.clear();
+    stores.push_back(windowed(100, 1));
+    stores.push_back(windowed(100, 1));
+    check_none(policy, stores);
+    stores.push_back(windowed(100, 1));
+    check(policy, stores, 0, 3);
+
+    stores.clear();
+    stores.push_back(windowed(1000, 1));
+    stores.push_back(windowed(100, 1));
+    stores.push_back(windowed(100, 1));
+    stores.push_back(windowed(100, 1));
+    check(policy, stores, 1, 3);
+
+    // closed window runs are capped at max-threshold
+    stores.clear();
+    for (size_t i=0; i<6; i++)
+      stores.push_back(windowed(10, 0));
+    stores.push_back(windowed(10, 1));
+    check(policy, stores, 0, 4);
+
+    // stores without timestamped cells split runs
+    stores.clear();
+    stores.push_back(windowed(100, 0));
+    stores.push_back(StoreInfo(100, 1, 0));
+    stores.push_back(windowed(100, 0));
+    stores.push_back(windowed(50, 1));
+    check_none(policy, stores);
+  }
+
+  void test_create() {
+    CompactionPolicyPtr policy;
+
+    policy = CompactionPolicy::create("", settings());
+    HT_ASSERT(!strcmp(policy->name(), "default"));
+
+    policy = CompactionPolicy::create("merge-run", settings());
+    HT_ASSERT(!strcmp(policy->name(), "default"));
+
+    policy = CompactionPolicy::create("tiered --min-threshold 3", settings());
+    HT_ASSERT(!strcmp(policy->name(), "size-tiered"));
+    const int64_t one_tier[] = { 100, 100, 100 };
+    HT_ASSERT(policy->find_merge_run(stores(3, one_tier)));
+
+    policy = CompactionPolicy::create("leveled --fanout 4", settings());
+    HT_ASSERT(!strcmp(policy->name(), "leveled"));
+    const int64_t fanout[] = { 1000, 200 };
+    HT_ASSERT(!policy->find_merge_run(stores(2, fanout)));
+
+    policy = CompactionPolicy::create("time-window --window 3600", settings());
+    HT_ASSERT(!strcmp(policy->name(), "time-window"));
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  test_default();
+  test_size_tiered();
+  test_leveled();
+  test_time_window();
+  test_create();
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "../HotSplitTracker.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  const int64_t MINIMUM_SIZE = 1000;
+
+  /**
+   * Accesses rows [first, first+rows) round robin, SAMPLE_INTERVAL times
+   * each, so that every row is sampled once per round
+   */
+  void access(HotSplitTracker &tracker, int first, int rows, int count) {
+    char row[16];
+    for (int i=0; i<count; i++) {
+      sprintf(row, "row%04d", first + (i / HotSplitTracker::SAMPLE_INTERVAL) % rows);
+      tracker.sample(row);
+    }
+  }
+
+  void test_choose_split_row() {
+    std::vector<String> samples;
+    String split_row;
+
+    // too few samples
+    for (int i=0; i<HotSplitTracker::MINIMUM_SAMPLES-1; i++)
+      samples.push_back(format("row%04d", i));
+    HT_ASSERT(!HotSplitTracker::choose_split_row(samples, "", "\xff\xff",
+                                                 split_row));
+
+    // evenly spread samples are split at the median
+    samples.clear();
+    for (int i=0; i<100; i++)
+      samples.push_back(format("row%04d", 99-i));
+    HT_ASSERT(HotSplitTracker::choose_split_row(samples, "", "\xff\xff",
+                                                split_row));
+    HT_ASSERT(split_row == "row0049");
+
+    // samples outside (start_row, end_row] are ignored
+    samples.clear();
+    for (int i=0; i<100; i++)
+      samples.push_back(format("row%04d", i));
+    HT_ASSERT(HotSplitTracker::choose_split_row(samples, "row0019", "row0099",
+                                                split_row));
+    HT_ASSERT(split_row == "row0059");
+
+    // the median is the end row, so the split row must be below it
+    samples.clear();
+    for (int i=0; i<100; i++)
+      samples.push_back(i < 30 ? format("row%04d", i) : String("row9999"));
+    HT_ASSERT(HotSplitTracker::choose_split_row(samples, "", "row9999",
+                                                split_row));
+    HT_ASSERT(split_row == "row0029");
+
+    // a single hot row can't be divided
+    samples.clear();
+    for (int i=0; i<100; i++)
+      samples.push_back("row0001");
+    HT_ASSERT(!HotSplitTracker::choose_split_row(samples, "", "row9999",
+                                                 split_row));
+
+    // too few distinct rows
+    samples.clear();
+    for (int i=0; i<100; i++)
+      samples.push_back(format("row%04d", i % (HotSplitTracker::MINIMUM_DISTINCT_SAMPLES-1)));
+    HT_ASSERT(!HotSplitTracker::choose_split_row(samples, "", "row9999",
+                                                 split_row));
+  }
+
+  void test_minimum_size() {
+    HotSplitTracker tracker(100, 0, MINIMUM_SIZE);
+    time_t now = 1000;
+
+    access(tracker, 0, 100, 100 * HotSplitTracker::SAMPLE_INTERVAL);
+    HT_ASSERT(!tracker.check(now, 0, 0, MINIMUM_SIZE-1, "", "row9999"));
+    now += 10;
+    HT_ASSERT(!tracker.check(now, 10000, 0, MINIMUM_SIZE-1, "", "row9999"));
+    HT_ASSERT(tracker.backoff() == 0);
+    now += 10;
+    HT_ASSERT(tracker.check(now, 20000, 0, MINIMUM_SIZE, "", "row9999"));
+  }
+
+  void test_rates() {
+    HotSplitTracker tracker(100, 10, MINIMUM_SIZE);
+    String split_row;
+    time_t now = 1000;
+
+    access(tracker, 0, 100, 100 * HotSplitTracker::SAMPLE_INTERVAL);
+
+    // first check only establishes the baseline
+    HT_ASSERT(!tracker.check(now, 0, 0, MINIMUM_SIZE, "", "row9999"));
+
+    // below both rates
+    now += 10;
+    HT_ASSERT(!tracker.check(now, 1000, 100, MINIMUM_SIZE, "", "row9999"));
+
+    // above the scan rate
+    now += 10;
+    HT_ASSERT(tracker.check(now, 2000, 300, MINIMUM_SIZE, "", "row9999"));
+
+    // stays hot until the split row is consumed
+    now += 10;
+    HT_ASSERT(tracker.check(now, 2000, 300, MINIMUM_SIZE, "", "row9999"));
+    HT_ASSERT(tracker.consume_split_row(split_row));
+    HT_ASSERT(split_row == "row0049");
+    HT_ASSERT(!tracker.is_hot());
+    HT_ASSERT(!tracker.consume_split_row(split_row));
+
+    // samples are discarded by the split
+    now += 10;
+    HT_ASSERT(!tracker.check(now, 100000, 300, MINIMUM_SIZE, "", "row0049"));
+  }
+
+  void test_backoff() {
+    HotSplitTracker tracker(100, 0, MINIMUM_SIZE);
+    uint64_t cells = 0;
+    time_t now = 1000;
+
+    // all accesses are to the end row, so there is nothing to split at
+    access(tracker, 9999, 1, 100 * HotSplitTracker::SAMPLE_INTERVAL);
+    HT_ASSERT(!tracker.check(now, cells, 0, MINIMUM_SIZE, "", "row9999"));
+
+    now += 10;
+    cells += 10000;
+    HT_ASSERT(!tracker.check(now, cells, 0, MINIMUM_SIZE, "", "row9999"));
+    HT_ASSERT(tracker.backoff() == HotSplitTracker::INITIAL_BACKOFF);
+
+    // the access pattern changes but checks are suspended during backoff
+    access(tracker, 0, 100, 300 * HotSplitTracker::SAMPLE_INTERVAL);
+    now += 10;
+    cells += 10000;
+    HT_ASSERT(!tracker.check(now, cells, 0, MINIMUM_SIZE, "", "row9999"));
+    HT_ASSERT(tracker.backoff() == HotSplitTracker::INITIAL_BACKOFF);
+
+    now += HotSplitTracker::INITIAL_BACKOFF;
+    cells += 100000;
+    HT_ASSERT(tracker.check(now, cells, 0, MINIMUM_SIZE, "", "row9999"));
+    HT_ASSERT(tracker.backoff() == 0);
+  }
+
+  void test_backoff_doubles() {
+    HotSplitTracker tracker(100, 0, MINIMUM_SIZE);
+    uint64_t cells = 0;
+    time_t now = 1000;
+    time_t expected = HotSplitTracker::INITIAL_BACKOFF;
+
+    access(tracker, 1, 1, 100 * HotSplitTracker::SAMPLE_INTERVAL);
+    HT_ASSERT(!tracker.check(now, cells, 0, MINIMUM_SIZE, "", "row9999"));
+
+    for (int i=0; i<10; i++) {
+      now += 1;
+      cells += 1000;
+      HT_ASSERT(!tracker.check(now, cells, 0, MINIMUM_SIZE, "", "row9999"));
+      HT_ASSERT(tracker.backoff() == expected);
+      now += tracker.backoff();
+      cells += 1000 * tracker.backoff();
+      expected = std::min(2*expected, (time_t)HotSplitTracker::MAXIMUM_BACKOFF);
+    }
+    HT_ASSERT(tracker.backoff() == HotSplitTracker::MAXIMUM_BACKOFF);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  test_choose_split_row();
+  test_minimum_size();
+  test_rates();
+  test_backoff();
+  test_backoff_doubles();
+
+  return 0;
+}
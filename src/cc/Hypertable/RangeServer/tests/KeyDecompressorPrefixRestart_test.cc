@@ -0,0 +1,223 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/SerializedKey.h"
+
+#include "../KeyCompressorPrefix.h"
+#include "../KeyDecompressorPrefixRestart.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  const size_t RESTART_INTERVAL = 4;
+
+  /**
+   * Each row holds two qualifiers so that consecutive keys share long
+   * prefixes; entry i has value "v<i>"
+   */
+  void make_keys(size_t count, DynamicBuffer &keys,
+                 std::vector<SerializedKey> &serkeys) {
+    std::vector<size_t> offsets;
+    char row[16];
+
+    for (size_t i=0; i<count; i++) {
+      sprintf(row, "row%03d", (int)(i / 2));
+      offsets.push_back(keys.fill());
+      create_key_and_append(keys, FLAG_INSERT, row, 1, (i % 2) ? "b" : "a",
+                            1, 1);
+    }
+    serkeys.clear();
+    for (size_t i=0; i<count; i++)
+      serkeys.push_back(SerializedKey(keys.base + offsets[i]));
+  }
+
+  /**
+   * Lays out a block the way CellStoreV7 does: prefix compressed
+   * key/value pairs, a full key every RESTART_INTERVAL entries, then the
+   * restart point offsets followed by their count
+   */
+  void build_block(const std::vector<SerializedKey> &serkeys,
+                   DynamicBuffer &block) {
+    KeyCompressorPrefix compressor;
+    std::vector<uint32_t> restarts;
+    char value[16];
+    Key key;
+
+    for (size_t i=0; i<serkeys.size(); i++) {
+      if (i % RESTART_INTERVAL == 0) {
+        compressor.reset();
+        restarts.push_back((uint32_t)block.fill());
+      }
+      key.load(serkeys[i]);
+      compressor.add(key);
+      block.ensure(compressor.length());
+      compressor.write(block.ptr);
+      block.ptr += compressor.length();
+      sprintf(value, "v%d", (int)i);
+      append_as_byte_string(block, value, strlen(value));
+    }
+
+    block.ensure(4 * (restarts.size() + 1));
+    for (size_t i=0; i<restarts.size(); i++)
+      Serialization::encode_i32(&block.ptr, restarts[i]);
+    Serialization::encode_i32(&block.ptr, (uint32_t)restarts.size());
+  }
+
+  bool value_is(const uint8_t *ptr, size_t entry) {
+    char expected[16];
+    const uint8_t *vptr;
+    ByteString value(ptr);
+    size_t len = value.decode_length(&vptr);
+    sprintf(expected, "v%d", (int)entry);
+    return len == strlen(expected) && !memcmp(vptr, expected, len);
+  }
+
+  /**
+   * Positions on the first entry not less than <i>target</i> the way the
+   * CellStore scanners do, checking that seek() never moves past it, and
+   * returns the index of that entry (the entry count if there is none)
+   */
+  size_t position(KeyDecompressorPrefixRestart &decompressor,
+                  DynamicBuffer &block,
+                  const std::vector<SerializedKey> &serkeys,
+                  SerializedKey target, size_t *stepsp) {
+    const uint8_t *end = decompressor.load_block(block.base, block.fill());
+    const uint8_t *value = decompressor.add(block.base);
+    const uint8_t *ptr;
+    size_t entry = 0, steps = 0;
+
+    if (decompressor.less_than(target) &&
+        (ptr = decompressor.seek(target)) != 0) {
+      HT_ASSERT(decompressor.less_than(target));
+      value = ptr;
+      // the new current entry must be a restart point
+      while (entry < serkeys.size() && !value_is(value, entry))
+        entry++;
+      HT_ASSERT(entry < serkeys.size() && entry % RESTART_INTERVAL == 0);
+    }
+
+    while (decompressor.less_than(target)) {
+      ptr = value + ByteString(value).length();
+      if (ptr >= end)
+        return serkeys.size();
+      value = decompressor.add(ptr);
+      entry++;
+      steps++;
+    }
+
+    Key key, expected;
+    decompressor.load(key);
+    expected.load(serkeys[entry]);
+    HT_ASSERT(!strcmp(key.row, expected.row));
+    HT_ASSERT(!strcmp(key.column_qualifier, expected.column_qualifier));
+    HT_ASSERT(value_is(value, entry));
+    if (stepsp)
+      *stepsp = steps;
+    return entry;
+  }
+
+  void test_seek_existing_keys() {
+    KeyDecompressorPrefixRestart decompressor;
+    std::vector<SerializedKey> serkeys;
+    DynamicBuffer keys, block;
+    size_t steps;
+
+    make_keys(50, keys, serkeys);
+    build_block(serkeys, block);
+
+    for (size_t i=0; i<serkeys.size(); i++) {
+      HT_ASSERT(position(decompressor, block, serkeys, serkeys[i],
+                         &steps) == i);
+      // seek() leaves at most one restart interval to walk
+      HT_ASSERT(steps <= RESTART_INTERVAL);
+    }
+  }
+
+  void test_seek_between_keys() {
+    KeyDecompressorPrefixRestart decompressor;
+    std::vector<SerializedKey> serkeys;
+    DynamicBuffer keys, block, target;
+    char row[16];
+
+    make_keys(50, keys, serkeys);
+    build_block(serkeys, block);
+
+    // "rowNNN" < "rowNNN!" < "row(NNN+1)", so the first key of the next row
+    for (size_t r=0; r<25; r++) {
+      sprintf(row, "row%03d!", (int)r);
+      target.clear();
+      create_key_and_append(target, FLAG_INSERT, row, 1, "a", 1, 1);
+      HT_ASSERT(position(decompressor, block, serkeys,
+                         SerializedKey(target.base), 0) == 2*r + 2);
+    }
+
+    // before the first key
+    target.clear();
+    create_key_and_append(target, FLAG_INSERT, "a", 1, "a", 1, 1);
+    HT_ASSERT(position(decompressor, block, serkeys,
+                       SerializedKey(target.base), 0) == 0);
+
+    // past the last key
+    target.clear();
+    create_key_and_append(target, FLAG_INSERT, "z", 1, "a", 1, 1);
+    HT_ASSERT(position(decompressor, block, serkeys,
+                       SerializedKey(target.base), 0) == serkeys.size());
+  }
+
+  void test_single_restart() {
+    KeyDecompressorPrefixRestart decompressor;
+    std::vector<SerializedKey> serkeys;
+    DynamicBuffer keys, block;
+
+    // fewer keys than the restart interval, so seek() has nothing to skip
+    make_keys(RESTART_INTERVAL - 1, keys, serkeys);
+    build_block(serkeys, block);
+
+    decompressor.load_block(block.base, block.fill());
+    decompressor.add(block.base);
+    HT_ASSERT(decompressor.seek(serkeys.back()) == 0);
+    HT_ASSERT(position(decompressor, block, serkeys, serkeys.back(), 0) ==
+              serkeys.size() - 1);
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  test_seek_existing_keys();
+  test_seek_between_keys();
+  test_single_restart();
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+#include "Common/Time.h"
+
+extern "C" {
+#include <poll.h>
+}
+
+#include <cmath>
+
+#include "../MaintenanceThrottle.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  const int64_t MiB = 1024 * 1024;
+
+  bool about(double value, double expected) {
+    return fabs(value - expected) < 0.001;
+  }
+
+  /** Lets the backoff adjustment interval pass, then adjusts the backoff */
+  double adjust(MaintenanceThrottle &throttle,
+                MaintenanceThrottle::Stats &stats) {
+    poll(0, 0, 300);
+    throttle.charge(MaintenanceThrottle::MINOR_COMPACTION, true, 0, 0);
+    throttle.get_stats(stats);
+    return stats.backoff;
+  }
+
+  void test_unlimited() {
+    MaintenanceThrottle throttle(0, 0, 0, 0, 0.25);
+    MaintenanceThrottle::Stats stats;
+    boost::xtime start, end;
+
+    boost::xtime_get(&start, TIME_UTC);
+    throttle.charge(MaintenanceThrottle::MAJOR_COMPACTION, false,
+                    1024*MiB, 1024*MiB);
+    boost::xtime_get(&end, TIME_UTC);
+    HT_ASSERT(xtime_diff_millis(start, end) < 100);
+
+    throttle.get_stats(stats);
+    HT_ASSERT(stats.throttled_millis[MaintenanceThrottle::MAJOR_COMPACTION] == 0);
+    HT_ASSERT(stats.bytes_read[MaintenanceThrottle::MAJOR_COMPACTION] == 1024*MiB);
+    HT_ASSERT(stats.bytes_written[MaintenanceThrottle::MAJOR_COMPACTION] == 1024*MiB);
+  }
+
+  void test_rate_limit() {
+    MaintenanceThrottle throttle(MiB, 0, 0, 0, 0.25);
+    MaintenanceThrottle::Stats stats;
+
+    // urgent work is charged but never waits
+    throttle.charge(MaintenanceThrottle::MINOR_COMPACTION, true, MiB/2, 0);
+    throttle.get_stats(stats);
+    HT_ASSERT(stats.throttled_millis[MaintenanceThrottle::MINOR_COMPACTION] == 0);
+    HT_ASSERT(stats.bytes_read[MaintenanceThrottle::MINOR_COMPACTION] == MiB/2);
+
+    // background work waits for the deficit to be paid back
+    throttle.charge(MaintenanceThrottle::MERGING_COMPACTION, false, MiB/2, 0);
+    throttle.get_stats(stats);
+    int64_t waited = stats.throttled_millis[MaintenanceThrottle::MERGING_COMPACTION];
+    HT_ASSERT(waited >= 500 && waited <= 1000);
+  }
+
+  void test_update_queue_backoff() {
+    MaintenanceThrottle throttle(MiB, MiB, 2, 0, 0.25);
+    MaintenanceThrottle::Stats stats;
+
+    for (int i=0; i<3; i++)
+      throttle.update_enqueued();
+
+    // multiplicative decrease down to the minimum fraction
+    HT_ASSERT(about(adjust(throttle, stats), 0.5));
+    HT_ASSERT(about(adjust(throttle, stats), 0.25));
+    HT_ASSERT(about(adjust(throttle, stats), 0.25));
+
+    // additive increase once the queue drains
+    throttle.update_dequeued();
+    HT_ASSERT(about(adjust(throttle, stats), 0.35));
+    throttle.update_dequeued();
+    throttle.update_dequeued();
+    HT_ASSERT(about(adjust(throttle, stats), 0.45));
+  }
+
+  void test_scan_latency_backoff() {
+    MaintenanceThrottle throttle(MiB, MiB, 0, 100, 0.25);
+    MaintenanceThrottle::Stats stats;
+
+    for (int i=0; i<10; i++)
+      throttle.record_scan_latency(500);
+
+    HT_ASSERT(about(adjust(throttle, stats), 0.5));
+    HT_ASSERT(about(stats.scan_latency, 250.0));
+
+    // without scans the latency decays
+    HT_ASSERT(about(adjust(throttle, stats), 0.25));
+    HT_ASSERT(about(stats.scan_latency, 125.0));
+    HT_ASSERT(about(adjust(throttle, stats), 0.35));
+    HT_ASSERT(about(stats.scan_latency, 62.5));
+  }
+
+  void test_scan_latency_limits() {
+    MaintenanceThrottle::Stats stats;
+
+    {
+      MaintenanceThrottle throttle(0, 0, 0, 100, 0.25);
+      throttle.record_scan_latency(1000000000LL);
+      adjust(throttle, stats);
+      HT_ASSERT(about(stats.scan_latency,
+                      MaintenanceThrottle::MAX_SCAN_MILLIS / 2.0));
+    }
+
+    {
+      MaintenanceThrottle throttle(0, 0, 0, 100, 0.25);
+      for (int i=0; i<MaintenanceThrottle::MAX_SCAN_SAMPLES; i++)
+        throttle.record_scan_latency(0);
+      // the interval is full, so this sample is dropped
+      throttle.record_scan_latency(1000);
+      adjust(throttle, stats);
+      HT_ASSERT(about(stats.scan_latency, 0.0));
+
+      // the samples were drained by the adjustment
+      throttle.record_scan_latency(1000);
+      adjust(throttle, stats);
+      HT_ASSERT(about(stats.scan_latency, 500.0));
+    }
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  test_unlimited();
+  test_rate_limit();
+  test_update_queue_backoff();
+  test_scan_latency_backoff();
+  test_scan_latency_limits();
+
+  return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hypertable. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+extern "C" {
+#include <pthread.h>
+}
+
+#include "ApiMetrics.h"
+
+using namespace Hypertable;
+
+namespace {
+
+  inline int bucket_of(int64_t latency_us) {
+    int bucket = 0;
+    while (((int64_t)1 << bucket) < latency_us &&
+           bucket < ApiMetrics::BUCKETS-1)
+      bucket++;
+    return bucket;
+  }
+
+}
+
+ApiMetrics::ApiMetrics(int32_t report_interval)
+  : m_report_interval(report_interval), m_last_report(time(0)) {
+}
+
+
+void ApiMetrics::record(const char *method, int64_t latency_us, bool error) {
+
+  {
+    Stripe &stripe = get_stripe();
+    ScopedLock lock(stripe.mutex);
+    Histogram &h = stripe.histograms[method];
+    h.buckets[bucket_of(latency_us)]++;
+    h.count++;
+    if (error)
+      h.errors++;
+    h.total_us += latency_us;
+    if (latency_us > h.max_us)
+      h.max_us = latency_us;
+  }
+
+  if (m_report_interval <= 0 ||
+      (time(0) - m_last_report) * 1000 < m_report_interval)
+    return;
+
+  // only one caller produces the report, the others carry on
+  boost::mutex::scoped_try_lock lock(m_report_mutex);
+  if (!lock)
+    return;
+
+  time_t now = time(0);
+  if ((now - m_last_report) * 1000 < m_report_interval)
+    return;
+  m_last_report = now;
+
+  HistogramMap histograms;
+  String out;
+  collect(histograms, true);
+  format(histograms, out);
+  HT_INFOF("API latency (microseconds)\n%s", out.c_str());
+}
+
+
+void ApiMetrics::report(String &out) {
+  HistogramMap histograms;
+  collect(histograms, false);
+  format(histograms, out);
+}
+
+
+ApiMetrics::Stripe &ApiMetrics::get_stripe() {
+  uint64_t id = (uint64_t)pthread_self();
+  id ^= id >> 33;
+  id *= 0xff51afd7ed558ccdULL;
+  id ^= id >> 33;
+  return m_stripes[id % STRIPES];
+}
+
+
+void ApiMetrics::collect(HistogramMap &histograms, bool reset) {
+  for (int i=0; i<STRIPES; i++) {
+    HistogramMap stripe_histograms;
+    {
+      ScopedLock lock(m_stripes[i].mutex);
+      if (reset)
+        stripe_histograms.swap(m_stripes[i].histograms);
+      else
+        stripe_histograms = m_stripes[i].histograms;
+    }
+    for (HistogramMap::iterator iter = stripe_histograms.begin();
+         iter != stripe_histograms.end(); ++iter)
+      histograms[iter->first].merge(iter->second);
+  }
+}
+
+
+void ApiMetrics::format(HistogramMap &histograms, String &out) {
+  char buf[256];
+
+  snprintf(buf, sizeof(buf), "%-40s %10s %10s %10s %10s %10s %10s %10s\n",
+           "method", "count", "errors", "mean", "p50", "p99", "p999", "max");
+  out = buf;
+
+  for (HistogramMap::iterator iter = histograms.begin();
+       iter != histograms.end(); ++iter) {
+    const Histogram &h = iter->second;
+    snprintf(buf, sizeof(buf),
+             "%-40s %10llu %10llu %10llu %10lld %10lld %10lld %10lld\n",
+             iter->first, (Llu)h.count, (Llu)h.errors,
+             (Llu)(h.total_us / h.count), (Lld)h.percentile(0.50),
+             (Lld)h.percentile(0.99), (Lld)h.percentile(0.999),
+             (Lld)h.max_us);
+    out += buf;
+  }
+}
+
+
+void ApiMetrics::Histogram::merge(const Histogram &other) {
+  for (int i=0; i<BUCKETS; i++)
+    buckets[i] += other.buckets[i];
+  count += other.count;
+  errors += other.errors;
+  total_us += other.total_us;
+  if (other.max_us > max_us)
+    max_us = other.max_us;
+}
+
+
+int64_t ApiMetrics::Histogram::percentile(double fraction) const {
+  uint64_t target = (uint64_t)(fraction * count);
+  uint64_t seen = 0;
+
+  for (int i=0; i<BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen > target)
+      return std::min((int64_t)1 << i, max_us);
+  }
+  return max_us;
+}
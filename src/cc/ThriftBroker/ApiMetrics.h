@@ -0,0 +1,133 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hypertable. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef HYPERTABLE_APIMETRICS_H
+#define HYPERTABLE_APIMETRICS_H
+
+#include <exception>
+#include <map>
+
+#include <boost/thread/xtime.hpp>
+
+#include "Common/Mutex.h"
+#include "Common/String.h"
+#include "Common/StringExt.h"
+
+namespace Hypertable {
+
+  /**
+   * Collects per-method call counts and latency histograms for the
+   * ThriftBroker API.  Latencies are bucketed by powers of two (in
+   * microseconds) so recording is constant time, and percentiles are
+   * estimated from the bucket upper bounds.  Histograms are kept in
+   * independently locked stripes selected by the calling thread, so
+   * concurrent API calls rarely contend; stripes are only merged when a
+   * report is produced.  Every <i>report_interval</i> milliseconds the
+   * accumulated statistics are written to the log and reset.
+   */
+  class ApiMetrics {
+  public:
+
+    enum { BUCKETS = 32, STRIPES = 16 };
+
+    /**
+     * Times an API call from construction to destruction and records it
+     * with the metrics object, if any.  Calls that leave through an
+     * exception are recorded as errors.
+     */
+    class Timer {
+    public:
+      Timer(ApiMetrics *metrics, const char *method)
+        : m_metrics(metrics), m_method(method) {
+        if (m_metrics)
+          boost::xtime_get(&m_start_time, boost::TIME_UTC);
+      }
+      ~Timer() {
+        if (m_metrics) {
+          boost::xtime end_time;
+          boost::xtime_get(&end_time, boost::TIME_UTC);
+          m_metrics->record(m_method,
+              (end_time.sec - m_start_time.sec) * 1000000LL
+              + (end_time.nsec - m_start_time.nsec) / 1000,
+              std::uncaught_exception());
+        }
+      }
+    private:
+      ApiMetrics *m_metrics;
+      const char *m_method;
+      boost::xtime m_start_time;
+    };
+
+    ApiMetrics(int32_t report_interval);
+
+    /**
+     * Records a completed call.
+     *
+     * @param method name of the API method (must be a static string,
+     *        typically <code>__func__</code>)
+     * @param latency_us call latency in microseconds
+     * @param error true if the call failed with an exception
+     */
+    void record(const char *method, int64_t latency_us, bool error=false);
+
+    /**
+     * Formats the current statistics as a table, one line per method
+     * with count, errors, mean, p50, p99, p999 and maximum latency.
+     *
+     * @param out string to hold the report
+     */
+    void report(String &out);
+
+  private:
+
+    struct Histogram {
+      Histogram() : count(0), errors(0), total_us(0), max_us(0) {
+        memset(buckets, 0, sizeof(buckets));
+      }
+      void merge(const Histogram &other);
+      int64_t percentile(double fraction) const;
+      uint64_t buckets[BUCKETS];
+      uint64_t count;
+      uint64_t errors;
+      uint64_t total_us;
+      int64_t max_us;
+    };
+
+    typedef std::map<const char *, Histogram, LtCstr> HistogramMap;
+
+    struct Stripe {
+      Mutex mutex;
+      HistogramMap histograms;
+    };
+
+    Stripe &get_stripe();
+
+    void collect(HistogramMap &histograms, bool reset);
+
+    static void format(HistogramMap &histograms, String &out);
+
+    Stripe m_stripes[STRIPES];
+    Mutex m_report_mutex;
+    int32_t m_report_interval;
+    time_t m_last_report;
+  };
+
+} // namespace Hypertable
+
+#endif // HYPERTABLE_APIMETRICS_H
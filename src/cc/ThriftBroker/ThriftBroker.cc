@@ -30,8 +30,10 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <concurrency/PosixThreadFactory.h>
 #include <concurrency/ThreadManager.h>
 #include <protocol/TBinaryProtocol.h>
+#include <server/TNonblockingServer.h>
 #include <server/TThreadedServer.h>
 #include <transport/TBufferTransports.h>
 #include <transport/TServerSocket.h>
@@ -44,6 +46,7 @@
 #include "Hypertable/Lib/NamespaceListing.h"
 #include "Hypertable/Lib/Future.h"
 
+#include "ApiMetrics.h"
 #include "Config.h"
 #include "SerializedCellsReader.h"
 #include "SerializedCellsWriter.h"
@@ -69,6 +72,7 @@
 }
 
 #define LOG_API_START(_expr_) \
+  ApiMetrics::Timer api_metrics_timer(m_metrics, __func__); \
   boost::xtime start_time, end_time; \
   std::ostringstream logging_stream;\
   if (m_log_api) {\
@@ -162,12 +166,58 @@ inline bool operator < (const SharedMutatorMapKey &skey1, const SharedMutatorMap
 
 typedef Meta::list<ThriftBrokerPolicy, DefaultCommPolicy> Policies;
 
+/**
+ * Map from object ID to object, split into independently locked stripes
+ * so that connections working on different scanners or mutators do not
+ * contend on a single mutex.  IDs are object addresses, so the low bits
+ * are skipped when choosing the stripe.
+ */
+template <class ValueT>
+class StripedIdMap {
+public:
+  enum { STRIPES = 64 };
+
+  void insert(::int64_t id, const ValueT &value) {
+    Stripe &stripe = get_stripe(id);
+    ScopedLock lock(stripe.mutex);
+    stripe.map.insert(make_pair(id, value)); // no overwrite
+  }
+
+  bool get(::int64_t id, ValueT &value) {
+    Stripe &stripe = get_stripe(id);
+    ScopedLock lock(stripe.mutex);
+    typename hash_map< ::int64_t, ValueT>::iterator it = stripe.map.find(id);
+    if (it == stripe.map.end())
+      return false;
+    value = it->second;
+    return true;
+  }
+
+  bool remove(::int64_t id) {
+    Stripe &stripe = get_stripe(id);
+    ScopedLock lock(stripe.mutex);
+    return stripe.map.erase(id) > 0;
+  }
+
+private:
+  struct Stripe {
+    Mutex mutex;
+    hash_map< ::int64_t, ValueT> map;
+  };
+
+  Stripe &get_stripe(::int64_t id) {
+    return m_stripes[((::uint64_t)id >> 4) % STRIPES];
+  }
+
+  Stripe m_stripes[STRIPES];
+};
+
 typedef std::map<SharedMutatorMapKey, TableMutatorPtr> SharedMutatorMap;
-typedef hash_map< ::int64_t, TableScannerPtr> ScannerMap;
+typedef StripedIdMap<TableScannerPtr> ScannerMap;
 typedef hash_map< ::int64_t, TableScannerAsyncPtr> ScannerAsyncMap;
 typedef hash_map< ::int64_t, ::int64_t> ReverseScannerAsyncMap;
-typedef hash_map< ::int64_t, TableMutatorPtr> MutatorMap;
-typedef hash_map< ::int64_t, TableMutatorAsyncPtr> MutatorAsyncMap;
+typedef StripedIdMap<TableMutatorPtr> MutatorMap;
+typedef StripedIdMap<TableMutatorAsyncPtr> MutatorAsyncMap;
 typedef hash_map< ::int64_t, NamespacePtr> NamespaceMap;
 typedef hash_map< ::int64_t, FuturePtr> FutureMap;
 typedef hash_map< ::int64_t, HqlInterpreterPtr> HqlInterpreterMap;
@@ -477,6 +527,9 @@ void convert_table_split(const Hypertable::TableSplit &hsplit, ThriftGen::TableS
 
 class ServerHandler;
 
+/** Number of cells decoded from a serialized buffer per mutator call */
+const size_t SERIALIZED_CELLS_BATCH_SIZE = 1024;
+
 template <class ResultT, class CellT>
 struct HqlCallback : HqlInterpreter::Callback {
   typedef HqlInterpreter::Callback Parent;
@@ -502,6 +555,14 @@ public:
     m_next_namespace_id = 1;
     m_next_future_id = 1;
     m_future_capacity = Config::get_i32("ThriftBroker.Future.Capacity");
+    m_metrics = 0;
+    if (Config::get_bool("ThriftBroker.API.Metrics"))
+      m_metrics =
+        new ApiMetrics(Config::get_i32("ThriftBroker.API.Metrics.ReportInterval"));
+  }
+
+  virtual ~ServerHandler() {
+    delete m_metrics;
   }
 
   virtual void
@@ -724,24 +785,9 @@ public:
     LOG_API_START("scanner="<< scanner_id);
 
     try {
-      SerializedCellsWriter writer(m_next_threshold);
-      Hypertable::Cell cell;
-
+      SerializedCellsWriter writer(m_next_threshold, true);
       TableScannerPtr scanner = get_scanner(scanner_id);
-
-      while (1) {
-        if (scanner->next(cell)) {
-          if (!writer.add(cell)) {
-            writer.finalize(SerializedCellsFlag::EOB);
-            scanner->unget(cell);
-            break;
-          }
-        }
-        else {
-          writer.finalize(SerializedCellsFlag::EOS);
-          break;
-        }
-      }
+      _next(writer, scanner, m_next_threshold);
 
       result = String((char *)writer.get_buffer(), writer.get_buffer_length());
     } RETHROW("scanner="<< scanner_id);
@@ -861,11 +907,7 @@ public:
                                                          row.c_str(), true));
       ss.max_versions = 1;
       TableScannerPtr scanner = t->create_scanner(ss);
-      Hypertable::Cell cell;
-
-      while (scanner->next(cell))
-        writer.add(cell);
-      writer.finalize(SerializedCellsFlag::EOS);
+      _next(writer, scanner, INT32_MAX);
 
       result = String((char *)writer.get_buffer(), writer.get_buffer_length());
     } RETHROW("namespace=" << ns << " table="<< table <<" row"<< row)
@@ -928,11 +970,7 @@ public:
     try {
       SerializedCellsWriter writer(0, true);
       TableScannerPtr scanner = _open_scanner(ns, table, ss);
-      Hypertable::Cell cell;
-
-      while (scanner->next(cell))
-        writer.add(cell);
-      writer.finalize(SerializedCellsFlag::EOS);
+      _next(writer, scanner, INT32_MAX);
 
       result = String((char *)writer.get_buffer(), writer.get_buffer_length());
     } RETHROW("namespace=" << ns << " table="<< table <<" scan_spec="<< ss)
@@ -1349,16 +1387,9 @@ public:
 
     LOG_API_START("mutator="<< mutator <<" cell.size="<< cells.size());
     try {
-      CellsBuilder cb;
-      Hypertable::Cell hcell;
-      SerializedCellsReader reader((void *)cells.c_str(), (uint32_t)cells.length());
-      while (reader.next()) {
-        reader.get(hcell);
-        cb.add(hcell, false);
-      }
-	  get_mutator(mutator)->set_cells(cb.get());
-      if (flush || reader.flush())
-        get_mutator(mutator)->flush();
+      TableMutatorPtr mutator_ptr = get_mutator(mutator);
+      if (_set_cells_serialized(mutator_ptr, cells) || flush)
+        mutator_ptr->flush();
     } RETHROW(" mutator="<< mutator <<" cell.size="<< cells.size())
 
     LOG_API_FINISH;
@@ -1429,14 +1460,7 @@ public:
     LOG_API_START("ns="<< ns <<" table=" << table<<" cell_serialized.size="<< cells.size()<<" flush="<<flush);
     try {
       TableMutatorPtr mutator = _open_mutator(ns, table);
-      CellsBuilder cb;
-      Hypertable::Cell hcell;
-      SerializedCellsReader reader((void *)cells.c_str(), (uint32_t)cells.length());
-      while (reader.next()) {
-        reader.get(hcell);
-        cb.add(hcell, false);
-      }
-      mutator->set_cells(cb.get());
+      _set_cells_serialized(mutator, cells);
     } RETHROW(" ns="<< ns <<" table=" << table<<" cell_serialized.size="<< cells.size()<<" flush="<<flush);
 
     LOG_API_FINISH;
@@ -1499,16 +1523,8 @@ public:
       const bool flush) {
    LOG_API_START("mutator="<< mutator <<" cells.size="<< cells.size());
     try {
-      CellsBuilder cb;
-      Hypertable::Cell hcell;
-      SerializedCellsReader reader((void *)cells.c_str(), (uint32_t)cells.length());
-      while (reader.next()) {
-        reader.get(hcell);
-        cb.add(hcell, false);
-      }
       TableMutatorAsyncPtr mutator_ptr = get_mutator_async(mutator);
-	    mutator_ptr->set_cells(cb.get());
-      if (flush || reader.flush() || mutator_ptr->needs_flush())
+      if (_set_cells_serialized(mutator_ptr, cells) || flush || mutator_ptr->needs_flush())
         mutator_ptr->flush();
 
     } RETHROW(" mutator="<< mutator <<" cells.size="<< cells.size());
@@ -1922,6 +1938,31 @@ public:
     }
   }
 
+  /**
+   * Serializes scan results a whole ScanCells block at a time, straight
+   * from the cells held by the scanner, until at least <code>limit</code>
+   * bytes have been written or the scan is exhausted.  The writer is
+   * finalized with EOS or EOB accordingly.
+   */
+  void _next(SerializedCellsWriter &writer, TableScannerPtr &scanner,
+             int32_t limit) {
+    ScanCellsPtr cells;
+    Hypertable::Cell cell;
+    size_t first;
+
+    while (writer.get_buffer_length() < limit) {
+      if (!scanner->next(cells, &first)) {
+        writer.finalize(SerializedCellsFlag::EOS);
+        return;
+      }
+      for (size_t ii=first; ii<cells->size(); ++ii) {
+        cells->get_cell_unchecked(cell, ii);
+        writer.add(cell);
+      }
+    }
+    writer.finalize(SerializedCellsFlag::EOB);
+  }
+
   template <class CellT>
   void _next_row(vector<CellT> &result, TableScannerPtr &scanner) {
     Hypertable::Cell cell;
@@ -2024,6 +2065,32 @@ public:
       mutator_ptr->flush();
   }
 
+  /**
+   * Decodes a buffer of serialized cells and streams them into
+   * <code>mutator</code> in fixed size batches that reference the buffer
+   * directly, so no per-cell copies are made and memory stays bounded
+   * regardless of the buffer size.
+   *
+   * @return true if the buffer carries the FLUSH flag
+   */
+  template <class MutatorT>
+  bool _set_cells_serialized(MutatorT &mutator, const CellsSerialized &cells) {
+    CellsBuilder cb(SERIALIZED_CELLS_BATCH_SIZE);
+    Hypertable::Cell hcell;
+    SerializedCellsReader reader((void *)cells.c_str(), (uint32_t)cells.length());
+    while (reader.next()) {
+      reader.get(hcell);
+      cb.add(hcell, false);
+      if (cb.size() == SERIALIZED_CELLS_BATCH_SIZE) {
+        mutator->set_cells(cb.get());
+        cb.clear();
+      }
+    }
+    if (cb.size())
+      mutator->set_cells(cb.get());
+    return reader.flush();
+  }
+
   FuturePtr get_future(::int64_t id) {
     ScopedLock lock(m_future_mutex);
     FutureMap::iterator it = m_future_map.find(id);
@@ -2106,18 +2173,16 @@ public:
   }
 
   ::int64_t get_scanner_id(TableScanner *scanner) {
-    ScopedLock lock(m_scanner_mutex);
     ::int64_t id = (::int64_t)scanner;
-    m_scanner_map.insert(make_pair(id, scanner)); // no overwrite
+    m_scanner_map.insert(id, scanner);
     return id;
   }
 
   TableScannerPtr get_scanner(::int64_t id) {
-    ScopedLock lock(m_scanner_mutex);
-    ScannerMap::iterator it = m_scanner_map.find(id);
+    TableScannerPtr scanner;
 
-    if (it != m_scanner_map.end())
-      return it->second;
+    if (m_scanner_map.get(id, scanner))
+      return scanner;
 
     HT_ERROR_OUT << "Bad scanner id - " << id << HT_END;
     THROW_TE(Error::THRIFTBROKER_BAD_SCANNER_ID,
@@ -2125,13 +2190,8 @@ public:
   }
 
   void remove_scanner(::int64_t id) {
-    ScopedLock lock(m_scanner_mutex);
-    ScannerMap::iterator it = m_scanner_map.find(id);
-
-    if (it != m_scanner_map.end()) {
-      m_scanner_map.erase(it);
+    if (m_scanner_map.remove(id))
       return;
-    }
 
     HT_ERROR_OUT << "Bad scanner id - " << id << HT_END;
     THROW_TE(Error::THRIFTBROKER_BAD_SCANNER_ID,
@@ -2156,16 +2216,14 @@ public:
   }
 
   ::int64_t get_mutator_id(TableMutator *mutator) {
-    ScopedLock lock(m_mutator_mutex);
     ::int64_t id = (::int64_t)mutator;
-    m_mutator_map.insert(make_pair(id, mutator)); // no overwrite
+    m_mutator_map.insert(id, mutator);
     return id;
   }
 
   ::int64_t get_mutator_async_id(TableMutatorAsync *mutator) {
-    ScopedLock lock(m_mutator_async_mutex);
     ::int64_t id = (::int64_t)mutator;
-    m_mutator_async_map.insert(make_pair(id, mutator)); // no overwrite
+    m_mutator_async_map.insert(id, mutator);
     return id;
   }
 
@@ -2223,11 +2281,10 @@ public:
   }
 
   TableMutatorPtr get_mutator(::int64_t id) {
-    ScopedLock lock(m_mutator_mutex);
-    MutatorMap::iterator it = m_mutator_map.find(id);
+    TableMutatorPtr mutator;
 
-    if (it != m_mutator_map.end())
-      return it->second;
+    if (m_mutator_map.get(id, mutator))
+      return mutator;
 
     HT_ERROR_OUT << "Bad mutator id - " << id << HT_END;
     THROW_TE(Error::THRIFTBROKER_BAD_MUTATOR_ID,
@@ -2235,11 +2292,10 @@ public:
   }
 
   TableMutatorAsyncPtr get_mutator_async(::int64_t id) {
-    ScopedLock lock(m_mutator_async_mutex);
-    MutatorAsyncMap::iterator it = m_mutator_async_map.find(id);
+    TableMutatorAsyncPtr mutator;
 
-    if (it != m_mutator_async_map.end())
-      return it->second;
+    if (m_mutator_async_map.get(id, mutator))
+      return mutator;
 
     HT_ERROR_OUT << "Bad mutator id - " << id << HT_END;
     THROW_TE(Error::THRIFTBROKER_BAD_MUTATOR_ID,
@@ -2276,13 +2332,8 @@ public:
 
 
   void remove_mutator(::int64_t id) {
-    ScopedLock lock(m_mutator_mutex);
-    MutatorMap::iterator it = m_mutator_map.find(id);
-
-    if (it != m_mutator_map.end()) {
-      m_mutator_map.erase(it);
+    if (m_mutator_map.remove(id))
       return;
-    }
 
     HT_ERROR_OUT << "Bad mutator id - " << id << HT_END;
     THROW_TE(Error::THRIFTBROKER_BAD_MUTATOR_ID,
@@ -2290,13 +2341,8 @@ public:
   }
 
   void remove_mutator_async(::int64_t id) {
-    ScopedLock lock(m_mutator_async_mutex);
-    MutatorAsyncMap::iterator it = m_mutator_async_map.find(id);
-
-    if (it != m_mutator_async_map.end()) {
-      m_mutator_async_map.erase(it);
+    if (m_mutator_async_map.remove(id))
       return;
-    }
 
     HT_ERROR_OUT << "Bad mutator id - " << id << HT_END;
     THROW_TE(Error::THRIFTBROKER_BAD_MUTATOR_ID,
@@ -2305,10 +2351,8 @@ public:
 
 private:
   bool             m_log_api;
-  Mutex            m_scanner_mutex;
+  ApiMetrics      *m_metrics;
   ScannerMap       m_scanner_map;
-  Mutex            m_mutator_mutex;
-  Mutex            m_mutator_async_mutex;
   MutatorMap       m_mutator_map;
   MutatorAsyncMap  m_mutator_async_map;
   Mutex            m_shared_mutator_mutex;
@@ -2392,12 +2436,33 @@ int main(int argc, char **argv) {
     else
       serverTransport.reset( new TServerSocket(port) );
 
-    boost::shared_ptr<TTransportFactory> transportFactory(new TFramedTransportFactory());
+    String server_type = get_str("ThriftBroker.Server.Type");
+
+    if (server_type == "nonblocking") {
+      int workers = get_i32("ThriftBroker.Workers");
+      boost::shared_ptr<ThreadManager> thread_manager =
+        ThreadManager::newSimpleThreadManager(workers);
+      thread_manager->threadFactory(
+          boost::shared_ptr<PosixThreadFactory>(new PosixThreadFactory()));
+      thread_manager->start();
 
-    TThreadedServer server(processor, serverTransport, transportFactory, protocolFactory);
+      TNonblockingServer server(processor, protocolFactory, port, thread_manager);
+      server.setNumIOThreads(get_i32("ThriftBroker.Reactors"));
 
-    HT_INFO("Starting the server...");
-    server.serve();
+      HT_INFOF("Starting the non-blocking server (reactors=%d, workers=%d)...",
+               (int)get_i32("ThriftBroker.Reactors"), workers);
+      server.serve();
+    }
+    else if (server_type == "threaded") {
+      boost::shared_ptr<TTransportFactory> transportFactory(new TFramedTransportFactory());
+
+      TThreadedServer server(processor, serverTransport, transportFactory, protocolFactory);
+
+      HT_INFO("Starting the server...");
+      server.serve();
+    }
+    else
+      HT_FATALF("Unrecognized ThriftBroker.Server.Type '%s'", server_type.c_str());
     HT_INFO("Exiting.\n");
   }
   catch (Hypertable::Exception &e) {
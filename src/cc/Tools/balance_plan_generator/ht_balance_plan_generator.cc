@@ -39,6 +39,7 @@ extern "C" {
 #include "Hypertable/Lib/Config.h"
 #include "Hypertable/Lib/Client.h"
 #include "Hypertable/Lib/BalancePlan.h"
+#include "Hypertable/Master/LoadBalancerBasicDistributeCost.h"
 #include "Hypertable/Master/LoadBalancerBasicDistributeLoad.h"
 
 using namespace Hypertable;
@@ -70,7 +71,11 @@ namespace {
         ("rs-metrics-loaded",  boo()->zero_tokens()->default_value(false),
          "If true then assume RS_METRICS is already loaded in namespace/table")
         ("load-balancer", str()->default_value("basic-distribute-load"),
-         "Type of load balancer to be used.")
+         "Type of load balancer to be used ('basic-distribute-load' or "
+         "'basic-distribute-cost').")
+        ("dry-run", boo()->zero_tokens()->default_value(false),
+         "Also show the modeled cost of each server before and after the plan "
+         "(basic-distribute-cost only)")
         ("verbose,v", boo()->zero_tokens()->default_value(false),
          "Show more verbose output")
         ("balance-plan-file,b",  str()->default_value(""),
@@ -79,6 +84,7 @@ namespace {
     }
   };
   bool verbose=false;
+  bool dry_run=false;
 }
 
 
@@ -100,6 +106,7 @@ int main(int argc, char **argv) {
     if (has("verbose")) {
       verbose = get_bool("verbose");
     }
+    dry_run = get_bool("dry-run");
 
     table_str = get_str("table");
     ns_str = get_str("namespace");
@@ -157,10 +164,23 @@ int main(int argc, char **argv) {
 void generate_balance_plan(PropertiesPtr &props, const String &load_balancer,
     TablePtr &rs_metrics, BalancePlanPtr &plan) {
 
+  if (load_balancer == "basic-distribute-cost") {
+    LoadBalancerBasicDistributeCost balancer(Config::properties, rs_metrics);
+    balancer.compute_plan(plan);
+    if (dry_run) {
+      cout << "Server\tCost\tPlannedCost" << endl;
+      foreach(const LoadBalancerBasicDistributeCost::ServerCostSummary &summary,
+              balancer.get_server_summaries())
+        cout << summary.server_id << "\t" << summary.cost << "\t"
+             << summary.planned_cost << endl;
+    }
+    return;
+  }
+
   if (load_balancer != "basic-distribute-load")
     HT_THROW(Error::NOT_IMPLEMENTED,
-             (String)"Only 'basic-distribute-load' balancer is supported. '" + load_balancer
-             + "' balancer not supported.");
+             (String)"Only 'basic-distribute-load' and 'basic-distribute-cost' balancers "
+             "are supported. '" + load_balancer + "' balancer not supported.");
 
   double loadavg_threshold = get_f64("Hypertable.LoadBalancer.LoadavgThreshold");
   LoadBalancerBasicDistributeLoad balancer(loadavg_threshold, rs_metrics);
@@ -0,0 +1,479 @@
+/**
+ * Copyright (C) 2007-2012 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+#include "Common/Compat.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+
+extern "C" {
+#include <poll.h>
+#include <unistd.h>
+}
+
+#include "Common/ByteString.h"
+#include "Common/DynamicBuffer.h"
+#include "Common/Error.h"
+#include "Common/Init.h"
+#include "Common/PageArena.h"
+#include "Common/System.h"
+#include "Common/Time.h"
+
+#include "AsyncComm/Comm.h"
+
+#include "DfsBroker/Lib/Client.h"
+
+#include "Hypertable/Lib/Client.h"
+#include "Hypertable/Lib/Config.h"
+#include "Hypertable/Lib/Key.h"
+#include "Hypertable/Lib/LoadDataSourceFactory.h"
+#include "Hypertable/Lib/RangeServerClient.h"
+
+#include "Hypertable/RangeServer/CellStoreFactory.h"
+#include "Hypertable/RangeServer/CellStoreV7.h"
+#include "Hypertable/RangeServer/Global.h"
+
+using namespace Hypertable;
+using namespace Hypertable::Config;
+using namespace std;
+
+namespace {
+
+  const char *usage =
+    "\n"
+    "Usage: ht_bulk_load [options] <table> <input-file>\n\n"
+    "Description:\n"
+    "  Loads the tab delimited <input-file> into <table> without going through\n"
+    "  the commit log and cell cache.  The input is sorted with an external merge\n"
+    "  sort, written as CellStores split on the table's current range boundaries,\n"
+    "  and each set of CellStores is then adopted by the RangeServer that holds\n"
+    "  the range.  All cells are given the same revision, taken when the load\n"
+    "  starts.  Delete records in the input are skipped.\n\n"
+    "Options";
+
+  struct AppPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc(usage).add_options()
+        ("help,h", "Show this help message and exit")
+        ("namespace", str()->default_value("/"),
+         "Namespace containing <table>")
+        ("staging-dir", str(), "DFS directory in which to write sort runs "
+         "and CellStores before they are adopted (default is "
+         "<Hypertable.Directory>/bulk/<table-id>)")
+        ("memory-limit", i64()->default_value(256*MiB),
+         "Amount of input to sort in memory before writing a sort run")
+        ("retries", i32()->default_value(30),
+         "Number of times to retry adopting CellStores into a busy range")
+        ("table", str(), "Name of table to load")
+        ("input-file", str(), "Tab delimited input file");
+      cmdline_hidden_desc().add_options()
+        ("table", str(), "")
+        ("input-file", str(), "");
+      cmdline_positional_desc().add("table", 1).add("input-file", 1);
+    }
+    static void init() {
+      if (!has("table") || !has("input-file")) {
+        HT_ERROR_OUT << "table and input-file required" << HT_END;
+        cout << cmdline_desc() << endl;
+        exit(1);
+      }
+    }
+  };
+
+  typedef Meta::list<AppPolicy, DfsClientPolicy, DefaultCommPolicy> Policies;
+
+  struct KeyValue {
+    SerializedKey key;
+    ByteString value;
+  };
+
+  struct LtKeyValue {
+    bool operator()(const KeyValue &kv1, const KeyValue &kv2) const {
+      return kv1.key < kv2.key;
+    }
+  };
+
+  /**
+   * Scanner over one sort run.  Ordered so that a std::priority_queue
+   * yields the run with the smallest current key first.
+   */
+  struct RunScanner {
+    CellStorePtr cellstore;
+    CellListScannerPtr scanner;
+    Key key;
+    ByteString value;
+  };
+
+  struct GtRunScanner {
+    bool operator()(const RunScanner *rs1, const RunScanner *rs2) const {
+      return rs1->key.serial > rs2->key.serial;
+    }
+  };
+
+  typedef std::priority_queue<RunScanner *, std::vector<RunScanner *>,
+                              GtRunScanner> RunQueue;
+
+  /**
+   * Number of cells headed for each range, per access group, keyed by the
+   * end row of the range
+   */
+  typedef std::map<String, std::map<String, uint64_t> > RangeCellCounts;
+
+  /**
+   * Builds the CellStore creation properties for an access group the same
+   * way the RangeServer does for its compactions
+   */
+  PropertiesPtr cellstore_properties(SchemaPtr &schema, Schema::AccessGroup *ag) {
+    PropertiesPtr props = new Properties();
+    props->set("compressor", ag->compressor.size() ?
+               ag->compressor : schema->get_compressor());
+    props->set("blocksize", ag->blocksize);
+    if (ag->replication != -1)
+      props->set("replication", (int32_t)ag->replication);
+    if (ag->bloom_filter.size())
+      Schema::parse_bloom_filter(ag->bloom_filter, props);
+    else
+      Schema::parse_bloom_filter(get_str("Hypertable.RangeServer"
+          ".CellStore.DefaultBloomFilter"), props);
+    return props;
+  }
+
+  /**
+   * Writes the CellStores for one range, one per access group, and asks
+   * the owning RangeServer to adopt them
+   */
+  class RangeWriter {
+  public:
+    RangeWriter(TableIdentifier *table, SchemaPtr &schema,
+                RangeServerClient *rs_client, const String &staging_dir,
+                const RangeCellCounts &counts, size_t default_entries,
+                int retries)
+      : m_table(table), m_schema(schema), m_rs_client(rs_client),
+        m_staging_dir(staging_dir), m_counts(counts),
+        m_default_entries(default_entries), m_retries(retries),
+        m_next_file_id(0), m_cells(0) { }
+
+    void set_range(const RangeLocationInfo &loc) {
+      HT_ASSERT(m_cellstores.empty());
+      m_location = loc;
+    }
+
+    const String &end_row() { return m_location.end_row; }
+
+    void add(const Key &key, const ByteString value) {
+      Schema::ColumnFamily *cf =
+        m_schema->get_column_family(key.column_family_code);
+      HT_ASSERT(cf);
+      CellStorePtr &cellstore = m_cellstores[cf->ag];
+      if (!cellstore) {
+        String fname = format("%s/cs%u", m_staging_dir.c_str(),
+                              m_next_file_id++);
+        PropertiesPtr props =
+          cellstore_properties(m_schema, m_schema->get_access_group(cf->ag));
+        cellstore = new CellStoreV7(Global::dfs.get(), m_schema.get());
+        cellstore->create(fname.c_str(), max_entries(cf->ag), props, m_table);
+      }
+      cellstore->add(key, value);
+      m_cells++;
+    }
+
+    void finish() {
+      RangeSpec range(m_location.start_row.c_str(), m_location.end_row.c_str());
+
+      for (std::map<String, CellStorePtr>::iterator iter = m_cellstores.begin();
+           iter != m_cellstores.end(); ++iter) {
+        std::vector<String> files;
+        iter->second->finalize(m_table);
+        files.push_back(iter->second->get_filename());
+        iter->second = 0;
+
+        for (int attempt=0; ; attempt++) {
+          try {
+            m_rs_client->adopt_cellstores(m_location.addr, *m_table, range,
+                                          iter->first, files);
+            break;
+          }
+          catch (Exception &e) {
+            if (e.code() != Error::RANGESERVER_RANGE_BUSY || attempt == m_retries)
+              HT_THROW2F(e.code(), e, "Unable to adopt %s into %s[%s..%s] "
+                         "access group %s", files[0].c_str(), m_table->id,
+                         m_location.start_row.c_str(),
+                         m_location.end_row.c_str(), iter->first.c_str());
+            poll(0, 0, 1000);
+          }
+        }
+      }
+
+      HT_INFOF("Loaded %llu cells into %s[%s..%s]", (Llu)m_cells, m_table->id,
+               m_location.start_row.c_str(), m_location.end_row.c_str());
+      m_cellstores.clear();
+      m_cells = 0;
+    }
+
+  private:
+
+    /**
+     * Returns the number of cells counted for the current range and access
+     * group during the sort phase.  If the range split since then, the
+     * count of the range that contained it is used, which overestimates.
+     */
+    size_t max_entries(const String &ag) {
+      RangeCellCounts::const_iterator iter =
+        m_counts.lower_bound(m_location.end_row);
+      if (iter != m_counts.end()) {
+        std::map<String, uint64_t>::const_iterator ag_iter =
+          iter->second.find(ag);
+        if (ag_iter != iter->second.end())
+          return (size_t)ag_iter->second;
+      }
+      return m_default_entries;
+    }
+
+    TableIdentifier *m_table;
+    SchemaPtr m_schema;
+    RangeServerClient *m_rs_client;
+    String m_staging_dir;
+    const RangeCellCounts &m_counts;
+    size_t m_default_entries;
+    int m_retries;
+    RangeLocationInfo m_location;
+    std::map<String, CellStorePtr> m_cellstores;
+    uint32_t m_next_file_id;
+    uint64_t m_cells;
+  };
+
+  /**
+   * Sorts the buffered cells and writes them out as a CellStore run.  While
+   * the run is written, its cells are counted against the range that
+   * currently holds them so the final CellStores can be sized per range.
+   */
+  String write_run(std::vector<KeyValue> &cells, const String &staging_dir,
+                   size_t run, TableIdentifier *table, SchemaPtr &schema,
+                   RangeLocatorPtr &range_locator, int32_t timeout,
+                   RangeCellCounts &counts) {
+    String fname = format("%s/run%u", staging_dir.c_str(), (unsigned)run);
+    PropertiesPtr props = new Properties();
+    RangeLocationInfo loc;
+    bool have_range = false;
+    Key key;
+
+    props->set("compressor", String("snappy"));
+    props->set("blocksize", (uint32_t)0);
+    Schema::parse_bloom_filter("none", props);
+
+    std::sort(cells.begin(), cells.end(), LtKeyValue());
+
+    CellStorePtr cellstore = new CellStoreV7(Global::dfs.get(), schema.get());
+    cellstore->create(fname.c_str(), cells.size(), props, table);
+    for (size_t i=0; i<cells.size(); i++) {
+      key.load(cells[i].key);
+      cellstore->add(key, cells[i].value);
+      if (!have_range || strcmp(key.row, loc.end_row.c_str()) > 0) {
+        Timer timer(timeout, true);
+        range_locator->find_loop(table, key.row, &loc, timer, false);
+        have_range = true;
+      }
+      counts[loc.end_row][schema->get_column_family(key.column_family_code)->ag]++;
+    }
+    cellstore->finalize(table);
+
+    HT_INFOF("Wrote sort run %s (%llu cells)", fname.c_str(), (Llu)cells.size());
+    return fname;
+  }
+
+} // local namespace
+
+
+int main(int argc, char **argv) {
+  System::initialize(System::locate_install_dir(argv[0]));
+
+  try {
+    init_with_policies<Policies>(argc, argv);
+
+    String table_name = get_str("table");
+    String input_file = get_str("input-file");
+    int64_t memory_limit = get_i64("memory-limit");
+    int retries = get_i32("retries");
+    int32_t timeout = get_i32("Hypertable.Request.Timeout");
+
+    ClientPtr client = new Hypertable::Client(System::install_dir);
+    NamespacePtr ns = client->open_namespace(get_str("namespace"));
+    TablePtr table = ns->open_table(table_name);
+    TableIdentifierManaged table_id;
+    SchemaPtr schema;
+    table->get(table_id, schema);
+    RangeLocatorPtr range_locator = table->get_range_locator();
+
+    ConnectionManagerPtr conn_mgr = new ConnectionManager();
+    DfsBroker::ClientPtr dfs = new DfsBroker::Client(conn_mgr, properties);
+    if (!dfs->wait_for_connection(timeout))
+      HT_THROW(Error::REQUEST_TIMEOUT, "connecting to DFS Broker");
+    Global::dfs = dfs.get();
+    Global::memory_tracker = new MemoryTracker(0, 0);
+
+    String toplevel_dir = get_str("Hypertable.Directory");
+    boost::trim_if(toplevel_dir, boost::is_any_of("/"));
+    String staging_dir = has("staging-dir") ? get_str("staging-dir") :
+      format("/%s/bulk/%s", toplevel_dir.c_str(), table_id.id);
+    Global::dfs->mkdirs(staging_dir);
+
+    /**
+     * Sort phase: buffer cells up to the memory limit, then sort and
+     * spill them as a CellStore run.  The RangeServers reject stores whose
+     * revision is ahead of their own clock, so the revision is taken once,
+     * before any cells are read.
+     */
+    int64_t revision = get_ts64();
+    std::vector<String> key_columns;
+    LoadDataSourcePtr lds = LoadDataSourceFactory::create(dfs, input_file,
+        LOCAL_FILE, "", LOCAL_FILE, key_columns, "");
+    KeySpec key_spec;
+    uint8_t *value;
+    uint32_t value_len, consumed;
+    bool is_delete;
+    ByteArena arena;
+    DynamicBuffer buf;
+    std::vector<KeyValue> cells;
+    std::vector<String> runs;
+    RangeCellCounts counts;
+    int64_t buffered = 0;
+    uint64_t total_cells = 0, skipped_deletes = 0;
+    KeyValue kv;
+
+    while (lds->next(&key_spec, &value, &value_len, &is_delete, &consumed)) {
+      if (is_delete) {
+        skipped_deletes++;
+        continue;
+      }
+      Schema::ColumnFamily *cf = schema->get_column_family(key_spec.column_family);
+      if (cf == 0)
+        HT_THROWF(Error::RANGESERVER_INVALID_COLUMNFAMILY, "Unknown column "
+                  "family '%s' at line %lld", key_spec.column_family,
+                  (Lld)lds->get_current_lineno());
+
+      String row((const char *)key_spec.row, key_spec.row_len);
+      String qualifier;
+      if (key_spec.column_qualifier)
+        qualifier = String(key_spec.column_qualifier,
+                           key_spec.column_qualifier_len);
+
+      buf.clear();
+      create_key_and_append(buf, FLAG_INSERT, row.c_str(), (uint8_t)cf->id,
+                            qualifier.c_str(),
+                            key_spec.timestamp == AUTO_ASSIGN ? revision
+                            : key_spec.timestamp, revision);
+      size_t key_len = buf.fill();
+      append_as_byte_string(buf, value, value_len);
+
+      uint8_t *ptr = arena.alloc(buf.fill());
+      memcpy(ptr, buf.base, buf.fill());
+      kv.key.ptr = ptr;
+      kv.value.ptr = ptr + key_len;
+      cells.push_back(kv);
+      buffered += buf.fill() + sizeof(KeyValue);
+      total_cells++;
+
+      if (buffered >= memory_limit) {
+        runs.push_back(write_run(cells, staging_dir, runs.size(),
+                                 &table_id, schema, range_locator, timeout,
+                                 counts));
+        cells.clear();
+        arena.free();
+        buffered = 0;
+      }
+    }
+    if (!cells.empty()) {
+      runs.push_back(write_run(cells, staging_dir, runs.size(),
+                               &table_id, schema, range_locator, timeout,
+                               counts));
+      cells.clear();
+      arena.free();
+    }
+
+    if (skipped_deletes)
+      HT_WARNF("Skipped %llu delete records", (Llu)skipped_deletes);
+
+    /**
+     * Merge phase: merge the runs in key order, cutting CellStores at the
+     * range boundaries and handing each range's stores to its server
+     */
+    RunQueue queue;
+    std::vector<RunScanner *> run_scanners;
+    ScanContextPtr scan_ctx = new ScanContext();
+
+    for (size_t i=0; i<runs.size(); i++) {
+      RunScanner *rs = new RunScanner();
+      rs->cellstore = CellStoreFactory::open(runs[i], 0, 0);
+      rs->scanner = rs->cellstore->create_scanner(scan_ctx);
+      run_scanners.push_back(rs);
+      if (rs->scanner->get(rs->key, rs->value))
+        queue.push(rs);
+    }
+
+    RangeServerClient rs_client(Comm::instance(), timeout);
+    RangeWriter writer(&table_id, schema, &rs_client, staging_dir,
+                       counts, total_cells, retries);
+    RangeLocationInfo loc;
+    bool have_range = false;
+
+    while (!queue.empty()) {
+      RunScanner *rs = queue.top();
+      queue.pop();
+
+      if (!have_range || strcmp(rs->key.row, writer.end_row().c_str()) > 0) {
+        if (have_range)
+          writer.finish();
+        Timer timer(timeout, true);
+        range_locator->find_loop(&table_id, rs->key.row, &loc, timer, true);
+        writer.set_range(loc);
+        have_range = true;
+      }
+
+      writer.add(rs->key, rs->value);
+
+      rs->scanner->forward();
+      if (rs->scanner->get(rs->key, rs->value))
+        queue.push(rs);
+    }
+    if (have_range)
+      writer.finish();
+
+    for (size_t i=0; i<run_scanners.size(); i++) {
+      run_scanners[i]->scanner = 0;
+      run_scanners[i]->cellstore = 0;
+      Global::dfs->remove(runs[i]);
+      delete run_scanners[i];
+    }
+
+    cout << "Loaded " << total_cells << " cells into " << table_name << endl;
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    _exit(1);
+  }
+
+  fflush(stdout);
+  _exit(0); // don't bother with static objects
+}